@@ -51,15 +51,14 @@ typedef struct{
 } SerialCommand;
 SerialCommand Command;
 
-typedef struct{
+typedef struct{                         // same layout as SerialFeedback in main.c (without MULTI_MODE_DRIVE and MULTI_BOARD_MASTER)
    uint16_t start;
-   int16_t  cmd1;
-   int16_t  cmd2;
-   int16_t  speedR_meas;
-   int16_t  speedL_meas;
+   int16_t  leftSpeed;
+   int16_t  rightSpeed;
+   uint16_t leftTicks;
+   uint16_t rightTicks;
    int16_t  batVoltage;
    int16_t  boardTemp;
-   uint16_t cmdLed;
    uint16_t checksum;
 } SerialFeedback;
 SerialFeedback Feedback;
@@ -120,8 +119,8 @@ void Receive()
     // Check if we reached the end of the package
     if (idx == sizeof(SerialFeedback)) {
         uint16_t checksum;
-        checksum = (uint16_t)(NewFeedback.start ^ NewFeedback.cmd1 ^ NewFeedback.cmd2 ^ NewFeedback.speedR_meas ^ NewFeedback.speedL_meas
-                            ^ NewFeedback.batVoltage ^ NewFeedback.boardTemp ^ NewFeedback.cmdLed);
+        checksum = (uint16_t)(NewFeedback.start ^ NewFeedback.leftSpeed ^ NewFeedback.rightSpeed ^ NewFeedback.leftTicks ^ NewFeedback.rightTicks
+                            ^ NewFeedback.batVoltage ^ NewFeedback.boardTemp);
 
         // Check validity of the new data
         if (NewFeedback.start == START_FRAME && checksum == NewFeedback.checksum) {
@@ -129,13 +128,12 @@ void Receive()
             memcpy(&Feedback, &NewFeedback, sizeof(SerialFeedback));
 
             // Print data to built-in Serial
-            Serial.print("1: ");   Serial.print(Feedback.cmd1);
-            Serial.print(" 2: ");  Serial.print(Feedback.cmd2);
-            Serial.print(" 3: ");  Serial.print(Feedback.speedR_meas);
-            Serial.print(" 4: ");  Serial.print(Feedback.speedL_meas);
+            Serial.print("1: ");   Serial.print(Feedback.leftSpeed);
+            Serial.print(" 2: ");  Serial.print(Feedback.rightSpeed);
+            Serial.print(" 3: ");  Serial.print(Feedback.leftTicks);
+            Serial.print(" 4: ");  Serial.print(Feedback.rightTicks);
             Serial.print(" 5: ");  Serial.print(Feedback.batVoltage);
-            Serial.print(" 6: ");  Serial.print(Feedback.boardTemp);
-            Serial.print(" 7: ");  Serial.println(Feedback.cmdLed);
+            Serial.print(" 6: ");  Serial.println(Feedback.boardTemp);
         } else {
           Serial.println("Non-valid data skipped");
         }
@@ -0,0 +1,252 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Resident serial bootloader with two application slots, see Inc/boot.h for the flash layout and the protocol.
+// Register level (CMSIS only) to stay within 16 KB: the ports and the flash driver, the slot logic and the commands are in
+// bootcore.c. Build and flash once with: make -C Bootloader && make -C Bootloader flash
+
+#include "stm32f1xx.h"
+#include "bootcore.h"
+
+#ifndef BOARD_VARIANT
+  #define BOARD_VARIANT 0                             // keep in sync with config.h
+#endif
+#if BOARD_VARIANT == 0                                // power latch and power button, see defines.h
+  #define OFF_PORT      GPIOA
+  #define OFF_PIN       5
+  #define BUTTON_PORT   GPIOA
+  #define BUTTON_PIN    1
+#elif BOARD_VARIANT == 1
+  #define OFF_PORT      GPIOC
+  #define OFF_PIN       15
+  #define BUTTON_PORT   GPIOB
+  #define BUTTON_PIN    9
+#endif
+
+#ifndef BOOT_PORTS
+  #define BOOT_PORTS    3                             // bit 0: USART2 (PA2/PA3), bit 1: USART3 (PB10/PB11), set by the Makefile
+#endif
+
+#define BOOT_PCLK1      32000000                      // [Hz] APB1 clock: HSI / 2 * 16 = 64 MHz, APB1 / 2
+
+typedef struct {
+  USART_TypeDef *usart;
+  GPIO_TypeDef  *gpio;
+  uint8_t   txPin;
+  uint8_t   tx;                       // TX pin driven, after the first reply
+  BootRx    rx;
+} BootPort;
+
+static uint8_t flashErase(uint32_t addr, uint32_t size);
+static uint8_t flashProgram(uint32_t addr, const uint8_t *data, uint32_t size);
+
+static volatile uint32_t msTicks;     // [ms] SysTick counter
+static BootPort port[2] = {{.usart = USART2, .gpio = GPIOA, .txPin = 2}, {.usart = USART3, .gpio = GPIOB, .txPin = 10}};
+static BootCore core    = {.flash = (const uint8_t *)BOOT_LOADER_ADDR, .erase = flashErase, .program = flashProgram};
+
+
+/* =========================== Hardware Functions =========================== */
+
+void SysTick_Handler(void) {
+  msTicks++;
+}
+
+static void gpioMode(GPIO_TypeDef *gpio, uint8_t pin, uint32_t mode) {
+  volatile uint32_t *cr = (pin < 8) ? &gpio->CRL : &gpio->CRH;
+  uint8_t shift = (pin & 7) * 4;
+  *cr = (*cr & ~(0xFU << shift)) | (mode << shift);
+}
+
+static void hwInit(void) {
+  RCC->APB2ENR |= RCC_APB2ENR_IOPAEN | RCC_APB2ENR_IOPBEN | RCC_APB2ENR_IOPCEN | RCC_APB2ENR_AFIOEN;
+  OFF_PORT->BSRR = 1U << OFF_PIN;                     // Activate the power latch first, the button may be released any time
+  gpioMode(OFF_PORT, OFF_PIN, 0x2);                   // Output push-pull 2 MHz
+  gpioMode(BUTTON_PORT, BUTTON_PIN, 0x4);             // Input floating
+
+  // HSI / 2 * 16 = 64 MHz, same as the application. APB1 = 32 MHz
+  FLASH->ACR = FLASH_ACR_PRFTBE | FLASH_ACR_LATENCY_1;
+  RCC->CFGR  = RCC_CFGR_PLLMULL16 | RCC_CFGR_PPRE1_DIV2;
+  RCC->CR   |= RCC_CR_PLLON;
+  while (!(RCC->CR & RCC_CR_PLLRDY)) {}
+  RCC->CFGR |= RCC_CFGR_SW_PLL;
+  while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL) {}
+
+  SysTick->LOAD = 64000 - 1;                          // 1 ms
+  SysTick->VAL  = 0;
+  SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+
+  // USART2: TX PA2, RX PA3. USART3: TX PB10, RX PB11. Receiver only: the pins stay floating inputs as after reset,
+  // the application may use them for something else. portSend() takes the TX pin once a host synced on the port
+  RCC->APB1ENR |= RCC_APB1ENR_USART2EN | RCC_APB1ENR_USART3EN | RCC_APB1ENR_PWREN | RCC_APB1ENR_BKPEN;
+  for (uint8_t i = 0; i < 2; i++) {
+    if (BOOT_PORTS & (1U << i)) {
+      port[i].usart->BRR = (BOOT_PCLK1 + BOOT_BAUD / 2) / BOOT_BAUD;
+      port[i].usart->CR1 = USART_CR1_UE | USART_CR1_RE;
+    }
+  }
+}
+
+ /*
+ * Return the peripherals and the clock to their reset state, so the application starts as after a reset
+ */
+static void hwDeInit(void) {
+  SysTick->CTRL = 0;
+  SCB->ICSR     = SCB_ICSR_PENDSTCLR_Msk;
+  RCC->APB1RSTR = RCC_APB1RSTR_USART2RST | RCC_APB1RSTR_USART3RST;
+  RCC->APB1RSTR = 0;
+  for (uint8_t i = 0; i < 2; i++) {
+    if (port[i].tx) {
+      gpioMode(port[i].gpio, port[i].txPin, 0x4);     // Input floating
+    }
+  }
+  PWR->CR      &= ~PWR_CR_DBP;
+  RCC->APB1ENR &= ~(RCC_APB1ENR_USART2EN | RCC_APB1ENR_USART3EN | RCC_APB1ENR_PWREN | RCC_APB1ENR_BKPEN);
+  RCC->CFGR    &= ~RCC_CFGR_SW;                       // Back to HSI, the application configures the PLL again
+  while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_HSI) {}
+  RCC->CR      &= ~RCC_CR_PLLON;
+  RCC->CFGR     = 0;
+  FLASH->ACR    = FLASH_ACR_PRFTBE;                   // The power latch pin keeps its output state
+}
+
+static void bootJump(uint32_t addr) {
+  const uint32_t *vector = (const uint32_t *)addr;
+  hwDeInit();
+  SCB->VTOR = addr;
+  __set_MSP(vector[0]);
+  ((void (*)(void))vector[1])();
+}
+
+ /*
+ * Power off on a fresh press of the power button: the button is usually still held when the bootloader starts
+ */
+static void buttonCheck(void) {
+  static uint8_t  released;
+  static uint32_t pressTime;
+  if (!(BUTTON_PORT->IDR & (1U << BUTTON_PIN))) {
+    released  = 1;
+    pressTime = msTicks;
+  } else if (released && msTicks - pressTime > 100) {
+    OFF_PORT->BRR = 1U << OFF_PIN;                    // Release the power latch
+    while (1) {}
+  }
+}
+
+
+/* =========================== Flash Functions =========================== */
+
+static uint8_t flashWait(void) {
+  while (FLASH->SR & FLASH_SR_BSY) {}
+  uint32_t sr = FLASH->SR;
+  FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR;
+  return (sr & (FLASH_SR_PGERR | FLASH_SR_WRPRTERR)) ? BOOT_ERR_FLASH : BOOT_OK;
+}
+
+static uint8_t flashErase(uint32_t addr, uint32_t size) {
+  uint8_t status = BOOT_OK;
+  FLASH->KEYR = FLASH_KEY1;
+  FLASH->KEYR = FLASH_KEY2;
+  for (uint32_t page = addr; page < addr + size && status == BOOT_OK; page += BOOT_PAGE_SIZE) {
+    FLASH->CR |= FLASH_CR_PER;
+    FLASH->AR  = page;
+    FLASH->CR |= FLASH_CR_STRT;
+    status     = flashWait();
+    FLASH->CR &= ~FLASH_CR_PER;
+  }
+  FLASH->CR |= FLASH_CR_LOCK;
+  return status;
+}
+
+static uint8_t flashProgram(uint32_t addr, const uint8_t *data, uint32_t size) {
+  uint8_t status = BOOT_OK;
+  FLASH->KEYR = FLASH_KEY1;
+  FLASH->KEYR = FLASH_KEY2;
+  FLASH->CR  |= FLASH_CR_PG;
+  for (uint32_t i = 0; i < size && status == BOOT_OK; i += 2) {
+    uint16_t value = data[i] | (data[i + 1] << 8);
+    *(volatile uint16_t *)(addr + i) = value;
+    status = flashWait();
+    if (*(volatile uint16_t *)(addr + i) != value) {
+      status = BOOT_ERR_FLASH;
+    }
+  }
+  FLASH->CR &= ~FLASH_CR_PG;
+  FLASH->CR |= FLASH_CR_LOCK;
+  return status;
+}
+
+
+/* =========================== Port Functions =========================== */
+
+static void portSend(BootPort *p, const uint8_t *data, uint16_t len) {
+  if (!p->tx) {
+    p->tx = 1;
+    gpioMode(p->gpio, p->txPin, 0xB);                 // Alternate function push-pull 50 MHz
+    p->usart->CR1 |= USART_CR1_TE;
+  }
+  for (uint16_t i = 0; i < len; i++) {
+    while (!(p->usart->SR & USART_SR_TXE)) {}
+    p->usart->DR = data[i];
+  }
+  while (!(p->usart->SR & USART_SR_TC)) {}
+}
+
+static void portPoll(BootPort *p) {
+  uint8_t reply[BOOT_REPLY_MAX];
+  if (!(p->usart->SR & (USART_SR_RXNE | USART_SR_ORE))) {
+    return;
+  }
+  uint8_t  byte = (uint8_t)p->usart->DR;              // Reading SR then DR also clears an overrun
+  uint16_t len  = bootRxByte(&core, &p->rx, byte, msTicks, reply);
+  if (len) {
+    portSend(p, reply, len);
+  }
+}
+
+
+/* =========================== Main =========================== */
+
+int main(void) {
+  hwInit();
+  bootCoreInit(&core);
+  if (BKP->DR1 == BOOT_REQ_MAGIC) {                   // Update requested by the application
+    PWR->CR  |= PWR_CR_DBP;
+    BKP->DR1  = 0;
+    core.stay = 1;
+  }
+
+  uint32_t start = msTicks;
+  while (1) {
+    for (uint8_t i = 0; i < 2; i++) {
+      if (BOOT_PORTS & (1U << i)) {
+        portPoll(&port[i]);
+      }
+    }
+    buttonCheck();
+    IWDG->KR = 0xAAAA;                                // Refresh in case the IWDG is started by the option bytes, no effect otherwise
+    if (core.runReq || (!core.stay && msTicks - start > BOOT_WAIT)) {
+      uint8_t slot = bootSlotStart(&core);
+      if (slot == BOOT_NONE) {
+        core.stay   = 1;                              // Nothing to start: wait for an update
+        core.runReq = 0;
+        continue;
+      }
+      bootJump(BOOT_SLOT_ADDR(slot));
+    }
+  }
+}
@@ -0,0 +1,396 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Includes
+#include <stddef.h>
+#include "bootcore.h"
+
+#define META(b, slot)   ((const BootMeta *)&(b)->flash[BOOT_META_ADDR(slot) - BOOT_LOADER_ADDR])
+#define IMAGE(b, slot)  (&(b)->flash[BOOT_SLOT_ADDR(slot) - BOOT_LOADER_ADDR])
+#define PAGE_MASK       (BOOT_PAGE_SIZE - 1)
+
+
+/* =========================== Slot Functions =========================== */
+
+static uint32_t rd32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void wr32(uint8_t *p, uint32_t value) {
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+  p[2] = (uint8_t)(value >> 16);
+  p[3] = (uint8_t)(value >> 24);
+}
+
+// CRC-32 (zlib), bitwise: about 110 ms for a full slot at 64 MHz
+uint32_t bootCrc32(const uint8_t *data, uint32_t len) {
+  uint32_t crc = 0xFFFFFFFF;
+  while (len--) {
+    crc ^= *data++;
+    for (uint8_t k = 0; k < 8; k++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
+
+static uint8_t slotCheck(const BootCore *b, uint8_t slot) {
+  const BootMeta *meta   = META(b, slot);
+  const uint8_t  *vector = IMAGE(b, slot);
+  if (meta->magic != BOOT_META_MAGIC || meta->size < 8 || meta->size > BOOT_SLOT_SIZE) {
+    return 0;
+  }
+  if (rd32(&vector[0]) < BOOT_RAM_ADDR || rd32(&vector[0]) > BOOT_RAM_END) {                    // Initial stack pointer
+    return 0;
+  }
+  if (rd32(&vector[4]) < BOOT_SLOT_ADDR(slot) || rd32(&vector[4]) >= BOOT_SLOT_ADDR(slot) + meta->size) {  // Reset handler
+    return 0;
+  }
+  return bootCrc32(IMAGE(b, slot), meta->size) == meta->crc;
+}
+
+void bootCoreInit(BootCore *b) {
+  for (uint8_t i = 0; i < BOOT_SLOTS; i++) {
+    b->valid[i] = slotCheck(b, i);
+  }
+  b->eraseSlot = BOOT_NONE;
+}
+
+uint8_t bootSlotAttempts(const BootCore *b, uint8_t slot) {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < BOOT_ATTEMPTS; i++) {
+    n += (META(b, slot)->attempt[i] == 0x0000);
+  }
+  return n;
+}
+
+uint8_t bootSlotConfirmed(const BootCore *b, uint8_t slot) {
+  return b->valid[slot] && META(b, slot)->confirmed == 0x0000;
+}
+
+ /*
+ * Slot to boot: the newest image that is confirmed or still has trial boots left
+ */
+uint8_t bootSlotActive(const BootCore *b) {
+  uint8_t active = BOOT_NONE;
+  for (uint8_t i = 0; i < BOOT_SLOTS; i++) {
+    if (b->valid[i] && (bootSlotConfirmed(b, i) || bootSlotAttempts(b, i) < BOOT_ATTEMPTS) &&
+        (active == BOOT_NONE || META(b, i)->seq > META(b, active)->seq)) {
+      active = i;
+    }
+  }
+  return active;
+}
+
+ /*
+ * Slot for an update: never the newest confirmed image, it is the fallback if the update fails
+ */
+uint8_t bootSlotTarget(const BootCore *b) {
+  uint8_t keep = BOOT_NONE;
+  for (uint8_t i = 0; i < BOOT_SLOTS; i++) {
+    if (bootSlotConfirmed(b, i) && (keep == BOOT_NONE || META(b, i)->seq > META(b, keep)->seq)) {
+      keep = i;
+    }
+  }
+  if (keep == BOOT_NONE) {
+    keep = bootSlotActive(b);
+  }
+  return (keep == BOOT_NONE) ? 0 : 1 - keep;
+}
+
+ /*
+ * Slot to start now, BOOT_NONE if there is none. A trial boot of an unconfirmed image is counted first,
+ * the application confirms a good one.
+ */
+uint8_t bootSlotStart(BootCore *b) {
+  uint8_t slot = bootSlotActive(b);
+  if (slot != BOOT_NONE && !bootSlotConfirmed(b, slot)) {
+    static const uint8_t cleared[2] = {0, 0};
+    b->program(BOOT_META_ADDR(slot) + offsetof(BootMeta, attempt) + 2 * bootSlotAttempts(b, slot), cleared, 2);
+  }
+  return slot;
+}
+
+
+/* =========================== Decoder Functions =========================== */
+
+static uint8_t zPut(BootCore *b, uint8_t byte) {
+  if (b->zOut >= b->eraseSize) {
+    return BOOT_ERR_ARG;
+  }
+  b->page[b->zOut & PAGE_MASK] = byte;
+  b->zOut++;
+  if (b->zOut & PAGE_MASK) {
+    return BOOT_OK;
+  }
+  return b->program(BOOT_SLOT_ADDR(b->eraseSlot) + b->zOut - BOOT_PAGE_SIZE, b->page, BOOT_PAGE_SIZE);
+}
+
+// Program the decoded bytes of the last, partial page
+static uint8_t zFlush(BootCore *b) {
+  uint32_t n = b->zOut & PAGE_MASK;
+  if (n & 1) {
+    b->page[n++] = 0xFF;
+  }
+  return n ? b->program(BOOT_SLOT_ADDR(b->eraseSlot) + (b->zOut & ~PAGE_MASK), b->page, n) : BOOT_OK;
+}
+
+static uint8_t zCopy(BootCore *b) {
+  uint8_t n      = (b->zTok & 0x3F) + BOOT_Z_COPY_MIN;
+  uint8_t status = BOOT_OK;
+  if (b->zTok & 0x40) {                               // From the image in the other slot
+    uint8_t base = 1 - b->eraseSlot;
+    if (!b->valid[base]) {
+      return BOOT_ERR_STATE;
+    }
+    if (b->zArg + n > META(b, base)->size) {
+      return BOOT_ERR_ARG;
+    }
+    for (uint8_t i = 0; i < n && status == BOOT_OK; i++) {
+      status = zPut(b, IMAGE(b, base)[b->zArg + i]);
+    }
+    return status;
+  }
+  if (b->zArg == 0 || b->zArg > b->zOut) {           // From the new image, may overlap the bytes it produces
+    return BOOT_ERR_ARG;
+  }
+  for (uint8_t i = 0; i < n && status == BOOT_OK; i++) {
+    uint32_t pos = b->zOut - b->zArg;
+    status = zPut(b, (pos >= (b->zOut & ~PAGE_MASK)) ? b->page[pos & PAGE_MASK] : IMAGE(b, b->eraseSlot)[pos]);
+  }
+  return status;
+}
+
+static uint8_t zDecode(BootCore *b, uint8_t byte) {
+  if (b->zLeft) {
+    b->zLeft--;
+    return zPut(b, byte);
+  }
+  if (b->zNeed) {
+    b->zArg |= (uint32_t)byte << (8 * (((b->zTok & 0x40) ? 3 : 2) - b->zNeed));
+    return (--b->zNeed) ? BOOT_OK : zCopy(b);
+  }
+  b->zTok = byte;
+  b->zArg = 0;
+  if (byte & 0x80) {
+    b->zNeed = (byte & 0x40) ? 3 : 2;
+  } else {
+    b->zLeft = (byte & 0x7F) + 1;
+  }
+  return BOOT_OK;
+}
+
+
+/* =========================== Command Functions =========================== */
+
+static uint8_t cmdSync(BootCore *b, uint8_t *info) {
+  b->stay = 1;
+  info[0] = BOOT_PROTOCOL_VERSION;
+  info[1] = bootSlotActive(b);
+  info[2] = bootSlotTarget(b);
+  for (uint8_t i = 0; i < BOOT_SLOTS; i++) {
+    uint8_t *s = &info[3 + 15 * i];
+    s[0] = b->valid[i];
+    s[1] = bootSlotConfirmed(b, i);
+    s[2] = bootSlotAttempts(b, i);
+    wr32(&s[3],  META(b, i)->seq);
+    wr32(&s[7],  META(b, i)->size);
+    wr32(&s[11], META(b, i)->crc);
+  }
+  return BOOT_INFO_LEN;
+}
+
+static uint8_t cmdErase(BootCore *b, const uint8_t *payload, uint16_t len) {
+  if (len != 5 || payload[0] >= BOOT_SLOTS || rd32(&payload[1]) == 0 || rd32(&payload[1]) > BOOT_SLOT_SIZE) {
+    return BOOT_ERR_ARG;
+  }
+  uint8_t slot = payload[0];
+  if (slot != bootSlotTarget(b)) {
+    return BOOT_ERR_STATE;
+  }
+  b->eraseSlot   = BOOT_NONE;
+  b->valid[slot] = 0;
+  uint8_t status = b->erase(BOOT_META_ADDR(slot), BOOT_PAGE_SIZE);    // Meta page first: an interrupted update leaves an invalid slot
+  if (status == BOOT_OK) {
+    status = b->erase(BOOT_SLOT_ADDR(slot), rd32(&payload[1]));
+  }
+  if (status == BOOT_OK) {
+    b->eraseSlot = slot;
+    b->eraseSize = (rd32(&payload[1]) + 1) & ~1U;      // The last half-word of an odd size image is padded
+    b->zIn       = 0;
+    b->zOut      = 0;
+    b->zLeft     = 0;
+    b->zNeed     = 0;
+  }
+  return status;
+}
+
+static uint8_t cmdWrite(BootCore *b, const uint8_t *payload, uint16_t len) {
+  if (b->eraseSlot == BOOT_NONE) {
+    return BOOT_ERR_STATE;
+  }
+  uint32_t offset = rd32(payload);
+  if (len < 6 || (len & 1) || (offset & 1) || offset > b->eraseSize || len - 4U > b->eraseSize - offset) {
+    return BOOT_ERR_ARG;
+  }
+  return b->program(BOOT_SLOT_ADDR(b->eraseSlot) + offset, &payload[4], len - 4);
+}
+
+static uint8_t cmdWriteZ(BootCore *b, const uint8_t *payload, uint16_t len) {
+  if (b->eraseSlot == BOOT_NONE) {
+    return BOOT_ERR_STATE;
+  }
+  uint8_t status = (len < 5 || rd32(payload) != b->zIn) ? BOOT_ERR_ARG : BOOT_OK;   // Also a lost or repeated frame
+  for (uint16_t i = 4; i < len && status == BOOT_OK; i++) {
+    status = zDecode(b, payload[i]);
+  }
+  if (status == BOOT_OK) {
+    b->zIn += len - 4;
+  } else {
+    b->eraseSlot = BOOT_NONE;                         // The stream is broken: the update starts over with BOOT_CMD_ERASE
+  }
+  return status;
+}
+
+static uint8_t cmdCommit(BootCore *b, const uint8_t *payload, uint16_t len) {
+  if (b->eraseSlot == BOOT_NONE) {
+    return BOOT_ERR_STATE;
+  }
+  if (len != 8 || rd32(payload) > b->eraseSize) {
+    return BOOT_ERR_ARG;
+  }
+  uint8_t  slot   = b->eraseSlot;
+  uint32_t size   = rd32(payload);
+  uint32_t crc    = rd32(&payload[4]);
+  uint8_t  status = zFlush(b);
+  b->eraseSlot    = BOOT_NONE;
+  if (status != BOOT_OK) {
+    return status;
+  }
+  if (bootCrc32(IMAGE(b, slot), size) != crc) {
+    return BOOT_ERR_VERIFY;
+  }
+  uint32_t seq = 0;
+  for (uint8_t i = 0; i < BOOT_SLOTS; i++) {
+    if (META(b, i)->magic == BOOT_META_MAGIC && META(b, i)->seq > seq) {
+      seq = META(b, i)->seq;
+    }
+  }
+  uint8_t record[16];
+  wr32(&record[0],  BOOT_META_MAGIC);
+  wr32(&record[4],  seq + 1);
+  wr32(&record[8],  size);
+  wr32(&record[12], crc);
+  status = b->program(BOOT_META_ADDR(slot) + 4, &record[4], 12);        // Magic last: the record only counts when complete
+  if (status == BOOT_OK) {
+    status = b->program(BOOT_META_ADDR(slot), record, 4);
+  }
+  b->valid[slot] = slotCheck(b, slot);
+  if (status == BOOT_OK && !b->valid[slot]) {
+    status = BOOT_ERR_VERIFY;                         // CRC fine but the vector table does not belong to this slot
+  }
+  return status;
+}
+
+
+/* =========================== Protocol Functions =========================== */
+
+uint16_t bootCrc16(const uint8_t *data, uint32_t len) {
+  uint16_t crc = 0xFFFF;
+  while (len--) {
+    crc ^= (uint16_t)(*data++) << 8;
+    for (uint8_t k = 0; k < 8; k++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+static uint16_t replyFrame(uint8_t *frame, uint8_t cmd, uint8_t status, const uint8_t *data, uint16_t len) {
+  frame[0] = BOOT_SOF;
+  frame[1] = cmd | BOOT_REPLY;
+  frame[2] = (uint8_t)(len + 1);
+  frame[3] = (uint8_t)((len + 1) >> 8);
+  frame[4] = status;
+  for (uint16_t i = 0; i < len; i++) {
+    frame[5 + i] = data[i];
+  }
+  uint16_t crc = bootCrc16(&frame[1], 4 + len);
+  frame[5 + len] = (uint8_t)crc;
+  frame[6 + len] = (uint8_t)(crc >> 8);
+  return 7 + len;
+}
+
+static uint16_t frameProcess(BootCore *b, BootRx *rx, uint8_t *reply) {
+  uint8_t  cmd     = rx->buf[0];
+  uint16_t len     = rx->buf[1] | (rx->buf[2] << 8);
+  uint8_t *payload = &rx->buf[3];
+  uint8_t  info[BOOT_INFO_LEN];
+  uint8_t  infoLen = 0;
+  uint8_t  status;
+
+  if (bootCrc16(rx->buf, 3 + len) != (payload[len] | (payload[len + 1] << 8))) {
+    return rx->synced ? replyFrame(reply, cmd, BOOT_ERR_FRAME, NULL, 0) : 0;
+  }
+  if (!rx->synced && cmd != BOOT_CMD_SYNC) {
+    return 0;                                         // Not a bootloader host, e.g. the normal traffic of an attached device
+  }
+  switch (cmd) {
+    case BOOT_CMD_SYNC:    infoLen    = cmdSync(b, info);
+                           rx->synced = 1;
+                           status     = BOOT_OK;                    break;
+    case BOOT_CMD_ERASE:   status     = cmdErase(b, payload, len);  break;
+    case BOOT_CMD_WRITE:   status     = cmdWrite(b, payload, len);  break;
+    case BOOT_CMD_WRITE_Z: status     = cmdWriteZ(b, payload, len); break;
+    case BOOT_CMD_COMMIT:  status     = cmdCommit(b, payload, len); break;
+    case BOOT_CMD_RUN:     status     = (bootSlotActive(b) != BOOT_NONE) ? BOOT_OK : BOOT_ERR_STATE;
+                           b->runReq  = (status == BOOT_OK);        break;
+    default:               status     = BOOT_ERR_CMD;               break;
+  }
+  return replyFrame(reply, cmd, status, info, infoLen);
+}
+
+ /*
+ * Feed one received byte at time now [ms]. Returns the length of the reply frame in reply (BOOT_REPLY_MAX bytes),
+ * 0 if there is nothing to send. Until a BOOT_CMD_SYNC arrived only that command is answered.
+ */
+uint16_t bootRxByte(BootCore *b, BootRx *rx, uint8_t byte, uint32_t now, uint8_t *reply) {
+  if (rx->idx && now - rx->time > BOOT_BYTE_GAP) {
+    rx->idx = 0;                                      // Drop an incomplete frame
+  }
+  rx->time = now;
+  if (rx->idx == 0) {
+    rx->idx = (byte == BOOT_SOF);
+    return 0;
+  }
+  rx->buf[rx->idx - 1] = byte;
+  rx->idx++;
+  if (rx->idx < 4) {
+    return 0;
+  }
+  uint16_t len = rx->buf[1] | (rx->buf[2] << 8);
+  if (len > 4 + BOOT_CHUNK_MAX) {
+    rx->idx = 0;
+  } else if (rx->idx == 1 + 3 + len + 2) {
+    rx->idx = 0;
+    return frameProcess(b, rx, reply);
+  }
+  return 0;
+}
@@ -0,0 +1,73 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Slot selection, update commands and frame parser of the serial bootloader. No hardware access: Bootloader/boot.c
+// adds the flash driver and the ports, tools/hostcheck runs the same code on a simulated flash image.
+
+// Define to prevent recursive inclusion
+#ifndef BOOTCORE_H
+#define BOOTCORE_H
+
+#include <stdint.h>
+#include "boot.h"
+
+#define BOOT_NONE       0xFF                          // no slot
+#define BOOT_RAM_ADDR   0x20000000
+#define BOOT_RAM_END    (BOOT_RAM_ADDR + 48 * 1024)
+#define BOOT_FRAME_MAX  (3 + 4 + BOOT_CHUNK_MAX + 2)  // cmd, len, WRITE offset and data, crc
+#define BOOT_INFO_LEN   (3 + 15 * BOOT_SLOTS)         // BOOT_CMD_SYNC reply data
+#define BOOT_REPLY_MAX  (7 + BOOT_INFO_LEN)
+#define BOOT_BYTE_GAP   100                           // [ms] a frame with a longer pause between bytes is dropped
+
+typedef struct {
+  const uint8_t *flash;               // flash contents from BOOT_LOADER_ADDR on, memory mapped on the target
+  uint8_t (*erase)(uint32_t addr, uint32_t size);                         // whole pages, BOOT_OK or BOOT_ERR_FLASH
+  uint8_t (*program)(uint32_t addr, const uint8_t *data, uint32_t size);  // even size, BOOT_OK or BOOT_ERR_FLASH
+  uint8_t   valid[BOOT_SLOTS];        // meta record complete, vectors plausible and image CRC correct
+  uint8_t   eraseSlot;                // slot erased by BOOT_CMD_ERASE and not yet committed
+  uint32_t  eraseSize;                // [bytes] image size announced by BOOT_CMD_ERASE, rounded up to even
+  uint8_t   stay;                     // stay in the bootloader: boot request, host in sync or no usable image
+  uint8_t   runReq;                   // BOOT_CMD_RUN received
+  uint32_t  zIn;                      // [bytes] BOOT_CMD_WRITE_Z data received
+  uint32_t  zOut;                     // [bytes] decoded image
+  uint8_t   zTok;                     // token of the current literal or copy
+  uint8_t   zLeft;                    // literal bytes still to come
+  uint8_t   zNeed;                    // copy argument bytes still to come
+  uint32_t  zArg;                     // copy argument
+  uint8_t   page[BOOT_PAGE_SIZE];     // decoded bytes of the page not yet programmed
+} BootCore;
+
+typedef struct {
+  uint16_t  idx;                      // bytes received after the start of frame, 0 = waiting for BOOT_SOF
+  uint32_t  time;                     // [ms] time of the last received byte
+  uint8_t   synced;                   // BOOT_CMD_SYNC received: the port may be answered
+  uint8_t   buf[BOOT_FRAME_MAX];      // cmd, len, payload, crc
+} BootRx;
+
+void     bootCoreInit(BootCore *b);
+uint8_t  bootSlotConfirmed(const BootCore *b, uint8_t slot);
+uint8_t  bootSlotAttempts(const BootCore *b, uint8_t slot);
+uint8_t  bootSlotActive(const BootCore *b);
+uint8_t  bootSlotTarget(const BootCore *b);
+uint8_t  bootSlotStart(BootCore *b);
+uint16_t bootRxByte(BootCore *b, BootRx *rx, uint8_t byte, uint32_t now, uint8_t *reply);
+uint32_t bootCrc32(const uint8_t *data, uint32_t len);
+uint16_t bootCrc16(const uint8_t *data, uint32_t len);
+
+#endif
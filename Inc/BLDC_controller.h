@@ -200,36 +200,10 @@ typedef struct {
    * Referenced by: '<S11>/vec_hallToPos'
    */
   int8_T vec_hallToPos_Value[8];
-} ConstP;
-
-/* External inputs (root inport signals with auto storage) */
-typedef struct {
-  boolean_T b_motEna;                  /* '<Root>/b_motEna' */
-  uint8_T z_ctrlModReq;                /* '<Root>/z_ctrlModReq' */
-  int16_T r_inpTgt;                    /* '<Root>/r_inpTgt' */
-  uint8_T b_hallA;                     /* '<Root>/b_hallA ' */
-  uint8_T b_hallB;                     /* '<Root>/b_hallB' */
-  uint8_T b_hallC;                     /* '<Root>/b_hallC' */
-  int16_T i_phaAB;                     /* '<Root>/i_phaAB' */
-  int16_T i_phaBC;                     /* '<Root>/i_phaBC' */
-  int16_T i_DCLink;                    /* '<Root>/i_DCLink' */
-  int16_T a_mechAngle;                 /* '<Root>/a_mechAngle' */
-} ExtU;
-
-/* External outputs (root outports fed by signals with auto storage) */
-typedef struct {
-  int16_T DC_phaA;                     /* '<Root>/DC_phaA' */
-  int16_T DC_phaB;                     /* '<Root>/DC_phaB' */
-  int16_T DC_phaC;                     /* '<Root>/DC_phaC' */
-  uint8_T z_errCode;                   /* '<Root>/z_errCode' */
-  int16_T n_mot;                       /* '<Root>/n_mot' */
-  int16_T a_elecAngle;                 /* '<Root>/a_elecAngle' */
-  int16_T iq;                          /* '<Root>/iq' */
-  int16_T id;                          /* '<Root>/id' */
-} ExtY;
 
-/* Parameters (auto storage) */
-struct P_ {
+  /* Parameters below are not tuned at runtime: kept in flash and shared by
+   * both motors instead of in the per-motor P (post-processed, not generated)
+   */
   int32_T dV_openRate;                 /* Variable: dV_openRate
                                         * Referenced by: '<S37>/dV_openRate'
                                         */
@@ -239,9 +213,6 @@ struct P_ {
   int16_T dz_cntTrnsDetLo;             /* Variable: dz_cntTrnsDetLo
                                         * Referenced by: '<S17>/dz_cntTrnsDet'
                                         */
-  int16_T n_cruiseMotTgt;              /* Variable: n_cruiseMotTgt
-                                        * Referenced by: '<S61>/n_cruiseMotTgt'
-                                        */
   int16_T z_maxCntRst;                 /* Variable: z_maxCntRst
                                         * Referenced by:
                                         *   '<S13>/Counter'
@@ -270,17 +241,6 @@ struct P_ {
   int16_T Vq_max_XA[46];               /* Variable: Vq_max_XA
                                         * Referenced by: '<S80>/Vq_max_XA'
                                         */
-  int16_T a_phaAdvMax;                 /* Variable: a_phaAdvMax
-                                        * Referenced by: '<S42>/a_phaAdvMax'
-                                        */
-  int16_T i_max;                       /* Variable: i_max
-                                        * Referenced by:
-                                        *   '<S36>/i_max'
-                                        *   '<S80>/i_max'
-                                        */
-  int16_T id_fieldWeakMax;             /* Variable: id_fieldWeakMax
-                                        * Referenced by: '<S42>/id_fieldWeakMax'
-                                        */
   int16_T n_commAcvLo;                 /* Variable: n_commAcvLo
                                         * Referenced by: '<S13>/n_commDeacv'
                                         */
@@ -293,23 +253,12 @@ struct P_ {
   int16_T n_fieldWeakAuthLo;           /* Variable: n_fieldWeakAuthLo
                                         * Referenced by: '<S42>/n_fieldWeakAuthLo'
                                         */
-  int16_T n_max;                       /* Variable: n_max
-                                        * Referenced by:
-                                        *   '<S36>/n_max'
-                                        *   '<S80>/n_max1'
-                                        */
   int16_T n_stdStillDet;               /* Variable: n_stdStillDet
                                         * Referenced by: '<S13>/n_stdStillDet'
                                         */
   int16_T r_errInpTgtThres;            /* Variable: r_errInpTgtThres
                                         * Referenced by: '<S20>/r_errInpTgtThres'
                                         */
-  int16_T r_fieldWeakHi;               /* Variable: r_fieldWeakHi
-                                        * Referenced by: '<S42>/r_fieldWeakHi'
-                                        */
-  int16_T r_fieldWeakLo;               /* Variable: r_fieldWeakLo
-                                        * Referenced by: '<S42>/r_fieldWeakLo'
-                                        */
   uint16_T cf_KbLimProt;               /* Variable: cf_KbLimProt
                                         * Referenced by:
                                         *   '<S82>/cf_KbLimProt'
@@ -349,6 +298,61 @@ struct P_ {
   uint8_T n_polePairs;                 /* Variable: n_polePairs
                                         * Referenced by: '<S15>/n_polePairs'
                                         */
+} ConstP;
+
+/* External inputs (root inport signals with auto storage) */
+typedef struct {
+  boolean_T b_motEna;                  /* '<Root>/b_motEna' */
+  uint8_T z_ctrlModReq;                /* '<Root>/z_ctrlModReq' */
+  int16_T r_inpTgt;                    /* '<Root>/r_inpTgt' */
+  uint8_T b_hallA;                     /* '<Root>/b_hallA ' */
+  uint8_T b_hallB;                     /* '<Root>/b_hallB' */
+  uint8_T b_hallC;                     /* '<Root>/b_hallC' */
+  int16_T i_phaAB;                     /* '<Root>/i_phaAB' */
+  int16_T i_phaBC;                     /* '<Root>/i_phaBC' */
+  int16_T i_DCLink;                    /* '<Root>/i_DCLink' */
+  int16_T a_mechAngle;                 /* '<Root>/a_mechAngle' */
+} ExtU;
+
+/* External outputs (root outports fed by signals with auto storage) */
+typedef struct {
+  int16_T DC_phaA;                     /* '<Root>/DC_phaA' */
+  int16_T DC_phaB;                     /* '<Root>/DC_phaB' */
+  int16_T DC_phaC;                     /* '<Root>/DC_phaC' */
+  uint8_T z_errCode;                   /* '<Root>/z_errCode' */
+  int16_T n_mot;                       /* '<Root>/n_mot' */
+  int16_T a_elecAngle;                 /* '<Root>/a_elecAngle' */
+  int16_T iq;                          /* '<Root>/iq' */
+  int16_T id;                          /* '<Root>/id' */
+} ExtY;
+
+/* Parameters (auto storage) */
+struct P_ {
+  int16_T n_cruiseMotTgt;              /* Variable: n_cruiseMotTgt
+                                        * Referenced by: '<S61>/n_cruiseMotTgt'
+                                        */
+  int16_T a_phaAdvMax;                 /* Variable: a_phaAdvMax
+                                        * Referenced by: '<S42>/a_phaAdvMax'
+                                        */
+  int16_T i_max;                       /* Variable: i_max
+                                        * Referenced by:
+                                        *   '<S36>/i_max'
+                                        *   '<S80>/i_max'
+                                        */
+  int16_T id_fieldWeakMax;             /* Variable: id_fieldWeakMax
+                                        * Referenced by: '<S42>/id_fieldWeakMax'
+                                        */
+  int16_T n_max;                       /* Variable: n_max
+                                        * Referenced by:
+                                        *   '<S36>/n_max'
+                                        *   '<S80>/n_max1'
+                                        */
+  int16_T r_fieldWeakHi;               /* Variable: r_fieldWeakHi
+                                        * Referenced by: '<S42>/r_fieldWeakHi'
+                                        */
+  int16_T r_fieldWeakLo;               /* Variable: r_fieldWeakLo
+                                        * Referenced by: '<S42>/r_fieldWeakLo'
+                                        */
   uint8_T z_ctrlTypSel;                /* Variable: z_ctrlTypSel
                                         * Referenced by: '<S1>/z_ctrlTypSel'
                                         */
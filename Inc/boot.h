@@ -0,0 +1,112 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Shared between the serial bootloader (Bootloader/boot.c) and the application built for a boot slot (make SLOT=A/B)
+
+// Define to prevent recursive inclusion
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <stdint.h>
+
+// ############################### FLASH LAYOUT ###############################
+// The whole 256 KB are used. The slot builds keep their EEPROM emulation pages below the slots (see eeprom.h),
+// so the saved parameters survive an update. A board flashed by ST-Link without the bootloader keeps them at
+// 0x08010000: they are reset once when changing to the bootloader. Keep the slot addresses in sync with the
+// SLOT build in the Makefile and the slot envs in platformio.ini.
+//
+// 0x08000000  bootloader           16 KB
+// 0x08004000  slot A meta page      2 KB
+// 0x08004800  slot B meta page      2 KB
+// 0x08005000  EEPROM page 0         2 KB
+// 0x08005800  EEPROM page 1         2 KB
+// 0x08006000  slot A              116 KB
+// 0x08023000  slot B              116 KB
+#define BOOT_PAGE_SIZE        0x800                 // [bytes] flash page size of the STM32F103xE
+#define BOOT_LOADER_ADDR      0x08000000
+#define BOOT_META_A_ADDR      0x08004000
+#define BOOT_META_B_ADDR      0x08004800
+#define BOOT_EEPROM_ADDR      0x08005000
+#define BOOT_SLOT_A_ADDR      0x08006000
+#define BOOT_SLOT_B_ADDR      0x08023000
+#define BOOT_SLOT_SIZE        0x1D000               // [bytes] 116 KB per slot
+#define BOOT_SLOTS            2
+#define BOOT_META_ADDR(slot)  (BOOT_META_A_ADDR + (slot) * (uint32_t)BOOT_PAGE_SIZE)
+#define BOOT_SLOT_ADDR(slot)  (BOOT_SLOT_A_ADDR + (slot) * (uint32_t)BOOT_SLOT_SIZE)
+
+// ############################### BOOT STATE ###############################
+// One meta record per slot, at the start of the slot meta page. The bootloader writes it after the image CRC
+// was verified (magic last), then burns one attempt half-word per trial boot. The application clears 'confirmed'
+// after running healthy for BOOT_CONFIRM_TIME. An image not confirmed within BOOT_ATTEMPTS boots is skipped and
+// the other slot boots again (rollback). Half-words are only ever programmed from 0xFFFF to 0x0000, no erase needed.
+#define BOOT_META_MAGIC       0xB0075107            // marks a complete meta record
+#define BOOT_ATTEMPTS         3                     // trial boots of a new image before rolling back
+#define BOOT_CONFIRM_TIME     10                    // [s] healthy running time before the application confirms the image
+typedef struct {
+  uint32_t  magic;                    // BOOT_META_MAGIC once the record is complete
+  uint32_t  seq;                      // image sequence number: the usable image with the highest number boots
+  uint32_t  size;                     // [bytes] image size
+  uint32_t  crc;                      // CRC-32 of the image, checked at every boot
+  uint16_t  attempt[BOOT_ATTEMPTS];   // 0x0000 for each trial boot started by the bootloader
+  uint16_t  confirmed;                // 0x0000 once the application confirmed a good boot
+} BootMeta;
+
+// Boot request: the application writes BOOT_REQ_MAGIC to the backup register BKP_DR1 and resets,
+// the bootloader then waits for an update instead of starting the application
+#define BOOT_REQ_MAGIC        0xB007
+
+// ############################### SERIAL PROTOCOL ###############################
+// The bootloader listens on USART2 and USART3 (8N1, BOOT_BAUD, ports selected by BOOT_PORTS in Bootloader/Makefile)
+// with the RX pins left floating as after reset. The TX pin of a port is only driven after a BOOT_CMD_SYNC
+// arrived on it, other frames are ignored until then. Replies go to the port a frame came from.
+// Frame: sof(u8) cmd(u8) len(u16) payload(len bytes) crc(u16), little endian, CRC-16/CCITT-FALSE over cmd..payload.
+// Reply: sof, cmd | BOOT_REPLY, len, status(u8) + data, crc.
+#define BOOT_BAUD             460800                // [bit/s] 64 MHz / 2 / 460800 = 69.4 -> 0.6 % baud error
+#define BOOT_WAIT             300                   // [ms] time after reset to wait for a BOOT_CMD_SYNC before starting the application
+#define BOOT_SOF              0xA5
+#define BOOT_REPLY            0x80
+#define BOOT_CHUNK_MAX        1024                  // [bytes] max WRITE / WRITE_Z data per frame
+#define BOOT_PROTOCOL_VERSION 2
+
+#define BOOT_CMD_SYNC         0x01  // -> version(u8) active(u8) target(u8) {valid(u8) confirmed(u8) attempts(u8) seq(u32) size(u32) crc(u32)} * 2
+#define BOOT_CMD_ERASE        0x02  // slot(u8) size(u32): erase the meta page and the image area of the target slot
+#define BOOT_CMD_WRITE        0x03  // offset(u32) data: program the erased slot, offset and length even
+#define BOOT_CMD_COMMIT       0x04  // size(u32) crc(u32): verify the slot and write its meta record
+#define BOOT_CMD_RUN          0x05  // leave the bootloader and start the selected image
+#define BOOT_CMD_WRITE_Z      0x06  // offset(u32) data: next part of the compressed image, offset counts the compressed bytes
+
+// Compressed image for BOOT_CMD_WRITE_Z, decoded from slot offset 0 on. LZ77 with the image written so far as
+// window and the image in the other slot as delta base: an update of a similar build mostly copies from there.
+// A copy is limited to BOOT_Z_COPY_MAX bytes.
+//   0lllllll              literal: l + 1 bytes follow
+//   10llllll dist(u16)    copy l + 3 bytes from dist bytes back in the new image
+//   11llllll offset(u24)  copy l + 3 bytes from the image in the other slot, which has to be valid
+#define BOOT_Z_LITERAL_MAX    128
+#define BOOT_Z_COPY_MIN       3
+#define BOOT_Z_COPY_MAX       66
+
+#define BOOT_OK               0
+#define BOOT_ERR_FRAME        1     // frame CRC or length error
+#define BOOT_ERR_ARG          2     // invalid slot, offset or size
+#define BOOT_ERR_STATE        3     // slot not erased, the slot holds the confirmed fallback image, or no delta base
+#define BOOT_ERR_FLASH        4     // flash erase or program failed
+#define BOOT_ERR_VERIFY       5     // image CRC mismatch
+#define BOOT_ERR_CMD          6     // unknown command
+
+#endif
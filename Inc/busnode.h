@@ -0,0 +1,52 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Node of the addressed multi-drop bus (SERIAL_BUS): the Rx rules of usart3_rx_check() and usart_process_command()
+// and the reply rule of busReplySend(). No HAL dependency: tools/hoverserial (hoverbench bus) runs one instance per
+// node against the host BusMaster on a simulated line.
+
+// Define to prevent recursive inclusion
+#ifndef BUSNODE_H
+#define BUSNODE_H
+
+#include <stdint.h>
+
+#define BUS_CMD_START_FRAME  0xABCD    // start word of the commands, same as SERIAL_START_FRAME
+#define BUS_ADDR_BROADCAST   0         // address of the commands for all nodes, never answered
+
+enum {                              // busCommandRx() result
+  BUS_RX_INVALID,                   // wrong start word or checksum
+  BUS_RX_OTHER,                     // valid, for another node
+  BUS_RX_BROADCAST,                 // valid, for all nodes: apply, no reply
+  BUS_RX_OWN                        // valid, for this node: apply and reply
+};
+
+typedef struct{
+  uint16_t  own;                    // valid commands addressed to this node
+  uint16_t  broadcast;              // valid broadcast commands
+  uint16_t  other;                  // valid commands for other nodes
+  uint16_t  reply;                  // replies sent
+  uint16_t  busy;                   // polls not answered: previous reply still in transmission or none ready yet
+} BusStats;
+
+uint8_t  busRxBurst(const uint8_t *ring, uint32_t ringLen, uint32_t oldPos, uint32_t pos, void *frame, uint32_t len);
+uint8_t  busCommandRx(const void *frame, uint32_t len, uint8_t node, BusStats *stats);
+uint8_t  busReplyReady(uint16_t replyLen, uint8_t txReady, BusStats *stats);
+
+#endif  // BUSNODE_H
@@ -54,6 +54,9 @@ int8_t initParamVal(uint8_t index);
 int8_t incrParamVal(uint8_t index);
 
 int8_t saveAllParamVal();
+int8_t exportParamBlob();
+int8_t enterBootloader();
+int8_t importParamBlob();
 int16_t getParamInitInt(uint8_t index);
 int32_t getParamInitExt(uint8_t index);
 int8_t printCommandHelp(uint8_t index);
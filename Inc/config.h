@@ -28,13 +28,12 @@
 #define PWM_FREQ            16000     // PWM frequency in Hz / is also used for buzzer
 #define DEAD_TIME              48     // PWM deadtime
 #ifdef VARIANT_TRANSPOTTER
-  #define DELAY_IN_MAIN_LOOP    2
+  #define DELAY_IN_MAIN_LOOP    1
 #else
   #define DELAY_IN_MAIN_LOOP    5     // in ms. default 5. it is independent of all the timing critical stuff. do not touch if you do not know what you are doing.
 #endif
-#define TIMEOUT                20     // number of wrong / missing input commands before emergency off
+#define TIMEOUT                (100 / DELAY_IN_MAIN_LOOP)  // number of wrong / missing input commands (main loops) before emergency off: 100 ms
 #define A2BIT_CONV             50     // A to bit for current conversion on ADC. Example: 1 A = 50, 2 A = 100, etc
-// #define PRINTF_FLOAT_SUPPORT          // [-] Uncomment this for printf to support float on Serial Debug. It will increase code size! Better to avoid it!
 
 // ADC conversion time definitions
 #define ADC_CONV_TIME_1C5       (14)  //Total ADC clock cycles / conversion = (  1.5+12.5)
@@ -79,7 +78,7 @@
 #define BAT_LVL2_ENABLE         0         // to beep or not to beep, 1 or 0
 #define BAT_LVL1_ENABLE         1         // to beep or not to beep, 1 or 0
 #define BAT_DEAD_ENABLE         1         // to poweroff or not to poweroff, 1 or 0
-#define BAT_BLINK_INTERVAL      80        // battery led blink interval (80 loops * 5ms ~= 400ms)
+#define BAT_BLINK_INTERVAL      (400 / DELAY_IN_MAIN_LOOP)   // battery led blink interval in main loops: 400 ms
 #define BAT_LVL5                (390 * BAT_CELLS * BAT_CALIB_ADC) / BAT_CALIB_REAL_VOLTAGE    // Green blink:  no beep
 #define BAT_LVL4                (380 * BAT_CELLS * BAT_CALIB_ADC) / BAT_CALIB_REAL_VOLTAGE    // Yellow:       no beep
 #define BAT_LVL3                (370 * BAT_CELLS * BAT_CALIB_ADC) / BAT_CALIB_REAL_VOLTAGE    // Yellow blink: no beep 
@@ -99,7 +98,7 @@
  * Write debug output value 8 to TEMP_CAL_LOW_ADC. drive around to warm up the board. it should be at least 20°C warmer. repeat it for the HIGH-values.
  * Enable warning and/or poweroff and make and flash firmware.
 */
-#define TEMP_FILT_COEF          655       // temperature filter coefficient in fixed-point. coef_fixedPoint = coef_floatingPoint * 2^16. In this case 655 = 0.01 * 2^16
+#define TEMP_FILT_COEF          655       // temperature filter coefficient in fixed-point per 5 ms of main loop (scaled with DELAY_IN_MAIN_LOOP). coef_fixedPoint = coef_floatingPoint * 2^16. In this case 655 = 0.01 * 2^16
 #define TEMP_CAL_LOW_ADC        1655      // temperature 1: ADC value
 #define TEMP_CAL_LOW_DEG_C      358       // temperature 1: measured temperature [°C * 10]. Here 35.8 °C
 #define TEMP_CAL_HIGH_ADC       1588      // temperature 2: ADC value
@@ -148,6 +147,7 @@
 
 // Control selections
 #define CTRL_TYP_SEL    FOC_CTRL        // [-] Control type selection: COM_CTRL, SIN_CTRL, FOC_CTRL (default)
+// #define CTRL_TYP_FIXED                  // [-] Build the motor controller for CTRL_TYP_SEL only: the other control types are removed from the step (less flash and cycles, see make bench in tools/motorsim). Control type changes at runtime (debug protocol, sideboard) are ignored.
 #define CTRL_MOD_REQ    VLT_MODE        // [-] Control mode request: OPEN_MODE, VLT_MODE (default), SPD_MODE, TRQ_MODE. Note: SPD_MODE and TRQ_MODE are only available for CTRL_FOC!
 #define DIAG_ENA        1               // [-] Motor Diagnostics enable flag: 0 = Disabled, 1 = Enabled (default)
 
@@ -163,11 +163,51 @@
 #define FIELD_WEAK_HI   1000            // (1000, 1500] Input target High threshold for reaching maximum Field Weakening / Phase Advance. Do NOT set this higher than 1500.
 #define FIELD_WEAK_LO   750             // ( 500, 1000] Input target Low threshold for starting Field Weakening / Phase Advance. Do NOT set this higher than 1000.
 
+// Control Type Scheduler
+// #define CTRL_SCHED_ENABLE               // [-] Pick the control type by operating point in VOLTAGE mode: speed bands below, the low band type at high load. Switches keep the phase voltage (bumpless). Other control modes use FOC. Replaces CTRL_TYP_SEL and the control type selection of the sideboard and the debug protocol. Check the settings with tools/motorsim.
+#define CTRL_SCHED_TYP_LO     FOC_CTRL  // [-] Control type below CTRL_SCHED_N_MID and above CTRL_SCHED_I_HI
+#define CTRL_SCHED_TYP_MID    FOC_CTRL  // [-] Control type between CTRL_SCHED_N_MID and CTRL_SCHED_N_HI
+#define CTRL_SCHED_TYP_HI     COM_CTRL  // [-] Control type above CTRL_SCHED_N_HI. Note: SIN and COM do not limit the speed to N_MOT_MAX
+#define CTRL_SCHED_N_MID      150       // [rpm] Speed between the low and the mid band
+#define CTRL_SCHED_N_HI       230       // [rpm] Speed between the mid and the high band. Keep it below N_MOT_MAX, FOC does not go faster
+#define CTRL_SCHED_N_HYST     30        // [rpm] Hysteresis around CTRL_SCHED_N_MID and CTRL_SCHED_N_HI
+#define CTRL_SCHED_I_HI       8         // [A] DC link current above which the low band type is used (FOC current limitation), released at 3/4 of it
+#define CTRL_SCHED_DWELL      1000      // [ms] Minimum time between two control type switches
+#define CTRL_SCHED_BLEND_TIME 500       // [ms] Time to blend the input target gain back to 1.0 after a switch
+
 // Extra functionality
 // #define STANDSTILL_HOLD_ENABLE          // [-] Flag to hold the position when standtill is reached. Only available and makes sense for VOLTAGE or TORQUE mode.
 // #define ELECTRIC_BRAKE_ENABLE           // [-] Flag to enable electric brake and replace the motor "freewheel" with a constant braking when the input torque request is 0. Only available and makes sense for TORQUE mode.
 // #define ELECTRIC_BRAKE_MAX    100       // (0, 500) Maximum electric brake to be applied when input torque request is 0 (pedal fully released).
 // #define ELECTRIC_BRAKE_THRES  120       // (0, 500) Threshold below at which the electric brake starts engaging.
+// #define TIMEOUT_FAILSAFE_ENABLE         // [-] Flag to replace the immediate OPEN_MODE on input timeout by: hold the last command, brake to standstill, then OPEN_MODE.
+// #define FAILSAFE_HOLD_TIME    200       // [ms] Time to hold the last valid command after the timeout is detected
+// #define FAILSAFE_RATE         80        // [-] fixdt(1,16,4) Command ramp-down rate to 0 during braking in VOLTAGE and SPEED mode. 80 = 5 per main loop
+// #define FAILSAFE_TRQ_BRAKE    200       // (0, 1000] Braking torque applied opposite to the direction of motion during braking in TORQUE mode
+// #define FAILSAFE_BRAKE_TIME   3000      // [ms] Maximum braking time. OPEN_MODE is requested afterwards, even if standstill was not reached
+// #define FAILSAFE_STOP_SPEED   10        // [rpm] Standstill threshold at which braking ends and OPEN_MODE is requested
+// #define STALL_DETECT_ENABLE             // [-] Flag to enable stall / locked-rotor detection with current foldback. Reported by 6 beeps (low pitch). FOC_CTRL only: the criterion uses iq
+// #define STALL_I_THRES         80        // [%] Current threshold relative to I_MOT_MAX above which the motor is considered pushing
+// #define STALL_N_THRES         10        // [rpm] Speed threshold below which the motor is considered not turning
+// #define STALL_TIME            500       // [ms] Stall qualification time
+// #define STALL_I_FOLDBACK      40        // [%] Current limit relative to I_MOT_MAX applied while stalled
+// #define STALL_FOLDBACK_TIME   1000      // [ms] Ramp time of the current limit between I_MOT_MAX and the foldback value (both directions)
+// #define STALL_RECOVERY_TIME   300       // [ms] The wheel needs to turn again or the current request to drop for this time before the current limit is restored
+// #define MOTOR_DIAG_ENABLE               // [-] Flag to enable the power-on phase self test and the runtime shunt-saturation / phase-imbalance checks. Faults disable the motors, reported by 7 beeps (low pitch).
+// #define DIAG_TEST_DUTY        20        // [-] Self test PWM duty applied between the pulsed phase and the other two (pwm_res = 2000). 20 = 2% of the battery voltage
+// #define DIAG_TEST_PULSE       16        // [-] Self test pulse length in PWM periods (16 kHz). 16 = 1 ms
+// #define DIAG_TEST_I_MIN       15        // [-] Minimum pulsed phase current in ADC counts (A2BIT_CONV = 50 counts/A). Below half of this the phase is considered open
+// #define DIAG_TEST_I_SHORT     500       // [-] Current in ADC counts during the self test above which a bridge short / shorted MOSFET is reported
+// #define DIAG_OFFSET_TOL       600       // [-] Maximum deviation of the current sensor ADC offsets from mid-scale (2048)
+// #define DIAG_SAT_MARGIN       20        // [-] Phase current ADC margin to 0 / 4095 at which the shunt amplifier is considered saturated
+// #define DIAG_SAT_TIME         16        // [-] Consecutive saturated samples (16 kHz) before a shunt-saturation fault is reported
+// #define DIAG_IMB_N_MIN        60        // [rpm] Minimum speed for the phase-imbalance check (phase currents must be alternating)
+// #define DIAG_IMB_I_MIN        50        // [-] Minimum average phase current in ADC counts for the phase-imbalance check
+// #define DIAG_IMB_RATIO        25        // [%] A phase whose average current stays below this percentage of the mean of all phases is considered lost
+// #define WATCHDOG_ENABLE                 // [-] Flag to enable the independent watchdog (IWDG). The motor ISR refreshes it only while the main loop and the input reading check in within their deadlines. A missed deadline disables the motors at once and the IWDG resets the board.
+// #define WATCHDOG_TIMEOUT      250       // [ms] IWDG timeout after the refresh stops (LSI 40 kHz nominal, max 3276)
+// #define WDG_DEADLINE_RUN      50        // [ms] Check-in deadline of the main loop while the motors are enabled. The input task, checked in when input data arrives, gets the input timeout on top
+// #define WDG_DEADLINE_IDLE     1500      // [ms] Check-in deadline while the motors are disabled. Must cover the 1 s HAL_Delay of the transpotter distance setting in mainLoop, the longest wait left in the loop
 // ########################### END OF MOTOR CONTROL ########################
 
 
@@ -177,7 +217,7 @@
 #define INACTIVITY_TIMEOUT        8       // Minutes of not driving until poweroff. it is not very precise.
 #define BEEPS_BACKWARD            0       // 0 or 1
 #define ADC_MARGIN                100     // ADC input margin applied on the raw ADC min and max to make sure the MIN and MAX values are reached even in the presence of noise
-#define ADC_PROTECT_TIMEOUT       100     // ADC Protection: number of wrong / missing input commands before safety state is taken
+#define ADC_PROTECT_TIMEOUT       (500 / DELAY_IN_MAIN_LOOP)  // ADC Protection: number of wrong / missing input commands (main loops) before safety state is taken: 500 ms
 #define ADC_PROTECT_THRESH        10     // ADC Protection threshold below/above the MIN/MAX ADC values
 #define AUTO_CALIBRATION_ENA              // Enable/Disable input auto-calibration by holding power button pressed. Un-comment this if auto-calibration is not needed.
 
@@ -252,6 +292,9 @@
 // #define DEBUG_SERIAL_USART2          // left sensor board cable, disable if ADC or PPM is used!
 // #define DEBUG_SERIAL_USART3          // right sensor board cable, disable if I2C (nunchuk or lcd) is used!
 // #define DEBUG_SERIAL_PROTOCOL        // uncomment this to send user commands to the board, change parameters and print specific signals (see comms.c for the user commands)
+// #define STACK_MONITOR_ENABLE         // uncomment this to paint the free stack at start-up and track its high-water mark (see STACK_USED, STACK_FREE in comms.c)
+// #define STACK_MARGIN_MIN     256     // [bytes] Print a warning on the debug serial once the never-used stack drops below this margin
+// #define CYCLE_MEASURE_ENABLE         // uncomment this to measure the motor control ISR and main loop execution time in CPU cycles (72 per us) with the DWT cycle counter (see CYC_ISR, CYCMAX_ISR, CYCMAX_LOOP in comms.c)
 // ########################### END OF DEBUG SERIAL ############################
 
 
@@ -335,6 +378,22 @@
   // #define TANK_STEERING              // use for tank steering, each input controls each wheel 
   // #define SUPPORT_BUTTONS_LEFT       // use left sensor board cable for button inputs.  Disable DEBUG_SERIAL_USART2!
   // #define SUPPORT_BUTTONS_RIGHT      // use right sensor board cable for button inputs. Disable DEBUG_SERIAL_USART3!
+
+  // Two boards per vehicle (4WD): connect the left sensor board cables (USART2) of both boards, TX to RX. Both boards need the same settings.
+  // #define MULTI_BOARD_MASTER         // relay the commands with a timestamp to the slave board and merge its feedback into FEEDBACK_SERIAL_USART3. Use CONTROL_SERIAL_USART3 for the host
+  // #define MULTI_BOARD_SLAVE          // take the commands from the master board and align the control cycle to them
+  // #define TORQUE_SPLIT_ENABLE        // master splits the demand of each side between the two axles, away from a slipping wheel, the slave follows the per-wheel targets. Enable on both boards
+  // #define TORQUE_SPLIT_FRONT   50    // [%] nominal share of the master axle
+  // #define TORQUE_SPLIT_MIN     20    // [%] minimum share of each axle
+  // #define TORQUE_SLIP_N        40    // [rpm] a wheel faster than the other wheel of its side by this speed in the driving direction is slipping
+
+  // #define FEEDBACK_TIMESTAMP         // add a syncId to the command and the board time with a sync echo to the feedback, for host clock synchronization (tools/hoverserial)
+
+  // Many boards on one host port: RS-485 transceiver on the right sensor board cable, CONTROL_SERIAL_USART3 and FEEDBACK_SERIAL_USART3 on a shared half duplex bus.
+  // #define SERIAL_BUS                 // take only the commands addressed to this node (BUS_NODE, in EEPROM) or broadcast, reply to each poll instead of the periodic feedback
+  // #define SERIAL_BUS_NODE      1     // [-] node id 1..SERIAL_BUS_NODES until set with the debug protocol (BUS_NODE, SAVE)
+  // #define SERIAL_BUS_DE_PORT   GPIOA // transceiver driver enable, high while replying. Leave undefined for auto direction transceivers
+  // #define SERIAL_BUS_DE_PIN    GPIO_PIN_2  // PA2: left sensor board cable TX, only when USART2 is not used
 #endif
 // ######################## END OF VARIANT_USART SETTINGS #########################
 
@@ -527,6 +586,11 @@
 
   #define MULTI_MODE_DRIVE                  // This option enables the selection of 3 driving modes at start-up using combinations of Brake and Throttle pedals (see below)
   #ifdef MULTI_MODE_DRIVE
+      // The driving modes below are the defaults of the drive profiles. The profiles can be changed and saved to EEPROM via the Debug Serial Protocol (M1_SPD_MAX, M1_RATE, ...).
+      // At runtime the mode can be switched via the Debug Serial Protocol (DRV_MODE), the Sideboard sensor2 / SWD switch (instead of Field Weakening) or, with CONTROL_SERIAL_USART2/3, the driveMode field of the Serial command.
+      #define MULTI_MODE_DRIVE_NR       3         // [-] Number of drive modes
+      #define MULTI_MODE_SWITCH_TIME    2000      // [ms] Transition time for the limits when switching the drive mode at runtime
+
       // BEGINNER MODE:     Power ON + Brake [released] + Throttle [released or pressed]
       #define MULTI_MODE_DRIVE_M1_MAX   175
       #define MULTI_MODE_DRIVE_M1_RATE  250
@@ -587,7 +651,12 @@
   // #define SUPPORT_NUNCHUK
   #define GAMETRAK_CONNECTION_NORMAL    // for normal wiring according to the wiki instructions
   // #define GAMETRAK_CONNECTION_ALTERNATE // use this define instead if you messed up the gametrak ADC wiring (steering is speed, and length of the wire is steering)
-  #define ROT_P               1.2       // P coefficient for the direction controller. Positive / Negative values to invert gametrak steering direction.
+  #define TRANSPOTTER_DIST_SCALE  1345  // [ADC counts / m] gametrak wire length conversion
+  #define TRANSPOTTER_KP      16384     // 1.0f   fixdt(1,16,14) P coefficient of the distance controller [cmd / ADC count]
+  #define TRANSPOTTER_KD      1638      // 0.025f fixdt(0,16,16) D coefficient of the distance controller [cmd / (ADC count / s)]. Set to 0 for a pure P controller
+  #define TRANSPOTTER_D_FILTER  3277    // 0.05f  fixdt(0,16,16) low-pass filter coefficient of the distance error derivative
+  #define TRANSPOTTER_FILTER  6921      // 0.106f fixdt(0,16,16) low-pass filter coefficient of the motor commands. Same time constant as the former 0.2 @ 2 ms loop
+  #define ROT_P               19661     // 1.2f   fixdt(1,16,14) P coefficient for the direction controller. Positive / Negative values to invert gametrak steering direction.
   // during nunchuk control (only relevant when activated)
   #define SPEED_COEFFICIENT   14746     // 0.9f - higher value == stronger. 0.0 to ~2.0?
   #define STEER_COEFFICIENT   8192      // 0.5f - higher value == stronger. if you do not want any steering, set it to 0.0; 0.0 to 1.0
@@ -635,13 +704,29 @@
 
 
 // ########################### UART SETIINGS ############################
+#if defined(MULTI_MODE_DRIVE) && (defined(CONTROL_SERIAL_USART2) || defined(CONTROL_SERIAL_USART3))
+  #define MULTI_MODE_SERIAL                               // driveMode word in the serial command and feedback. Not on the sideboard frames
+#endif
+#if defined(MULTI_BOARD_MASTER) || defined(MULTI_BOARD_SLAVE)
+  #define MULTI_BOARD_LINK                                // board link on the left sensor board cable (USART2)
+  #define MULTI_BOARD_TIMEOUT     (100 / DELAY_IN_MAIN_LOOP)  // [-] Board link timeout in main loop cycles: 0.1 sec
+#endif
 #if defined(FEEDBACK_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(DEBUG_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || \
-    defined(FEEDBACK_SERIAL_USART3) || defined(CONTROL_SERIAL_USART3) || defined(DEBUG_SERIAL_USART3) || defined(SIDEBOARD_SERIAL_USART3)
+    defined(FEEDBACK_SERIAL_USART3) || defined(CONTROL_SERIAL_USART3) || defined(DEBUG_SERIAL_USART3) || defined(SIDEBOARD_SERIAL_USART3) || defined(MULTI_BOARD_LINK)
   #define SERIAL_START_FRAME      0xABCD                  // [-] Start frame definition for serial commands
   #define SERIAL_BUFFER_SIZE      128                     // [bytes] Size of Serial Rx buffer. Make sure it is always larger than the structure size
-  #define SERIAL_TIMEOUT          160                     // [-] Serial timeout duration for the received data. 160 ~= 0.8 sec. Calculation: 0.8 sec / 0.005 sec
+  #define SERIAL_TIMEOUT          (800 / DELAY_IN_MAIN_LOOP)  // [-] Serial timeout duration for the received data in main loop cycles: 0.8 sec
 #endif
-#if defined(FEEDBACK_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(DEBUG_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2)
+#ifdef SERIAL_BUS
+  #ifndef SERIAL_BUS_NODE
+    #define SERIAL_BUS_NODE       1                       // [-] default node id
+  #endif
+  #define SERIAL_BUS_NODES        31                      // [-] highest node id
+  #define FEEDBACK_INTERVAL       1                       // [-] bus reply refreshed every main loop, sent when the node is polled
+#else
+  #define FEEDBACK_INTERVAL       (20 / DELAY_IN_MAIN_LOOP)   // [-] feedback every 20 ms in main loops: 50 Hz
+#endif
+#if defined(FEEDBACK_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(DEBUG_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || defined(MULTI_BOARD_LINK)
   #ifndef USART2_BAUD
     #define USART2_BAUD           115200                  // UART2 baud rate (long wired cable)
   #endif
@@ -691,6 +776,42 @@
   #error CONTROL_SERIAL_USART2 and SIDEBOARD_SERIAL_USART2 not allowed, choose one.
 #endif
 
+#if defined(MULTI_BOARD_MASTER) && defined(MULTI_BOARD_SLAVE)
+  #error MULTI_BOARD_MASTER and MULTI_BOARD_SLAVE not allowed, choose one.
+#endif
+
+#if defined(CTRL_SCHED_ENABLE) && defined(CTRL_TYP_FIXED)
+  #error CTRL_SCHED_ENABLE and CTRL_TYP_FIXED not allowed, choose one.
+#endif
+
+#if defined(CTRL_SCHED_ENABLE) && (CTRL_SCHED_N_MID + CTRL_SCHED_N_HYST >= CTRL_SCHED_N_HI)
+  #error CTRL_SCHED_N_HI must be above CTRL_SCHED_N_MID + CTRL_SCHED_N_HYST.
+#endif
+
+#if defined(STALL_DETECT_ENABLE) && (CTRL_TYP_SEL != FOC_CTRL)
+  #error STALL_DETECT_ENABLE needs CTRL_TYP_SEL FOC_CTRL. iq is not estimated in COM_CTRL and SIN_CTRL.
+#endif
+
+#if defined(TORQUE_SPLIT_ENABLE) && !defined(MULTI_BOARD_LINK)
+  #error TORQUE_SPLIT_ENABLE needs MULTI_BOARD_MASTER or MULTI_BOARD_SLAVE.
+#endif
+
+#if defined(FEEDBACK_TIMESTAMP) && (defined(CONTROL_IBUS) || !(defined(CONTROL_SERIAL_USART2) || defined(CONTROL_SERIAL_USART3)) || !(defined(FEEDBACK_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART3)))
+  #error FEEDBACK_TIMESTAMP needs CONTROL_SERIAL_USARTx and FEEDBACK_SERIAL_USARTx, not with CONTROL_IBUS.
+#endif
+
+#if defined(SERIAL_BUS) && (!defined(CONTROL_SERIAL_USART3) || !defined(FEEDBACK_SERIAL_USART3) || defined(CONTROL_IBUS) || defined(FEEDBACK_SERIAL_USART2) || defined(MULTI_BOARD_LINK))
+  #error SERIAL_BUS needs CONTROL_SERIAL_USART3 and FEEDBACK_SERIAL_USART3, not with CONTROL_IBUS, FEEDBACK_SERIAL_USART2 or MULTI_BOARD.
+#endif
+
+#if defined(SERIAL_BUS) && (SERIAL_BUS_NODE < 1 || SERIAL_BUS_NODE > SERIAL_BUS_NODES)
+  #error SERIAL_BUS_NODE must be 1..31, 0 is the broadcast address.
+#endif
+
+#if defined(MULTI_BOARD_LINK) && (defined(CONTROL_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART2) || defined(DEBUG_SERIAL_USART2))
+  #error MULTI_BOARD and SERIAL_USART2 not allowed. The board link is on the same cable.
+#endif
+
 #if defined(CONTROL_SERIAL_USART3) && defined(SIDEBOARD_SERIAL_USART3)
   #error CONTROL_SERIAL_USART3 and SIDEBOARD_SERIAL_USART3 not allowed, choose one.
 #endif
@@ -721,19 +842,19 @@
 
 
 // LEFT cable checks
-#if defined(CONTROL_ADC) && (defined(CONTROL_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART2) || defined(DEBUG_SERIAL_USART2))
+#if defined(CONTROL_ADC) && (defined(CONTROL_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART2) || defined(DEBUG_SERIAL_USART2) || defined(MULTI_BOARD_LINK))
   #error CONTROL_ADC and SERIAL_USART2 not allowed. It is on the same cable.
 #endif
 
-#if defined(CONTROL_PPM_LEFT) && (defined(CONTROL_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART2) || defined(DEBUG_SERIAL_USART2))
+#if defined(CONTROL_PPM_LEFT) && (defined(CONTROL_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART2) || defined(DEBUG_SERIAL_USART2) || defined(MULTI_BOARD_LINK))
   #error CONTROL_PPM_LEFT and SERIAL_USART2 not allowed. It is on the same cable.
 #endif
 
-#if defined(CONTROL_PWM_LEFT) && (defined(CONTROL_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART2) || defined(DEBUG_SERIAL_USART2))
+#if defined(CONTROL_PWM_LEFT) && (defined(CONTROL_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART2) || defined(DEBUG_SERIAL_USART2) || defined(MULTI_BOARD_LINK))
   #error CONTROL_PWM_LEFT and SERIAL_USART2 not allowed. It is on the same cable.
 #endif
 
-#if defined(SUPPORT_BUTTONS_LEFT) && (defined(CONTROL_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART2) || defined(DEBUG_SERIAL_USART2))
+#if defined(SUPPORT_BUTTONS_LEFT) && (defined(CONTROL_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART2) || defined(DEBUG_SERIAL_USART2) || defined(MULTI_BOARD_LINK))
   #error SUPPORT_BUTTONS_LEFT and SERIAL_USART2 not allowed. It is on the same cable.
 #endif
 
@@ -0,0 +1,58 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Control type scheduler (CTRL_SCHED_ENABLE): picks COM, SIN or FOC by operating point. No HAL dependency, the
+// host motor model in tools/motorsim runs the same code against the motor controller.
+
+// Define to prevent recursive inclusion
+#ifndef CTRLSCHED_H
+#define CTRLSCHED_H
+
+#include <stdint.h>
+
+// Speed bands low / mid / high, separated at n_mid and n_hi with a hysteresis of n_hyst. Above i_hi the low band
+// is used regardless of the speed, released below 3/4 of i_hi. A switch waits for dwell after the previous one.
+// At a switch the input target gain is set so that the fundamental phase voltage stays the same, then the gain
+// is blended back to 1.0. Not when leaving FOC, and outside VOLTAGE mode the gain stays 1.0.
+typedef struct {
+  uint8_t   typ[3];         // [-] control type of the low, mid and high speed band
+  int16_t   n_mid;          // [rpm] speed between the low and the mid band
+  int16_t   n_hi;           // [rpm] speed between the mid and the high band
+  int16_t   n_hyst;         // [rpm] hysteresis around n_mid and n_hi
+  int16_t   i_hi;           // [-] DC link current in ADC counts above which the low band is used
+  uint16_t  dwell;          // [main loop] minimum time between two switches
+  uint16_t  blendStep;      // [-] gain blend progress per main loop fixdt(0,16,15)
+  uint8_t   matchEna;       // [-] match the fundamental phase voltage at a switch: 0 = off, 1 = on
+
+  uint8_t   ctrlTyp;        // [-] active control type
+  uint8_t   band;           // [-] active speed band: 0 = low, 1 = mid, 2 = high
+  uint8_t   overload;       // [-] DC link current above i_hi
+  uint16_t  hold;           // [main loop] time since the last switch
+  uint16_t  gain;           // [-] input target gain fixdt(0,16,14), 1.0 outside of a transition
+  uint16_t  gainFrom;       // [-] gain right after the last switch fixdt(0,16,14)
+  uint16_t  blend;          // [-] blend progress fixdt(0,16,15) = [0, 1.0]
+  int32_t   iDcFilt;        // [-] filtered DC link current fixdt(1,32,16)
+  uint16_t  switches;       // [-] number of control type switches
+} CtrlSched;
+
+void    ctrlSchedInit(CtrlSched *s);
+void    ctrlSchedBands(CtrlSched *s, uint8_t hiSet);
+uint8_t ctrlSchedStep(CtrlSched *s, int16_t speedAbs, int16_t iDcAbs, uint8_t active);
+
+#endif  // CTRLSCHED_H
@@ -0,0 +1,38 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Minimal printf formatter for the debug serial: integers, characters, strings and binary fixed point values via
+// dbgFixdt(). No HAL dependency, tools/hostcheck compares it with the C library printf.
+
+// Define to prevent recursive inclusion
+#ifndef DBGFMT_H
+#define DBGFMT_H
+
+#include <stdarg.h>
+#include <stdint.h>
+
+#define DBG_FIXDT_LEN   18          // buffer size for dbgFixdt(): sign, 10 integer digits, point, 4 decimals, NUL
+
+// Called with each full buffer and with the rest at the end of dbgFormat()
+typedef void (*DbgFlush)(const char *s, uint16_t n);
+
+uint16_t dbgFormat(char *buf, uint16_t size, DbgFlush flush, const char *fmt, va_list ap);
+char    *dbgFixdt(char *buf, int32_t val, uint8_t q, uint8_t dec);
+
+#endif  // DBGFMT_H
@@ -211,10 +211,6 @@
 #define ARRAY_LEN(x) (uint32_t)(sizeof(x) / sizeof(*(x)))
 #define MAP(x, in_min, in_max, out_min, out_max) (((((x) - (in_min)) * ((out_max) - (out_min))) / ((in_max) - (in_min))) + (out_min))
 
-#if defined(PRINTF_FLOAT_SUPPORT) && (defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)) && defined(__GNUC__)
-    asm(".global _printf_float");     // this is the magic trick for printf to support float. Warning: It will increase code considerably! Better to avoid!
-#endif
-
 
 typedef struct {
   uint16_t dcr; 
@@ -261,5 +257,14 @@ void PWM_ISR_CH2_Callback(void);
 #define SWC_SET             (0x1800)   //  0001 1000 0000 0000
 #define SWD_SET             (0x2000)   //  0010 0000 0000 0000
 
+// Motor diagnostics error codes (bit field)
+#define DIAG_ERR_PHA_U      (0x01)     // phase U open (no self test current / lost at runtime)
+#define DIAG_ERR_PHA_V      (0x02)     // phase V open
+#define DIAG_ERR_PHA_W      (0x04)     // phase W open
+#define DIAG_ERR_BRIDGE     (0x08)     // bridge short / shorted MOSFET (over-current during the self test)
+#define DIAG_ERR_SENSOR     (0x10)     // current sensor offset out of range or no self test response
+#define DIAG_ERR_SHUNT_SAT  (0x20)     // shunt amplifier saturated at runtime
+#define DIAG_ERR_IMBALANCE  (0x40)     // phase current imbalance at runtime
+
 #endif // DEFINES_H
 
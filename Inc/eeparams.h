@@ -0,0 +1,103 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// EEPROM parameter registry and store. EE_PARAMS defines every persistent parameter once and generates the debug
+// protocol rows (params[] in comms.c), the virtual addresses (VirtAddVarTab in util.c) and their number (NB_OF_VAR in
+// eeprom.h). The store writes only the parameters that changed. No HAL dependency, tools/hostcheck counts its writes.
+
+// Define to prevent recursive inclusion
+#ifndef EEPARAMS_H
+#define EEPARAMS_H
+
+#include <stdint.h>
+
+// X(id, EEPROM index, name, variable, right motor copy or NULL, init, init Int/Ext, min, max, div, mul, fix, callback,
+//   help), the columns after the variable as in params[]. The index selects the virtual address
+// VirtAddVarTab[index] = EE_VIRT_ADDR + index: keep it when adding parameters, the EEPROM holds the values by index.
+// Index 0 holds the FLASH_WRITE_KEY.
+#define EE_PARAMS_LIMITS(X) \
+  X(EE_I_MOT_MAX,   1,  "I_MOT_MAX",   iMotMax,                 NULL,             I_MOT_MAX,                1, 1,       40,               A2BIT_CONV, 0, 4, NULL, "Max phase current A") \
+  X(EE_N_MOT_MAX,   2,  "N_MOT_MAX",   rtP_Left.n_max,          &rtP_Right.n_max, N_MOT_MAX,                1, 10,      2000,             0,          0, 4, NULL, "Max motor RPM")
+#define EE_PARAMS_IN1(X) \
+  X(EE_IN1_TYP,     3,  "IN1_TYP",     input1[0].typ,           NULL,             0,                        0, 0,       3,                0,          0, 0, NULL, "Input1 type") \
+  X(EE_IN1_MIN,     4,  "IN1_MIN",     input1[0].min,           NULL,             RAW_MIN,                  0, RAW_MIN, RAW_MAX,          0,          0, 0, NULL, "Input1 min") \
+  X(EE_IN1_MID,     5,  "IN1_MID",     input1[0].mid,           NULL,             0,                        0, RAW_MIN, RAW_MAX,          0,          0, 0, NULL, "Input1 mid") \
+  X(EE_IN1_MAX,     6,  "IN1_MAX",     input1[0].max,           NULL,             RAW_MAX,                  0, RAW_MIN, RAW_MAX,          0,          0, 0, NULL, "Input1 max")
+#define EE_PARAMS_IN2(X) \
+  X(EE_IN2_TYP,     7,  "IN2_TYP",     input2[0].typ,           NULL,             0,                        0, 0,       3,                0,          0, 0, NULL, "Input2 type") \
+  X(EE_IN2_MIN,     8,  "IN2_MIN",     input2[0].min,           NULL,             RAW_MIN,                  0, RAW_MIN, RAW_MAX,          0,          0, 0, NULL, "Input2 min") \
+  X(EE_IN2_MID,     9,  "IN2_MID",     input2[0].mid,           NULL,             0,                        0, RAW_MIN, RAW_MAX,          0,          0, 0, NULL, "Input2 mid") \
+  X(EE_IN2_MAX,     10, "IN2_MAX",     input2[0].max,           NULL,             RAW_MAX,                  0, RAW_MIN, RAW_MAX,          0,          0, 0, NULL, "Input2 max")
+#define EE_PARAMS_AUX_IN1(X) \
+  X(EE_AUX_IN1_TYP, 11, "AUX_IN1_TYP", input1[1].typ,           NULL,             0,                        0, 0,       3,                0,          0, 0, NULL, "Aux. input1 type") \
+  X(EE_AUX_IN1_MIN, 12, "AUX_IN1_MIN", input1[1].min,           NULL,             RAW_MIN,                  0, RAW_MIN, RAW_MAX,          0,          0, 0, NULL, "Aux. input1 min") \
+  X(EE_AUX_IN1_MID, 13, "AUX_IN1_MID", input1[1].mid,           NULL,             0,                        0, RAW_MIN, RAW_MAX,          0,          0, 0, NULL, "Aux. input1 mid") \
+  X(EE_AUX_IN1_MAX, 14, "AUX_IN1_MAX", input1[1].max,           NULL,             RAW_MAX,                  0, RAW_MIN, RAW_MAX,          0,          0, 0, NULL, "Aux. input1 max")
+#define EE_PARAMS_AUX_IN2(X) \
+  X(EE_AUX_IN2_TYP, 15, "AUX_IN2_TYP", input2[1].typ,           NULL,             0,                        0, 0,       3,                0,          0, 0, NULL, "Aux. input2 type") \
+  X(EE_AUX_IN2_MIN, 16, "AUX_IN2_MIN", input2[1].min,           NULL,             RAW_MIN,                  0, RAW_MIN, RAW_MAX,          0,          0, 0, NULL, "Aux. input2 min") \
+  X(EE_AUX_IN2_MID, 17, "AUX_IN2_MID", input2[1].mid,           NULL,             0,                        0, RAW_MIN, RAW_MAX,          0,          0, 0, NULL, "Aux. input2 mid") \
+  X(EE_AUX_IN2_MAX, 18, "AUX_IN2_MAX", input2[1].max,           NULL,             RAW_MAX,                  0, RAW_MIN, RAW_MAX,          0,          0, 0, NULL, "Aux. input2 max")
+#define EE_PARAMS_DRIVE_MODES(X) \
+  X(EE_M1_SPD_MAX,  19, "M1_SPD_MAX",  driveModes[0].max_speed, NULL,             MULTI_MODE_DRIVE_M1_MAX,  0, 0,       1000,             0,          0, 0, NULL, "Mode1 max speed") \
+  X(EE_M1_RATE,     20, "M1_RATE",     driveModes[0].rate,      NULL,             MULTI_MODE_DRIVE_M1_RATE, 0, 1,       32767,            0,          0, 0, NULL, "Mode1 rate fixdt(1,16,4)") \
+  X(EE_M1_I_MAX,    21, "M1_I_MAX",    driveModes[0].i_max,     NULL,             MULTI_MODE_M1_I_MOT_MAX,  1, 1,       40,               A2BIT_CONV, 0, 4, NULL, "Mode1 max phase current A") \
+  X(EE_M1_N_MAX,    22, "M1_N_MAX",    driveModes[0].n_max,     NULL,             MULTI_MODE_M1_N_MOT_MAX,  1, 10,      2000,             0,          0, 4, NULL, "Mode1 max motor RPM") \
+  X(EE_M2_SPD_MAX,  23, "M2_SPD_MAX",  driveModes[1].max_speed, NULL,             MULTI_MODE_DRIVE_M2_MAX,  0, 0,       1000,             0,          0, 0, NULL, "Mode2 max speed") \
+  X(EE_M2_RATE,     24, "M2_RATE",     driveModes[1].rate,      NULL,             MULTI_MODE_DRIVE_M2_RATE, 0, 1,       32767,            0,          0, 0, NULL, "Mode2 rate fixdt(1,16,4)") \
+  X(EE_M2_I_MAX,    25, "M2_I_MAX",    driveModes[1].i_max,     NULL,             MULTI_MODE_M2_I_MOT_MAX,  1, 1,       40,               A2BIT_CONV, 0, 4, NULL, "Mode2 max phase current A") \
+  X(EE_M2_N_MAX,    26, "M2_N_MAX",    driveModes[1].n_max,     NULL,             MULTI_MODE_M2_N_MOT_MAX,  1, 10,      2000,             0,          0, 4, NULL, "Mode2 max motor RPM") \
+  X(EE_M3_SPD_MAX,  27, "M3_SPD_MAX",  driveModes[2].max_speed, NULL,             MULTI_MODE_DRIVE_M3_MAX,  0, 0,       1000,             0,          0, 0, NULL, "Mode3 max speed") \
+  X(EE_M3_RATE,     28, "M3_RATE",     driveModes[2].rate,      NULL,             MULTI_MODE_DRIVE_M3_RATE, 0, 1,       32767,            0,          0, 0, NULL, "Mode3 rate fixdt(1,16,4)") \
+  X(EE_M3_I_MAX,    29, "M3_I_MAX",    driveModes[2].i_max,     NULL,             MULTI_MODE_M3_I_MOT_MAX,  1, 1,       40,               A2BIT_CONV, 0, 4, NULL, "Mode3 max phase current A") \
+  X(EE_M3_N_MAX,    30, "M3_N_MAX",    driveModes[2].n_max,     NULL,             MULTI_MODE_M3_N_MOT_MAX,  1, 10,      2000,             0,          0, 4, NULL, "Mode3 max motor RPM")
+#define EE_PARAMS_BUS(X) \
+  X(EE_BUS_NODE,    31, "BUS_NODE",    busNode,                 NULL,             SERIAL_BUS_NODE,          0, 1,       SERIAL_BUS_NODES, 0,          0, 0, NULL, "Bus node id (SAVE to keep)")
+#define EE_PARAMS(X)  EE_PARAMS_LIMITS(X) EE_PARAMS_IN1(X) EE_PARAMS_IN2(X) EE_PARAMS_AUX_IN1(X) EE_PARAMS_AUX_IN2(X) \
+                      EE_PARAMS_DRIVE_MODES(X) EE_PARAMS_BUS(X)
+
+#define EE_VIRT_ADDR  1000          // virtual address of index 0, 0xFFFF is prohibited
+
+#define EE_PARAM_ENUM(id, addr, name, var, varR, init, initFormat, min, max, div, mul, fix, callback, help)  id = addr,
+enum eeParamIndex { EE_PARAMS(EE_PARAM_ENUM) EE_PARAMS_END };
+
+typedef struct {
+  uint8_t   addr;           // EEPROM index
+  uint8_t   size;           // variable size: 1 = uint8_t, 2 = int16_t
+  void     *valueL;         // variable
+  void     *valueR;         // right motor copy, NULL if none
+} EEParam;
+
+typedef struct {
+  const EEParam  *param;                                  // registered parameters
+  uint8_t         nr;
+  const uint16_t *virtAddr;                               // VirtAddVarTab
+  uint16_t        key;                                    // FLASH_WRITE_KEY
+  uint16_t      (*read)(uint16_t virtAddr, uint16_t *data);  // EE_ReadVariable: 0 = found
+  uint16_t      (*write)(uint16_t virtAddr, uint16_t data);  // EE_WriteVariable: 0 = written
+  uint16_t        shadow[EE_PARAMS_END];                  // value held by the EEPROM
+  uint32_t        synced;                                 // bit i set: shadow[i] is valid
+  uint8_t         keySynced;                              // the key is in the EEPROM
+  uint8_t         failed;                                 // writes failed in the last save
+} EEStore;
+
+void    eeStoreLoad(EEStore *s);
+uint8_t eeStoreSave(EEStore *s);
+
+#endif  // EEPARAMS_H
@@ -42,6 +42,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "stm32f1xx_hal.h"
+#include "eeparams.h"
 
 /* Exported constants --------------------------------------------------------*/
 /* Base address of the Flash sectors */
@@ -177,6 +178,22 @@
 /* Define the size of the sectors to be used */
 #define PAGE_SIZE               (uint32_t)FLASH_PAGE_SIZE  /* Page size */
 
+#ifdef BOOT_SLOT
+/* Boot slot build: two adjacent pages below the slots, see boot.h */
+#include "boot.h"
+#define EEPROM_START_ADDRESS  ((uint32_t)BOOT_EEPROM_ADDR)
+
+#define PAGE0_BASE_ADDRESS    ((uint32_t)(EEPROM_START_ADDRESS + 0x0000))
+#define PAGE0_END_ADDRESS     ((uint32_t)(EEPROM_START_ADDRESS + (PAGE_SIZE - 1)))
+#define PAGE0_ID               PAGE0_BASE_ADDRESS
+
+#define PAGE1_BASE_ADDRESS    ((uint32_t)(EEPROM_START_ADDRESS + PAGE_SIZE))
+#define PAGE1_END_ADDRESS     ((uint32_t)(EEPROM_START_ADDRESS + 2 * PAGE_SIZE - 1))
+#define PAGE1_ID               PAGE1_BASE_ADDRESS
+
+#define PAGE0                 ((uint16_t)0x0000)
+#define PAGE1                 ((uint16_t)0x0001)
+#else
 /* EEPROM start address in Flash */
 #define EEPROM_START_ADDRESS  ((uint32_t)ADDR_FLASH_PAGE_64) /* EEPROM emulation start address */
 
@@ -192,6 +209,7 @@
 /* Used Flash pages for EEPROM emulation */
 #define PAGE0                 ((uint16_t)0x0000)
 #define PAGE1                 ((uint16_t)0x0040)
+#endif
 
 /* No valid page define */
 #define NO_VALID_PAGE         ((uint16_t)0x00AB)
@@ -208,8 +226,8 @@
 /* Page full define */
 #define PAGE_FULL             ((uint8_t)0x80)
 
-/* Variables' number */
-#define NB_OF_VAR             ((uint8_t)0x13)       /* 19 Variables */
+/* Variables' number: one per EEPROM index of the parameter registry */
+#define NB_OF_VAR             ((uint8_t)EE_PARAMS_END)
 
 /* Exported types ------------------------------------------------------------*/
 /* Exported macro ------------------------------------------------------------*/
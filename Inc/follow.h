@@ -0,0 +1,46 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Transpotter follow controller (VARIANT_TRANSPOTTER): fixed-point PD distance control and steering. No HAL
+// dependency, tools/hostcheck compares it with the same law in floating point.
+
+// Define to prevent recursive inclusion
+#ifndef FOLLOW_H
+#define FOLLOW_H
+
+#include <stdint.h>
+
+typedef struct {
+  int16_t   kp;             // [-] P coefficient of the distance controller fixdt(1,16,14) [cmd / ADC count]
+  uint16_t  kd;             // [-] D coefficient of the distance controller fixdt(0,16,16) [cmd / (ADC count / s)]
+  uint16_t  dFilt;          // [-] low-pass filter coefficient of the distance error derivative fixdt(0,16,16)
+  uint16_t  cmdFilt;        // [-] low-pass filter coefficient of the motor commands fixdt(0,16,16)
+  int16_t   rotP;           // [-] P coefficient of the direction controller fixdt(1,16,14)
+  uint16_t  rate;           // [Hz] step rate, 1000 / DELAY_IN_MAIN_LOOP
+
+  int32_t   errPrev;        // [ADC counts] distance error of the previous step
+  int32_t   derFixdt;       // [ADC counts / s] filtered distance error derivative fixdt(1,32,16)
+  int32_t   cmdLFixdt;      // [-] filtered left command fixdt(1,32,16)
+  int32_t   cmdRFixdt;      // [-] filtered right command fixdt(1,32,16)
+} Follow;
+
+void followInit(Follow *f);
+void followStep(Follow *f, int32_t distanceErr, int16_t steering, int16_t *cmdL, int16_t *cmdR);
+
+#endif  // FOLLOW_H
@@ -0,0 +1,75 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Board link of the 4WD multi-board setup (MULTI_BOARD_MASTER / MULTI_BOARD_SLAVE): frames, checksum, link timeout
+// and the torque split between the axles (TORQUE_SPLIT_ENABLE). No HAL dependency: tools/hostcheck runs a master and a
+// slave instance over a simulated cable, tools/motorsim runs the torque split on a 4WD vehicle model.
+
+// Define to prevent recursive inclusion
+#ifndef MULTIBOARD_H
+#define MULTIBOARD_H
+
+#include <stdint.h>
+
+#define LINK_START_FRAME  0xABCD    // start word of the link frames, same as SERIAL_START_FRAME
+
+typedef struct{                     // Board link master -> slave, every main loop cycle
+  uint16_t  start;
+  int16_t   cmd1;                   // master input1 command
+  int16_t   cmd2;                   // master input2 command
+  int16_t   wheelL;                 // slave left wheel target (TORQUE_SPLIT_ENABLE)
+  int16_t   wheelR;                 // slave right wheel target (TORQUE_SPLIT_ENABLE)
+  uint16_t  tick;                   // master main loop counter
+  uint16_t  checksum;
+} SerialLinkCommand;
+
+typedef struct{                     // Board link slave -> master, every main loop cycle
+  uint16_t  start;
+  int16_t   leftSpeed;
+  int16_t   rightSpeed;
+  uint16_t  leftTicks;
+  uint16_t  rightTicks;
+  int16_t   batVoltage;
+  int16_t   boardTemp;
+  uint16_t  tick;                   // master main loop counter of the last command applied
+  uint16_t  checksum;
+} SerialLinkFeedback;
+
+typedef struct {
+  uint16_t  timeout;                // [-] main loop cycles without a valid frame until the link is lost
+  uint16_t  cnt;                    // [-] main loop cycles since the last valid frame
+  uint8_t   lost;                   // 1: link lost, the motors are held safe. Cleared by the next valid frame
+} LinkState;
+
+typedef struct {
+  int32_t   shareNom;               // [-] nominal master axle share fixdt(1,32,15)
+  int32_t   shareMin;               // [-] minimum share of each axle fixdt(1,32,15)
+  int16_t   slipN;                  // [rpm] speed difference of the wheels of a side that counts as slip
+  int32_t   share[2];               // [-] master axle share of the left / right side fixdt(1,32,15)
+} TorqueSplit;
+
+void     linkInit(LinkState *l, uint16_t timeout);
+void     linkSeal(void *frame, uint32_t size);
+uint8_t  linkRxValid(LinkState *l, const void *frame, uint32_t size);
+uint8_t  linkTimeoutStep(LinkState *l);
+void     torqueSplitInit(TorqueSplit *t, uint8_t frontPct, uint8_t minPct, int16_t slipN);
+void     torqueSplitStep(TorqueSplit *t, int16_t cmd[2], int16_t slv[2], const int16_t dir[2], const int16_t nMst[2],
+                         const int16_t nSlv[2], int16_t cmdMax);
+
+#endif  // MULTIBOARD_H
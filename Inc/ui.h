@@ -0,0 +1,74 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Beeper queue and power button state machine, ticked from the main loop without blocking waits. No HAL
+// dependency, tools/hostcheck runs them in a simulated main loop. The actions (buzzer, poweroff, calibration) are
+// taken in util.c.
+
+// Define to prevent recursive inclusion
+#ifndef UI_H
+#define UI_H
+
+#include <stdint.h>
+
+#define UI_TICKS_MS       16        // time base: buzzerTimer, 16 ticks per ms
+
+#define BEEP_QUEUE_SIZE   16
+
+typedef struct {
+  uint8_t  freq[BEEP_QUEUE_SIZE];   // queued tones: buzzer frequency, 0 = pause
+  uint16_t time[BEEP_QUEUE_SIZE];   // queued tones: length [ms]
+  volatile uint8_t head;            // next free queue entry
+  volatile uint8_t tail;            // tone playing or next to play
+  uint8_t  acv;                     // a queued tone is playing
+  uint32_t start;                   // time at the start of the tone
+} BeepQueue;
+
+void    beepQueuePush(BeepQueue *q, uint8_t freq, uint16_t duration);
+uint8_t beepQueueStep(BeepQueue *q, uint32_t now, uint8_t *freq);
+uint8_t beepQueueIdle(const BeepQueue *q);
+
+#define BUTTON_IDLE       0         // power button released
+#define BUTTON_PRESSED    1         // first press held
+#define BUTTON_WAIT       2         // released, waiting for a second press
+#define BUTTON_PRESSED2   3         // second press held
+#define BUTTON_CONFIRM    4         // calibration confirmed, waiting for the release
+
+#define BUTTON_EVT_NONE       0
+#define BUTTON_EVT_CONFIRM    1     // pressed while a calibration runs: confirm it
+#define BUTTON_EVT_HELD       2     // held for BUTTON_LONG_MS: beep
+#define BUTTON_EVT_SHORT      3     // short press released: power off
+#define BUTTON_EVT_RELEASED   4     // long press released: disable the motors, wait for a second press
+#define BUTTON_EVT_LONG       5     // long press, no second press: calibrate the input limits
+#define BUTTON_EVT_DOUBLE     6     // long press, then a second press: adjust the current and speed limits
+
+#define BUTTON_DEBOUNCE_MS    80
+#define BUTTON_LONG_MS        5000
+#define BUTTON_SECOND_MS      1000  // window for the second press after a long press
+
+typedef struct {
+  uint8_t  state;                   // BUTTON_IDLE, ...
+  uint8_t  held;                    // long press beep done
+  uint32_t time;                    // time of the last state change
+} Button;
+
+void    buttonInit(Button *b);
+uint8_t buttonStep(Button *b, uint8_t pressed, uint8_t calib, uint32_t now);
+
+#endif  // UI_H
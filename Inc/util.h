@@ -22,6 +22,10 @@
 #define UTIL_H
 
 #include <stdint.h>
+#include "busnode.h"
+#include "eeparams.h"
+#include "multiboard.h"
+#include "ui.h"
 
 
 // Rx Structures USART
@@ -37,8 +41,17 @@
   #else
     typedef struct{
       uint16_t  start;
+      #ifdef SERIAL_BUS
+      uint16_t  address;    // node id, BUS_ADDR_BROADCAST (busnode.h): all nodes
+      #endif
       int16_t   steer;
       int16_t   speed;
+      #ifdef MULTI_MODE_SERIAL
+      uint16_t  driveMode;  // requested drive mode. Values out of range are ignored
+      #endif
+      #ifdef FEEDBACK_TIMESTAMP
+      uint16_t  syncId;     // echoed in the feedback with the time since its reception, for the host clock sync
+      #endif
       uint16_t  checksum;
     } SerialCommand;
   #endif
@@ -67,6 +80,18 @@ typedef struct {
   int16_t   dband;  // deadband
 } InputStruct;
 
+// Drive Mode Structure
+typedef struct {
+  int16_t   max_speed;  // maximum speed
+  int16_t   rate;       // rate limiter rate fixdt(1,16,4)
+  int16_t   i_max;      // maximum phase current fixdt(1,16,4)
+  int16_t   n_max;      // maximum motor speed fixdt(1,16,4)
+} DriveMode;
+
+// Debug Print Functions
+void dbgPrintf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+void dbgUpdate(void);
+
 // Initialization Functions
 void BLDC_Init(void);
 void Input_Lim_Init(void);
@@ -74,14 +99,20 @@ void Input_Init(void);
 void UART_DisableRxErrors(UART_HandleTypeDef *huart);
 
 // General Functions
+#define CALIB_OFF         0         // no calibration running
+#define CALIB_INPUT       1         // input limits calibration (adcCalibLim)
+#define CALIB_LIMITS      2         // current and speed limits update (updateCurSpdLim)
 void poweronMelody(void);
 void beepCount(uint8_t cnt, uint8_t freq, uint8_t pattern);
 void beepLong(uint8_t freq);
 void beepShort(uint8_t freq);
 void beepShortMany(uint8_t cnt, int8_t dir);
+void beepTone(uint8_t freq, uint16_t duration);
+void beepUpdate(void);
 void calcAvgSpeed(void);
 void adcCalibLim(void);
 void updateCurSpdLim(void);
+void calibUpdate(void);
 void standstillHold(void);
 void electricBrake(uint16_t speedBlend, uint8_t reverseDir);
 void cruiseControl(uint8_t button);
@@ -91,6 +122,7 @@ int  checkInputType(int16_t min, int16_t mid, int16_t max);
 void calcInputCmd(InputStruct *in, int16_t out_min, int16_t out_max);
 void readInputRaw(void);
 void handleTimeout(void);
+void failsafeHandle(void);
 void readCommand(void);
 void usart2_rx_check(void);
 void usart3_rx_check(void);
@@ -100,19 +132,38 @@ void usart_process_debug(uint8_t *userCommand, uint32_t len);
 #if defined(CONTROL_SERIAL_USART2) || defined(CONTROL_SERIAL_USART3)
 void usart_process_command(SerialCommand *command_in, SerialCommand *command_out, uint8_t usart_idx);
 #endif
+#ifdef FEEDBACK_TIMESTAMP
+void feedbackTimestamp(uint32_t *time, uint16_t *id, uint16_t *age);
+#endif
 #if defined(SIDEBOARD_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART3)
 void usart_process_sideboard(SerialSideboard *Sideboard_in, SerialSideboard *Sideboard_out, uint8_t usart_idx);
 #endif
+#if defined(MULTI_BOARD_MASTER) || defined(MULTI_BOARD_SLAVE)
+void usart_process_link(void);
+#endif
 
 // Sideboard functions
 void sideboardLeds(uint8_t *leds);
 void sideboardSensors(uint8_t sensors);
 
+// Serial Bus Functions
+void busReplySet(const uint8_t *frame, uint16_t len);
+
+// Multi-Board Functions
+void multiBoardSend(void);
+void multiBoardSync(uint32_t *timerPrev);
+void torqueSplit(int16_t *cmdL, int16_t *cmdR);
+
 // Poweroff Functions
 void saveConfig(void);
 void poweroff(void);
+void poweroffUpdate(void);
 void poweroffPressCheck(void);
 
+// EEPROM Parameter Functions
+void eeParamsLoad(void);
+uint8_t eeParamsSave(void);
+
 // Filtering Functions
 void filtLowPass32(int32_t u, uint16_t coef, int32_t *y);
 void rateLimiter16(int16_t u, int16_t rate, int16_t *y);
@@ -127,5 +178,75 @@ typedef struct {
 } MultipleTap;
 void multipleTapDet(int16_t u, uint32_t timeNow, MultipleTap *x);
 
+// Stall Detection Function
+typedef struct {
+  uint16_t  cnt;        // qualification counter
+  uint16_t  fold;       // current limit foldback factor fixdt(0,16,15)
+  uint8_t   b_stall;    // stall detected
+} StallDetect;
+int16_t stallDetect(int16_t iq, int16_t n_mot, int16_t i_max, StallDetect *x);
+void curLimUpdate(void);
+
+// Motor Diagnostics Functions
+typedef struct {
+  uint16_t  satCnt;     // shunt saturation qualification counter
+  uint16_t  imbSmp;     // phase-imbalance window sample counter
+  uint8_t   imbCnt;     // consecutive windows with phase imbalance
+  int32_t   imbSum[3];  // accumulated absolute phase currents U, V, W
+  uint8_t   z_errCode;  // DIAG_ERR_* bit field, latched until power-off
+} MotorDiag;
+void motorSelfTest(void);
+void motorDiag(uint16_t adc1, uint16_t adc2, int16_t cur1, int16_t cur2, uint8_t pha1, int16_t n_mot, MotorDiag *x);
+
+// Drive Mode Functions
+void driveModeInit(void);
+void driveModeUpdate(void);
+
+// Control Type Scheduler Functions
+void ctrlSchedUpdate(void);
+void ctrlSchedNMidSet(void);
+void ctrlSchedNHiSet(void);
+
+// Stack Monitor Functions
+void stackPaint(void);
+void stackCheck(void);
+
+// Fault Capture Functions
+#define FAULT_MAGIC   0xFA11C0DE  // marks a valid fault record in .noinit RAM
+#ifdef __CC_ARM                   // Keil: zero_init makes .noinit a ZI section, left uncleared by the UNINIT region of mainboard-hack.sct
+  #define NOINIT      __attribute__((section(".noinit"), zero_init))
+#else
+  #define NOINIT      __attribute__((section(".noinit")))
+#endif
+typedef struct {
+  uint32_t  magic;      // FAULT_MAGIC while the record is unreported
+  uint32_t  r0, r1, r2, r3, r12;
+  uint32_t  lr;         // stacked LR: return address of the faulting function
+  uint32_t  pc;         // stacked PC: faulting instruction
+  uint32_t  psr;        // stacked xPSR
+  uint32_t  excReturn;  // EXC_RETURN of the fault handler: bit 2 set = PSP, else MSP
+  uint32_t  cfsr;       // Configurable Fault Status Register
+  uint32_t  hfsr;       // HardFault Status Register
+  uint32_t  bfar;       // BusFault Address Register
+  uint32_t  mmfar;      // MemManage Fault Address Register
+  uint16_t  isr;        // exception active when the fault occurred: 0 = main loop, 16+n = IRQn
+  uint16_t  handler;    // fault handler taken: 3 = HardFault, 4 = MemManage, 5 = BusFault, 6 = UsageFault
+  uint32_t  stack[8];   // stack words above the exception frame
+} FaultRecord;
+void faultCapture(uint32_t *frame, uint32_t excReturn);
+void faultReport(void);
+
+// Watchdog Functions (tasks: watchdog.h)
+void watchdogInit(void);
+void watchdogCheckIn(uint8_t task);
+void inputCheckIn(uint8_t idx);
+void watchdogYield(void);
+void watchdogSupervise(void);
+void resetReasonReport(void);
+
+// Bootloader Functions
+void bootConfirm(void);
+uint8_t bootEnter(void);
+
 #endif
 
@@ -0,0 +1,42 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Watchdog supervision (WATCHDOG_ENABLE): check-in deadlines of the supervised tasks. No HAL dependency,
+// tools/hostcheck runs it on a simulated time line. The IWDG itself is handled in util.c.
+
+// Define to prevent recursive inclusion
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <stdint.h>
+
+#define WDG_TASK_LOOP   0           // main loop
+#define WDG_TASK_INPUT  1           // input data: ADC conversion, serial frame, Nunchuk read, PPM / PWM pulse, board link
+#define WDG_TASKS       2
+
+typedef struct {
+  volatile uint32_t checkIn[WDG_TASKS];   // time of the last check-in of each task
+  uint8_t   miss;                         // tasks that missed their deadline, latched: bit n = WDG_TASK n
+} WdgSup;
+
+void    wdgSupInit(WdgSup *w, uint32_t now);
+void    wdgSupCheckIn(WdgSup *w, uint8_t task, uint32_t now);
+uint8_t wdgSupStep(WdgSup *w, uint32_t now, const uint32_t deadline[WDG_TASKS]);
+
+#endif  // WATCHDOG_H
@@ -19,6 +19,22 @@
 
 #include "BLDC_controller.h"
 
+/* Build-time control type specialization (post-processed, not generated):
+ * with CTRL_TYP_FIXED the control type is the constant CTRL_TYP_SEL and the
+ * compiler removes the code paths of the other control types from the step.
+ */
+#include "config.h"
+#ifdef CTRL_TYP_FIXED
+#define rtP_z_ctrlTypSel               ((uint8_T)CTRL_TYP_SEL)
+#else
+#define rtP_z_ctrlTypSel               (rtP->z_ctrlTypSel)
+#endif
+
+#undef OPEN_MODE                       /* redefined below with model types */
+#undef SPD_MODE
+#undef TRQ_MODE
+#undef VLT_MODE
+
 /* Named constants for Chart: '<S5>/F03_02_Control_Mode_Manager' */
 #define IN_ACTIVE                      ((uint8_T)1U)
 #define IN_NO_ACTIVE_CHILD             ((uint8_T)0U)
@@ -98,6 +114,14 @@ uint8_T plook_u8s16_evencka(int16_T u, int16_T bp0, uint16_T bpSpace, uint32_T
 uint8_T plook_u8u16_evencka(uint16_T u, uint16_T bp0, uint16_T bpSpace, uint32_T
   maxIndex);
 int32_T div_nde_s32_floor(int32_T numerator, int32_T denominator);
+static uint8_T plook_u8s16_evencka_pow2(int16_T u, int16_T bp0, uint8_T
+  bpShift, uint32_T maxIndex);
+static uint8_T plook_u8s16_evencka_rcp(int16_T u, int16_T bp0, uint32_T
+  bpRecip, uint32_T maxIndex);
+static uint8_T plook_u8u16_evencka_rcp(uint16_T u, uint16_T bp0, uint32_T
+  bpRecip, uint32_T maxIndex);
+static int32_T div_nde_s32_floor_rcp(int32_T numerator, uint32_T recip, uint8_T
+  shift);
 extern void Counter_Init(DW_Counter *localDW, int16_T rtp_z_cntInit);
 extern int16_T Counter(int16_T rtu_inc, int16_T rtu_max, boolean_T rtu_rst,
   DW_Counter *localDW);
@@ -194,6 +218,93 @@ int32_T div_nde_s32_floor(int32_T numerator, int32_T denominator)
            0) ? -1 : 0) + numerator / denominator;
 }
 
+/* ======================== Division-free helpers ========================
+ * Post-processed, not generated: drop-in replacements for the prelookups
+ * and floor divisions above, avoiding the hardware divide in the step.
+ * A divisor that is a power of two becomes a shift, any other divisor a
+ * multiplication by its reciprocal ceil(2^32 / divisor) keeping the high
+ * word. This is bit-exact for all uint16 dividends and divisors, because
+ * the reciprocal error, at most dividend / 2^32 < 2^-16, stays below
+ * 1 / divisor.
+ * Re-apply to the call sites marked 'Division-free' after regenerating,
+ * 'motorsim sweep' (tools/motorsim) checks them over their input range.
+ */
+/* plook_u8s16_evencka with bpSpace = 2^bpShift */
+static uint8_T plook_u8s16_evencka_pow2(int16_T u, int16_T bp0, uint8_T
+  bpShift, uint32_T maxIndex)
+{
+  uint8_T bpIndex;
+  uint16_T fbpIndex;
+  if (u <= bp0) {
+    bpIndex = 0U;
+  } else {
+    fbpIndex = (uint16_T)((uint16_T)(u - bp0) >> bpShift);
+    if (fbpIndex < maxIndex) {
+      bpIndex = (uint8_T)fbpIndex;
+    } else {
+      bpIndex = (uint8_T)maxIndex;
+    }
+  }
+
+  return bpIndex;
+}
+
+/* plook_u8s16_evencka with a constant bpSpace, bpRecip = ceil(2^32 / bpSpace) */
+static uint8_T plook_u8s16_evencka_rcp(int16_T u, int16_T bp0, uint32_T
+  bpRecip, uint32_T maxIndex)
+{
+  uint8_T bpIndex;
+  uint16_T fbpIndex;
+  if (u <= bp0) {
+    bpIndex = 0U;
+  } else {
+    fbpIndex = (uint16_T)(((uint64_T)(uint16_T)(u - bp0) * bpRecip) >> 32);
+    if (fbpIndex < maxIndex) {
+      bpIndex = (uint8_T)fbpIndex;
+    } else {
+      bpIndex = (uint8_T)maxIndex;
+    }
+  }
+
+  return bpIndex;
+}
+
+/* plook_u8u16_evencka with a constant bpSpace, bpRecip = ceil(2^32 / bpSpace) */
+static uint8_T plook_u8u16_evencka_rcp(uint16_T u, uint16_T bp0, uint32_T
+  bpRecip, uint32_T maxIndex)
+{
+  uint8_T bpIndex;
+  uint16_T fbpIndex;
+  if (u <= bp0) {
+    bpIndex = 0U;
+  } else {
+    fbpIndex = (uint16_T)(((uint64_T)(uint16_T)((uint32_T)u - bp0) * bpRecip) >>
+                          32);
+    if (fbpIndex < maxIndex) {
+      bpIndex = (uint8_T)fbpIndex;
+    } else {
+      bpIndex = (uint8_T)maxIndex;
+    }
+  }
+
+  return bpIndex;
+}
+
+/* div_nde_s32_floor by a positive constant, recip = ceil(2^shift / denominator).
+ * Bit-exact for |numerator| < 2^24 when denominator < 2^(shift - 24).
+ * Uses floor(-n / d) = -floor((n - 1) / d) - 1 for negative numerators.
+ */
+static int32_T div_nde_s32_floor_rcp(int32_T numerator, uint32_T recip, uint8_T
+  shift)
+{
+  if (numerator >= 0) {
+    return (int32_T)(((uint64_T)(uint32_T)numerator * recip) >> shift);
+  }
+
+  return -(int32_T)(((uint64_T)(uint32_T)(-1 - numerator) * recip) >> shift) -
+    1;
+}
+
 /* System initialize for atomic system: '<S13>/Counter' */
 void Counter_Init(DW_Counter *localDW, int16_T rtp_z_cntInit)
 {
@@ -1122,10 +1233,10 @@ void BLDC_controller_step(RT_MODEL *const rtM)
     /* End of Abs: '<S17>/Abs2' */
 
     /* Relay: '<S17>/dz_cntTrnsDet' */
-    if (rtb_Switch1_l >= rtP->dz_cntTrnsDetHi) {
+    if (rtb_Switch1_l >= rtConstP.dz_cntTrnsDetHi) {
       rtDW->dz_cntTrnsDet_Mode = true;
     } else {
-      if (rtb_Switch1_l <= rtP->dz_cntTrnsDetLo) {
+      if (rtb_Switch1_l <= rtConstP.dz_cntTrnsDetLo) {
         rtDW->dz_cntTrnsDet_Mode = false;
       }
     }
@@ -1157,7 +1268,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
        *  Product: '<S17>/Divide14'
        *  Switch: '<S17>/Switch2'
        */
-      rtb_Switch1_l = (int16_T)((rtP->cf_speedCoef << 4) /
+      rtb_Switch1_l = (int16_T)((rtConstP.cf_speedCoef << 4) /
         rtDW->z_counterRawPrev);
     } else {
       /* Switch: '<S17>/Switch1' incorporates:
@@ -1170,7 +1281,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
        *  UnitDelay: '<S17>/UnitDelay3'
        *  UnitDelay: '<S17>/UnitDelay5'
        */
-      rtb_Switch1_l = (int16_T)(((uint16_T)(rtP->cf_speedCoef << 2) << 4) /
+      rtb_Switch1_l = (int16_T)(((uint16_T)(rtConstP.cf_speedCoef << 2) << 4) /
         (int16_T)(((rtDW->UnitDelay2_DSTATE + rtDW->UnitDelay3_DSTATE_o) +
                    rtDW->UnitDelay5_DSTATE) + rtDW->z_counterRawPrev));
     }
@@ -1209,7 +1320,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
   /* Constant: '<S13>/Constant6' incorporates:
    *  Constant: '<S13>/z_maxCntRst2'
    */
-  rtb_Switch1_l = (int16_T) Counter(1, rtP->z_maxCntRst, rtb_LogicalOperator,
+  rtb_Switch1_l = (int16_T) Counter(1, rtConstP.z_maxCntRst, rtb_LogicalOperator,
     &rtDW->Counter_e);
 
   /* End of Outputs for SubSystem: '<S13>/Counter' */
@@ -1219,7 +1330,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
    *  Constant: '<S13>/z_maxCntRst'
    *  RelationalOperator: '<S13>/Relational Operator2'
    */
-  if (rtb_Switch1_l > rtP->z_maxCntRst) {
+  if (rtb_Switch1_l > rtConstP.z_maxCntRst) {
     Switch2 = 0;
   } else {
     Switch2 = rtDW->Divide11;
@@ -1237,10 +1348,10 @@ void BLDC_controller_step(RT_MODEL *const rtM)
   /* End of Abs: '<S13>/Abs5' */
 
   /* Relay: '<S13>/n_commDeacv' */
-  if (Abs5 >= rtP->n_commDeacvHi) {
+  if (Abs5 >= rtConstP.n_commDeacvHi) {
     rtDW->n_commDeacv_Mode = true;
   } else {
-    if (Abs5 <= rtP->n_commAcvLo) {
+    if (Abs5 <= rtConstP.n_commAcvLo) {
       rtDW->n_commDeacv_Mode = false;
     }
   }
@@ -1378,7 +1489,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
      *  Inport: '<Root>/a_mechAngle'
      *  Product: '<S15>/Divide'
      */
-    rtb_Sum1_jt = rtU->a_mechAngle * rtP->n_polePairs - 480;
+    rtb_Sum1_jt = rtU->a_mechAngle * rtConstP.n_polePairs - 480;
 
     /* DataTypeConversion: '<S15>/Data Type Conversion20' incorporates:
      *  Constant: '<S15>/a_elecPeriod'
@@ -1386,8 +1497,9 @@ void BLDC_controller_step(RT_MODEL *const rtM)
      *  Product: '<S19>/Divide3'
      *  Sum: '<S19>/Sum3'
      */
+    /* Division-free: floor(rtb_Sum1_jt / 5760), |rtb_Sum1_jt| < 2^24 */
     rtb_Merge_m = (int16_T)((int16_T)(rtb_Sum1_jt - ((int16_T)((int16_T)
-      div_nde_s32_floor(rtb_Sum1_jt, 5760) * 360) << 4)) << 2);
+      div_nde_s32_floor_rcp(rtb_Sum1_jt, 23860930U, 37U) * 360) << 4)) << 2);
 
     /* End of Outputs for SubSystem: '<S3>/F01_06_Electrical_Angle_Measurement' */
   }
@@ -1399,7 +1511,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
    */
   rtb_Sum2_h = rtDW->If1_ActiveSubsystem;
   UnitDelay3 = -1;
-  if (rtP->z_ctrlTypSel == 2) {
+  if (rtP_z_ctrlTypSel == 2) {
     UnitDelay3 = 0;
   }
 
@@ -1539,7 +1651,8 @@ void BLDC_controller_step(RT_MODEL *const rtM)
     /* End of If: '<S49>/If1' */
 
     /* PreLookup: '<S52>/a_elecAngle_XA' */
-    rtb_a_elecAngle_XA_g = plook_u8s16_evencka(rtb_Merge_m, 0, 128U, 180U);
+    /* Division-free: bpSpace 128 = 2^7 */
+    rtb_a_elecAngle_XA_g = plook_u8s16_evencka_pow2(rtb_Merge_m, 0, 7U, 180U);
 
     /* Interpolation_n-D: '<S52>/r_sin_M1' */
     rtDW->r_sin_M1 = rtConstP.r_sin_M1_Table[rtb_a_elecAngle_XA_g];
@@ -1632,7 +1745,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
       rtb_TmpSignalConversionAtLow_Pa[1] = (int16_T)rtb_Gain3;
 
       /* Outputs for Atomic SubSystem: '<S50>/Low_Pass_Filter' */
-      Low_Pass_Filter(rtb_TmpSignalConversionAtLow_Pa, rtP->cf_currFilt,
+      Low_Pass_Filter(rtb_TmpSignalConversionAtLow_Pa, rtConstP.cf_currFilt,
                       rtDW->DataTypeConversion, &rtDW->Low_Pass_Filter_m);
 
       /* End of Outputs for SubSystem: '<S50>/Low_Pass_Filter' */
@@ -1703,7 +1816,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
         }
 
         rtb_RelationalOperator1_mv = (rtU->b_motEna && (Abs5 <
-          rtP->n_stdStillDet) && (rtb_Saturation1 > rtP->r_errInpTgtThres));
+          rtConstP.n_stdStillDet) && (rtb_Saturation1 > rtConstP.r_errInpTgtThres));
       }
 
       /* End of Switch: '<S20>/Switch3' */
@@ -1721,8 +1834,8 @@ void BLDC_controller_step(RT_MODEL *const rtM)
         + (rtb_RelationalOperator1_mv << 2));
 
       /* Outputs for Atomic SubSystem: '<S20>/Debounce_Filter' */
-      Debounce_Filter(rtb_a_elecAngle_XA_g != 0, rtP->t_errQual,
-                      rtP->t_errDequal, &rtDW->Merge_p, &rtDW->Debounce_Filter_k);
+      Debounce_Filter(rtb_a_elecAngle_XA_g != 0, rtConstP.t_errQual,
+                      rtConstP.t_errDequal, &rtDW->Merge_p, &rtDW->Debounce_Filter_k);
 
       /* End of Outputs for SubSystem: '<S20>/Debounce_Filter' */
 
@@ -1879,7 +1992,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
      *  Inport: '<S34>/r_inpTgt'
      *  Saturate: '<S33>/Saturation'
      */
-    if (rtP->z_ctrlTypSel == 2) {
+    if (rtP_z_ctrlTypSel == 2) {
       /* Outputs for IfAction SubSystem: '<S33>/FOC_Control_Type' incorporates:
        *  ActionPort: '<S36>/Action Port'
        */
@@ -1890,7 +2003,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
        *  Constant: '<S36>/n_max'
        */
       tmp[0] = 0;
-      tmp[1] = rtP->Vd_max;
+      tmp[1] = rtConstP.Vd_max;
       tmp[2] = rtP->n_max;
       tmp[3] = rtP->i_max;
 
@@ -2018,11 +2131,11 @@ void BLDC_controller_step(RT_MODEL *const rtM)
        *  Constant: '<S37>/dV_openRate'
        *  RelationalOperator: '<S41>/LowerRelop1'
        */
-      if (rtb_Sum1 > rtP->dV_openRate) {
-        rtb_Sum1 = rtP->dV_openRate;
+      if (rtb_Sum1 > rtConstP.dV_openRate) {
+        rtb_Sum1 = rtConstP.dV_openRate;
       } else {
         /* Gain: '<S37>/Gain3' */
-        rtb_Gain3 = -rtP->dV_openRate;
+        rtb_Gain3 = -rtConstP.dV_openRate;
         rtb_Gain3 = (rtb_Gain3 & 134217728) != 0 ? rtb_Gain3 | -134217728 :
           rtb_Gain3 & 134217727;
 
@@ -2135,13 +2248,13 @@ void BLDC_controller_step(RT_MODEL *const rtM)
        *  RelationalOperator: '<S43>/UpperRelop'
        *  Switch: '<S43>/Switch'
        */
-      if (Abs5 > rtP->n_fieldWeakAuthHi) {
-        rtb_Saturation = rtP->n_fieldWeakAuthHi;
-      } else if (Abs5 < rtP->n_fieldWeakAuthLo) {
+      if (Abs5 > rtConstP.n_fieldWeakAuthHi) {
+        rtb_Saturation = rtConstP.n_fieldWeakAuthHi;
+      } else if (Abs5 < rtConstP.n_fieldWeakAuthLo) {
         /* Switch: '<S43>/Switch' incorporates:
          *  Constant: '<S42>/n_fieldWeakAuthLo'
          */
-        rtb_Saturation = rtP->n_fieldWeakAuthLo;
+        rtb_Saturation = rtConstP.n_fieldWeakAuthLo;
       } else {
         rtb_Saturation = Abs5;
       }
@@ -2155,8 +2268,8 @@ void BLDC_controller_step(RT_MODEL *const rtM)
        *  Sum: '<S42>/Sum4'
        */
       rtb_Divide1_f = (uint16_T)(((int16_T)(rtb_Saturation -
-        rtP->n_fieldWeakAuthLo) << 15) / (int16_T)(rtP->n_fieldWeakAuthHi -
-        rtP->n_fieldWeakAuthLo));
+        rtConstP.n_fieldWeakAuthLo) << 15) / (int16_T)(rtConstP.n_fieldWeakAuthHi -
+        rtConstP.n_fieldWeakAuthLo));
 
       /* Switch: '<S42>/Switch1' incorporates:
        *  MinMax: '<S42>/MinMax1'
@@ -2185,7 +2298,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
        *  Constant: '<S42>/id_fieldWeakMax'
        *  RelationalOperator: '<S42>/Relational Operator1'
        */
-      if (rtP->z_ctrlTypSel == 2) {
+      if (rtP_z_ctrlTypSel == 2) {
         rtb_Saturation1 = rtP->id_fieldWeakMax;
       } else {
         rtb_Saturation1 = rtP->a_phaAdvMax;
@@ -2210,7 +2323,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
      */
     rtb_Sum2_h = rtDW->If1_ActiveSubsystem_o;
     UnitDelay3 = -1;
-    if (rtP->z_ctrlTypSel == 2) {
+    if (rtP_z_ctrlTypSel == 2) {
       UnitDelay3 = 0;
     }
 
@@ -2224,7 +2337,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
       /* Outputs for IfAction SubSystem: '<S48>/Motor_Limitations_Enabled' incorporates:
        *  ActionPort: '<S80>/Action Port'
        */
-      rtDW->Vd_max1 = rtP->Vd_max;
+      rtDW->Vd_max1 = rtConstP.Vd_max;
 
       /* Gain: '<S80>/Gain3' incorporates:
        *  Constant: '<S80>/Vd_max1'
@@ -2242,9 +2355,9 @@ void BLDC_controller_step(RT_MODEL *const rtM)
         rtb_Saturation1 = rtDW->Switch1;
       }
 
-      rtDW->Vq_max_M1 = rtP->Vq_max_M1[plook_u8s16_evencka(rtb_Saturation1,
-        rtP->Vq_max_XA[0], (uint16_T)(rtP->Vq_max_XA[1] - rtP->Vq_max_XA[0]),
-        45U)];
+      /* Division-free: bpSpace 320, bpRecip = ceil(2^32 / 320) */
+      rtDW->Vq_max_M1 = rtConstP.Vq_max_M1[plook_u8s16_evencka_rcp(rtb_Saturation1,
+        0, 13421773U, 45U)];
 
       /* End of Interpolation_n-D: '<S80>/Vq_max_M1' */
 
@@ -2272,9 +2385,10 @@ void BLDC_controller_step(RT_MODEL *const rtM)
        *  PreLookup: '<S80>/iq_maxSca_XA'
        *  Product: '<S80>/Divide4'
        */
+      /* Division-free: bpSpace 1311, bpRecip = ceil(2^32 / 1311) */
       rtDW->Divide1_n = (int16_T)
-        ((rtConstP.iq_maxSca_M1_Table[plook_u8u16_evencka((uint16_T)rtb_Gain3,
-           0U, 1311U, 49U)] * rtDW->i_max) >> 16);
+        ((rtConstP.iq_maxSca_M1_Table[plook_u8u16_evencka_rcp((uint16_T)
+           rtb_Gain3, 0U, 3276101U, 49U)] * rtDW->i_max) >> 16);
 
       /* Gain: '<S80>/Gain1' */
       rtDW->Gain1 = (int16_T)-rtDW->Divide1_n;
@@ -2338,14 +2452,14 @@ void BLDC_controller_step(RT_MODEL *const rtM)
 
         /* Outputs for Atomic SubSystem: '<S83>/I_backCalc_fixdt' */
         I_backCalc_fixdt((int16_T)(rtDW->Divide1_n - rtDW->Abs5_h),
-                         rtP->cf_iqKiLimProt, rtP->cf_KbLimProt, rtDW->Abs1, 0,
+                         rtConstP.cf_iqKiLimProt, rtConstP.cf_KbLimProt, rtDW->Abs1, 0,
                          &rtDW->Switch2_a, &rtDW->I_backCalc_fixdt_i);
 
         /* End of Outputs for SubSystem: '<S83>/I_backCalc_fixdt' */
 
         /* Outputs for Atomic SubSystem: '<S83>/I_backCalc_fixdt1' */
-        I_backCalc_fixdt((int16_T)(rtP->n_max - Abs5), rtP->cf_nKiLimProt,
-                         rtP->cf_KbLimProt, rtDW->Abs1, 0, &rtDW->Switch2_o,
+        I_backCalc_fixdt((int16_T)(rtP->n_max - Abs5), rtConstP.cf_nKiLimProt,
+                         rtConstP.cf_KbLimProt, rtDW->Abs1, 0, &rtDW->Switch2_o,
                          &rtDW->I_backCalc_fixdt1);
 
         /* End of Outputs for SubSystem: '<S83>/I_backCalc_fixdt1' */
@@ -2378,7 +2492,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
          *  Sum: '<S81>/Sum3'
          */
         rtDW->Divide1 = (int16_T)(rtb_Saturation1 - rtDW->DataTypeConversion[0])
-          * rtP->cf_iqKiLimProt;
+          * rtConstP.cf_iqKiLimProt;
 
         /* End of Outputs for SubSystem: '<S80>/Speed_Mode_Protection' */
         break;
@@ -2404,8 +2518,8 @@ void BLDC_controller_step(RT_MODEL *const rtM)
          */
 
         /* Outputs for Atomic SubSystem: '<S82>/I_backCalc_fixdt' */
-        I_backCalc_fixdt((int16_T)(rtP->n_max - Abs5), rtP->cf_nKiLimProt,
-                         rtP->cf_KbLimProt, rtDW->Vq_max_M1, 0, &rtDW->Switch2_i,
+        I_backCalc_fixdt((int16_T)(rtP->n_max - Abs5), rtConstP.cf_nKiLimProt,
+                         rtConstP.cf_KbLimProt, rtDW->Vq_max_M1, 0, &rtDW->Switch2_i,
                          &rtDW->I_backCalc_fixdt_j);
 
         /* End of Outputs for SubSystem: '<S82>/I_backCalc_fixdt' */
@@ -2432,7 +2546,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
        */
       rtb_Sum2_h = rtDW->If1_ActiveSubsystem_j;
       UnitDelay3 = -1;
-      if (rtP->z_ctrlTypSel == 2) {
+      if (rtP_z_ctrlTypSel == 2) {
         UnitDelay3 = 0;
       }
 
@@ -2612,7 +2726,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
           }
 
           /* Outputs for Atomic SubSystem: '<S61>/PI_clamp_fixdt' */
-          PI_clamp_fixdt_l((int16_T)rtb_Gain3, rtP->cf_nKp, rtP->cf_nKi,
+          PI_clamp_fixdt_l((int16_T)rtb_Gain3, rtConstP.cf_nKp, rtConstP.cf_nKi,
                            rtDW->UnitDelay4_DSTATE_eu,
                            rtb_TmpSignalConversionAtLow_Pa[0],
                            rtb_TmpSignalConversionAtLow_Pa[1], rtDW->Divide1,
@@ -2696,7 +2810,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
            *  Sum: '<S62>/Sum2'
            *  UnitDelay: '<S8>/UnitDelay4'
            */
-          PI_clamp_fixdt_k((int16_T)rtb_Gain3, rtP->cf_iqKp, rtP->cf_iqKi,
+          PI_clamp_fixdt_k((int16_T)rtb_Gain3, rtConstP.cf_iqKp, rtConstP.cf_iqKi,
                            rtDW->UnitDelay4_DSTATE_eu, rtb_Saturation1,
                            rtb_Saturation, 0, &rtDW->Merge,
                            &rtDW->PI_clamp_fixdt_kh);
@@ -2781,7 +2895,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
           }
 
           /* Outputs for Atomic SubSystem: '<S63>/PI_clamp_fixdt' */
-          PI_clamp_fixdt((int16_T)rtb_Gain3, rtP->cf_idKp, rtP->cf_idKi, 0,
+          PI_clamp_fixdt((int16_T)rtb_Gain3, rtConstP.cf_idKp, rtConstP.cf_idKi, 0,
                          rtDW->Vd_max1, rtDW->Gain3, 0, &rtDW->Switch1,
                          &rtDW->PI_clamp_fixdt_i);
 
@@ -2809,7 +2923,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
    */
   rtb_Sum2_h = rtDW->If2_ActiveSubsystem;
   UnitDelay3 = -1;
-  if (rtP->z_ctrlTypSel == 2) {
+  if (rtP_z_ctrlTypSel == 2) {
     rtb_Saturation = rtDW->Merge;
     UnitDelay3 = 0;
   } else {
@@ -3007,7 +3121,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
    * About '<S94>/z_commutMap_M1':
    *  2-dimensional Direct Look-Up returning a Column
    */
-  if (rtb_LogicalOperator && (rtP->z_ctrlTypSel == 2)) {
+  if (rtb_LogicalOperator && (rtP_z_ctrlTypSel == 2)) {
     /* Outputs for IfAction SubSystem: '<S8>/FOC_Method' incorporates:
      *  ActionPort: '<S95>/Action Port'
      */
@@ -3016,7 +3130,7 @@ void BLDC_controller_step(RT_MODEL *const rtM)
     rtb_Merge1 = rtDW->Gain4_e[2];
 
     /* End of Outputs for SubSystem: '<S8>/FOC_Method' */
-  } else if (rtb_LogicalOperator && (rtP->z_ctrlTypSel == 1)) {
+  } else if (rtb_LogicalOperator && (rtP_z_ctrlTypSel == 1)) {
     /* Outputs for IfAction SubSystem: '<S8>/SIN_Method' incorporates:
      *  ActionPort: '<S96>/Action Port'
      */
@@ -3032,8 +3146,9 @@ void BLDC_controller_step(RT_MODEL *const rtM)
        */
       DataTypeConversion2 = (int16_T)((int16_T)((int16_T)(rtDW->Divide3 *
         rtDW->Switch2_e) << 2) + rtb_Merge_m);
-      DataTypeConversion2 -= (int16_T)((int16_T)((int16_T)div_nde_s32_floor
-        (DataTypeConversion2, 23040) * 360) << 6);
+      /* Division-free: floor(DataTypeConversion2 / 23040) */
+      DataTypeConversion2 -= (int16_T)((int16_T)((int16_T)div_nde_s32_floor_rcp
+        (DataTypeConversion2, 23860930U, 39U) * 360) << 6);
     } else {
       DataTypeConversion2 = rtb_Merge_m;
     }
@@ -3041,7 +3156,8 @@ void BLDC_controller_step(RT_MODEL *const rtM)
     /* End of Switch: '<S97>/Switch_PhaAdv' */
 
     /* PreLookup: '<S96>/a_elecAngle_XA' */
-    Sum = plook_u8s16_evencka(DataTypeConversion2, 0, 128U, 180U);
+    /* Division-free: bpSpace 128 = 2^7 */
+    Sum = plook_u8s16_evencka_pow2(DataTypeConversion2, 0, 7U, 180U);
 
     /* Product: '<S96>/Divide2' incorporates:
      *  Interpolation_n-D: '<S96>/r_sin3PhaA_M1'
@@ -3184,7 +3300,6 @@ void BLDC_controller_step(RT_MODEL *const rtM)
 /* Model initialize function */
 void BLDC_controller_initialize(RT_MODEL *const rtM)
 {
-  P *rtP = ((P *) rtM->defaultParam);
   DW *rtDW = ((DW *) rtM->dwork);
 
   /* Start for Atomic SubSystem: '<Root>/BLDC_controller' */
@@ -3237,19 +3352,19 @@ void BLDC_controller_initialize(RT_MODEL *const rtM)
 
   /* SystemInitialize for Atomic SubSystem: '<Root>/BLDC_controller' */
   /* InitializeConditions for UnitDelay: '<S13>/UnitDelay3' */
-  rtDW->UnitDelay3_DSTATE = rtP->z_maxCntRst;
+  rtDW->UnitDelay3_DSTATE = rtConstP.z_maxCntRst;
 
   /* InitializeConditions for UnitDelay: '<S2>/UnitDelay2' */
   rtDW->UnitDelay2_DSTATE_c = true;
 
   /* SystemInitialize for IfAction SubSystem: '<S13>/Raw_Motor_Speed_Estimation' */
   /* SystemInitialize for Outport: '<S17>/z_counter' */
-  rtDW->z_counterRawPrev = rtP->z_maxCntRst;
+  rtDW->z_counterRawPrev = rtConstP.z_maxCntRst;
 
   /* End of SystemInitialize for SubSystem: '<S13>/Raw_Motor_Speed_Estimation' */
 
   /* SystemInitialize for Atomic SubSystem: '<S13>/Counter' */
-  Counter_Init(&rtDW->Counter_e, rtP->z_maxCntRst);
+  Counter_Init(&rtDW->Counter_e, rtConstP.z_maxCntRst);
 
   /* End of SystemInitialize for SubSystem: '<S13>/Counter' */
 
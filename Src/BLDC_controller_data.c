@@ -147,10 +147,8 @@ const ConstP rtConstP = {
   /* Computed Parameter: vec_hallToPos_Value
    * Referenced by: '<S11>/vec_hallToPos'
    */
-  { 0, 2, 0, 1, 4, 3, 5, 0 }
-};
+  { 0, 2, 0, 1, 4, 3, 5, 0 },
 
-P rtP_Left = {
   /* Variable: dV_openRate
    * Referenced by: '<S37>/dV_openRate'
    */
@@ -166,11 +164,6 @@ P rtP_Left = {
    */
   20,
 
-  /* Variable: n_cruiseMotTgt
-   * Referenced by: '<S61>/n_cruiseMotTgt'
-   */
-  0,
-
   /* Variable: z_maxCntRst
    * Referenced by:
    *   '<S13>/Counter'
@@ -219,23 +212,6 @@ P rtP_Left = {
     8640, 8960, 9280, 9600, 9920, 10240, 10560, 10880, 11200, 11520, 11840,
     12160, 12480, 12800, 13120, 13440, 13760, 14080, 14400 },
 
-  /* Variable: a_phaAdvMax
-   * Referenced by: '<S42>/a_phaAdvMax'
-   */
-  400,
-
-  /* Variable: i_max
-   * Referenced by:
-   *   '<S36>/i_max'
-   *   '<S80>/i_max'
-   */
-  12000,
-
-  /* Variable: id_fieldWeakMax
-   * Referenced by: '<S42>/id_fieldWeakMax'
-   */
-  4000,
-
   /* Variable: n_commAcvLo
    * Referenced by: '<S13>/n_commDeacv'
    */
@@ -256,13 +232,6 @@ P rtP_Left = {
    */
   4800,
 
-  /* Variable: n_max
-   * Referenced by:
-   *   '<S36>/n_max'
-   *   '<S80>/n_max1'
-   */
-  16000,
-
   /* Variable: n_stdStillDet
    * Referenced by: '<S13>/n_stdStillDet'
    */
@@ -273,16 +242,6 @@ P rtP_Left = {
    */
   9600,
 
-  /* Variable: r_fieldWeakHi
-   * Referenced by: '<S42>/r_fieldWeakHi'
-   */
-  16000,
-
-  /* Variable: r_fieldWeakLo
-   * Referenced by: '<S42>/r_fieldWeakLo'
-   */
-  12000,
-
   /* Variable: cf_KbLimProt
    * Referenced by:
    *   '<S82>/cf_KbLimProt'
@@ -342,7 +301,48 @@ P rtP_Left = {
   /* Variable: n_polePairs
    * Referenced by: '<S15>/n_polePairs'
    */
-  15U,
+  15U
+};
+
+P rtP_Left = {
+  /* Variable: n_cruiseMotTgt
+   * Referenced by: '<S61>/n_cruiseMotTgt'
+   */
+  0,
+
+  /* Variable: a_phaAdvMax
+   * Referenced by: '<S42>/a_phaAdvMax'
+   */
+  400,
+
+  /* Variable: i_max
+   * Referenced by:
+   *   '<S36>/i_max'
+   *   '<S80>/i_max'
+   */
+  12000,
+
+  /* Variable: id_fieldWeakMax
+   * Referenced by: '<S42>/id_fieldWeakMax'
+   */
+  4000,
+
+  /* Variable: n_max
+   * Referenced by:
+   *   '<S36>/n_max'
+   *   '<S80>/n_max1'
+   */
+  16000,
+
+  /* Variable: r_fieldWeakHi
+   * Referenced by: '<S42>/r_fieldWeakHi'
+   */
+  16000,
+
+  /* Variable: r_fieldWeakLo
+   * Referenced by: '<S42>/r_fieldWeakLo'
+   */
+  12000,
 
   /* Variable: z_ctrlTypSel
    * Referenced by: '<S1>/z_ctrlTypSel'
@@ -27,6 +27,8 @@
 #include "setup.h"
 #include "config.h"
 #include "util.h"
+#include "ctrlsched.h"
+#include "watchdog.h"
 
 // Matlab includes and defines - from auto-code generation
 // ###############################################################################
@@ -49,6 +51,9 @@ extern ExtY rtY_Right;                  /* External outputs */
 static int16_t pwm_margin;              /* This margin allows to have a window in the PWM signal for proper FOC Phase currents measurement */
 
 extern uint8_t ctrlModReq;
+#ifdef CTRL_SCHED_ENABLE
+extern CtrlSched ctrlSched;
+#endif
 static int16_t curDC_max = (I_DC_MAX * A2BIT_CONV);
 int16_t curL_phaA = 0, curL_phaB = 0, curL_DC = 0;
 int16_t curR_phaB = 0, curR_phaC = 0, curR_DC = 0;
@@ -78,6 +83,23 @@ static int16_t offsetrrC    = 2000;
 static int16_t offsetdcl    = 2000;
 static int16_t offsetdcr    = 2000;
 
+#ifdef CYCLE_MEASURE_ENABLE
+uint32_t cycIsr             = 0;        // execution time of the last motor control ISR [CPU cycles]
+uint32_t cycIsrMax          = 0;        // maximum execution time of the motor control ISR [CPU cycles]
+#endif
+
+#ifdef WATCHDOG_ENABLE
+extern uint8_t wdgMiss;                 // tasks that missed their watchdog deadline
+#endif
+
+#ifdef MOTOR_DIAG_ENABLE
+MotorDiag diagLeft;                     // diagnostics of the Left motor
+MotorDiag diagRight;                    // diagnostics of the Right motor
+volatile uint8_t  selfTestPha = 0;      // phase pulsed by the self test: 1 = U, 2 = V, 3 = W
+volatile uint16_t selfTestCnt = 0;      // remaining self test pulse length [PWM periods]
+volatile int16_t  selfTestCur[6];       // currents at the end of the pulse: curL_phaA, curL_phaB, curL_DC, curR_phaB, curR_phaC, curR_DC
+#endif
+
 int16_t        batVoltage       = (400 * BAT_CELLS * BAT_CALIB_ADC) / BAT_CALIB_REAL_VOLTAGE;
 static int32_t batVoltageFixdt  = (400 * BAT_CELLS * BAT_CALIB_ADC) / BAT_CALIB_REAL_VOLTAGE << 16;  // Fixed-point filter output initialized at 400 V*100/cell = 4 V/cell converted to fixed-point
 
@@ -102,6 +124,10 @@ int8_t calc_encoder_ticks(uint8_t enc_val_previous, uint8_t enc_val_current) {
 // =================================
 void DMA1_Channel1_IRQHandler(void) {
 
+  #ifdef CYCLE_MEASURE_ENABLE
+  uint32_t cycStart = DWT->CYCCNT;
+  #endif
+
   DMA1->IFCR = DMA_IFCR_CTCIF1;
   // HAL_GPIO_WritePin(LED_PORT, LED_PIN, 1);
   // HAL_GPIO_TogglePin(LED_PORT, LED_PIN);
@@ -114,6 +140,16 @@ void DMA1_Channel1_IRQHandler(void) {
     offsetrrC = (adc_buffer.rrC + offsetrrC) / 2;
     offsetdcl = (adc_buffer.dcl + offsetdcl) / 2;
     offsetdcr = (adc_buffer.dcr + offsetdcr) / 2;
+    #ifdef MOTOR_DIAG_ENABLE
+    if (offsetcount == 2000) {  // calibration done: a dead current sensor sits far away from mid-scale
+      if (ABS(offsetrlA - 2048) > DIAG_OFFSET_TOL || ABS(offsetrlB - 2048) > DIAG_OFFSET_TOL || ABS(offsetdcl - 2048) > DIAG_OFFSET_TOL) {
+        diagLeft.z_errCode  |= DIAG_ERR_SENSOR;
+      }
+      if (ABS(offsetrrB - 2048) > DIAG_OFFSET_TOL || ABS(offsetrrC - 2048) > DIAG_OFFSET_TOL || ABS(offsetdcr - 2048) > DIAG_OFFSET_TOL) {
+        diagRight.z_errCode |= DIAG_ERR_SENSOR;
+      }
+    }
+    #endif
     return;
   }
 
@@ -132,6 +168,33 @@ void DMA1_Channel1_IRQHandler(void) {
   curR_phaC = (int16_t)(offsetrrC - adc_buffer.rrC);
   curR_DC   = (int16_t)(offsetdcr - adc_buffer.dcr);
 
+  #ifdef MOTOR_DIAG_ENABLE
+  // Power-on self test: pulse the same phase of both motors against the other two phases. The models are not stepped
+  if (selfTestCnt && selfTestPha >= 1 && selfTestPha <= 3) {
+    uint16_t ccr[3];
+    ccr[0] = ccr[1] = ccr[2]  = pwm_res / 2 - DIAG_TEST_DUTY;
+    ccr[selfTestPha - 1]      = pwm_res / 2 + DIAG_TEST_DUTY;
+    if (--selfTestCnt == 0 || ABS(curL_DC) > DIAG_TEST_I_SHORT || ABS(curR_DC) > DIAG_TEST_I_SHORT) {
+      selfTestCur[0] = curL_phaA; selfTestCur[1] = curL_phaB; selfTestCur[2] = curL_DC;
+      selfTestCur[3] = curR_phaB; selfTestCur[4] = curR_phaC; selfTestCur[5] = curR_DC;
+      selfTestCnt = 0;
+      ccr[0] = ccr[1] = ccr[2]  = pwm_res / 2;
+      LEFT_TIM->BDTR  &= ~TIM_BDTR_MOE;
+      RIGHT_TIM->BDTR &= ~TIM_BDTR_MOE;
+    } else {
+      LEFT_TIM->BDTR  |= TIM_BDTR_MOE;
+      RIGHT_TIM->BDTR |= TIM_BDTR_MOE;
+    }
+    LEFT_TIM->LEFT_TIM_U    = ccr[0];
+    LEFT_TIM->LEFT_TIM_V    = ccr[1];
+    LEFT_TIM->LEFT_TIM_W    = ccr[2];
+    RIGHT_TIM->RIGHT_TIM_U  = ccr[0];
+    RIGHT_TIM->RIGHT_TIM_V  = ccr[1];
+    RIGHT_TIM->RIGHT_TIM_W  = ccr[2];
+    return;
+  }
+  #endif
+
   // Disable PWM when current limit is reached (current chopping)
   // This is the Level 2 of current protection. The Level 1 should kick in first given by I_MOT_MAX
   if(ABS(curL_DC) > curDC_max || enable == 0) {
@@ -163,8 +226,21 @@ void DMA1_Channel1_IRQHandler(void) {
       buzzerPrev = 0;
   }
 
+  #ifdef WATCHDOG_ENABLE
+  #if defined(CONTROL_ADC)
+  inputCheckIn(CONTROL_ADC);                // ADC input sampled with this conversion
+  #elif defined(VARIANT_TRANSPOTTER)
+  watchdogCheckIn(WDG_TASK_INPUT);          // Gametrak sampled with this conversion
+  #endif
+  watchdogSupervise();
+  #endif
+
   // Adjust pwm_margin depending on the selected Control Type
+  #ifdef CTRL_TYP_FIXED
+  if (CTRL_TYP_SEL == FOC_CTRL) {
+  #else
   if (rtP_Left.z_ctrlTypSel == FOC_CTRL) {
+  #endif
     pwm_margin = 110;
   } else {
     pwm_margin = 0;
@@ -184,6 +260,18 @@ void DMA1_Channel1_IRQHandler(void) {
 
   /* Make sure to stop BOTH motors in case of an error */
   enableFin = enable && !rtY_Left.z_errCode && !rtY_Right.z_errCode;
+
+  #ifdef WATCHDOG_ENABLE
+  enableFin = enableFin && !wdgMiss;
+  #endif
+
+  #ifdef MOTOR_DIAG_ENABLE
+  enableFin = enableFin && !diagLeft.z_errCode && !diagRight.z_errCode;
+  if (enableFin) {  // Runtime shunt-saturation and phase-imbalance checks. Left measures phases U, V; Right measures V, W
+    motorDiag(adc_buffer.rlA, adc_buffer.rlB, curL_phaA, curL_phaB, 0, rtY_Left.n_mot,  &diagLeft);
+    motorDiag(adc_buffer.rrB, adc_buffer.rrC, curR_phaB, curR_phaC, 1, rtY_Right.n_mot, &diagRight);
+  }
+  #endif
  
   // ========================= LEFT MOTOR ============================ 
     // Get hall sensors values
@@ -194,7 +282,11 @@ void DMA1_Channel1_IRQHandler(void) {
     /* Set motor inputs here */
     rtU_Left.b_motEna     = enableFin;
     rtU_Left.z_ctrlModReq = ctrlModReq;  
+    #ifdef CTRL_SCHED_ENABLE
+    rtU_Left.r_inpTgt     = (int16_t)CLAMP((pwml * ctrlSched.gain) >> 14, -2000, 2000);  // same phase voltage over a control type switch
+    #else
     rtU_Left.r_inpTgt     = pwml;
+    #endif
     rtU_Left.b_hallA      = hall_ul;
     rtU_Left.b_hallB      = hall_vl;
     rtU_Left.b_hallC      = hall_wl;
@@ -241,7 +333,11 @@ void DMA1_Channel1_IRQHandler(void) {
     /* Set motor inputs here */
     rtU_Right.b_motEna      = enableFin;
     rtU_Right.z_ctrlModReq  = ctrlModReq;
+    #ifdef CTRL_SCHED_ENABLE
+    rtU_Right.r_inpTgt      = (int16_t)CLAMP((pwmr * ctrlSched.gain) >> 14, -2000, 2000);
+    #else
     rtU_Right.r_inpTgt      = pwmr;
+    #endif
     rtU_Right.b_hallA       = hall_ur;
     rtU_Right.b_hallB       = hall_vr;
     rtU_Right.b_hallC       = hall_wr;
@@ -279,6 +375,11 @@ void DMA1_Channel1_IRQHandler(void) {
 
   /* Indicate task complete */
   OverrunFlag = false;
+
+  #ifdef CYCLE_MEASURE_ENABLE
+  cycIsr    = DWT->CYCCNT - cycStart;
+  cycIsrMax = MAX(cycIsrMax, cycIsr);
+  #endif
  
  // ###############################################################################
 
@@ -0,0 +1,85 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Includes
+#include <string.h>
+#include "busnode.h"
+
+// XOR of all 16 bit words of the frame except the checksum (last word)
+static uint16_t busChecksum(const void *frame, uint32_t len) {
+  const uint16_t *word = (const uint16_t *)frame;
+  uint16_t checksum = 0;
+  for (uint32_t i = 0; i < len / 2 - 1; i++) {
+    checksum ^= word[i];
+  }
+  return checksum;
+}
+
+ /*
+ * Idle line interrupt: the bytes the Rx DMA wrote to its ring buffer since oldPos up to pos. Only a burst of exactly
+ * len bytes is copied to frame, so replies (other length) and bursts of back to back frames are dropped.
+ * Returns 1 if a frame was copied.
+ */
+uint8_t busRxBurst(const uint8_t *ring, uint32_t ringLen, uint32_t oldPos, uint32_t pos, void *frame, uint32_t len) {
+  uint8_t *dst = (uint8_t *)frame;
+  if (pos > oldPos && pos - oldPos == len) {                    // "Linear" buffer mode
+    memcpy(dst, &ring[oldPos], len);
+    return 1;
+  }
+  if (pos <= oldPos && ringLen - oldPos + pos == len) {         // "Overflow" buffer mode: end, then start of the ring
+    memcpy(dst, &ring[oldPos], ringLen - oldPos);
+    memcpy(dst + ringLen - oldPos, ring, pos);
+    return 1;
+  }
+  return 0;
+}
+
+ /*
+ * Check a command frame of len bytes (SerialCommand: start, address, ..., checksum) and count it. Only BUS_RX_OWN and
+ * BUS_RX_BROADCAST commands are applied.
+ */
+uint8_t busCommandRx(const void *frame, uint32_t len, uint8_t node, BusStats *stats) {
+  const uint16_t *word = (const uint16_t *)frame;
+  if (word[0] != BUS_CMD_START_FRAME || word[len / 2 - 1] != busChecksum(frame, len)) {
+    return BUS_RX_INVALID;
+  }
+  if (word[1] == node) {
+    stats->own++;
+    return BUS_RX_OWN;
+  }
+  if (word[1] == BUS_ADDR_BROADCAST) {
+    stats->broadcast++;
+    return BUS_RX_BROADCAST;
+  }
+  stats->other++;
+  return BUS_RX_OTHER;
+}
+
+ /*
+ * Poll of this node: reply if the main loop has set a feedback frame and the previous reply is out (txReady).
+ * Returns 1 to send the reply, else the poll is counted as busy.
+ */
+uint8_t busReplyReady(uint16_t replyLen, uint8_t txReady, BusStats *stats) {
+  if (!replyLen || !txReady) {
+    stats->busy++;
+    return 0;
+  }
+  stats->reply++;
+  return 1;
+}
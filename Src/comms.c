@@ -28,6 +28,7 @@
 #include "BLDC_controller.h"
 #include "util.h"
 #include "comms.h"
+#include "ctrlsched.h"
 
 #if defined(DEBUG_SERIAL_PROTOCOL)
 #if defined(DEBUG_SERIAL_PROTOCOL) && (defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3))
@@ -42,6 +43,8 @@
 
 
 #define MAX_PARAM_WATCH 15
+#define PROFILE_VERSION   1
+#define PROFILE_MAX_SIZE  128     // [bytes] Parameter profile: header(4) + values(2 each) + CRC(2)
 
 extern ExtY rtY_Left;                   /* External outputs */
 extern ExtU rtU_Left;                   /* External inputs */
@@ -66,10 +69,46 @@ extern int16_t right_dc_curr;
 extern int16_t dc_curr;
 extern int16_t cmdL; 
 extern int16_t cmdR; 
+#ifdef STALL_DETECT_ENABLE
+extern StallDetect stallLeft;
+extern StallDetect stallRight;
+#endif
+#ifdef MOTOR_DIAG_ENABLE
+extern MotorDiag diagLeft;
+extern MotorDiag diagRight;
+#endif
+extern uint8_t calibReq;
+extern InputStruct calIn1;
+extern InputStruct calIn2;
+extern FaultRecord faultLast;
+extern uint8_t resetReason;
+extern uint8_t wdgMissLast;
+extern uint16_t dbgDrop;
+#ifdef STACK_MONITOR_ENABLE
+extern uint16_t stackUsed;
+extern uint16_t stackFree;
+#endif
+#ifdef CYCLE_MEASURE_ENABLE
+extern uint32_t cycIsr;
+extern uint32_t cycIsrMax;
+extern uint32_t cycLoopMax;
+#endif
+extern int16_t   iMotMax;
+#ifdef CTRL_SCHED_ENABLE
+extern CtrlSched ctrlSched;
+#endif
+#ifdef MULTI_MODE_DRIVE
+extern uint8_t   drive_mode;
+extern DriveMode driveModes[];
+#endif
+#ifdef SERIAL_BUS
+extern uint8_t   busNode;
+extern BusStats  busStats;
+#endif
 
 
 
-enum commandTypes {READ,WRITE};
+enum commandTypes {READ,WRITE,BLOB};
 // Function0 - Function with 0 parameter
 // Function1 - Function with 1 parameter (e.g. GET PARAM)
 // Function2 - Function with 2 parameter (e.g. SET PARAM XXXX)
@@ -81,50 +120,83 @@ const command_entry commands[] = {
     {WRITE  ,"SET"     ,NULL              ,NULL            ,setParamValExt ,"Set Parameter"},
     {WRITE  ,"INIT"    ,NULL              ,initParamVal    ,NULL           ,"Init Parameter from EEPROM or CONFIG.H"},
     {WRITE  ,"SAVE"    ,saveAllParamVal   ,NULL            ,NULL           ,"Save Parameters to EEPROM"},
+    {READ   ,"EXPORT"  ,exportParamBlob   ,NULL            ,NULL           ,"Export Parameters as hex profile"},
+    {BLOB   ,"IMPORT"  ,importParamBlob   ,NULL            ,NULL           ,"Import profile: IMPORT <hex> per chunk, then IMPORT"},
+#ifdef BOOT_SLOT
+    {WRITE  ,"UPDATE"  ,enterBootloader   ,NULL            ,NULL           ,"Reset into the serial bootloader"},
+#endif
 };
 
 enum paramTypes {PARAMETER,VARIABLE};
+// Persistent parameters: the rows are generated from the EEPROM parameter registry EE_PARAMS in eeparams.h
+#define EE_PARAM_ROW(id, addr, name, var, varR, init, initFormat, min, max, div, mul, fix, callback, help) \
+    {PARAMETER  ,name ,ADD_PARAM(var) ,varR ,addr ,init ,initFormat ,min ,max ,div ,mul ,fix ,callback ,help},
 const parameter_entry params[] = {
   // CONTROL PARAMETERS
   // Type       ,Name                 ,Datatype ,ValueL ptr                  ,ValueR                    ,EEPRM Addr ,Init              Int/Ext ,Min    ,Max    ,Div             ,Mul  ,Fix   ,Callback Function  ,Help text
     {PARAMETER  ,"CTRL_MOD"           ,ADD_PARAM(ctrlModReqRaw)              ,NULL                      ,0          ,CTRL_MOD_REQ      ,0      ,1      ,3      ,0               ,0    ,0     ,NULL               ,"Ctrl mode 1:VLT 2:SPD 3:TRQ"},
+#if defined(CTRL_SCHED_ENABLE)
+    {VARIABLE   ,"CTRL_TYP"           ,ADD_PARAM(rtP_Left.z_ctrlTypSel)      ,&rtP_Right.z_ctrlTypSel   ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Ctrl type 0:COM 1:SIN 2:FOC (scheduled)"},
+#elif !defined(CTRL_TYP_FIXED)
     {PARAMETER  ,"CTRL_TYP"           ,ADD_PARAM(rtP_Left.z_ctrlTypSel)      ,&rtP_Right.z_ctrlTypSel   ,0          ,CTRL_TYP_SEL      ,0      ,0      ,2      ,0               ,0    ,0     ,NULL               ,"Ctrl type 0:COM 1:SIN 2:FOC"},
-    {PARAMETER  ,"I_MOT_MAX"          ,ADD_PARAM(rtP_Left.i_max)             ,&rtP_Right.i_max          ,1          ,I_MOT_MAX         ,1      ,1      ,40     ,A2BIT_CONV      ,0    ,4     ,NULL               ,"Max phase current A"},
-    {PARAMETER  ,"N_MOT_MAX"          ,ADD_PARAM(rtP_Left.n_max)             ,&rtP_Right.n_max          ,2          ,N_MOT_MAX         ,1      ,10     ,2000   ,0               ,0    ,4     ,NULL               ,"Max motor RPM"},
+#endif
+    EE_PARAMS_LIMITS(EE_PARAM_ROW)
     {PARAMETER  ,"FI_WEAK_ENA"        ,ADD_PARAM(rtP_Left.b_fieldWeakEna)    ,&rtP_Right.b_fieldWeakEna ,0          ,FIELD_WEAK_ENA    ,0      ,0      ,1      ,0               ,0    ,0     ,NULL               ,"Enable field weak"},
   	{PARAMETER  ,"FI_WEAK_HI"         ,ADD_PARAM(rtP_Left.r_fieldWeakHi)     ,&rtP_Right.r_fieldWeakHi  ,0          ,FIELD_WEAK_HI     ,1      ,0      ,1500   ,0               ,0    ,4     ,Input_Lim_Init     ,"Field weak high RPM"},
 	  {PARAMETER  ,"FI_WEAK_LO"         ,ADD_PARAM(rtP_Left.r_fieldWeakLo)     ,&rtP_Right.r_fieldWeakLo  ,0          ,FIELD_WEAK_LO     ,1      ,0      ,1000   ,0               ,0    ,4     ,Input_Lim_Init     ,"Field weak low RPM"},
     {PARAMETER  ,"FI_WEAK_MAX"        ,ADD_PARAM(rtP_Left.id_fieldWeakMax)   ,&rtP_Right.id_fieldWeakMax,0          ,FIELD_WEAK_MAX    ,1      ,0      ,20     ,A2BIT_CONV      ,0    ,4     ,NULL               ,"Field weak max current A(FOC)"},
     {PARAMETER  ,"PHA_ADV_MAX"        ,ADD_PARAM(rtP_Left.a_phaAdvMax)       ,&rtP_Right.a_phaAdvMax    ,0          ,PHASE_ADV_MAX     ,1      ,0      ,55     ,0               ,0    ,4     ,NULL               ,"Max Phase Adv angle Deg(SIN)"},     
+#ifdef CTRL_SCHED_ENABLE
+  // CONTROL TYPE SCHEDULER
+  // Type       ,Name                 ,Datatype ,ValueL ptr                  ,ValueR                    ,EEPRM Addr ,Init              Int/Ext ,Min    ,Max    ,Div             ,Mul  ,Fix   ,Callback Function  ,Help text
+    {PARAMETER  ,"SCHED_N_MID"        ,ADD_PARAM(ctrlSched.n_mid)            ,NULL                      ,0          ,CTRL_SCHED_N_MID  ,0      ,0      ,2000   ,0               ,0    ,0     ,ctrlSchedNMidSet   ,"Sched low/mid band speed RPM"},
+    {PARAMETER  ,"SCHED_N_HI"         ,ADD_PARAM(ctrlSched.n_hi)             ,NULL                      ,0          ,CTRL_SCHED_N_HI   ,0      ,0      ,2000   ,0               ,0    ,0     ,ctrlSchedNHiSet    ,"Sched mid/high band speed RPM"},
+    {PARAMETER  ,"SCHED_I_HI"         ,ADD_PARAM(ctrlSched.i_hi)             ,NULL                      ,0          ,CTRL_SCHED_I_HI   ,1      ,0      ,40     ,A2BIT_CONV      ,0    ,0     ,NULL               ,"Sched low band DC current A"},
+    {PARAMETER  ,"SCHED_MATCH"        ,ADD_PARAM(ctrlSched.matchEna)         ,NULL                      ,0          ,1                 ,0      ,0      ,1      ,0               ,0    ,0     ,NULL               ,"Sched voltage matching"},
+    {VARIABLE   ,"SCHED_GAIN"         ,ADD_PARAM(ctrlSched.gain)             ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Sched input gain fixdt(0,16,14)"},
+    {VARIABLE   ,"SCHED_SW"           ,ADD_PARAM(ctrlSched.switches)         ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Sched control type switches"},
+#endif
+#ifdef MULTI_MODE_DRIVE
+  // DRIVE MODES
+  // Type       ,Name                 ,Datatype ,ValueL ptr                  ,ValueR                    ,EEPRM Addr ,Init                      Int/Ext ,Min    ,Max    ,Div             ,Mul  ,Fix   ,Callback Function  ,Help text
+    {PARAMETER  ,"DRV_MODE"           ,ADD_PARAM(drive_mode)                  ,NULL                      ,0          ,0                         ,0      ,0      ,MULTI_MODE_DRIVE_NR-1,0               ,0    ,0     ,NULL               ,"Active drive mode (switched smoothly)"},
+    EE_PARAMS_DRIVE_MODES(EE_PARAM_ROW)
+#endif
+#ifdef SERIAL_BUS
+  // SERIAL BUS
+  // Type       ,Name                 ,Datatype ,ValueL ptr                  ,ValueR                    ,EEPRM Addr ,Init              Int/Ext ,Min    ,Max    ,Div             ,Mul  ,Fix   ,Callback Function  ,Help text
+    EE_PARAMS_BUS(EE_PARAM_ROW)
+    {VARIABLE   ,"BUS_OWN"            ,ADD_PARAM(busStats.own)               ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Bus commands to this node"},
+    {VARIABLE   ,"BUS_BCAST"          ,ADD_PARAM(busStats.broadcast)         ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Bus broadcast commands"},
+    {VARIABLE   ,"BUS_OTHER"          ,ADD_PARAM(busStats.other)             ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Bus commands to other nodes"},
+    {VARIABLE   ,"BUS_REPLY"          ,ADD_PARAM(busStats.reply)             ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Bus replies sent"},
+    {VARIABLE   ,"BUS_BUSY"           ,ADD_PARAM(busStats.busy)              ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Bus polls not answered"},
+#endif
   // INPUT PARAMETERS
   // Type       ,Name                 ,ValueL ptr                            ,ValueR                    ,EEPRM Addr ,Init              Int/Ext ,Min    ,Max    ,Div             ,Mul  ,Fix   ,Callback Function  ,Help text
     {VARIABLE   ,"IN1_RAW"            ,ADD_PARAM(input1[0].raw)              ,NULL                      ,0          ,0                 ,0      ,RAW_MIN,RAW_MAX,0               ,0    ,0     ,0                  ,"Input1 raw"},        
-    {PARAMETER  ,"IN1_TYP"            ,ADD_PARAM(input1[0].typ)              ,NULL                      ,3          ,0                 ,0      ,0      ,3      ,0               ,0    ,0     ,0                  ,"Input1 type"},        
-    {PARAMETER  ,"IN1_MIN"            ,ADD_PARAM(input1[0].min)              ,NULL                      ,4          ,RAW_MIN           ,0      ,RAW_MIN,RAW_MAX,0               ,0    ,0     ,0                  ,"Input1 min"},        
-    {PARAMETER  ,"IN1_MID"            ,ADD_PARAM(input1[0].mid)              ,NULL                      ,5          ,0                 ,0      ,RAW_MIN,RAW_MAX,0               ,0    ,0     ,0                  ,"Input1 mid"},
-    {PARAMETER  ,"IN1_MAX"            ,ADD_PARAM(input1[0].max)              ,NULL                      ,6          ,RAW_MAX           ,0      ,RAW_MIN,RAW_MAX,0               ,0    ,0     ,0                  ,"Input1 max"},        
+    EE_PARAMS_IN1(EE_PARAM_ROW)
     {VARIABLE   ,"IN1_CMD"            ,ADD_PARAM(input1[0].cmd)              ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,0                  ,"Input1 cmd"},        
     
     {VARIABLE   ,"IN2_RAW"            ,ADD_PARAM(input2[0].raw)              ,NULL                      ,0          ,0                 ,0      ,RAW_MIN,RAW_MAX,0               ,0    ,0     ,0                  ,"Input2 raw"},   
-    {PARAMETER  ,"IN2_TYP"            ,ADD_PARAM(input2[0].typ)              ,NULL                      ,7          ,0                 ,0      ,0      ,3      ,0               ,0    ,0     ,0                  ,"Input2 type"},        
-    {PARAMETER  ,"IN2_MIN"            ,ADD_PARAM(input2[0].min)              ,NULL                      ,8          ,RAW_MIN           ,0      ,RAW_MIN,RAW_MAX,0               ,0    ,0     ,0                  ,"Input2 min"},        
-    {PARAMETER  ,"IN2_MID"            ,ADD_PARAM(input2[0].mid)              ,NULL                      ,9          ,0                 ,0      ,RAW_MIN,RAW_MAX,0               ,0    ,0     ,0                  ,"Input2 mid"},
-    {PARAMETER  ,"IN2_MAX"            ,ADD_PARAM(input2[0].max)              ,NULL                      ,10         ,RAW_MAX           ,0      ,RAW_MIN,RAW_MAX,0               ,0    ,0     ,0                  ,"Input2 max"},
+    EE_PARAMS_IN2(EE_PARAM_ROW)
     {VARIABLE   ,"IN2_CMD"            ,ADD_PARAM(input2[0].cmd)              ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,0                  ,"Input2 cmd"},
+
+    {PARAMETER  ,"CALIB"              ,ADD_PARAM(calibReq)                   ,NULL                      ,0          ,0                 ,0      ,0      ,2      ,0               ,0    ,0     ,0                  ,"Calibration 1:Inputs 2:Limits 0:Confirm"},
+    {VARIABLE   ,"CAL_IN1_MIN"        ,ADD_PARAM(calIn1.min)                 ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,0                  ,"Calibration input1 min"},
+    {VARIABLE   ,"CAL_IN1_MID"        ,ADD_PARAM(calIn1.mid)                 ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,0                  ,"Calibration input1 mid"},
+    {VARIABLE   ,"CAL_IN1_MAX"        ,ADD_PARAM(calIn1.max)                 ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,0                  ,"Calibration input1 max"},
+    {VARIABLE   ,"CAL_IN2_MIN"        ,ADD_PARAM(calIn2.min)                 ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,0                  ,"Calibration input2 min"},
+    {VARIABLE   ,"CAL_IN2_MID"        ,ADD_PARAM(calIn2.mid)                 ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,0                  ,"Calibration input2 mid"},
+    {VARIABLE   ,"CAL_IN2_MAX"        ,ADD_PARAM(calIn2.max)                 ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,0                  ,"Calibration input2 max"},
 #if defined(PRI_INPUT1) && defined(PRI_INPUT2) && defined(AUX_INPUT1) && defined(AUX_INPUT2)  
   // Type       ,Name                 ,ValueL ptr                            ,ValueR                    ,EEPRM Addr ,Init              Int/Ext ,Min    ,Max    ,Div             ,Mul  ,Fix   ,Callback Function  ,Help text
     {VARIABLE   ,"AUX_IN1_RAW"        ,ADD_PARAM(input1[1].raw)              ,NULL                      ,0          ,0                 ,0      ,RAW_MIN,RAW_MAX,0               ,0    ,0     ,0                  ,"Aux. input1 raw"},        
-    {PARAMETER  ,"AUX_IN1_TYP"        ,ADD_PARAM(input1[1].typ)              ,NULL                      ,11         ,0                 ,0      ,0      ,3      ,0               ,0    ,0     ,0                  ,"Aux. input1 type"},        
-    {PARAMETER  ,"AUX_IN1_MIN"        ,ADD_PARAM(input1[1].min)              ,NULL                      ,12         ,RAW_MIN           ,0      ,RAW_MIN,RAW_MAX,0               ,0    ,0     ,0                  ,"Aux. input1 min"},        
-    {PARAMETER  ,"AUX_IN1_MID"        ,ADD_PARAM(input1[1].mid)              ,NULL                      ,13         ,0                 ,0      ,RAW_MIN,RAW_MAX,0               ,0    ,0     ,0                  ,"Aux. input1 mid"},
-    {PARAMETER  ,"AUX_IN1_MAX"        ,ADD_PARAM(input1[1].max)              ,NULL                      ,14         ,RAW_MAX           ,0      ,RAW_MIN,RAW_MAX,0               ,0    ,0     ,0                  ,"Aux. input1 max"},        
+    EE_PARAMS_AUX_IN1(EE_PARAM_ROW)
     {VARIABLE   ,"AUX_IN1_CMD"        ,ADD_PARAM(input1[1].cmd)              ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,0                  ,"Aux. input1 cmd"},        
     
     {VARIABLE   ,"AUX_IN2_RAW"        ,ADD_PARAM(input2[1].raw)              ,NULL                      ,0          ,0                 ,0      ,RAW_MIN,RAW_MAX,0               ,0    ,0     ,0                  ,"Aux. input2 raw"},        
-    {PARAMETER  ,"AUX_IN2_TYP"        ,ADD_PARAM(input2[1].typ)              ,NULL                      ,15         ,0                 ,0      ,0      ,3      ,0               ,0    ,0     ,0                  ,"Aux. input2 type"},        
-    {PARAMETER  ,"AUX_IN2_MIN"        ,ADD_PARAM(input2[1].min)              ,NULL                      ,16         ,RAW_MIN           ,0      ,RAW_MIN,RAW_MAX,0               ,0    ,0     ,0                  ,"Aux. input2 min"},        
-    {PARAMETER  ,"AUX_IN2_MID"        ,ADD_PARAM(input2[1].mid)              ,NULL                      ,17         ,0                 ,0      ,RAW_MIN,RAW_MAX,0               ,0    ,0     ,0                  ,"Aux. input2 mid"},
-    {PARAMETER  ,"AUX_IN2_MAX"        ,ADD_PARAM(input2[1].max)              ,NULL                      ,18         ,RAW_MAX           ,0      ,RAW_MIN,RAW_MAX,0               ,0    ,0     ,0                  ,"Aux. input2 max"},
+    EE_PARAMS_AUX_IN2(EE_PARAM_ROW)
     {VARIABLE   ,"AUX_IN2_CMD"        ,ADD_PARAM(input2[1].cmd)              ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,0                  ,"Aux. input2 cmd"},
 #endif  
   // FEEDBACK
@@ -137,6 +209,30 @@ const parameter_entry params[] = {
     {VARIABLE   ,"SPD_AVG"            ,ADD_PARAM(speedAvg)                   ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Motor Measured Avg RPM"},
     {VARIABLE   ,"SPDL"               ,ADD_PARAM(rtY_Left.n_mot)             ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Left Motor Measured RPM"},
     {VARIABLE   ,"SPDR"               ,ADD_PARAM(rtY_Right.n_mot)            ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Right Motor Measured RPM"},
+#ifdef STALL_DETECT_ENABLE
+    {VARIABLE   ,"STALLL"             ,ADD_PARAM(stallLeft.b_stall)          ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Left Motor stalled"},
+    {VARIABLE   ,"STALLR"             ,ADD_PARAM(stallRight.b_stall)         ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Right Motor stalled"},
+#endif
+#ifdef MOTOR_DIAG_ENABLE
+    {VARIABLE   ,"DIAGL"              ,ADD_PARAM(diagLeft.z_errCode)         ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Left Motor diagnostics code"},
+    {VARIABLE   ,"DIAGR"              ,ADD_PARAM(diagRight.z_errCode)        ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Right Motor diagnostics code"},
+#endif
+#ifdef STACK_MONITOR_ENABLE
+    {VARIABLE   ,"STACK_USED"         ,ADD_PARAM(stackUsed)                  ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Stack high-water mark bytes"},
+    {VARIABLE   ,"STACK_FREE"         ,ADD_PARAM(stackFree)                  ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Stack never used bytes"},
+#endif
+    {VARIABLE   ,"FAULT_PC"           ,ADD_PARAM(faultLast.pc)               ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"PC of the last fault"},
+    {VARIABLE   ,"FAULT_LR"           ,ADD_PARAM(faultLast.lr)               ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"LR of the last fault"},
+    {VARIABLE   ,"FAULT_CFSR"         ,ADD_PARAM(faultLast.cfsr)             ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"CFSR of the last fault"},
+    {VARIABLE   ,"FAULT_ISR"          ,ADD_PARAM(faultLast.isr)              ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Exception active at the last fault"},
+    {VARIABLE   ,"RST_FLAGS"          ,ADD_PARAM(resetReason)                ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Reset flags (RCC_CSR >> 26)"},
+    {VARIABLE   ,"WDG_MISS"           ,ADD_PARAM(wdgMissLast)                ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Tasks missed before watchdog reset"},
+    {VARIABLE   ,"DBG_DROP"           ,ADD_PARAM(dbgDrop)                    ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Debug output dropped in interrupts"},
+#ifdef CYCLE_MEASURE_ENABLE
+    {VARIABLE   ,"CYC_ISR"            ,ADD_PARAM(cycIsr)                     ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Motor ISR cycles (72/us)"},
+    {VARIABLE   ,"CYCMAX_LOOP"        ,ADD_PARAM(cycLoopMax)                 ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Max main loop cycles"},
+    {VARIABLE   ,"CYCMAX_ISR"         ,ADD_PARAM(cycIsrMax)                  ,NULL                      ,0          ,0                 ,0      ,0      ,0      ,0               ,0    ,0     ,NULL               ,"Max motor ISR cycles"},
+#endif
     {VARIABLE   ,"RATE"               ,0       , NULL                        ,NULL                      ,0          ,RATE              ,0      ,0      ,0      ,0               ,0    ,4     ,NULL               ,"Rate *10"},
     {VARIABLE   ,"SPD_COEF"           ,0       , NULL                        ,NULL                      ,0          ,SPEED_COEFFICIENT ,0      ,0      ,0      ,0               ,10   ,14    ,NULL               ,"Speed Coefficient *10"},
     {VARIABLE   ,"STR_COEF"           ,0       , NULL                        ,NULL                      ,0          ,STEER_COEFFICIENT ,0      ,0      ,0      ,0               ,10   ,14    ,NULL               ,"Steer Coefficient *10"},
@@ -146,7 +242,7 @@ const parameter_entry params[] = {
 };
 
 
-const char *errors[9] = {
+const char *errors[13] = {
   "Command not found", // Err1
   "Parameter not found", // Err2
   "This command cannot be used with a Variable", // Err3
@@ -155,12 +251,17 @@ const char *errors[9] = {
   "Start of line expected", // Err6
   "End of line expected", // Err7
   "Parameter expected", // Err8
-  "Uncaught error" // Err9
-  "Watch list is full" // Err10
+  "Uncaught error", // Err9
+  "Watch list is full", // Err10
+  "Profile invalid", // Err11
+  "Profile value not in range", // Err12
+  "Wheels not at standstill" // Err13
 };
 
 debug_command command;
 int8_t watchParamList[MAX_PARAM_WATCH] = {-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1}; 
+uint8_t  profileBuf[PROFILE_MAX_SIZE];  // IMPORT staging buffer, filled chunk by chunk from the Rx interrupt
+uint16_t profileLen;
 
 // Set Param with Value from external format
 int8_t setParamValExt(uint8_t index, int32_t value) {   
@@ -175,37 +276,42 @@ int8_t setParamValExt(uint8_t index, int32_t value) {
   return ret;
 }
 
+// Cast and assign value from internal format
+static void writeParamValInt(uint8_t index, int32_t newValue) {
+  switch (params[index].datatype){
+    case UINT8_T:
+      if (params[index].valueL != NULL) *(uint8_t*)params[index].valueL = newValue;
+      if (params[index].valueR != NULL) *(uint8_t*)params[index].valueR = newValue;
+      break;
+    case UINT16_T:
+      if (params[index].valueL != NULL) *(uint16_t*)params[index].valueL = newValue; 
+      if (params[index].valueR != NULL) *(uint16_t*)params[index].valueR = newValue;
+      break;
+    case UINT32_T:
+      if (params[index].valueL != NULL) *(uint32_t*)params[index].valueL = newValue; 
+      if (params[index].valueR != NULL) *(uint32_t*)params[index].valueR = newValue;
+      break;
+    case INT8_T:
+      if (params[index].valueL != NULL) *(int8_t*)params[index].valueL = newValue; 
+      if (params[index].valueR != NULL) *(int8_t*)params[index].valueR = newValue;
+      break;
+    case INT16_T:
+      if (params[index].valueL != NULL) *(int16_t*)params[index].valueL = newValue; 
+      if (params[index].valueR != NULL) *(int16_t*)params[index].valueR = newValue;
+      break;
+    case INT32_T:
+      if (params[index].valueL != NULL) *(int32_t*)params[index].valueL = newValue; 
+      if (params[index].valueR != NULL) *(int32_t*)params[index].valueR = newValue;
+      break;
+  }
+}
+
 // Set Param with value from internal format
 int8_t setParamValInt(uint8_t index, int32_t newValue) {
   int32_t oldValue = getParamValInt(index);
   if (oldValue != newValue){ 
     // if value is different, beep, cast and assign new value
-    switch (params[index].datatype){
-      case UINT8_T:
-        if (params[index].valueL != NULL) *(uint8_t*)params[index].valueL = newValue;
-        if (params[index].valueR != NULL) *(uint8_t*)params[index].valueR = newValue;
-        break;
-      case UINT16_T:
-        if (params[index].valueL != NULL) *(uint16_t*)params[index].valueL = newValue; 
-        if (params[index].valueR != NULL) *(uint16_t*)params[index].valueR = newValue;
-        break;
-      case UINT32_T:
-        if (params[index].valueL != NULL) *(uint32_t*)params[index].valueL = newValue; 
-        if (params[index].valueR != NULL) *(uint32_t*)params[index].valueR = newValue;
-        break;
-      case INT8_T:
-        if (params[index].valueL != NULL) *(int8_t*)params[index].valueL = newValue; 
-        if (params[index].valueR != NULL) *(int8_t*)params[index].valueR = newValue;
-        break;
-      case INT16_T:
-        if (params[index].valueL != NULL) *(int16_t*)params[index].valueL = newValue; 
-        if (params[index].valueR != NULL) *(int16_t*)params[index].valueR = newValue;
-        break;
-      case INT32_T:
-        if (params[index].valueL != NULL) *(int32_t*)params[index].valueL = newValue; 
-        if (params[index].valueR != NULL) *(int32_t*)params[index].valueR = newValue;
-        break;
-    }
+    writeParamValInt(index, newValue);
 
     // Beep if value was modified
     beepShort(5);
@@ -294,51 +400,51 @@ int8_t watchParamVal(uint8_t index){
 int8_t printParamVal(){
   int8_t i = 0; 
   for(i=0;i < MAX_PARAM_WATCH && watchParamList[i]>-1;i++){
-    printf("%s:%li ",params[watchParamList[i]].name,getParamValExt(watchParamList[i]));
+    dbgPrintf("%s:%li ",params[watchParamList[i]].name,getParamValExt(watchParamList[i]));
   }
-  if (i>0) printf("\r\n");
+  if (i>0) dbgPrintf("\r\n");
   return 1;
 }
 
 // Print help for Command
 int8_t printCommandHelp(uint8_t index){
-  printf("? %s:\"%s\"\r\n",commands[index].name,commands[index].help);
+  dbgPrintf("? %s:\"%s\"\r\n",commands[index].name,commands[index].help);
   return 1;
 }
 
 // Print help for parameter
 int8_t printParamHelp(uint8_t index){
-  printf("? %s:\"%s\" ",params[index].name,params[index].help);
-  if (params[index].type == PARAMETER) printf("[min:%li max:%li]",params[index].min,params[index].max);
-  printf("\r\n");
+  dbgPrintf("? %s:\"%s\" ",params[index].name,params[index].help);
+  if (params[index].type == PARAMETER) dbgPrintf("[min:%li max:%li]",params[index].min,params[index].max);
+  dbgPrintf("\r\n");
   return 1;
 }
 
 // Print help for all parameters
 int8_t printAllParamHelp(){
-  printf("? Commands\r\n");
+  dbgPrintf("? Commands\r\n");
   for(int i=0;i<COMMAND_SIZE(commands);i++)
     printCommandHelp(i);
-  printf("?\r\n");
+  dbgPrintf("?\r\n");
 
-  printf("? Parameters\r\n");
+  dbgPrintf("? Parameters\r\n");
   for(int i=0;i<PARAM_SIZE(params);i++){
     if (params[i].type == PARAMETER) printParamHelp(i);
   }
-  printf("?\r\n");
+  dbgPrintf("?\r\n");
 
-  printf("? Variables\r\n");
+  dbgPrintf("? Variables\r\n");
   for(int i=0;i<PARAM_SIZE(params);i++){
     if (params[i].type == VARIABLE) printParamHelp(i);
   }
-  printf("?\r\n");
+  dbgPrintf("?\r\n");
 
   return 1;
 }
 
 // Print definition(name,value,initial value, min, max) for parameter
 int8_t printParamDef(uint8_t index){
-  printf("# name:\"%s\" value:%li init:%li min:%li max:%li\r\n",
+  dbgPrintf("# name:\"%s\" value:%li init:%li min:%li max:%li\r\n",
          params[index].name,     // Parameter Name
          getParamValExt(index),  // Parameter Value translated to external format
          getParamInitExt(index), // Parameter Init Value translated to external format
@@ -354,7 +460,7 @@ int8_t printAllParamDef(){
 }
 
 void printError(uint8_t errornum ){
-  printf("! Err%i:\"%s\"\r\n",errornum,errors[errornum-1]);
+  dbgPrintf("! Err%i:\"%s\"\r\n",errornum,errors[errornum-1]);
 }
 
 // Function to increment a value
@@ -372,17 +478,9 @@ int8_t incrParamVal(uint8_t index) {
   } 
 }
 
-// Get internal Parameter value and save it to EEprom for all paraemeter with an address assigned 
+// Save the parameters of the EEPROM registry (EE_PARAMS in eeparams.h) to EEprom, unchanged ones are not written again
 int8_t saveAllParamVal() {
-  HAL_FLASH_Unlock();
-  EE_WriteVariable(VirtAddVarTab[0] , (uint16_t)FLASH_WRITE_KEY);
-  for(int i=0;i<PARAM_SIZE(params);i++){ 
-    // Only Parameters with eeprom address can be saved
-    if (params[i].addr){
-      EE_WriteVariable(VirtAddVarTab[params[i].addr] , (uint16_t)getParamValInt(i));    
-    }
-  }
-  HAL_FLASH_Lock();
+  eeParamsSave();
   return 1;
 }
 
@@ -417,15 +515,15 @@ int32_t getParamInitExt(uint8_t index) {
 int16_t getParamInitInt(uint8_t index){
   if (params[index].addr){
     // if EEPROM address is specified, init from EEPROM address
-    uint16_t writeCheck, readVal;
+    uint16_t writeCheck, readVal, readStatus;
     
     HAL_FLASH_Unlock();
     EE_ReadVariable(VirtAddVarTab[0], &writeCheck);
-    EE_ReadVariable(VirtAddVarTab[params[index].addr] , &readVal);
+    readStatus = EE_ReadVariable(VirtAddVarTab[params[index].addr] , &readVal);
     HAL_FLASH_Lock();
     
-    // EEPROM was written, use stored value
-    if (writeCheck == FLASH_WRITE_KEY){
+    // EEPROM was written and holds this parameter, use stored value
+    if (writeCheck == FLASH_WRITE_KEY && readStatus == 0){
       return readVal;
     }else{
       // Use init value from array
@@ -455,6 +553,126 @@ int8_t initParamVal(uint8_t index) {
   return ret;
 }
 
+// Parameters in the profile: all Parameters except the CALIB request
+static uint8_t inProfile(uint8_t index){
+  return params[index].type == PARAMETER && params[index].valueL != &calibReq;
+}
+
+// CRC-16/CCITT-FALSE
+static uint16_t profileCrc(const uint8_t *data, uint16_t len, uint16_t crc){
+  while (len--){
+    crc ^= (uint16_t)*data++ << 8;
+    for (uint8_t i = 0; i < 8; i++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+// Profile header: version, number of values, CRC of the parameter names (rejects profiles of a different parameter table)
+static uint16_t profileHeader(uint8_t *blob){
+  uint8_t  count  = 0;
+  uint16_t layout = 0xFFFF;
+  for(int i=0;i<PARAM_SIZE(params);i++){
+    if (inProfile(i)){
+      layout = profileCrc((const uint8_t *)params[i].name, strlen(params[i].name), layout);
+      count++;
+    }
+  }
+  blob[0] = PROFILE_VERSION;
+  blob[1] = count;
+  blob[2] = (uint8_t)layout;
+  blob[3] = (uint8_t)(layout >> 8);
+  return 4;
+}
+
+// Reset into the serial bootloader, does not return on success
+int8_t enterBootloader(){
+  bootEnter();
+  printError(13);
+  return 0;
+}
+
+// Print all Parameters in external format as one hex line: "% <header><int16 values><CRC16>", little endian
+int8_t exportParamBlob(){
+  uint8_t  blob[PROFILE_MAX_SIZE];
+  uint16_t len = profileHeader(blob);
+  if (len + 2*blob[1] + 2 > PROFILE_MAX_SIZE){
+    printError(11);
+    return 0;
+  }
+  for(int i=0;i<PARAM_SIZE(params);i++){
+    if (inProfile(i)){
+      int16_t value = (int16_t)getParamValExt(i);
+      blob[len++] = (uint8_t)value;
+      blob[len++] = (uint8_t)(value >> 8);
+    }
+  }
+  uint16_t crc = profileCrc(blob, len, 0xFFFF);
+  blob[len++] = (uint8_t)crc;
+  blob[len++] = (uint8_t)(crc >> 8);
+
+  dbgPrintf("%% ");
+  for(uint16_t i=0;i<len;i++) dbgPrintf("%02X",blob[i]);
+  dbgPrintf("\r\n");
+  return 1;
+}
+
+// Stage a hex chunk of an IMPORT, called from the Rx interrupt. Returns an error number or 0
+static uint8_t stageParamBlob(uint8_t *userCommand, uint32_t len){
+  for (; len > 1 && *userCommand != '\n' && *userCommand != '\r'; userCommand+=2, len-=2){
+    uint8_t byte = 0;
+    for (uint8_t k = 0; k < 2; k++){
+      uint8_t c = userCommand[k];
+      byte <<= 4;
+      if      ((unsigned)c-'0' < 10) byte |= c-'0';
+      else if ((unsigned)c-'A' < 6)  byte |= c-'A'+10;
+      else if ((unsigned)c-'a' < 6)  byte |= c-'a'+10;
+      else {profileLen = 0; return 11;}   // Error - Profile invalid
+    }
+    if (profileLen >= PROFILE_MAX_SIZE){profileLen = 0; return 11;}
+    profileBuf[profileLen++] = byte;
+  }
+  return 0;
+}
+
+// Apply the staged profile: version, layout, length and CRC are checked and all values are validated against min/max before any is applied
+int8_t importParamBlob(){
+  uint8_t  header[4];
+  uint16_t len = profileLen;
+  profileLen   = 0;           // The next IMPORT chunk starts a new profile
+  profileHeader(header);
+
+  if (len != 4 + 2*header[1] + 2 || memcmp(profileBuf, header, 4) != 0 ||
+      profileCrc(profileBuf, len - 2, 0xFFFF) != (uint16_t)(profileBuf[len-2] | (profileBuf[len-1] << 8))){
+    printError(11);
+    return 0;
+  }
+
+  uint8_t *value = &profileBuf[4];
+  for(int i=0;i<PARAM_SIZE(params);i++){
+    if (inProfile(i)){
+      if (!IN_RANGE((int16_t)(value[0] | (value[1] << 8)),params[i].min,params[i].max)){
+        dbgPrintf("%s ",params[i].name);
+        printError(12);
+        return 0;
+      }
+      value += 2;
+    }
+  }
+
+  value = &profileBuf[4];
+  for(int i=0;i<PARAM_SIZE(params);i++){
+    if (inProfile(i)){
+      writeParamValInt(i,extToInt(i,(int16_t)(value[0] | (value[1] << 8))));
+      value += 2;
+    }
+  }
+  for(int i=0;i<PARAM_SIZE(params);i++){
+    if (inProfile(i) && params[i].callback_function) (*params[i].callback_function)();
+  }
+  beepShort(5);
+  return 1;
+}
+
 // Find command in commands array and return index
 int8_t findCommand(uint8_t *userCommand, uint32_t len){
   for(int index=0;index<COMMAND_SIZE(commands);index++){
@@ -516,6 +734,12 @@ void handle_input(uint8_t *userCommand, uint32_t len)
   // Skip if space
   if (*userCommand == 0x20){len-=1;userCommand+=1;}
 
+  if (commands[cindex].type == BLOB && *userCommand != '\n' && *userCommand != '\r'){
+    // Data chunk: stage it, the command without data applies it
+    command.error = stageParamBlob(userCommand,len);
+    return;
+  }
+
   if (*userCommand == '\n' || *userCommand == '\r'){
     if (commands[cindex].callback_function0 != NULL){
       // Command without parameter
@@ -624,7 +848,7 @@ void process_debug()
       command.param_index == -1){
     // This function needs no parameter
     ret = (*commands[command.command_index].callback_function0)();
-    if (ret==1){printf("OK\r\n");}
+    if (ret==1){dbgPrintf("OK\r\n");}
     command.semaphore = 0;
     return;
   }
@@ -633,7 +857,7 @@ void process_debug()
       command.param_index != -1){
     // This function needs only a parameter
     ret = (*commands[command.command_index].callback_function1)(command.param_index);
-    if (ret==1){printf("OK\r\n");}
+    if (ret==1){dbgPrintf("OK\r\n");}
     command.semaphore = 0;
     return;
   }  
@@ -642,7 +866,7 @@ void process_debug()
       command.param_index != -1){
     // This function needs an additional parameter
     ret = (*commands[command.command_index].callback_function2)(command.param_index,command.param_value);
-    if (ret==1){printf("OK\r\n");}
+    if (ret==1){dbgPrintf("OK\r\n");}
     command.semaphore = 0;
   }
 }
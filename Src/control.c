@@ -5,6 +5,7 @@
 #include "defines.h"
 #include "setup.h"
 #include "config.h"
+#include "util.h"
 
 #define NUNCHUK_I2C_ADDRESS 0xA4
 
@@ -24,6 +25,11 @@ extern DMA_HandleTypeDef hdma_i2c2_rx;
 extern DMA_HandleTypeDef hdma_i2c2_tx;
 
 #if defined(CONTROL_PPM_LEFT) || defined(CONTROL_PPM_RIGHT)
+#ifdef CONTROL_PPM_LEFT
+  #define PPM_IDX   CONTROL_PPM_LEFT      // input index of the PPM receiver
+#else
+  #define PPM_IDX   CONTROL_PPM_RIGHT
+#endif
 uint16_t ppm_captured_value[PPM_NUM_CHANNELS + 1] = {500, 500};
 uint16_t ppm_captured_value_buffer[PPM_NUM_CHANNELS+1] = {500, 500};
 uint32_t ppm_timeout = 0;
@@ -41,6 +47,7 @@ void PPM_ISR_Callback(void) {
       timeoutCntGen = 0;
       timeoutFlgGen = 0;
       memcpy(ppm_captured_value, ppm_captured_value_buffer, sizeof(ppm_captured_value));
+      inputCheckIn(PPM_IDX);
     }
     ppm_valid = true;
     ppm_count = 0;
@@ -100,6 +107,11 @@ void PPM_Init(void) {
 
 
 #if defined(CONTROL_PWM_LEFT) || defined(CONTROL_PWM_RIGHT)
+#ifdef CONTROL_PWM_LEFT
+  #define PWM_IDX   CONTROL_PWM_LEFT      // input index of the PWM receiver
+#else
+  #define PWM_IDX   CONTROL_PWM_RIGHT
+#endif
  /*
   * Illustration of the PWM functionality
   * CH1 ________|‾‾‾‾‾‾‾‾‾‾|________
@@ -131,6 +143,7 @@ void PWM_ISR_CH1_Callback(void) {
       timeoutFlgGen = 0;
       pwm_timeout_ch1 = 0;
       pwm_captured_ch1_value = CLAMP(rc_signal, 1000, 2000) - 1000;
+      inputCheckIn(PWM_IDX);
     }
   }
 }
@@ -151,6 +164,7 @@ void PWM_ISR_CH2_Callback(void) {
       timeoutFlgGen = 0;
       pwm_timeout_ch2 = 0;
       pwm_captured_ch2_value = CLAMP(rc_signal, 1000, 2000) - 1000;
+      inputCheckIn(PWM_IDX);
     }
   }
 }
@@ -0,0 +1,130 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Includes
+#include "config.h"
+#include "ctrlsched.h"
+
+/* Fundamental phase voltage per input target of each control type, relative to FOC, fixdt(0,16,14).
+ * SIN adds a third harmonic to the sine, COM applies the six-step waveform, FOC goes through the inverse Clarke
+ * transform. Measured on the motor controller with 'motorsim amp' (tools/motorsim).
+ */
+static const uint16_t ctrlTypAmp[3] = {
+  17386,    // COM_CTRL
+  18130,    // SIN_CTRL
+  16384     // FOC_CTRL
+};
+
+void ctrlSchedInit(CtrlSched *s) {
+  s->typ[0]     = CTRL_SCHED_TYP_LO;
+  s->typ[1]     = CTRL_SCHED_TYP_MID;
+  s->typ[2]     = CTRL_SCHED_TYP_HI;
+  s->n_mid      = CTRL_SCHED_N_MID;
+  s->n_hi       = CTRL_SCHED_N_HI;
+  s->n_hyst     = CTRL_SCHED_N_HYST;
+  s->i_hi       = CTRL_SCHED_I_HI * A2BIT_CONV;
+  s->dwell      = CTRL_SCHED_DWELL / DELAY_IN_MAIN_LOOP;
+  s->blendStep  = (32768 * DELAY_IN_MAIN_LOOP) / CTRL_SCHED_BLEND_TIME;
+  s->matchEna   = 1;
+
+  s->ctrlTyp    = CTRL_SCHED_TYP_LO;
+  s->band       = 0;
+  s->overload   = 0;
+  s->hold       = s->dwell;
+  s->gain       = 16384;
+  s->gainFrom   = 16384;
+  s->blend      = 32768;
+  s->iDcFilt    = 0;
+  s->switches   = 0;
+}
+
+/*
+ * Keep the speed bands in order after n_mid or n_hi was set at runtime (debug protocol), as config.h checks it for
+ * the defaults: n_mid + n_hyst < n_hi. hiSet: n_hi was set and n_mid gives way, else n_hi gives way.
+ */
+void ctrlSchedBands(CtrlSched *s, uint8_t hiSet) {
+  if (s->n_mid + s->n_hyst < s->n_hi) {
+    return;
+  }
+  if (hiSet) {
+    s->n_mid = (s->n_hi > s->n_hyst) ? s->n_hi - s->n_hyst - 1 : 0;
+  }
+  if (s->n_mid + s->n_hyst >= s->n_hi) {
+    s->n_hi = s->n_mid + s->n_hyst + 1;
+  }
+}
+
+/*
+ * Called every main loop. speedAbs: average motor speed [rpm], iDcAbs: DC link current [ADC counts], active: the
+ * control mode allows a choice (VOLTAGE mode), otherwise FOC is used. Returns 1 if the control type changed: the
+ * caller applies ctrlTyp and gain to the controller together.
+ */
+uint8_t ctrlSchedStep(CtrlSched *s, int16_t speedAbs, int16_t iDcAbs, uint8_t active) {
+  int16_t h    = s->n_hyst / 2;
+  uint8_t up   = (speedAbs >  s->n_hi + h) ? 2 : (speedAbs >  s->n_mid + h) ? 1 : 0;   // band reached when speeding up
+  uint8_t down = (speedAbs >= s->n_hi - h) ? 2 : (speedAbs >= s->n_mid - h) ? 1 : 0;   // band kept when slowing down
+  uint8_t typ;
+
+  // Speed band with hysteresis: the band only changes once the speed is out of [up, down]
+  s->band = (s->band < up) ? up : (s->band > down) ? down : s->band;
+
+  // Load: high DC link current goes to the low band (FOC limits the phase current)
+  s->iDcFilt += (((int32_t)iDcAbs << 16) - s->iDcFilt) >> 5;
+  if (s->iDcFilt > ((int32_t)s->i_hi << 16)) {
+    s->overload = 1;
+  } else if (s->iDcFilt < ((int32_t)(s->i_hi * 3 / 4) << 16)) {
+    s->overload = 0;
+  }
+
+  if (!active) {
+    typ       = FOC_CTRL;
+    s->gain   = 16384;                  // TRQ / SPD: the input target is no voltage, it passes unchanged
+    s->blend  = 32768;
+  } else {
+    typ = s->typ[s->overload ? 0 : s->band];
+  }
+
+  if (s->hold < UINT16_MAX) {
+    s->hold++;
+  }
+  if (s->blend < 32768) {
+    s->blend = (s->blend > 32768 - s->blendStep) ? 32768 : s->blend + s->blendStep;
+    s->gain  = (uint16_t)(s->gainFrom + (((16384 - (int32_t)s->gainFrom) * s->blend) >> 15));
+  }
+
+  // Switch: a control mode change is applied at once, band changes wait for the dwell time
+  if (typ == s->ctrlTyp || (active && s->hold < s->dwell)) {
+    return 0;
+  }
+  if (s->matchEna && active && s->ctrlTyp != FOC_CTRL) {
+    // Not when leaving FOC: under load its d axis current controller adds to the phase voltage, the light load
+    // ratio of ctrlTypAmp then overcorrects ('motorsim ramp': FOC -> COM bump 1.18 N m matched, 0.89 N m not)
+    uint32_t gain = ((uint32_t)s->gain * ctrlTypAmp[s->ctrlTyp]) / ctrlTypAmp[typ];
+    s->gainFrom   = (uint16_t)(gain < 8192 ? 8192 : gain > 32767 ? 32767 : gain);   // [0.5, 2.0)
+    s->blend      = 0;
+  } else {
+    s->gainFrom   = 16384;
+    s->blend      = 32768;
+  }
+  s->gain     = s->gainFrom;
+  s->ctrlTyp  = typ;
+  s->hold     = 0;
+  s->switches++;
+  return 1;
+}
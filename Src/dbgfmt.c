@@ -0,0 +1,204 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Includes
+#include "dbgfmt.h"
+
+typedef struct {
+  char     *buf;
+  uint16_t  size;
+  uint16_t  len;                    // characters in buf
+  uint16_t  total;                  // characters output
+  DbgFlush  flush;
+} DbgOut;
+
+static void dbgPutc(DbgOut *out, char c) {
+  if (out->len + 1 < out->size) {
+    out->buf[out->len++] = c;
+    out->total++;
+    return;
+  }
+  if (out->flush) {                 // Full: hand over the buffer
+    out->buf[out->len++] = c;
+    out->total++;
+    out->flush(out->buf, out->len);
+    out->len = 0;
+  }                                 // Without a flush function the output is truncated
+}
+
+static void dbgPad(DbgOut *out, char pad, uint8_t n) {
+  while (n--) {
+    dbgPutc(out, pad);
+  }
+}
+
+ /*
+ * Format like vsnprintf(): %d %i %u %x %X %c %s %%, the 'l' length, the '-' and '0' flags and the field width.
+ * With flush = NULL the output is truncated to size - 1 characters, otherwise flush() gets the buffer whenever it is
+ * full and the rest at the end. The output is NUL terminated without flush. Returns the number of characters output.
+ */
+uint16_t dbgFormat(char *buf, uint16_t size, DbgFlush flush, const char *fmt, va_list ap) {
+  DbgOut out = {buf, size, 0, 0, flush};
+  while (*fmt) {
+    char c = *fmt++;
+    if (c != '%') {
+      dbgPutc(&out, c);
+      continue;
+    }
+    char    pad    = ' ';
+    uint8_t left   = 0;
+    uint8_t width  = 0;
+    uint8_t isLong = 0;
+    for (;; fmt++) {
+      if (*fmt == '-') {
+        left = 1;
+      } else if (*fmt == '0') {
+        pad  = '0';
+      } else {
+        break;
+      }
+    }
+    if (left) {
+      pad = ' ';                    // '-' overrides '0'
+    }
+    while (*fmt >= '0' && *fmt <= '9') {
+      width = width * 10 + (*fmt++ - '0');
+    }
+    if (*fmt == 'l') {
+      isLong = 1;
+      fmt++;
+    }
+    if (*fmt == 0) {
+      break;
+    }
+    c = *fmt++;
+
+    char        digits[11];
+    uint8_t     n    = 0;
+    uint8_t     neg  = 0;
+    uint32_t    val;
+    uint8_t     hex  = 0;
+    const char *str;
+    switch (c) {
+      case 'd':
+      case 'i': {
+        int32_t v = isLong ? (int32_t)va_arg(ap, long) : (int32_t)va_arg(ap, int);
+        neg = v < 0;
+        val = neg ? 0U - (uint32_t)v : (uint32_t)v;
+        break;
+      }
+      case 'u':
+      case 'x':
+      case 'X':
+        val  = isLong ? (uint32_t)va_arg(ap, unsigned long) : (uint32_t)va_arg(ap, unsigned int);
+        hex  = c != 'u';
+        break;
+      case 'c':
+        digits[0] = (char)va_arg(ap, int);
+        str       = digits;
+        n         = 1;
+        goto field;
+      case 's':
+        str = va_arg(ap, const char *);
+        for (n = 0; str[n] && n < 255; n++) {}
+        goto field;
+      default:                      // '%' and unsupported conversions are copied
+        dbgPutc(&out, c);
+        continue;
+    }
+
+    do {
+      uint8_t d;
+      if (hex) {
+        d    = (uint8_t)(val & 0xF);
+        val >>= 4;
+      } else {                      // Constant divisor: multiply and shift
+        d    = (uint8_t)(val % 10);
+        val /= 10;
+      }
+      digits[sizeof(digits) - 1 - n++] = (char)(d < 10 ? '0' + d : (c == 'x' ? 'a' : 'A') + d - 10);
+    } while (val);
+    if (neg && pad == '0') {        // The sign goes before the zero padding
+      dbgPutc(&out, '-');
+      width = width ? width - 1 : 0;
+    } else if (neg) {
+      digits[sizeof(digits) - 1 - n++] = '-';
+    }
+    str = &digits[sizeof(digits) - n];
+
+  field:
+    if (!left && width > n) {
+      dbgPad(&out, pad, width - n);
+    }
+    for (uint8_t k = 0; k < n; k++) {
+      dbgPutc(&out, str[k]);
+    }
+    if (left && width > n) {
+      dbgPad(&out, ' ', width - n);
+    }
+  }
+  if (out.flush) {
+    if (out.len) {
+      out.flush(out.buf, out.len);
+    }
+  } else if (out.size) {
+    out.buf[out.len] = 0;
+  }
+  return out.total;
+}
+
+ /*
+ * Format the fixed point value val with q fractional bits, e.g. fixdt(1,16,4): q = 4, as a decimal number with
+ * dec (0..4) decimals, rounded half away from zero. buf must hold DBG_FIXDT_LEN characters. Returns buf, for "%s".
+ */
+char *dbgFixdt(char *buf, int32_t val, uint8_t q, uint8_t dec) {
+  static const uint16_t pow10[5] = {1, 10, 100, 1000, 10000};
+  uint32_t mag   = val < 0 ? 0U - (uint32_t)val : (uint32_t)val;
+  uint32_t ipart = q < 32 ? mag >> q : 0;
+  uint32_t fpart = 0;
+  if (dec > 4) {
+    dec = 4;
+  }
+  if (q) {
+    uint64_t frac = (uint64_t)(mag & ((1ULL << q) - 1)) * pow10[dec] + (1ULL << (q - 1));
+    fpart = (uint32_t)(frac >> q);
+    if (fpart >= pow10[dec]) {      // Rounded up to the next integer
+      fpart -= pow10[dec];
+      ipart++;
+    }
+  }
+
+  char   *p = buf + DBG_FIXDT_LEN - 1;
+  *p = 0;
+  for (uint8_t k = 0; k < dec; k++) {
+    *--p  = (char)('0' + fpart % 10);
+    fpart /= 10;
+  }
+  if (dec) {
+    *--p = '.';
+  }
+  do {
+    *--p  = (char)('0' + ipart % 10);
+    ipart /= 10;
+  } while (ipart);
+  if (val < 0) {
+    *--p = '-';
+  }
+  return p;
+}
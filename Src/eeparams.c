@@ -0,0 +1,84 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Includes
+#include <stddef.h>
+#include "eeparams.h"
+
+static uint16_t eeParamGet(const EEParam *p) {
+  return (p->size == 1) ? *(uint8_t *)p->valueL : (uint16_t)*(int16_t *)p->valueL;
+}
+
+static void eeParamSet(const EEParam *p, uint16_t value) {
+  if (p->size == 1) {
+    *(uint8_t *)p->valueL = (uint8_t)value;
+    if (p->valueR != NULL) *(uint8_t *)p->valueR = (uint8_t)value;
+  } else {
+    *(int16_t *)p->valueL = (int16_t)value;
+    if (p->valueR != NULL) *(int16_t *)p->valueR = (int16_t)value;
+  }
+}
+
+ /*
+ * Load the registered parameters. Parameters not in the EEPROM keep their value.
+ * The loaded values are remembered, so eeStoreSave() writes only what changed since.
+ */
+void eeStoreLoad(EEStore *s) {
+  uint16_t readVal;
+  s->keySynced = (s->read(s->virtAddr[0], &readVal) == 0 && readVal == s->key);
+  for (uint8_t i = 0; i < s->nr; i++) {
+    if (s->read(s->virtAddr[s->param[i].addr], &readVal) == 0) {
+      eeParamSet(&s->param[i], readVal);
+      s->shadow[i]  = readVal;
+      s->synced    |= 1UL << i;
+    }
+  }
+}
+
+ /*
+ * Save the registered parameters: only the ones changed since the last load / save are written, and the key if it
+ * is not in the EEPROM yet. A failed write is counted in 'failed' and retried on the next save.
+ * Returns the number of successful writes.
+ */
+uint8_t eeStoreSave(EEStore *s) {
+  uint8_t writes = 0;
+  s->failed = 0;
+  if (!s->keySynced) {
+    if (s->write(s->virtAddr[0], s->key) == 0) {
+      s->keySynced = 1;
+      writes++;
+    } else {
+      s->failed++;
+    }
+  }
+  for (uint8_t i = 0; i < s->nr; i++) {
+    uint16_t value = eeParamGet(&s->param[i]);
+    if ((s->synced & (1UL << i)) && s->shadow[i] == value) {
+      continue;
+    }
+    if (s->write(s->virtAddr[s->param[i].addr], value) == 0) {
+      s->shadow[i]  = value;
+      s->synced    |= 1UL << i;
+      writes++;
+    } else {
+      s->failed++;
+    }
+  }
+  return writes;
+}
@@ -0,0 +1,67 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Includes
+#include "config.h"
+#include "defines.h"
+#include "follow.h"
+
+#ifdef VARIANT_TRANSPOTTER
+
+void followInit(Follow *f) {
+  f->kp         = TRANSPOTTER_KP;
+  f->kd         = TRANSPOTTER_KD;
+  f->dFilt      = TRANSPOTTER_D_FILTER;
+  f->cmdFilt    = TRANSPOTTER_FILTER;
+  f->rotP       = ROT_P;
+  f->rate       = 1000 / DELAY_IN_MAIN_LOOP;
+
+  f->errPrev    = 0;
+  f->derFixdt   = 0;
+  f->cmdLFixdt  = 0;
+  f->cmdRFixdt  = 0;
+}
+
+// Low-pass y += coef * (u - y), y = fixdt(1,32,16), coef = fixdt(0,16,16). As filtLowPass32() (util.c), which needs the HAL
+static void lowPass(int32_t u, uint16_t coef, int32_t *y) {
+  *y += (int32_t)(((((int64_t)u << 16) - *y) * coef) >> 16);
+}
+
+/*
+ * Called every main loop. distanceErr: gametrak wire length minus the setpoint [ADC counts], steering: gametrak
+ * angle fixdt(1,16,14) = [-1.0, 1.0]. cmdL, cmdR: motor commands [-850, 850], filtered.
+ */
+void followStep(Follow *f, int32_t distanceErr, int16_t steering, int16_t *cmdL, int16_t *cmdR) {
+  int32_t followCmd, rotCmd;
+
+  // PD follow law: followCmd = KP * err + KD * d(err)/dt. The derivative is low-pass filtered against ADC noise
+  lowPass(CLAMP((distanceErr - f->errPrev) * f->rate, -32000, 32000), f->dFilt, &f->derFixdt);
+  f->errPrev = distanceErr;
+  followCmd  = ((distanceErr * f->kp) >> 14) + (int32_t)(((int64_t)f->derFixdt * f->kd) >> 32);
+
+  // Steering: differential command proportional to the steering angle, scaled with the distance error (at least 50)
+  rotCmd     = (((steering * MAX(ABS(distanceErr), 50)) >> 14) * f->rotP) >> 14;
+
+  lowPass(-CLAMP(followCmd + rotCmd, -850, 850), f->cmdFilt, &f->cmdLFixdt);
+  lowPass(-CLAMP(followCmd - rotCmd, -850, 850), f->cmdFilt, &f->cmdRFixdt);
+  *cmdL = (int16_t)(f->cmdLFixdt >> 16);
+  *cmdR = (int16_t)(f->cmdRFixdt >> 16);
+}
+
+#endif
@@ -30,12 +30,15 @@
 #include "BLDC_controller.h"      /* BLDC's header file */
 #include "rtwtypes.h"
 #include "comms.h"
+#include "follow.h"
+#include "watchdog.h"
 
 #if defined(DEBUG_I2C_LCD) || defined(SUPPORT_LCD)
 #include "hd44780.h"
 #endif
 
 void SystemClock_Config(void);
+void mainLoop(void);
 
 //------------------------------------------------------------------------
 // Global variables set externally
@@ -76,6 +79,8 @@ extern volatile uint32_t timeoutCntGen; // Timeout counter for the General timeo
 extern volatile uint8_t  timeoutFlgGen; // Timeout Flag for the General timeout (PPM, PWM, Nunchuk)
 extern uint8_t timeoutFlgADC;           // Timeout Flag for for ADC Protection: 0 = OK, 1 = Problem detected (line disconnected or wrong ADC data)
 extern uint8_t timeoutFlgSerial;        // Timeout Flag for Rx Serial command: 0 = OK, 1 = Problem detected (line disconnected or wrong Rx data)
+extern uint8_t poweroffAcv;             // poweroff sequence running
+extern uint8_t calibMode;               // calibration mode running
 
 extern volatile int pwml;               // global variable for pwm left. -1000 to 1000
 extern volatile int pwmr;               // global variable for pwm right. -1000 to 1000
@@ -119,9 +124,19 @@ extern uint16_t wheel_right_ticks;
 //------------------------------------------------------------------------
 // Local variables
 //------------------------------------------------------------------------
+#ifdef MULTI_BOARD_MASTER
+extern SerialLinkFeedback linkFeedback;
+extern uint16_t linkTick;
+#endif
+#ifdef SERIAL_BUS
+extern uint8_t busNode;
+#endif
 #if defined(FEEDBACK_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART3)
 typedef struct{
   uint16_t  start;
+  #ifdef SERIAL_BUS
+  uint16_t  address;            // node id of the sender
+  #endif
   //int16_t   cmd1;
   //int16_t   cmd2;
   int16_t   leftSpeed;
@@ -130,10 +145,32 @@ typedef struct{
   uint16_t  rightTicks;
   int16_t   batVoltage;
   int16_t   boardTemp;
+  #ifdef MULTI_MODE_SERIAL
+  uint16_t  driveMode;
+  #endif
+  #ifdef MULTI_BOARD_MASTER
+  uint16_t  tick;               // main loop counter sent to the slave
+  int16_t   slaveLeftSpeed;     // slave board feedback
+  int16_t   slaveRightSpeed;
+  uint16_t  slaveLeftTicks;
+  uint16_t  slaveRightTicks;
+  int16_t   slaveBatVoltage;
+  int16_t   slaveBoardTemp;
+  uint16_t  slaveTick;          // main loop counter of the last command applied by the slave
+  #endif
+  #ifdef FEEDBACK_TIMESTAMP
+  uint16_t  timeL;              // board time of this frame [1/16 ms], low word
+  uint16_t  timeH;              // high word
+  uint16_t  syncId;             // syncId of the last host command
+  uint16_t  syncAge;            // time from its reception to timeL/timeH [1/16 ms], 0xFFFF: none
+  #endif
   uint16_t  checksum;
 } SerialFeedback;
 static SerialFeedback Feedback;
 #endif
+#ifdef SERIAL_BUS
+_Static_assert(sizeof(SerialFeedback) != sizeof(SerialCommand), "bus nodes tell commands from replies by their length");
+#endif
 /*#if defined(FEEDBACK_SERIAL_USART2)
 static uint8_t sideboard_leds_L;
 #endif
@@ -143,17 +180,21 @@ static uint8_t sideboard_leds_R;
 
 #ifdef VARIANT_TRANSPOTTER
   uint8_t  nunchuk_connected;
-  extern float    setDistance;  
+  extern uint16_t setDistance;          // distance setpoint [mm]
 
   static uint8_t  checkRemote = 0;
-  static uint16_t distance;
-  static float    steering;
-  static int      distanceErr;  
+  static uint16_t distance;             // measured gametrak wire length [ADC counts]
+  static int32_t  distanceSet;          // distance setpoint [ADC counts]
+  static int16_t  steering;             // gametrak steering fixdt(1,16,14) = [-1.0, 1.0]
+  static int32_t  distanceErr;          // distance error [ADC counts]
+  static Follow   follow;               // PD follow controller (follow.c)
   static int      lastDistance = 0;
   static uint16_t transpotter_counter = 0;
 #endif
 
 static int16_t    speed;                // local variable for speed. -1000 to 1000
+static int32_t    board_temp_adcFixdt;  // board temperature low-pass filter fixdt(1,32,16)
+static int16_t    board_temp_adcFilt;   // filtered board temperature [ADC counts]
 #ifndef VARIANT_TRANSPOTTER
   static int16_t  steer;                // local variable for steering. -1000 to 1000
   static int16_t  steerRateFixdt;       // local fixed-point variable for steering rate limiter
@@ -165,17 +206,33 @@ static int16_t    speed;                // local variable for speed. -1000 to 10
 static uint32_t    buzzerTimer_prev = 0;
 static uint32_t    inactivity_timeout_counter;
 static MultipleTap MultipleTapBrake;    // define multiple tap functionality for the Brake pedal
-
-static uint16_t rate = RATE; // Adjustable rate to support multiple drive modes on startup
+#ifdef STALL_DETECT_ENABLE
+StallDetect stallLeft;                  // stall detection of the Left motor
+StallDetect stallRight;                 // stall detection of the Right motor
+#endif
+#ifdef MOTOR_DIAG_ENABLE
+extern MotorDiag diagLeft;              // diagnostics of the Left motor
+extern MotorDiag diagRight;             // diagnostics of the Right motor
+#endif
+#ifdef CYCLE_MEASURE_ENABLE
+uint32_t cycLoopMax = 0;                // maximum execution time of the main loop, including interrupts [CPU cycles]
+#endif
 
 #ifdef MULTI_MODE_DRIVE
-  static uint8_t drive_mode;
-  static uint16_t max_speed;
+  extern uint8_t drive_mode;
+  uint16_t rate = RATE;                 // Adjustable rate to support multiple drive modes
+  uint16_t max_speed;
+#else
+  static uint16_t rate = RATE;
 #endif
 
 
 int main(void) {
 
+  #ifdef STACK_MONITOR_ENABLE
+    stackPaint();     // Paint the free stack for the high-water mark check
+  #endif
+
   HAL_Init();
   __HAL_RCC_AFIO_CLK_ENABLE();
   HAL_NVIC_SetPriorityGrouping(NVIC_PRIORITYGROUP_4);
@@ -197,6 +254,12 @@ int main(void) {
 
   SystemClock_Config();
 
+  #ifdef CYCLE_MEASURE_ENABLE
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;       // Enable the DWT cycle counter
+    DWT->CYCCNT       = 0;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+  #endif
+
   __HAL_RCC_DMA1_CLK_DISABLE();
   MX_GPIO_Init();
   MX_TIM_Init();
@@ -207,67 +270,97 @@ int main(void) {
   HAL_GPIO_WritePin(OFF_PORT, OFF_PIN, GPIO_PIN_SET);   // Activate Latch
   Input_Lim_Init();   // Input Limitations Init
   Input_Init();       // Input Init
+  #ifdef VARIANT_TRANSPOTTER
+    followInit(&follow);
+  #endif
+  faultReport();      // Report a fault captured before the last reset
+  #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
+    resetReasonReport();// Report the reset reason
+  #endif
 
   HAL_ADC_Start(&hadc1);
   HAL_ADC_Start(&hadc2);
 
   poweronMelody();
+  #ifdef MOTOR_DIAG_ENABLE
+    motorSelfTest();  // Pulse the motor phases and check the current response
+  #endif
   HAL_GPIO_WritePin(LED_PORT, LED_PIN, GPIO_PIN_SET);
   
-  int32_t board_temp_adcFixdt = adc_buffer.temp << 16;  // Fixed-point filter output initialized with current ADC converted to fixed-point
-  int16_t board_temp_adcFilt  = adc_buffer.temp;
+  board_temp_adcFixdt = adc_buffer.temp << 16;  // Fixed-point filter output initialized with current ADC converted to fixed-point
+  board_temp_adcFilt  = adc_buffer.temp;
 
   #ifdef MULTI_MODE_DRIVE
     if (adc_buffer.l_tx2 > input1[0].min + 50 && adc_buffer.l_rx2 > input2[0].min + 50) {
       drive_mode = 2;
-      max_speed = MULTI_MODE_DRIVE_M3_MAX;
-      rate = MULTI_MODE_DRIVE_M3_RATE;
-      rtP_Left.n_max = rtP_Right.n_max = MULTI_MODE_M3_N_MOT_MAX << 4;
-      rtP_Left.i_max = rtP_Right.i_max = (MULTI_MODE_M3_I_MOT_MAX * A2BIT_CONV) << 4;
     } else if (adc_buffer.l_tx2 > input1[0].min + 50) {
       drive_mode = 1;
-      max_speed = MULTI_MODE_DRIVE_M2_MAX;
-      rate = MULTI_MODE_DRIVE_M2_RATE;
-      rtP_Left.n_max = rtP_Right.n_max = MULTI_MODE_M2_N_MOT_MAX << 4;
-      rtP_Left.i_max = rtP_Right.i_max = (MULTI_MODE_M2_I_MOT_MAX * A2BIT_CONV) << 4;
     } else {
       drive_mode = 0;
-      max_speed = MULTI_MODE_DRIVE_M1_MAX;
-      rate = MULTI_MODE_DRIVE_M1_RATE;
-      rtP_Left.n_max = rtP_Right.n_max = MULTI_MODE_M1_N_MOT_MAX << 4;
-      rtP_Left.i_max = rtP_Right.i_max = (MULTI_MODE_M1_I_MOT_MAX * A2BIT_CONV) << 4;
     }
+    driveModeInit();
 
-    printf("Drive mode %i selected: max_speed:%i acc_rate:%i \r\n", drive_mode, max_speed, rate);
+    dbgPrintf("Drive mode %i selected: max_speed:%i acc_rate:%i \r\n", drive_mode, max_speed, rate);
   #endif
 
   // Loop until button is released
-  while(HAL_GPIO_ReadPin(BUTTON_PORT, BUTTON_PIN)) { HAL_Delay(10); }
+  while(HAL_GPIO_ReadPin(BUTTON_PORT, BUTTON_PIN)) { watchdogYield(); HAL_Delay(10); }
 
   #ifdef MULTI_MODE_DRIVE
     // Wait until triggers are released. Exit if timeout elapses (to unblock if the inputs are not calibrated)
     int iTimeout = 0;
     while((adc_buffer.l_rx2 + adc_buffer.l_tx2) >= (input1[0].min + input2[0].min) && iTimeout++ < 300) {
+      watchdogYield();
       HAL_Delay(10);
     }
   #endif
 
+  watchdogInit();     // Start the watchdog supervision
+
   while(1) {
+    #ifdef MULTI_BOARD_SLAVE
+      multiBoardSync(&buzzerTimer_prev);  // Start the cycle right after each master command
+    #endif
     if (buzzerTimer - buzzerTimer_prev > 16*DELAY_IN_MAIN_LOOP) {   // 1 ms = 16 ticks buzzerTimer
+      mainLoop();
+    }
+  }
+}
+
+
+// ===========================================================
+/* Main loop body, called every DELAY_IN_MAIN_LOOP. A function of its own, so tools/fwbench can run it on the host */
+void mainLoop(void) {
+
+    #ifdef CYCLE_MEASURE_ENABLE
+      uint32_t cycStart = DWT->CYCCNT;
+    #endif
 
     readCommand();                        // Read Command: input1[inIdx].cmd, input2[inIdx].cmd
+    calibUpdate();                        // Input calibration / limits update in the background
     calcAvgSpeed();                       // Calculate average measured speed: speedAvg, speedAvgAbs
 
+    #ifdef MULTI_MODE_DRIVE
+      driveModeUpdate();                  // Follow runtime drive mode changes: max_speed, rate, i_max (see curLimUpdate), n_max
+    #endif
+
+    #ifdef CTRL_SCHED_ENABLE
+      ctrlSchedUpdate();                  // Control type by operating point: speed band, load
+    #endif
+
     #ifndef VARIANT_TRANSPOTTER
       // ####### MOTOR ENABLING: Only if the initial input is very small (for SAFETY) #######
-      if (enable == 0 && !rtY_Left.z_errCode && !rtY_Right.z_errCode && 
+      if (enable == 0 && !poweroffAcv && !calibMode && !rtY_Left.z_errCode && !rtY_Right.z_errCode && 
+          #ifdef MOTOR_DIAG_ENABLE
+          !diagLeft.z_errCode && !diagRight.z_errCode &&
+          #endif
           ABS(input1[inIdx].cmd) < 50 && ABS(input2[inIdx].cmd) < 50){
         beepShort(6);                     // make 2 beeps indicating the motor enable
-        beepShort(4); HAL_Delay(100);
+        beepShort(4); beepTone(0, 100);
         steerFixdt = speedFixdt = 0;      // reset filters
         enable = 1;                       // enable motors
         #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-        printf("-- Motors enabled --\r\n");
+        dbgPrintf("-- Motors enabled --\r\n");
         #endif
       }
 
@@ -354,6 +447,13 @@ int main(void) {
         mixerFcn(speed << 4, steer << 4, &cmdR, &cmdL);   // This function implements the equations above
       #endif
 
+      #ifdef TORQUE_SPLIT_ENABLE
+        torqueSplit(&cmdL, &cmdR);        // 4WD: split the demand between the axles / take the master targets
+      #endif
+      #if defined(MULTI_BOARD_MASTER) || defined(MULTI_BOARD_SLAVE)
+        multiBoardSend();                 // Relay the command to the slave / send the slave feedback to the master
+      #endif
+
 
       // ####### SET OUTPUTS (if the target change is less than +/- 100) #######
       #ifdef INVERT_R_DIRECTION
@@ -370,13 +470,13 @@ int main(void) {
 
     #ifdef VARIANT_TRANSPOTTER
       distance    = CLAMP(input1[inIdx].cmd - 180, 0, 4095);
-      steering    = (input2[inIdx].cmd - 2048) / 2048.0;
-      distanceErr = distance - (int)(setDistance * 1345);
+      steering    = (input2[inIdx].cmd - 2048) * 8;               // [0, 4095] -> fixdt(1,16,14): 2048 * 8 = 16384 = 1.0
+      distanceSet = (int32_t)setDistance * TRANSPOTTER_DIST_SCALE / 1000;
+      distanceErr = distance - distanceSet;
 
       if (nunchuk_connected == 0) {
-        cmdL = cmdL * 0.8f + (CLAMP(distanceErr + (steering*((float)MAX(ABS(distanceErr), 50)) * ROT_P), -850, 850) * -0.2f);
-        cmdR = cmdR * 0.8f + (CLAMP(distanceErr - (steering*((float)MAX(ABS(distanceErr), 50)) * ROT_P), -850, 850) * -0.2f);
-        if (distanceErr > 0) {
+        followStep(&follow, distanceErr, steering, &cmdL, &cmdR);   // PD follow law and steering
+        if (distanceErr > 0 && !poweroffAcv) {  // the motors stay off during the poweroff melody
           enable = 1;
         }
         if (distanceErr > -300) {
@@ -418,7 +518,7 @@ int main(void) {
         nunchuk_connected = 0;
       }
 
-      if ((distance / 1345.0) - setDistance > 0.5 && (lastDistance / 1345.0) - setDistance > 0.5) { // Error, robot too far away!
+      if (distance - distanceSet > TRANSPOTTER_DIST_SCALE / 2 && lastDistance - distanceSet > TRANSPOTTER_DIST_SCALE / 2) { // Error, robot too far away (> 0.5 m)!
         enable = 0;
         beepLong(5);
         #ifdef SUPPORT_LCD
@@ -429,9 +529,10 @@ int main(void) {
         #endif
         poweroff();
       }
+      lastDistance = distance;
 
       #ifdef SUPPORT_NUNCHUK
-        if (transpotter_counter % 500 == 0) {
+        if (transpotter_counter % (1000 / DELAY_IN_MAIN_LOOP) == 0) {   // every 1 s
           if (nunchuk_connected == 0 && enable == 0) {
               if(Nunchuk_Read() == NUNCHUK_CONNECTED) {
                 #ifdef SUPPORT_LCD
@@ -447,13 +548,13 @@ int main(void) {
       #endif
 
       #ifdef SUPPORT_LCD
-        if (transpotter_counter % 100 == 0) {
+        if (transpotter_counter % (200 / DELAY_IN_MAIN_LOOP) == 0) {    // every 200 ms
           if (LCDerrorFlag == 1 && enable == 0) {
 
           } else {
             if (nunchuk_connected == 0) {
-              LCD_SetLocation(&lcd,  4, 0); LCD_WriteFloat(&lcd,distance/1345.0,2);
-              LCD_SetLocation(&lcd, 10, 0); LCD_WriteFloat(&lcd,setDistance,2);
+              LCD_SetLocation(&lcd,  4, 0); LCD_WriteFloat(&lcd,(distance * 1000 / TRANSPOTTER_DIST_SCALE) / 1000.0,2);
+              LCD_SetLocation(&lcd, 10, 0); LCD_WriteFloat(&lcd,setDistance / 1000.0,2);
             }
             LCD_SetLocation(&lcd,  4, 1); LCD_WriteFloat(&lcd,batVoltage, 1);
             // LCD_SetLocation(&lcd, 11, 1); LCD_WriteFloat(&lcd,MAX(ABS(currentR), ABS(currentL)),2);
@@ -479,7 +580,7 @@ int main(void) {
     
 
     // ####### CALC BOARD TEMPERATURE #######
-    filtLowPass32(adc_buffer.temp, TEMP_FILT_COEF, &board_temp_adcFixdt);
+    filtLowPass32(adc_buffer.temp, TEMP_FILT_COEF * DELAY_IN_MAIN_LOOP / 5, &board_temp_adcFixdt);
     board_temp_adcFilt  = (int16_t)(board_temp_adcFixdt >> 16);  // convert fixed-point to integer
     board_temp_deg_c    = (TEMP_CAL_HIGH_DEG_C - TEMP_CAL_LOW_DEG_C) * (board_temp_adcFilt - TEMP_CAL_LOW_ADC) / (TEMP_CAL_HIGH_ADC - TEMP_CAL_LOW_ADC) + TEMP_CAL_LOW_DEG_C;
 
@@ -491,13 +592,16 @@ int main(void) {
     right_dc_curr = -(rtU_Right.i_DCLink * 100) / A2BIT_CONV;  // Right DC Link Current * 100
     dc_curr       = left_dc_curr + right_dc_curr;            // Total DC Link Current * 100
 
+    // ####### CURRENT LIMIT: I_MOT_MAX, drive mode, stall foldback #######
+    curLimUpdate();
+
     // ####### DEBUG SERIAL OUT #######
     #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-      if (main_loop_counter % 25 == 0) {    // Send data periodically every 125 ms      
+      if (main_loop_counter % (125 / DELAY_IN_MAIN_LOOP) == 0) {    // Send data periodically every 125 ms      
         #if defined(DEBUG_SERIAL_PROTOCOL)
           process_debug();
         #else
-          printf("in1:%i in2:%i cmdL:%i cmdR:%i BatADC:%i BatV:%i TempADC:%i Temp:%i \r\n",
+          dbgPrintf("in1:%i in2:%i cmdL:%i cmdR:%i BatADC:%i BatV:%i TempADC:%i Temp:%i \r\n",
             input1[inIdx].raw,        // 1: INPUT1
             input2[inIdx].raw,        // 2: INPUT2
             cmdL,                     // 3: output command: [-1000, 1000]
@@ -513,8 +617,11 @@ int main(void) {
     // ####### FEEDBACK SERIAL OUT #######
     #if defined(FEEDBACK_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART3)
       // (main_loop_counter % N == 0) interval = N * 5 ms; N = interval / 5;
-      if (main_loop_counter % 4 == 0) { // 1000 / 20 = 50 times per second
+      if (main_loop_counter % FEEDBACK_INTERVAL == 0) { // 1000 / (DELAY_IN_MAIN_LOOP * FEEDBACK_INTERVAL) times per second
         Feedback.start	        = (uint16_t)SERIAL_START_FRAME;
+        #ifdef SERIAL_BUS
+        Feedback.address        = busNode;
+        #endif
         //Feedback.cmd1           = (int16_t)input1[inIdx].cmd;
         //Feedback.cmd2           = (int16_t)input2[inIdx].cmd;
         Feedback.leftSpeed	    = (int16_t)rtY_Left.n_mot;
@@ -523,6 +630,25 @@ int main(void) {
         Feedback.rightTicks	    = (uint16_t)wheel_right_ticks;
         Feedback.batVoltage	    = (int16_t)batVoltageCalib;
         Feedback.boardTemp	    = (int16_t)board_temp_deg_c;
+        #ifdef MULTI_MODE_SERIAL
+        Feedback.driveMode      = (uint16_t)drive_mode;
+        #endif
+        #ifdef MULTI_BOARD_MASTER
+        Feedback.tick           = linkTick;
+        Feedback.slaveLeftSpeed = linkFeedback.leftSpeed;
+        Feedback.slaveRightSpeed= linkFeedback.rightSpeed;
+        Feedback.slaveLeftTicks = linkFeedback.leftTicks;
+        Feedback.slaveRightTicks= linkFeedback.rightTicks;
+        Feedback.slaveBatVoltage= linkFeedback.batVoltage;
+        Feedback.slaveBoardTemp = linkFeedback.boardTemp;
+        Feedback.slaveTick      = linkFeedback.tick;
+        #endif
+        #ifdef FEEDBACK_TIMESTAMP
+        uint32_t fbTime;
+        feedbackTimestamp(&fbTime, &Feedback.syncId, &Feedback.syncAge);
+        Feedback.timeL          = (uint16_t)fbTime;
+        Feedback.timeH          = (uint16_t)(fbTime >> 16);
+        #endif
 
         #if defined(FEEDBACK_SERIAL_USART2)
           if(__HAL_DMA_GET_COUNTER(huart2.hdmatx) == 0) {
@@ -530,7 +656,19 @@ int main(void) {
                                           //^ Feedback.cmd1 ^ Feedback.cmd2 
                                           ^ Feedback.leftSpeed ^ Feedback.rightSpeed 
                                           ^ Feedback.leftTicks ^ Feedback.rightTicks 
-                                          ^ Feedback.batVoltage ^ Feedback.boardTemp);
+                                          ^ Feedback.batVoltage ^ Feedback.boardTemp
+                                          #ifdef MULTI_MODE_SERIAL
+                                          ^ Feedback.driveMode
+                                          #endif
+                                          #ifdef MULTI_BOARD_MASTER
+                                          ^ Feedback.tick ^ Feedback.slaveLeftSpeed ^ Feedback.slaveRightSpeed
+                                          ^ Feedback.slaveLeftTicks ^ Feedback.slaveRightTicks
+                                          ^ Feedback.slaveBatVoltage ^ Feedback.slaveBoardTemp ^ Feedback.slaveTick
+                                          #endif
+                                          #ifdef FEEDBACK_TIMESTAMP
+                                          ^ Feedback.timeL ^ Feedback.timeH ^ Feedback.syncId ^ Feedback.syncAge
+                                          #endif
+                                          );
 
             HAL_UART_Transmit_DMA(&huart2, (uint8_t *)&Feedback, sizeof(Feedback));
           }
@@ -538,11 +676,30 @@ int main(void) {
         #if defined(FEEDBACK_SERIAL_USART3)
           if(__HAL_DMA_GET_COUNTER(huart3.hdmatx) == 0) {
             Feedback.checksum   = (uint16_t)(Feedback.start 
+                                          #ifdef SERIAL_BUS
+                                          ^ Feedback.address
+                                          #endif
                                           ^ Feedback.leftSpeed ^ Feedback.rightSpeed 
                                           ^ Feedback.leftTicks ^ Feedback.rightTicks 
-                                          ^ Feedback.batVoltage ^ Feedback.boardTemp);
-
+                                          ^ Feedback.batVoltage ^ Feedback.boardTemp
+                                          #ifdef MULTI_MODE_SERIAL
+                                          ^ Feedback.driveMode
+                                          #endif
+                                          #ifdef MULTI_BOARD_MASTER
+                                          ^ Feedback.tick ^ Feedback.slaveLeftSpeed ^ Feedback.slaveRightSpeed
+                                          ^ Feedback.slaveLeftTicks ^ Feedback.slaveRightTicks
+                                          ^ Feedback.slaveBatVoltage ^ Feedback.slaveBoardTemp ^ Feedback.slaveTick
+                                          #endif
+                                          #ifdef FEEDBACK_TIMESTAMP
+                                          ^ Feedback.timeL ^ Feedback.timeH ^ Feedback.syncId ^ Feedback.syncAge
+                                          #endif
+                                          );
+
+            #ifdef SERIAL_BUS
+            busReplySet((uint8_t *)&Feedback, sizeof(Feedback));   // sent when the host polls this node
+            #else
             HAL_UART_Transmit_DMA(&huart3, (uint8_t *)&Feedback, sizeof(Feedback));
+            #endif
           }
         #endif
       }
@@ -554,17 +711,22 @@ int main(void) {
     // ####### BEEP AND EMERGENCY POWEROFF #######
     if (TEMP_POWEROFF_ENABLE && board_temp_deg_c >= TEMP_POWEROFF && speedAvgAbs < 20){  // poweroff before mainboard burns OR low bat 3
       #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-        printf("Powering off, temperature is too high\r\n");
+        dbgPrintf("Powering off, temperature is too high\r\n");
       #endif
       poweroff();
     } else if ( BAT_DEAD_ENABLE && batVoltage < BAT_DEAD && speedAvgAbs < 20){
       #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-        printf("Powering off, battery voltage is too low\r\n");
+        dbgPrintf("Powering off, battery voltage is too low\r\n");
       #endif
       poweroff();
     } else if (rtY_Left.z_errCode || rtY_Right.z_errCode) {                                           // 1 beep (low pitch): Motor error, disable motors
       enable = 0;
       beepCount(1, 24, 1);
+    #ifdef MOTOR_DIAG_ENABLE
+    } else if (diagLeft.z_errCode || diagRight.z_errCode) {                                           // 7 beeps (low pitch): Motor diagnostics fault (open phase, bridge, current sensor), disable motors
+      enable = 0;
+      beepCount(7, 24, 1);
+    #endif
     } else if (timeoutFlgADC) {                                                                       // 2 beeps (low pitch): ADC timeout
       beepCount(2, 24, 1);
     } else if (timeoutFlgSerial) {                                                                    // 3 beeps (low pitch): Serial timeout
@@ -573,6 +735,10 @@ int main(void) {
       beepCount(4, 24, 1);
     } else if (TEMP_WARNING_ENABLE && board_temp_deg_c >= TEMP_WARNING) {                             // 5 beeps (low pitch): Mainboard temperature warning
       beepCount(5, 24, 1);
+    #ifdef STALL_DETECT_ENABLE
+    } else if (stallLeft.b_stall || stallRight.b_stall) {                                              // 6 beeps (low pitch): Motor stalled, current limit reduced
+      beepCount(6, 24, 1);
+    #endif
     } else if (BAT_LVL1_ENABLE && batVoltage < BAT_LVL1) {                                            // 1 beep fast (medium pitch): Low bat 1
       beepCount(0, 10, 6);
     } else if (BAT_LVL2_ENABLE && batVoltage < BAT_LVL2) {                                            // 1 beep slow (medium pitch): Low bat 2
@@ -585,6 +751,10 @@ int main(void) {
       backwardDrive = 0;
     }
 
+    // ####### BEEP SEQUENCES AND POWEROFF SEQUENCE #######
+    beepUpdate();                         // Play the queued beeps
+    dbgUpdate();                          // Send the buffered debug output
+    poweroffUpdate();                     // Release the power latch once the poweroff melody is played
 
     inactivity_timeout_counter++;
 
@@ -602,7 +772,7 @@ int main(void) {
 
     if (inactivity_timeout_counter > (INACTIVITY_TIMEOUT * 60 * 1000) / (DELAY_IN_MAIN_LOOP + 1)) {  // rest of main loop needs maybe 1ms
       #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-        printf("Powering off, wheels were inactive for too long\r\n");
+        dbgPrintf("Powering off, wheels were inactive for too long\r\n");
       #endif
       poweroff();
     }
@@ -613,8 +783,20 @@ int main(void) {
     inIdx_prev = inIdx;
     buzzerTimer_prev = buzzerTimer;
     main_loop_counter++;
-    }
-  }
+    watchdogCheckIn(WDG_TASK_LOOP);
+    #ifdef STACK_MONITOR_ENABLE
+      if (main_loop_counter % (1000 / DELAY_IN_MAIN_LOOP) == 0) {   // Update the stack high-water mark every 1 s
+        stackCheck();
+      }
+    #endif
+    #ifdef BOOT_SLOT
+      if (main_loop_counter % (1000 / DELAY_IN_MAIN_LOOP) == 0) {   // Confirm a trial image to the bootloader once it runs healthy
+        bootConfirm();
+      }
+    #endif
+    #ifdef CYCLE_MEASURE_ENABLE
+      cycLoopMax = MAX(cycLoopMax, DWT->CYCCNT - cycStart);
+    #endif
 }
 
 
@@ -0,0 +1,121 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Includes
+#include "multiboard.h"
+
+static int32_t clamp32(int32_t x, int32_t lo, int32_t hi) {
+  return x < lo ? lo : (x > hi ? hi : x);
+}
+
+// XOR of all 16 bit words of the frame except the checksum (last word)
+static uint16_t linkChecksum(const void *frame, uint32_t size) {
+  const uint16_t *word = (const uint16_t *)frame;
+  uint16_t checksum = 0;
+  for (uint32_t i = 0; i < size / 2 - 1; i++) {
+    checksum ^= word[i];
+  }
+  return checksum;
+}
+
+ /*
+ * Start with the link lost: the motors stay safe until the first valid frame of the other board
+ */
+void linkInit(LinkState *l, uint16_t timeout) {
+  l->timeout = timeout;
+  l->cnt     = timeout;
+  l->lost    = 1;
+}
+
+ /*
+ * Set the start word and the checksum of a frame to send
+ */
+void linkSeal(void *frame, uint32_t size) {
+  uint16_t *word     = (uint16_t *)frame;
+  word[0]            = LINK_START_FRAME;
+  word[size / 2 - 1] = linkChecksum(frame, size);
+}
+
+ /*
+ * Check a received frame: start word and checksum. A valid frame restarts the link timeout. Returns 1 if valid
+ */
+uint8_t linkRxValid(LinkState *l, const void *frame, uint32_t size) {
+  const uint16_t *word = (const uint16_t *)frame;
+  if (word[0] != LINK_START_FRAME || word[size / 2 - 1] != linkChecksum(frame, size)) {
+    return 0;
+  }
+  l->cnt  = 0;
+  l->lost = 0;
+  return 1;
+}
+
+ /*
+ * Link timeout qualification, once per main loop cycle. Returns the lost flag
+ */
+uint8_t linkTimeoutStep(LinkState *l) {
+  if (l->cnt >= l->timeout) {
+    l->lost = 1;                    // No valid frame for timeout cycles
+  } else {
+    l->cnt++;
+  }
+  return l->lost;
+}
+
+ /*
+ * Torque split, nominal master axle share frontPct [%], each axle at least minPct [%]
+ */
+void torqueSplitInit(TorqueSplit *t, uint8_t frontPct, uint8_t minPct, int16_t slipN) {
+  t->shareNom = ((int32_t)frontPct << 15) / 100;
+  t->shareMin = ((int32_t)minPct << 15) / 100;
+  t->slipN    = slipN;
+  t->share[0] = t->share[1] = t->shareNom;
+}
+
+ /*
+ * Split the demand of each side (2 x cmd[i]) between the master wheel (cmd[i] out) and the slave wheel (slv[i]).
+ * dir: sign of the motor direction of the demand, nMst / nSlv: master / slave wheel speeds [rpm].
+ * A wheel faster than its partner by slipN in the driving direction is slipping: the master axle share moves away from
+ * it by 1 % per call, otherwise back to the nominal share. A wheel target clipped to +-cmdMax hands the excess to the
+ * other wheel of its side, so the sum of both targets stays the demand.
+ */
+void torqueSplitStep(TorqueSplit *t, int16_t cmd[2], int16_t slv[2], const int16_t dir[2], const int16_t nMst[2],
+                     const int16_t nSlv[2], int16_t cmdMax) {
+  const int32_t shareMax  = (1 << 15) - t->shareMin;
+  const int32_t shareStep = (1 << 15) / 100;
+  for (uint8_t i = 0; i < 2; i++) {
+    int32_t demand = 2 * (int32_t)cmd[i];
+    int32_t target = t->shareNom;
+    int32_t slip   = dir[i] >= 0 ? nMst[i] - nSlv[i] : nSlv[i] - nMst[i];  // > 0: master wheel faster in the driving direction
+    if (slip > t->slipN) {
+      target = t->shareMin;
+    } else if (slip < -t->slipN) {
+      target = shareMax;
+    }
+    t->share[i] += clamp32(target - t->share[i], -shareStep, shareStep);
+    t->share[i]  = clamp32(t->share[i], t->shareMin, shareMax);
+
+    int32_t mst    = (demand * t->share[i]) >> 15;
+    int32_t mstSat = clamp32(mst, -cmdMax, cmdMax);
+    int32_t sl     = demand - mstSat;                 // includes the excess of the master wheel
+    int32_t slSat  = clamp32(sl, -cmdMax, cmdMax);
+    mstSat         = clamp32(mstSat + sl - slSat, -cmdMax, cmdMax);   // and the excess of the slave wheel back
+    cmd[i]         = (int16_t)mstSat;
+    slv[i]         = (int16_t)slSat;
+  }
+}
@@ -53,8 +53,14 @@ DMA_HandleTypeDef hdma_usart3_rx;
 DMA_HandleTypeDef hdma_usart3_tx;
 volatile adc_buf_t adc_buffer;
 
+#if defined(SERIAL_BUS_DE_PORT) && (defined(DEBUG_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || defined(MULTI_BOARD_LINK))
+  // Pointer and cast compares, out of reach of #if: PA2 / PA3 are the USART2 pins on the left sensor board cable
+  _Static_assert(SERIAL_BUS_DE_PORT != GPIOA || !(SERIAL_BUS_DE_PIN & (GPIO_PIN_2 | GPIO_PIN_3)),
+                 "SERIAL_BUS_DE_PIN on PA2 / PA3 not allowed with SERIAL_USART2 or MULTI_BOARD, the USART2 cable");
+#endif
+
 
-#if defined(DEBUG_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2)
+#if defined(DEBUG_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || defined(MULTI_BOARD_LINK)
  /* USART2 init function */
  void UART2_Init(void)
 {
@@ -108,7 +114,7 @@ void UART3_Init(void)
 #endif
 
 #if defined(DEBUG_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || \
-    defined(DEBUG_SERIAL_USART3) || defined(CONTROL_SERIAL_USART3) || defined(FEEDBACK_SERIAL_USART3) || defined(SIDEBOARD_SERIAL_USART3)
+    defined(DEBUG_SERIAL_USART3) || defined(CONTROL_SERIAL_USART3) || defined(FEEDBACK_SERIAL_USART3) || defined(SIDEBOARD_SERIAL_USART3) || defined(MULTI_BOARD_LINK)
 void HAL_UART_MspInit(UART_HandleTypeDef* uartHandle)
 {
   GPIO_InitTypeDef GPIO_InitStruct = {0};
@@ -220,6 +226,14 @@ void HAL_UART_MspInit(UART_HandleTypeDef* uartHandle)
     HAL_NVIC_EnableIRQ(USART3_IRQn);
   /* USER CODE BEGIN USART3_MspInit 1 */
 	__HAL_UART_ENABLE_IT (uartHandle, UART_IT_IDLE);  // Enable the USART IDLE line detection interrupt
+  #ifdef SERIAL_BUS_DE_PORT
+    HAL_GPIO_WritePin(SERIAL_BUS_DE_PORT, SERIAL_BUS_DE_PIN, GPIO_PIN_RESET);   // bus transceiver: receive
+    GPIO_InitStruct.Pin   = SERIAL_BUS_DE_PIN;
+    GPIO_InitStruct.Mode  = GPIO_MODE_OUTPUT_PP;
+    GPIO_InitStruct.Pull  = GPIO_NOPULL;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+    HAL_GPIO_Init(SERIAL_BUS_DE_PORT, &GPIO_InitStruct);
+  #endif
   /* USER CODE END USART3_MspInit 1 */
   }
 }
@@ -50,6 +50,17 @@ extern DMA_HandleTypeDef hdma_usart3_tx;
 /* USER CODE BEGIN 0 */
 extern UART_HandleTypeDef huart2;
 extern UART_HandleTypeDef huart3;
+
+// Fault record in .noinit RAM: survives the reset and is reported by faultReport() at the next boot
+FaultRecord faultRecord NOINIT;
+
+// Fault handler entry: pass the exception frame (MSP or PSP, selected by EXC_RETURN bit 2) and EXC_RETURN to faultCapture()
+#define FAULT_ENTRY()   __asm volatile ("tst   lr, #4     \n"  \
+                                        "ite   eq         \n"  \
+                                        "mrseq r0, msp    \n"  \
+                                        "mrsne r0, psp    \n"  \
+                                        "mov   r1, lr     \n"  \
+                                        "b     faultCapture \n")
 /* USER CODE END 0 */
 
 /* External variables --------------------------------------------------------*/
@@ -74,57 +85,37 @@ void NMI_Handler(void) {
 /**
 * @brief This function handles Hard fault interrupt.
 */
-void HardFault_Handler(void) {
+__attribute__((naked)) void HardFault_Handler(void) {
   /* USER CODE BEGIN HardFault_IRQn 0 */
-
+  FAULT_ENTRY();
   /* USER CODE END HardFault_IRQn 0 */
-  while(1) {
-  }
-  /* USER CODE BEGIN HardFault_IRQn 1 */
-
-  /* USER CODE END HardFault_IRQn 1 */
 }
 
 /**
 * @brief This function handles Memory management fault.
 */
-void MemManage_Handler(void) {
+__attribute__((naked)) void MemManage_Handler(void) {
   /* USER CODE BEGIN MemoryManagement_IRQn 0 */
-
+  FAULT_ENTRY();
   /* USER CODE END MemoryManagement_IRQn 0 */
-  while(1) {
-  }
-  /* USER CODE BEGIN MemoryManagement_IRQn 1 */
-
-  /* USER CODE END MemoryManagement_IRQn 1 */
 }
 
 /**
 * @brief This function handles Prefetch fault, memory access fault.
 */
-void BusFault_Handler(void) {
+__attribute__((naked)) void BusFault_Handler(void) {
   /* USER CODE BEGIN BusFault_IRQn 0 */
-
+  FAULT_ENTRY();
   /* USER CODE END BusFault_IRQn 0 */
-  while(1) {
-  }
-  /* USER CODE BEGIN BusFault_IRQn 1 */
-
-  /* USER CODE END BusFault_IRQn 1 */
 }
 
 /**
 * @brief This function handles Undefined instruction or illegal state.
 */
-void UsageFault_Handler(void) {
+__attribute__((naked)) void UsageFault_Handler(void) {
   /* USER CODE BEGIN UsageFault_IRQn 0 */
-
+  FAULT_ENTRY();
   /* USER CODE END UsageFault_IRQn 0 */
-  while(1) {
-  }
-  /* USER CODE BEGIN UsageFault_IRQn 1 */
-
-  /* USER CODE END UsageFault_IRQn 1 */
 }
 
 /**
@@ -276,7 +267,7 @@ void EXTI15_10_IRQHandler(void)
 }
 #endif
 
-#if defined(DEBUG_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2)
+#if defined(DEBUG_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || defined(MULTI_BOARD_LINK)
 void DMA1_Channel6_IRQHandler(void)
 {
   /* USER CODE BEGIN DMA1_Channel4_IRQn 0 */
@@ -333,7 +324,7 @@ void DMA1_Channel3_IRQHandler(void)
 }
 #endif
 
-#if defined(DEBUG_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2)
+#if defined(DEBUG_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || defined(MULTI_BOARD_LINK)
 /**
   * @brief This function handles USART2 global interrupt.
   */
@@ -381,5 +372,41 @@ void USART3_IRQHandler(void)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief Common fault handler: disable both bridges, capture the fault record and reset.
+  * @param frame: exception stack frame (R0-R3, R12, LR, PC, xPSR)
+  * @param excReturn: EXC_RETURN value of the fault handler
+  */
+void faultCapture(uint32_t *frame, uint32_t excReturn) {
+  extern uint32_t _estack;
+
+  LEFT_TIM->BDTR  &= ~TIM_BDTR_MOE;                           // Bridges off first: the capture below may fault again
+  RIGHT_TIM->BDTR &= ~TIM_BDTR_MOE;
+
+  faultRecord.excReturn = excReturn;
+  faultRecord.cfsr      = SCB->CFSR;
+  faultRecord.hfsr      = SCB->HFSR;
+  faultRecord.bfar      = SCB->BFAR;
+  faultRecord.mmfar     = SCB->MMFAR;
+  faultRecord.handler   = (uint16_t)(__get_IPSR() & 0x1FF);
+  if ((uint32_t)frame >= SRAM_BASE && (uint32_t)(frame + 8) <= (uint32_t)&_estack) {  // Only read a frame that lies within RAM
+    faultRecord.r0      = frame[0];
+    faultRecord.r1      = frame[1];
+    faultRecord.r2      = frame[2];
+    faultRecord.r3      = frame[3];
+    faultRecord.r12     = frame[4];
+    faultRecord.lr      = frame[5];
+    faultRecord.pc      = frame[6];
+    faultRecord.psr     = frame[7];
+    faultRecord.isr     = (uint16_t)(frame[7] & 0x1FF);      // exception active when the fault occurred: 0 = main loop
+    for (uint8_t i = 0; i < 8; i++) {
+      faultRecord.stack[i] = (frame + 9 + i <= &_estack) ? frame[8 + i] : 0;
+    }
+  }
+  faultRecord.magic     = FAULT_MAGIC;
+
+  NVIC_SystemReset();
+}
+
 /* USER CODE END 1 */
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -110,8 +110,11 @@
 /*!< Uncomment the following line if you need to relocate your vector Table in
      Internal SRAM. */
 /* #define VECT_TAB_SRAM */
+#ifndef VECT_TAB_OFFSET
 #define VECT_TAB_OFFSET 0x00000000U /*!< Vector Table base offset field. \
-                                 This value must be a multiple of 0x200. */
+                                 This value must be a multiple of 0x200. \
+                                 Set by the Makefile for the boot slot builds (see boot.h). */
+#endif
 
 
 /**
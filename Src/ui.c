@@ -0,0 +1,132 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Includes
+#include "ui.h"
+
+ /*
+ * Queue a tone of the given length [ms]. freq = 0 is a pause. The tone is dropped if the queue is full.
+ * The caller masks the interrupts if it can be interrupted by another push.
+ */
+void beepQueuePush(BeepQueue *q, uint8_t freq, uint16_t duration) {
+  uint8_t next = (q->head + 1) % BEEP_QUEUE_SIZE;
+  if (next != q->tail) {
+    q->freq[q->head] = freq;
+    q->time[q->head] = duration;
+    q->head          = next;
+  }
+}
+
+ /*
+ * Play the queue at 'now'. Returns 1 if the buzzer changes to '*freq' (0 = off), at the end of a tone or the start
+ * of the next one
+ */
+uint8_t beepQueueStep(BeepQueue *q, uint32_t now, uint8_t *freq) {
+  uint8_t change = 0;
+  if (q->acv) {
+    if (now - q->start < (uint32_t)UI_TICKS_MS * q->time[q->tail]) {
+      return 0;
+    }
+    q->tail = (q->tail + 1) % BEEP_QUEUE_SIZE;
+    q->acv  = 0;
+    *freq   = 0;
+    change  = 1;
+  }
+  if (q->tail != q->head) {
+    *freq    = q->freq[q->tail];
+    q->start = now;
+    q->acv   = 1;
+    change   = 1;
+  }
+  return change;
+}
+
+ /*
+ * Nothing queued and nothing playing
+ */
+uint8_t beepQueueIdle(const BeepQueue *q) {
+  return !q->acv && q->tail == q->head;
+}
+
+void buttonInit(Button *b) {
+  b->state = BUTTON_IDLE;
+  b->held  = 0;
+  b->time  = 0;
+}
+
+ /*
+ * Power button, called every main loop cycle with the button level. calib: a calibration runs, a press confirms it.
+ * Short press: power off. Long press (5 s, beep) and release: calibrate the input limits, unless the button is
+ * pressed again within 1 s: adjust the current and speed limits on that release. Returns a BUTTON_EVT_
+ */
+uint8_t buttonStep(Button *b, uint8_t pressed, uint8_t calib, uint32_t now) {
+  uint32_t elapsed = (now - b->time) / UI_TICKS_MS;   // [ms] since the last state change
+  switch (b->state) {
+    case BUTTON_IDLE:
+      if (pressed && calib) {
+        b->state = BUTTON_CONFIRM;
+        return BUTTON_EVT_CONFIRM;
+      }
+      if (pressed) {
+        b->state = BUTTON_PRESSED;
+        b->time  = now;
+        b->held  = 0;
+      }
+      break;
+    case BUTTON_CONFIRM:
+      if (!pressed) {
+        b->state = BUTTON_IDLE;
+      }
+      break;
+    case BUTTON_PRESSED:
+      if (pressed) {
+        if (elapsed >= BUTTON_LONG_MS && !b->held) {
+          b->held = 1;
+          return BUTTON_EVT_HELD;
+        }
+      } else if (elapsed >= BUTTON_LONG_MS) {
+        b->state = BUTTON_WAIT;
+        b->time  = now;
+        return BUTTON_EVT_RELEASED;
+      } else if (elapsed > BUTTON_DEBOUNCE_MS) {
+        b->state = BUTTON_IDLE;
+        return BUTTON_EVT_SHORT;
+      } else {
+        b->state = BUTTON_IDLE;
+      }
+      break;
+    case BUTTON_WAIT:
+      if (elapsed >= BUTTON_SECOND_MS) {
+        if (pressed) {
+          b->state = BUTTON_PRESSED2;
+        } else {
+          b->state = BUTTON_IDLE;
+          return BUTTON_EVT_LONG;
+        }
+      }
+      break;
+    case BUTTON_PRESSED2:
+      if (!pressed) {
+        b->state = BUTTON_IDLE;
+        return BUTTON_EVT_DOUBLE;
+      }
+      break;
+  }
+  return BUTTON_EVT_NONE;
+}
@@ -19,6 +19,7 @@
 
 // Includes
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h> // for abs()
 #include <string.h>
 #include "stm32f1xx_hal.h"
@@ -27,9 +28,13 @@
 #include "config.h"
 #include "eeprom.h"
 #include "util.h"
+#include "boot.h"
 #include "BLDC_controller.h"
 #include "rtwtypes.h"
 #include "comms.h"
+#include "ctrlsched.h"
+#include "watchdog.h"
+#include "dbgfmt.h"
 
 #if defined(DEBUG_I2C_LCD) || defined(SUPPORT_LCD)
 #include "hd44780.h"
@@ -52,6 +57,19 @@ extern uint8_t buzzerFreq;              // global variable for the buzzer pitch.
 extern uint8_t buzzerPattern;           // global variable for the buzzer pattern. can be 1, 2, 3, 4, 5, 6, 7...
 
 extern uint8_t enable;                  // global variable for motor enable
+extern volatile uint32_t buzzerTimer;   // motor ISR tick counter: 16 ticks = 1 ms
+
+#ifdef MULTI_MODE_DRIVE
+extern uint16_t rate;                   // rate limiter rate of the main loop
+extern uint16_t max_speed;              // maximum speed of the main loop
+#endif
+#ifdef MOTOR_DIAG_ENABLE
+extern MotorDiag diagLeft;              // diagnostics of the Left motor
+extern MotorDiag diagRight;             // diagnostics of the Right motor
+extern volatile uint8_t  selfTestPha;   // phase pulsed by the self test
+extern volatile uint16_t selfTestCnt;   // remaining self test pulse length
+extern volatile int16_t  selfTestCur[6];// currents at the end of the self test pulse
+#endif
 
 extern uint8_t nunchuk_data[6];
 extern volatile uint32_t timeoutCntGen; // global counter for general timeout counter
@@ -67,6 +85,13 @@ extern volatile uint16_t pwm_captured_ch1_value;
 extern volatile uint16_t pwm_captured_ch2_value;
 #endif
 
+#if defined(MULTI_BOARD_SLAVE)
+extern int16_t  batVoltageCalib;        // calibrated battery voltage
+extern int16_t  board_temp_deg_c;       // calibrated temperature in degrees Celsius
+extern uint16_t wheel_left_ticks;
+extern uint16_t wheel_right_ticks;
+#endif
+
 
 //------------------------------------------------------------------------
 // Global variables set here in util.c
@@ -106,23 +131,71 @@ uint8_t  timeoutFlgSerial = 0;          // Timeout Flag for Rx Serial command: 0
 
 uint8_t  ctrlModReqRaw = CTRL_MOD_REQ;
 uint8_t  ctrlModReq    = CTRL_MOD_REQ;  // Final control mode request 
+int16_t  iMotMax;                       // configured max phase current (I_MOT_MAX parameter) fixdt(1,16,4), rtP i_max is the runtime limit
+
+#ifdef CTRL_SCHED_ENABLE
+CtrlSched ctrlSched;                    // control type scheduler: selected type and input target gain
+extern int16_t curL_DC, curR_DC;        // DC link currents [ADC counts] (bldc.c)
+#endif
+
+#ifdef MULTI_MODE_DRIVE
+uint8_t   drive_mode;                   // active drive mode. Can be changed at runtime, the limits follow smoothly
+DriveMode driveModes[MULTI_MODE_DRIVE_NR] = {
+  {MULTI_MODE_DRIVE_M1_MAX, MULTI_MODE_DRIVE_M1_RATE, (MULTI_MODE_M1_I_MOT_MAX * A2BIT_CONV) << 4, MULTI_MODE_M1_N_MOT_MAX << 4},
+  {MULTI_MODE_DRIVE_M2_MAX, MULTI_MODE_DRIVE_M2_RATE, (MULTI_MODE_M2_I_MOT_MAX * A2BIT_CONV) << 4, MULTI_MODE_M2_N_MOT_MAX << 4},
+  {MULTI_MODE_DRIVE_M3_MAX, MULTI_MODE_DRIVE_M3_RATE, (MULTI_MODE_M3_I_MOT_MAX * A2BIT_CONV) << 4, MULTI_MODE_M3_N_MOT_MAX << 4} };
+#endif
 
 #if defined(DEBUG_I2C_LCD) || defined(SUPPORT_LCD)
 LCD_PCF8574_HandleTypeDef lcd;
 #endif
 
 #ifdef VARIANT_TRANSPOTTER
-float    setDistance;
+uint16_t setDistance;                             // distance setpoint [mm]
 uint16_t VirtAddVarTab[NB_OF_VAR] = {1337};       // Virtual address defined by the user: 0xFFFF value is prohibited
 static   uint16_t saveValue       = 0;
 static   uint8_t  saveValue_valid = 0;
 #elif !defined(VARIANT_HOVERBOARD) && !defined(VARIANT_TRANSPOTTER)
-uint16_t VirtAddVarTab[NB_OF_VAR] = {1000, 1001, 1002, 1003, 1004, 1005, 1006, 1007, 1008, 1009,
-                                     1010, 1011, 1012, 1013, 1014, 1015, 1016, 1017, 1018};
+#define EE_PARAM_VIRT_ADDR(id, addr, name, var, varR, init, initFormat, min, max, div, mul, fix, callback, help) \
+  [addr] = EE_VIRT_ADDR + addr,
+uint16_t VirtAddVarTab[NB_OF_VAR] = {EE_VIRT_ADDR, EE_PARAMS(EE_PARAM_VIRT_ADDR)};  // see EE_PARAMS in eeparams.h
 #else
 uint16_t VirtAddVarTab[NB_OF_VAR] = {1000};       // Dummy virtual address to avoid warnings
 #endif
 
+#ifdef SERIAL_BUS
+uint8_t  busNode = SERIAL_BUS_NODE;               // node id on the bus
+BusStats busStats;
+static uint8_t  busReply[SERIAL_BUFFER_SIZE];     // latest feedback frame, set by the main loop
+static uint8_t  busTx[SERIAL_BUFFER_SIZE];        // reply in transmission
+static uint16_t busReplyLen;
+static void busReplySend(void);
+#endif
+
+#if !defined(VARIANT_HOVERBOARD) && !defined(VARIANT_TRANSPOTTER)
+#define EE_PARAM_ENTRY(id, addr, name, var, varR, init, initFormat, min, max, div, mul, fix, callback, help) \
+  {addr, sizeof(var), &(var), varR},
+static const EEParam eeParams[] = {               // Persistent parameters, see EE_PARAMS in eeparams.h
+  EE_PARAMS_LIMITS(EE_PARAM_ENTRY)
+  EE_PARAMS_IN1(EE_PARAM_ENTRY)
+  EE_PARAMS_IN2(EE_PARAM_ENTRY)
+  #if INPUTS_NR > 1
+  EE_PARAMS_AUX_IN1(EE_PARAM_ENTRY)
+  EE_PARAMS_AUX_IN2(EE_PARAM_ENTRY)
+  #endif
+  #ifdef MULTI_MODE_DRIVE
+  EE_PARAMS_DRIVE_MODES(EE_PARAM_ENTRY)
+  #endif
+  #ifdef SERIAL_BUS
+  EE_PARAMS_BUS(EE_PARAM_ENTRY)
+  #endif
+};
+#define EE_PARAM_NR   (sizeof(eeParams) / sizeof(EEParam))
+static EEStore eeStore = {.param = eeParams, .nr = EE_PARAM_NR, .virtAddr = VirtAddVarTab, .key = FLASH_WRITE_KEY,
+                          .read = EE_ReadVariable, .write = EE_WriteVariable};
+_Static_assert(EE_PARAM_NR <= 32, "EEStore.synced holds 32 parameters");
+#endif
+
 
 //------------------------------------------------------------------------
 // Local variables
@@ -130,6 +203,27 @@ uint16_t VirtAddVarTab[NB_OF_VAR] = {1000};       // Dummy virtual address to av
 static int16_t INPUT_MAX;             // [-] Input target maximum limitation
 static int16_t INPUT_MIN;             // [-] Input target minimum limitation
 
+#ifdef MULTI_MODE_DRIVE
+  #define DRIVE_MODE_BLEND_STEP ((32768 * DELAY_IN_MAIN_LOOP) / MULTI_MODE_SWITCH_TIME)
+  static uint8_t   drive_mode_prev;
+  static uint16_t  driveModeBlend = 32768;    // transition progress fixdt(0,16,15) = [0, 1.0]
+  static DriveMode driveModeFrom;             // limits at the moment of the drive mode switch
+  static int16_t   driveModeIMax;             // i_max of the drive mode, blended on a switch fixdt(1,16,4)
+#endif
+
+#ifdef STALL_DETECT_ENABLE
+  extern StallDetect stallLeft;               // stall detection of the Left motor
+  extern StallDetect stallRight;              // stall detection of the Right motor
+#endif
+
+
+#ifdef TIMEOUT_FAILSAFE_ENABLE
+  enum {FAILSAFE_IDLE, FAILSAFE_HOLD, FAILSAFE_BRAKE, FAILSAFE_STOP};
+  static uint8_t  failsafeState = FAILSAFE_IDLE;
+  static uint16_t failsafeCnt;                // [main loop] time spent in the current failsafe state
+  static int16_t  failsafeCmd1;               // last valid input1 command fixdt(1,16,4)
+  static int16_t  failsafeCmd2;               // last valid input2 command fixdt(1,16,4)
+#endif
 
 #if !defined(VARIANT_HOVERBOARD) && !defined(VARIANT_TRANSPOTTER)
   static uint8_t  cur_spd_valid  = 0;
@@ -140,7 +234,7 @@ static int16_t INPUT_MIN;             // [-] Input target minimum limitation
 static uint16_t timeoutCntADC = ADC_PROTECT_TIMEOUT;  // Timeout counter for ADC Protection
 #endif
 
-#if defined(DEBUG_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2)
+#if defined(DEBUG_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || defined(MULTI_BOARD_LINK)
 static uint8_t  rx_buffer_L[SERIAL_BUFFER_SIZE];      // USART Rx DMA circular buffer
 static uint32_t rx_buffer_L_len = ARRAY_LEN(rx_buffer_L);
 #endif
@@ -168,6 +262,33 @@ SerialSideboard Sideboard_R_raw;
 static uint32_t Sideboard_R_len = sizeof(Sideboard_R);
 #endif
 
+#if defined(MULTI_BOARD_MASTER)
+SerialLinkFeedback linkFeedback;                      // last valid slave feedback, merged into the host feedback
+static SerialLinkFeedback linkRx_raw;
+static SerialLinkCommand  linkTx;
+uint16_t linkTick;                                    // master main loop counter sent to the slave
+  #ifdef TORQUE_SPLIT_ENABLE
+  static int16_t  splitSlaveCmd[2];                   // slave left / right wheel targets
+  static TorqueSplit split = {(TORQUE_SPLIT_FRONT << 15) / 100, (TORQUE_SPLIT_MIN << 15) / 100, TORQUE_SLIP_N,
+                              {(TORQUE_SPLIT_FRONT << 15) / 100, (TORQUE_SPLIT_FRONT << 15) / 100}};
+  #endif
+#elif defined(MULTI_BOARD_SLAVE)
+static SerialLinkCommand  linkCommand;                // last valid master command
+static SerialLinkCommand  linkRx_raw;
+static SerialLinkFeedback linkTx;
+static volatile uint32_t  linkRxTime;                 // buzzerTimer at the last valid master command
+static volatile uint8_t   linkRxNew;                  // a master command arrived since the last multiBoardSync()
+#endif
+#if defined(MULTI_BOARD_LINK)
+static LinkState boardLink = {MULTI_BOARD_TIMEOUT, MULTI_BOARD_TIMEOUT, 1};  // board link timeout: lost until the first frame
+#endif
+
+#ifdef FEEDBACK_TIMESTAMP
+static volatile uint32_t  syncRxTime;                 // buzzerTimer at the last valid host command
+static volatile uint16_t  syncId;                     // its syncId
+static volatile uint8_t   syncValid;                  // a host command was received
+#endif
+
 #if defined(CONTROL_SERIAL_USART2)
 static SerialCommand commandL;
 static SerialCommand commandL_raw;
@@ -198,33 +319,98 @@ static uint8_t brakePressed;
 #if defined(CRUISE_CONTROL_SUPPORT) || (defined(STANDSTILL_HOLD_ENABLE) && (CTRL_TYP_SEL == FOC_CTRL) && (CTRL_MOD_REQ != SPD_MODE))
 static uint8_t cruiseCtrlAcv = 0;
 static uint8_t standstillAcv = 0;
+#ifdef CRUISE_CONTROL_SUPPORT
+static uint32_t cruiseCtrlTime;                 // buzzerTimer at the last cruise control change
+#endif
+#endif
+
+static BeepQueue beeps;                         // queued tones, played by beepUpdate()
+
+uint8_t poweroffAcv = 0;                        // poweroff sequence running, the motors stay disabled
+uint8_t calibReq    = CALIB_OFF;                // requested calibration mode, written by the debug protocol: 0 = confirm
+uint8_t calibMode   = CALIB_OFF;                // running calibration mode, the motors stay disabled
+InputStruct calIn1;                             // calibration progress: min, mid, max of input1
+InputStruct calIn2;                             // calibration progress: min, mid, max of input2
+#if !defined(VARIANT_HOVERBOARD) && !defined(VARIANT_TRANSPOTTER)
+static int32_t  calIn1_fixdt;
+static int32_t  calIn2_fixdt;
+static uint16_t calibCnt;                       // main loop cycles since the calibration start
 #endif
+static Button   button;                         // power button state machine, time base buzzerTimer
 
-/* =========================== Retargeting printf =========================== */
-/* retarget the C library printf function to the USART */
+/* =========================== Debug Print Functions =========================== */
+/* dbgPrintf() formats with dbgFormat() (dbgfmt.c) into a ring buffer and returns, dbgUpdate() in the main loop hands
+ * the buffer to the UART Tx DMA. In an interrupt, e.g. the debug protocol in the UART Rx interrupt, what does not
+ * fit is dropped (DBG_DROP). In the main loop a long output, e.g. the parameter help, waits for space. */
 #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-  #ifdef __GNUC__
-    #define PUTCHAR_PROTOTYPE int __io_putchar(int ch)
+  #define DBG_TX_SIZE   512                     // [bytes] debug output ring buffer, power of 2
+  #define DBG_CHUNK     32                      // [bytes] stack buffer of dbgPrintf()
+  #if defined(DEBUG_SERIAL_USART2)
+    #define DBG_UART    huart2
   #else
-    #define PUTCHAR_PROTOTYPE int fputc(int ch, FILE *f)
+    #define DBG_UART    huart3
   #endif
-  PUTCHAR_PROTOTYPE {
-    #if defined(DEBUG_SERIAL_USART2)
-      HAL_UART_Transmit(&huart2, (uint8_t *)&ch, 1, 1000);
-    #elif defined(DEBUG_SERIAL_USART3)
-      HAL_UART_Transmit(&huart3, (uint8_t *)&ch, 1, 1000);
-    #endif
-    return ch;
+  static char dbgTx[DBG_TX_SIZE];
+  static volatile uint16_t dbgHead;             // next free byte, written with the interrupts disabled
+  static volatile uint16_t dbgTail;             // first byte not yet sent, written by dbgUpdate() only
+  static uint16_t dbgSent;                      // bytes of the DMA transfer in progress, from dbgTail on
+  uint16_t dbgDrop;                             // characters dropped because the buffer was full in an interrupt
+
+  static void dbgWrite(const char *s, uint16_t n) {
+    while (n) {
+      uint32_t primask = __get_PRIMASK();
+      __disable_irq();
+      uint16_t head = dbgHead;
+      uint16_t k    = MIN(n, (uint16_t)((dbgTail - head - 1) & (DBG_TX_SIZE - 1)));
+      for (uint16_t i = 0; i < k; i++) {
+        dbgTx[(head + i) & (DBG_TX_SIZE - 1)] = s[i];
+      }
+      dbgHead = (head + k) & (DBG_TX_SIZE - 1);
+      __set_PRIMASK(primask);
+      s += k;
+      n -= k;
+      if (n && (__get_IPSR() || primask)) {     // Interrupt or interrupts disabled: no waiting for the DMA
+        dbgDrop += n;
+        return;
+      }
+      if (n) {
+        watchdogYield();                        // Sends the buffer, bounded by the output length
+      }
+    }
   }
-  
-  #ifdef __GNUC__
-    int _write(int file, char *data, int len) {
-      int i;
-      for (i = 0; i < len; i++) { __io_putchar( *data++ );}
-      return len;
+#endif
+
+void dbgPrintf(const char *fmt, ...) {
+  #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
+    char    buf[DBG_CHUNK];
+    va_list ap;
+    va_start(ap, fmt);
+    dbgFormat(buf, sizeof(buf), dbgWrite, fmt, ap);
+    va_end(ap);
+  #endif
+}
+
+ /*
+ * Start the DMA transfer of the buffered debug output once the previous one is done. Called every main loop cycle
+ */
+void dbgUpdate(void) {
+  #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
+    if (__HAL_DMA_GET_COUNTER(DBG_UART.hdmatx) != 0) {          // Transfer in progress (debug or feedback)
+      return;
+    }
+    dbgTail = (dbgTail + dbgSent) & (DBG_TX_SIZE - 1);
+    dbgSent = 0;
+    uint16_t head = dbgHead;
+    uint16_t tail = dbgTail;
+    if (head == tail) {
+      return;
+    }
+    uint16_t len = (head > tail ? head : DBG_TX_SIZE) - tail;   // Up to the end of the buffer, the rest follows
+    if (HAL_UART_Transmit_DMA(&DBG_UART, (uint8_t *)&dbgTx[tail], len) == HAL_OK) {
+      dbgSent = len;
     }
   #endif
-#endif
+}
 
  
 /* =========================== Initialization Functions =========================== */
@@ -235,13 +421,18 @@ void BLDC_Init(void) {
   rtP_Left.z_selPhaCurMeasABC   = 0;            // Left motor measured current phases {Green, Blue} = {iA, iB} -> do NOT change
   rtP_Left.z_ctrlTypSel         = CTRL_TYP_SEL;
   rtP_Left.b_diagEna            = DIAG_ENA;
-  rtP_Left.i_max                = (I_MOT_MAX * A2BIT_CONV) << 4;        // fixdt(1,16,4)
+  iMotMax                       = (I_MOT_MAX * A2BIT_CONV) << 4;        // fixdt(1,16,4)
+  rtP_Left.i_max                = iMotMax;
   rtP_Left.n_max                = N_MOT_MAX << 4;                       // fixdt(1,16,4)
   rtP_Left.b_fieldWeakEna       = FIELD_WEAK_ENA; 
   rtP_Left.id_fieldWeakMax      = (FIELD_WEAK_MAX * A2BIT_CONV) << 4;   // fixdt(1,16,4)
   rtP_Left.a_phaAdvMax          = PHASE_ADV_MAX << 4;                   // fixdt(1,16,4)
   rtP_Left.r_fieldWeakHi        = FIELD_WEAK_HI << 4;                   // fixdt(1,16,4)
   rtP_Left.r_fieldWeakLo        = FIELD_WEAK_LO << 4;                   // fixdt(1,16,4)
+  #ifdef CTRL_SCHED_ENABLE
+  ctrlSchedInit(&ctrlSched);
+  rtP_Left.z_ctrlTypSel         = ctrlSched.ctrlTyp;
+  #endif
 
   rtP_Right                     = rtP_Left;     // Copy the Left motor parameters to the Right motor parameters
   rtP_Right.z_selPhaCurMeasABC  = 1;            // Right motor measured current phases {Blue, Yellow} = {iB, iC} -> do NOT change
@@ -282,13 +473,13 @@ void Input_Init(void) {
     PWM_Init();
   #endif
 
-  #if defined(DEBUG_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2)
+  #if defined(DEBUG_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(FEEDBACK_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || defined(MULTI_BOARD_LINK)
     UART2_Init();
   #endif
   #if defined(DEBUG_SERIAL_USART3) || defined(CONTROL_SERIAL_USART3) || defined(FEEDBACK_SERIAL_USART3) || defined(SIDEBOARD_SERIAL_USART3)
     UART3_Init();
   #endif
-  #if defined(DEBUG_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2)
+  #if defined(DEBUG_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || defined(MULTI_BOARD_LINK)
     HAL_UART_Receive_DMA(&huart2, (uint8_t *)rx_buffer_L, sizeof(rx_buffer_L));
     UART_DisableRxErrors(&huart2);
   #endif
@@ -298,34 +489,24 @@ void Input_Init(void) {
   #endif
 
   #if !defined(VARIANT_HOVERBOARD) && !defined(VARIANT_TRANSPOTTER)
-    uint16_t writeCheck, readVal;
+    uint16_t writeCheck;
     HAL_FLASH_Unlock();
     EE_Init();            /* EEPROM Init */
     EE_ReadVariable(VirtAddVarTab[0], &writeCheck);
     if (writeCheck == FLASH_WRITE_KEY) {
       #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-        printf("Using the configuration from EEprom\r\n");
+        dbgPrintf("Using the configuration from EEprom\r\n");
       #endif
 
-      EE_ReadVariable(VirtAddVarTab[1] , &readVal); rtP_Left.i_max = rtP_Right.i_max = (int16_t)readVal;
-      EE_ReadVariable(VirtAddVarTab[2] , &readVal); rtP_Left.n_max = rtP_Right.n_max = (int16_t)readVal;
+      eeParamsLoad();     // Parameters not yet in EEPROM (older firmware) keep the config.h values
       for (uint8_t i=0; i<INPUTS_NR; i++) {
-        EE_ReadVariable(VirtAddVarTab[ 3+8*i] , &readVal); input1[i].typ = (uint8_t)readVal;
-        EE_ReadVariable(VirtAddVarTab[ 4+8*i] , &readVal); input1[i].min = (int16_t)readVal;
-        EE_ReadVariable(VirtAddVarTab[ 5+8*i] , &readVal); input1[i].mid = (int16_t)readVal;
-        EE_ReadVariable(VirtAddVarTab[ 6+8*i] , &readVal); input1[i].max = (int16_t)readVal;
-        EE_ReadVariable(VirtAddVarTab[ 7+8*i] , &readVal); input2[i].typ = (uint8_t)readVal;
-        EE_ReadVariable(VirtAddVarTab[ 8+8*i] , &readVal); input2[i].min = (int16_t)readVal;
-        EE_ReadVariable(VirtAddVarTab[ 9+8*i] , &readVal); input2[i].mid = (int16_t)readVal;
-        EE_ReadVariable(VirtAddVarTab[10+8*i] , &readVal); input2[i].max = (int16_t)readVal;
-      
-        printf("Limits Input1: TYP:%i MIN:%i MID:%i MAX:%i\r\nLimits Input2: TYP:%i MIN:%i MID:%i MAX:%i\r\n",
+        dbgPrintf("Limits Input1: TYP:%i MIN:%i MID:%i MAX:%i\r\nLimits Input2: TYP:%i MIN:%i MID:%i MAX:%i\r\n",
           input1[i].typ, input1[i].min, input1[i].mid, input1[i].max,
           input2[i].typ, input2[i].min, input2[i].mid, input2[i].max);
       }
     } else {
       #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-        printf("Using the configuration from config.h\r\n");
+        dbgPrintf("Using the configuration from config.h\r\n");
       #endif
 
       for (uint8_t i=0; i<INPUTS_NR; i++) {
@@ -339,7 +520,7 @@ void Input_Init(void) {
         } else {
           input2[i].typ = input2[i].typDef;
         }
-        printf("Limits Input1: TYP:%i MIN:%i MID:%i MAX:%i\r\nLimits Input2: TYP:%i MIN:%i MID:%i MAX:%i\r\n",
+        dbgPrintf("Limits Input1: TYP:%i MIN:%i MID:%i MAX:%i\r\nLimits Input2: TYP:%i MIN:%i MID:%i MAX:%i\r\n",
           input1[i].typ, input1[i].min, input1[i].mid, input1[i].max,
           input2[i].typ, input2[i].min, input2[i].mid, input2[i].max);
       }
@@ -355,9 +536,9 @@ void Input_Init(void) {
     EE_ReadVariable(VirtAddVarTab[0], &saveValue);
     HAL_FLASH_Lock();
 
-    setDistance = saveValue / 1000.0;
-    if (setDistance < 0.2) {
-      setDistance = 1.0;
+    setDistance = saveValue;
+    if (setDistance < 200) {
+      setDistance = 1000;
     }
   #endif
 
@@ -405,7 +586,7 @@ void Input_Init(void) {
   * @retval None
   */
 #if defined(DEBUG_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || \
-    defined(DEBUG_SERIAL_USART3) || defined(CONTROL_SERIAL_USART3) || defined(SIDEBOARD_SERIAL_USART3)
+    defined(DEBUG_SERIAL_USART3) || defined(CONTROL_SERIAL_USART3) || defined(SIDEBOARD_SERIAL_USART3) || defined(MULTI_BOARD_LINK)
 void UART_DisableRxErrors(UART_HandleTypeDef *huart)
 {  
   CLEAR_BIT(huart->Instance->CR1, USART_CR1_PEIE);    /* Disable PE (Parity Error) interrupts */  
@@ -417,32 +598,50 @@ void UART_DisableRxErrors(UART_HandleTypeDef *huart)
 /* =========================== General Functions =========================== */
 
 void poweronMelody(void) {
-    buzzerCount = 0;  // prevent interraction with beep counter
     for (int i = 8; i >= 0; i--) {
-      buzzerFreq = (uint8_t)i;
-      HAL_Delay(100);
+      beepTone((uint8_t)i, 100);
     }
-    buzzerFreq = 0;
 }
 
 void beepCount(uint8_t cnt, uint8_t freq, uint8_t pattern) {
+    if (!beepQueueIdle(&beeps)) {          // prevent interraction with the queued beeps
+      return;
+    }
     buzzerCount   = cnt;
     buzzerFreq    = freq;
     buzzerPattern = pattern;
 }
 
 void beepLong(uint8_t freq) {
-    buzzerCount = 0;  // prevent interraction with beep counter
-    buzzerFreq = freq;
-    HAL_Delay(500);
-    buzzerFreq = 0;
+    beepTone(freq, 500);
 }
 
 void beepShort(uint8_t freq) {
-    buzzerCount = 0;  // prevent interraction with beep counter
-    buzzerFreq = freq;
-    HAL_Delay(100);
-    buzzerFreq = 0;
+    beepTone(freq, 100);
+}
+
+ /*
+ * Queue a tone of the given length [ms]. freq = 0 is a pause. The tones are played by beepUpdate() without blocking.
+ * Can be called from interrupts (debug protocol). The tone is dropped if the queue is full.
+ */
+void beepTone(uint8_t freq, uint16_t duration) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    beepQueuePush(&beeps, freq, duration);
+    __set_PRIMASK(primask);
+}
+
+ /*
+ * Play the queued tones, called every main loop cycle and from the bounded waits (watchdogYield).
+ * The status beeps (beepCount) are held off while the queue is not empty.
+ */
+void beepUpdate(void) {
+    uint8_t freq;
+    if (beepQueueStep(&beeps, buzzerTimer, &freq)) {
+      buzzerCount   = 0;  // prevent interraction with beep counter
+      buzzerPattern = 0;
+      buzzerFreq    = freq;
+    }
 }
 
 void beepShortMany(uint8_t cnt, int8_t dir) {
@@ -491,86 +690,66 @@ void calcAvgSpeed(void) {
  * Auto-calibration of the ADC Limits
  * This function finds the Minimum, Maximum, and Middle for the ADC input
  * Procedure:
- * - press the power button for more than 5 sec and release after the beep sound
+ * - press the power button for more than 5 sec and release after the beep sound, or SET CALIB 1 via the debug protocol
  * - move the potentiometers freely to the min and max limits repeatedly
  * - release potentiometers to the resting postion
- * - press the power button to confirm or wait for the 20 sec timeout
+ * - press the power button or SET CALIB 0 to confirm, or wait for the 20 sec timeout
  * The Values will be saved to flash. Values are persistent if you flash with platformio. To erase them, make a full chip erase.
+ * The calibration runs in the background of the main loop (calibUpdate), the motors stay disabled until it is finished.
  */
 void adcCalibLim(void) {
-#ifdef AUTO_CALIBRATION_ENA
-  calcAvgSpeed();
-  if (speedAvgAbs > 5) {    // do not enter this mode if motors are spinning
-    return;
-  }
+  #ifdef AUTO_CALIBRATION_ENA
+    calibReq = CALIB_INPUT;
+  #endif
+}
 
-#if !defined(VARIANT_HOVERBOARD) && !defined(VARIANT_TRANSPOTTER)
+ /*
+ * Update Maximum Motor Current Limit (via ADC1) and Maximum Speed Limit (via ADC2)
+ * Procedure:
+ * - press the power button for more than 5 sec and immediatelly after the beep sound press one more time shortly, or SET CALIB 2
+ * - move and hold the pots to a desired limit position for Current and Speed
+ * - press the power button or SET CALIB 0 to confirm, or wait for the 10 sec timeout
+ */
+void updateCurSpdLim(void) {
+  calibReq = CALIB_LIMITS;
+}
 
-  #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-  printf("Input calibration started...\r\n");
-  #endif
-
-  readInputRaw();
-  // Inititalization: MIN = a high value, MAX = a low value
-  int32_t  input1_fixdt = input1[inIdx].raw << 16;
-  int32_t  input2_fixdt = input2[inIdx].raw << 16;
-  int16_t  INPUT1_MIN_temp = MAX_int16_T;
-  int16_t  INPUT1_MID_temp = 0;
-  int16_t  INPUT1_MAX_temp = MIN_int16_T;
-  int16_t  INPUT2_MIN_temp = MAX_int16_T;
-  int16_t  INPUT2_MID_temp = 0;
-  int16_t  INPUT2_MAX_temp = MIN_int16_T;
-  int16_t  input_margin    = 0;
-  uint16_t input_cal_timeout = 0;
-  
+#if !defined(VARIANT_HOVERBOARD) && !defined(VARIANT_TRANSPOTTER)
+static void adcCalibLimFinish(void) {
+  int16_t input_margin = 0;
   #ifdef CONTROL_ADC
   if (inIdx == CONTROL_ADC) {
     input_margin = ADC_MARGIN;
   }
   #endif
 
-  // Extract MIN, MAX and MID from ADC while the power button is not pressed
-  while (!HAL_GPIO_ReadPin(BUTTON_PORT, BUTTON_PIN) && input_cal_timeout++ < 4000) {   // 20 sec timeout
-    readInputRaw();
-    filtLowPass32(input1[inIdx].raw, FILTER, &input1_fixdt);
-    filtLowPass32(input2[inIdx].raw, FILTER, &input2_fixdt);
-    
-    INPUT1_MID_temp = (int16_t)(input1_fixdt >> 16);// CLAMP(input1_fixdt >> 16, INPUT1_MIN, INPUT1_MAX);   // convert fixed-point to integer
-    INPUT2_MID_temp = (int16_t)(input2_fixdt >> 16);// CLAMP(input2_fixdt >> 16, INPUT2_MIN, INPUT2_MAX);
-    INPUT1_MIN_temp = MIN(INPUT1_MIN_temp, INPUT1_MID_temp);
-    INPUT1_MAX_temp = MAX(INPUT1_MAX_temp, INPUT1_MID_temp);
-    INPUT2_MIN_temp = MIN(INPUT2_MIN_temp, INPUT2_MID_temp);
-    INPUT2_MAX_temp = MAX(INPUT2_MAX_temp, INPUT2_MID_temp);
-    HAL_Delay(5);
-  }
-
   #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-  printf("Input1 is ");
+  dbgPrintf("Input1 is ");
   #endif
-  uint8_t input1TypTemp = checkInputType(INPUT1_MIN_temp, INPUT1_MID_temp, INPUT1_MAX_temp);
+  uint8_t input1TypTemp = checkInputType(calIn1.min, calIn1.mid, calIn1.max);
   if (input1TypTemp == input1[inIdx].typDef || input1[inIdx].typDef == 3) {  // Accept calibration only if the type is correct OR type was set to 3 (auto)
     #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-    printf("..OK\r\n");
+    dbgPrintf("..OK\r\n");
     #endif
   } else {
     input1TypTemp = 0; // Disable input
     #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-    printf("..NOK\r\n");
+    dbgPrintf("..NOK\r\n");
     #endif
   }
 
   #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-  printf("Input2 is ");
+  dbgPrintf("Input2 is ");
   #endif
-  uint8_t input2TypTemp = checkInputType(INPUT2_MIN_temp, INPUT2_MID_temp, INPUT2_MAX_temp);
+  uint8_t input2TypTemp = checkInputType(calIn2.min, calIn2.mid, calIn2.max);
   if (input2TypTemp == input2[inIdx].typDef || input2[inIdx].typDef == 3) {  // Accept calibration only if the type is correct OR type was set to 3 (auto)
     #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-    printf("..OK\r\n");
+    dbgPrintf("..OK\r\n");
     #endif
   } else {
     input2TypTemp = 0; // Disable input
     #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-    printf("..NOK\r\n");
+    dbgPrintf("..NOK\r\n");
     #endif
   }
 
@@ -578,70 +757,40 @@ void adcCalibLim(void) {
   // At least one of the inputs is not ignored
   if (input1TypTemp != 0 || input2TypTemp != 0){
     input1[inIdx].typ = input1TypTemp;
-    input1[inIdx].min = INPUT1_MIN_temp + input_margin;
-    input1[inIdx].mid = INPUT1_MID_temp;
-    input1[inIdx].max = INPUT1_MAX_temp - input_margin;
+    input1[inIdx].min = calIn1.min + input_margin;
+    input1[inIdx].mid = calIn1.mid;
+    input1[inIdx].max = calIn1.max - input_margin;
 
     input2[inIdx].typ = input2TypTemp;
-    input2[inIdx].min = INPUT2_MIN_temp + input_margin;
-    input2[inIdx].mid = INPUT2_MID_temp;
-    input2[inIdx].max = INPUT2_MAX_temp - input_margin;
+    input2[inIdx].min = calIn2.min + input_margin;
+    input2[inIdx].mid = calIn2.mid;
+    input2[inIdx].max = calIn2.max - input_margin;
 
     inp_cal_valid = 1;    // Mark calibration to be saved in Flash at shutdown
     #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-    printf("Limits Input1: TYP:%i MIN:%i MID:%i MAX:%i\r\nLimits Input2: TYP:%i MIN:%i MID:%i MAX:%i\r\n",
+    dbgPrintf("Limits Input1: TYP:%i MIN:%i MID:%i MAX:%i\r\nLimits Input2: TYP:%i MIN:%i MID:%i MAX:%i\r\n",
             input1[inIdx].typ, input1[inIdx].min, input1[inIdx].mid, input1[inIdx].max,
             input2[inIdx].typ, input2[inIdx].min, input2[inIdx].mid, input2[inIdx].max);
     #endif
   }else{
     #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-    printf("Both inputs cannot be ignored, calibration rejected.\r\n");
+    dbgPrintf("Both inputs cannot be ignored, calibration rejected.\r\n");
     #endif
   }
-
-#endif
-#endif  // AUTO_CALIBRATION_ENA
 }
- /*
- * Update Maximum Motor Current Limit (via ADC1) and Maximum Speed Limit (via ADC2)
- * Procedure:
- * - press the power button for more than 5 sec and immediatelly after the beep sound press one more time shortly
- * - move and hold the pots to a desired limit position for Current and Speed
- * - press the power button to confirm or wait for the 10 sec timeout
- */
-void updateCurSpdLim(void) {
-  calcAvgSpeed();
-  if (speedAvgAbs > 5) {    // do not enter this mode if motors are spinning
-    return;
-  }
-
-#if !defined(VARIANT_HOVERBOARD) && !defined(VARIANT_TRANSPOTTER)
-
-  #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-  printf("Torque and Speed limits update started...\r\n");
-  #endif
 
-  int32_t  input1_fixdt = input1[inIdx].raw << 16;
-  int32_t  input2_fixdt = input2[inIdx].raw << 16;
+static void updateCurSpdLimFinish(void) {
   uint16_t cur_factor;    // fixdt(0,16,16)
   uint16_t spd_factor;    // fixdt(0,16,16)
-  uint16_t cur_spd_timeout = 0;
   cur_spd_valid = 0;
 
-  // Wait for the power button press
-  while (!HAL_GPIO_ReadPin(BUTTON_PORT, BUTTON_PIN) && cur_spd_timeout++ < 2000) {  // 10 sec timeout
-    readInputRaw();
-    filtLowPass32(input1[inIdx].raw, FILTER, &input1_fixdt);
-    filtLowPass32(input2[inIdx].raw, FILTER, &input2_fixdt);
-    HAL_Delay(5);
-  }
   // Calculate scaling factors
-  cur_factor = CLAMP((input1_fixdt - (input1[inIdx].min << 16)) / (input1[inIdx].max - input1[inIdx].min), 6553, 65535);    // ADC1, MIN_cur(10%) = 1.5 A 
-  spd_factor = CLAMP((input2_fixdt - (input2[inIdx].min << 16)) / (input2[inIdx].max - input2[inIdx].min), 3276, 65535);    // ADC2, MIN_spd(5%)  = 50 rpm
+  cur_factor = CLAMP((calIn1_fixdt - (input1[inIdx].min << 16)) / (input1[inIdx].max - input1[inIdx].min), 6553, 65535);    // ADC1, MIN_cur(10%) = 1.5 A 
+  spd_factor = CLAMP((calIn2_fixdt - (input2[inIdx].min << 16)) / (input2[inIdx].max - input2[inIdx].min), 3276, 65535);    // ADC2, MIN_spd(5%)  = 50 rpm
       
   if (input1[inIdx].typ != 0){
     // Update current limit
-    rtP_Left.i_max = rtP_Right.i_max  = (int16_t)((I_MOT_MAX * A2BIT_CONV * cur_factor) >> 12);    // fixdt(0,16,16) to fixdt(1,16,4)
+    iMotMax         = (int16_t)((I_MOT_MAX * A2BIT_CONV * cur_factor) >> 12);    // fixdt(0,16,16) to fixdt(1,16,4)
     cur_spd_valid   = 1;  // Mark update to be saved in Flash at shutdown
   }
 
@@ -653,11 +802,89 @@ void updateCurSpdLim(void) {
 
   #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
   // cur_spd_valid: 0 = No limit changed, 1 = Current limit changed, 2 = Speed limit changed, 3 = Both limits changed
-  printf("Limits (%i)\r\nCurrent: fixdt:%li factor%i i_max:%i \r\nSpeed: fixdt:%li factor:%i n_max:%i\r\n",
-          cur_spd_valid, input1_fixdt, cur_factor, rtP_Left.i_max, input2_fixdt, spd_factor, rtP_Left.n_max);
+  char curTxt[DBG_FIXDT_LEN], spdTxt[DBG_FIXDT_LEN], nTxt[DBG_FIXDT_LEN];
+  dbgPrintf("Limits (%i)\r\nCurrent: fixdt:%li factor:%s i_max:%i \r\nSpeed: fixdt:%li factor:%s n_max:%s rpm\r\n",
+          cur_spd_valid, calIn1_fixdt, dbgFixdt(curTxt, cur_factor, 16, 3), iMotMax,
+          calIn2_fixdt, dbgFixdt(spdTxt, spd_factor, 16, 3), dbgFixdt(nTxt, rtP_Left.n_max, 4, 1));
   #endif
-
+}
 #endif
+
+ /*
+ * Calibration modes, called every main loop cycle after readCommand(). Started by adcCalibLim() / updateCurSpdLim()
+ * or by the debug protocol (CALIB = 1 / 2), confirmed by the power button or CALIB = 0, or ended by the timeout.
+ * The main loop keeps running: feedback, timeouts and serial inputs stay alive and the progress can be watched (CAL_IN*).
+ */
+void calibUpdate(void) {
+  #if !defined(VARIANT_HOVERBOARD) && !defined(VARIANT_TRANSPOTTER)
+    if (calibMode == CALIB_OFF) {
+      if (calibReq == CALIB_OFF) {
+        return;
+      }
+      calcAvgSpeed();
+      if (speedAvgAbs > 5) {    // do not enter this mode if motors are spinning
+        calibReq = CALIB_OFF;
+        return;
+      }
+      #ifndef AUTO_CALIBRATION_ENA
+      if (calibReq == CALIB_INPUT) {
+        calibReq = CALIB_OFF;
+        return;
+      }
+      #endif
+      calibMode     = calibReq;
+      calibCnt      = 0;
+      enable        = 0;
+      calIn1_fixdt  = input1[inIdx].raw << 16;
+      calIn2_fixdt  = input2[inIdx].raw << 16;
+      calIn1.min    = calIn2.min = MAX_int16_T;   // Inititalization: MIN = a high value, MAX = a low value
+      calIn1.max    = calIn2.max = MIN_int16_T;
+      if (calibMode == CALIB_INPUT) {
+        beepLong(16);
+        #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
+        dbgPrintf("Input calibration started...\r\n");
+        #endif
+      } else {
+        beepLong(8);
+        #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
+        dbgPrintf("Torque and Speed limits update started...\r\n");
+        #endif
+      }
+      return;
+    }
+
+    // Extract MIN, MAX and MID from the inputs until confirmed
+    filtLowPass32(input1[inIdx].raw, FILTER, &calIn1_fixdt);
+    filtLowPass32(input2[inIdx].raw, FILTER, &calIn2_fixdt);
+    calIn1.mid = (int16_t)(calIn1_fixdt >> 16);
+    calIn2.mid = (int16_t)(calIn2_fixdt >> 16);
+    calIn1.min = MIN(calIn1.min, calIn1.mid);
+    calIn1.max = MAX(calIn1.max, calIn1.mid);
+    calIn2.min = MIN(calIn2.min, calIn2.mid);
+    calIn2.max = MAX(calIn2.max, calIn2.mid);
+    calibCnt++;
+
+    #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
+    if (calibCnt % (1000 / DELAY_IN_MAIN_LOOP) == 0) {  // Progress every second
+      dbgPrintf("Cal In1 MIN:%i MID:%i MAX:%i In2 MIN:%i MID:%i MAX:%i\r\n",
+              calIn1.min, calIn1.mid, calIn1.max, calIn2.min, calIn2.mid, calIn2.max);
+    }
+    #endif
+
+    uint16_t timeout = (calibMode == CALIB_INPUT ? 20000 : 10000) / DELAY_IN_MAIN_LOOP;   // 20 sec / 10 sec timeout
+    if (calibReq == calibMode && calibCnt < timeout) {
+      return;
+    }
+    if (calibMode == CALIB_INPUT) {
+      adcCalibLimFinish();
+    } else {
+      updateCurSpdLimFinish();
+    }
+    beepShort(5);
+    calibMode = calibReq = CALIB_OFF;
+  #else
+    calibReq = CALIB_OFF;
+  #endif
 }
 
  /*
@@ -736,17 +963,22 @@ void electricBrake(uint16_t speedBlend, uint8_t reverseDir) {
  */
 void cruiseControl(uint8_t button) {
   #ifdef CRUISE_CONTROL_SUPPORT
+    if (buzzerTimer - cruiseCtrlTime < 16 * 200) {                      // 200 ms hold-off after a change. Acts as a debounce also.
+      return;
+    }
     if (button && !rtP_Left.b_cruiseCtrlEna) {                          // Cruise control activated
       rtP_Left.n_cruiseMotTgt   = rtY_Left.n_mot;
       rtP_Right.n_cruiseMotTgt  = rtY_Right.n_mot;
       rtP_Left.b_cruiseCtrlEna  = 1;
       rtP_Right.b_cruiseCtrlEna = 1;
       cruiseCtrlAcv = 1;
-      beepShortMany(2, 1);                                              // 200 ms beep delay. Acts as a debounce also.
+      cruiseCtrlTime = buzzerTimer;
+      beepShortMany(2, 1);
     } else if (button && rtP_Left.b_cruiseCtrlEna && !standstillAcv) {  // Cruise control deactivated if no Standstill Hold is active
       rtP_Left.b_cruiseCtrlEna  = 0;
       rtP_Right.b_cruiseCtrlEna = 0;
       cruiseCtrlAcv = 0;
+      cruiseCtrlTime = buzzerTimer;
       beepShortMany(2, -1);
     }
   #endif
@@ -768,25 +1000,25 @@ int checkInputType(int16_t min, int16_t mid, int16_t max){
   if ((min / threshold) == (max / threshold) || (mid / threshold) == (max / threshold) || min > max || mid > max) {
     type = 0;
     #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-    printf("ignored");                // (MIN and MAX) OR (MID and MAX) are close, disable input
+    dbgPrintf("ignored");                // (MIN and MAX) OR (MID and MAX) are close, disable input
     #endif
   } else {
     if ((min / threshold) == (mid / threshold)){
       type = 1;
       #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-      printf("a normal pot");        // MIN and MID are close, it's a normal pot
+      dbgPrintf("a normal pot");        // MIN and MID are close, it's a normal pot
       #endif
     } else {
       type = 2;
       #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-      printf("a mid-resting pot");   // it's a mid resting pot
+      dbgPrintf("a mid-resting pot");   // it's a mid resting pot
       #endif
     }
 
     #ifdef CONTROL_ADC
     if ((min + ADC_MARGIN - ADC_PROTECT_THRESH) > 0 && (max - ADC_MARGIN + ADC_PROTECT_THRESH) < 4095) {
       #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-      printf(" AND protected");
+      dbgPrintf(" AND protected");
       #endif
       beepLong(2); // Indicate protection by a beep
     }
@@ -824,6 +1056,72 @@ void calcInputCmd(InputStruct *in, int16_t out_min, int16_t out_max) {
   }
 }
 
+ /*
+ * Failsafe Function
+ * Called on every main loop while an input timeout is active. Instead of going directly to OPEN_MODE (coasting), it:
+ *  1. holds the last valid command for FAILSAFE_HOLD_TIME
+ *  2. brakes to standstill: in TORQUE mode a braking torque opposite to the direction of motion is applied,
+ *     in VOLTAGE and SPEED mode the command is ramped to 0 with FAILSAFE_RATE
+ *  3. requests OPEN_MODE once standstill is reached or FAILSAFE_BRAKE_TIME elapsed
+ *
+ * Input: timeout flags, speedAvg, ctrlModReqRaw
+ * Output: input1[inIdx].cmd, input2[inIdx].cmd, ctrlModReq
+ */
+void failsafeHandle(void) {
+  #ifdef TIMEOUT_FAILSAFE_ENABLE
+    uint16_t speedBlend;
+    int16_t  brakeVal;
+
+    switch (failsafeState) {
+      case FAILSAFE_IDLE:                                               // Timeout just detected
+        failsafeState = FAILSAFE_HOLD;
+        failsafeCnt   = 0;
+        #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
+          dbgPrintf("Failsafe: holding last command\r\n");
+        #endif
+        // fall through
+      case FAILSAFE_HOLD:
+        if (++failsafeCnt >= FAILSAFE_HOLD_TIME / DELAY_IN_MAIN_LOOP) {
+          failsafeState = FAILSAFE_BRAKE;
+          failsafeCnt   = 0;
+        }
+        break;
+
+      case FAILSAFE_BRAKE:
+        if (ctrlModReqRaw == TRQ_MODE) {
+          speedBlend   = (uint16_t)(((CLAMP(speedAvgAbs,10,60) - 10) << 15) / 50);  // Fade out the braking torque towards standstill to avoid reverse driving
+          brakeVal     = (int16_t)((FAILSAFE_TRQ_BRAKE * speedBlend) >> 15);
+          failsafeCmd2 = (speedAvg > 0 ? -brakeVal : brakeVal) << 4;
+          #ifdef TANK_STEERING
+            failsafeCmd1 = failsafeCmd2;
+          #else
+            failsafeCmd1 = 0;
+          #endif
+        } else {
+          rateLimiter16(0, FAILSAFE_RATE, &failsafeCmd1);
+          rateLimiter16(0, FAILSAFE_RATE, &failsafeCmd2);
+        }
+        if ((speedAvgAbs < FAILSAFE_STOP_SPEED && (ctrlModReqRaw == TRQ_MODE || (!failsafeCmd1 && !failsafeCmd2))) ||
+            ++failsafeCnt >= FAILSAFE_BRAKE_TIME / DELAY_IN_MAIN_LOOP) {
+          failsafeState = FAILSAFE_STOP;
+          #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
+            dbgPrintf("Failsafe: braking finished\r\n");
+          #endif
+        }
+        break;
+
+      default:                                                          // FAILSAFE_STOP
+        failsafeCmd1 = 0;
+        failsafeCmd2 = 0;
+        break;
+    }
+
+    ctrlModReq        = (failsafeState == FAILSAFE_STOP) ? OPEN_MODE : ctrlModReqRaw;
+    input1[inIdx].cmd = failsafeCmd1 >> 4;
+    input2[inIdx].cmd = failsafeCmd2 >> 4;
+  #endif
+}
+
  /*
  * Function to read the Input Raw values from various input devices
  */
@@ -845,6 +1143,7 @@ void readInputRaw(void) {
       if (inIdx == CONTROL_NUNCHUK) {
         input1[inIdx].raw = (nunchuk_data[0] - 127) * 8; // X axis 0-255
         input2[inIdx].raw = (nunchuk_data[1] - 128) * 8; // Y axis 0-255
+        inputCheckIn(CONTROL_NUNCHUK);
       }
       #ifdef SUPPORT_BUTTONS
         button1 = (uint8_t)nunchuk_data[5] & 1;
@@ -925,6 +1224,11 @@ void readInputRaw(void) {
     }
     #endif
 
+    #if defined(MULTI_BOARD_SLAVE)
+      input1[inIdx].raw = linkCommand.cmd1;
+      input2[inIdx].raw = linkCommand.cmd2;
+    #endif
+
     #ifdef VARIANT_TRANSPOTTER
       #ifdef GAMETRAK_CONNECTION_NORMAL
         input1[inIdx].cmd = adc_buffer.l_rx2;
@@ -1007,6 +1311,11 @@ void handleTimeout(void) {
       timeoutFlgSerial = timeoutFlgSerial_L || timeoutFlgSerial_R;
     #endif
 
+    uint8_t timeoutFlgLink = 0;                         // Board link lost, cleared by the next frame of the other board
+    #if defined(MULTI_BOARD_LINK)
+      timeoutFlgLink = linkTimeoutStep(&boardLink);
+    #endif
+
     #if defined(CONTROL_NUNCHUK) || defined(SUPPORT_NUNCHUK) || defined(VARIANT_TRANSPOTTER) || \
         defined(CONTROL_PPM_LEFT) || defined(CONTROL_PPM_RIGHT) || defined(CONTROL_PWM_LEFT) || defined(CONTROL_PWM_RIGHT)
       if (timeoutCntGen++ >= TIMEOUT) {                 // Timeout qualification
@@ -1028,13 +1337,23 @@ void handleTimeout(void) {
       }
     #endif
 
-    // In case of timeout bring the system to a Safe State
-    if (timeoutFlgADC || timeoutFlgSerial || timeoutFlgGen) {
-      ctrlModReq  = OPEN_MODE;                                          // Request OPEN_MODE. This will bring the motor power to 0 in a controlled way
-      input1[inIdx].cmd  = 0;
-      input2[inIdx].cmd  = 0;
+    // In case of timeout bring the system to a Safe State. Both boards stop if the other one is lost
+    if (timeoutFlgADC || timeoutFlgSerial || timeoutFlgGen || timeoutFlgLink) {
+      watchdogCheckIn(WDG_TASK_INPUT);                                  // The input handling is alive and holds the motors safe
+      #ifdef TIMEOUT_FAILSAFE_ENABLE
+        failsafeHandle();                                               // Hold the last command, brake to standstill, then OPEN_MODE
+      #else
+        ctrlModReq  = OPEN_MODE;                                        // Request OPEN_MODE. This will bring the motor power to 0 in a controlled way
+        input1[inIdx].cmd  = 0;
+        input2[inIdx].cmd  = 0;
+      #endif
     } else {
       ctrlModReq  = ctrlModReqRaw;                                      // Follow the Mode request
+      #ifdef TIMEOUT_FAILSAFE_ENABLE
+        failsafeState = FAILSAFE_IDLE;
+        failsafeCmd1  = input1[inIdx].cmd << 4;                         // Remember the last valid command
+        failsafeCmd2  = input2[inIdx].cmd << 4;
+      #endif
     }
 
     // Beep in case of Input index change
@@ -1062,6 +1381,11 @@ void readCommand(void) {
       #endif
     #endif
 
+    #if defined(MULTI_BOARD_SLAVE)
+      input1[inIdx].cmd = linkCommand.cmd1;                             // The master commands are already limited
+      input2[inIdx].cmd = linkCommand.cmd2;
+    #endif
+
     handleTimeout();
 
     #ifdef VARIANT_HOVERCAR
@@ -1090,7 +1414,7 @@ void readCommand(void) {
  */
 void usart2_rx_check(void)
 {
-  #if defined(DEBUG_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2)  
+  #if defined(DEBUG_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || defined(MULTI_BOARD_LINK)
   static uint32_t old_pos;
   uint32_t pos;
   pos = rx_buffer_L_len - __HAL_DMA_GET_COUNTER(huart2.hdmarx);         // Calculate current position in buffer
@@ -1147,7 +1471,25 @@ void usart2_rx_check(void)
   }
   #endif // SIDEBOARD_SERIAL_USART2
 
-  #if defined(DEBUG_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2)
+  #ifdef MULTI_BOARD_LINK
+  uint8_t *ptr;	
+  if (pos != old_pos) {                                                 // Check change in received data
+    ptr = (uint8_t *)&linkRx_raw;                                       // Initialize the pointer with linkRx_raw address
+    if (pos > old_pos && (pos - old_pos) == sizeof(linkRx_raw)) {       // "Linear" buffer mode: check if current position is over previous one AND data length equals expected length
+      memcpy(ptr, &rx_buffer_L[old_pos], sizeof(linkRx_raw));           // Copy data. This is possible only if linkRx_raw is contiguous! (meaning all the structure members have the same size)
+      usart_process_link();                                             // Process data
+    } else if ((rx_buffer_L_len - old_pos + pos) == sizeof(linkRx_raw)) { // "Overflow" buffer mode: check if data length equals expected length
+      memcpy(ptr, &rx_buffer_L[old_pos], rx_buffer_L_len - old_pos);    // First copy data from the end of buffer
+      if (pos > 0) {                                                    // Check and continue with beginning of buffer
+        ptr += rx_buffer_L_len - old_pos;                               // Move to correct position in linkRx_raw
+        memcpy(ptr, &rx_buffer_L[0], pos);                              // Copy remaining data
+      }
+      usart_process_link();                                             // Process data
+    }
+  }
+  #endif // MULTI_BOARD_LINK
+
+  #if defined(DEBUG_SERIAL_USART2) || defined(CONTROL_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART2) || defined(MULTI_BOARD_LINK)
   old_pos = pos;                                                        // Update old position
   if (old_pos == rx_buffer_L_len) {                                     // Check and manually update if we reached end of buffer
     old_pos = 0;
@@ -1185,20 +1527,9 @@ void usart3_rx_check(void)
   #endif // DEBUG_SERIAL_USART3
 
   #ifdef CONTROL_SERIAL_USART3
-  uint8_t *ptr;
-  if (pos != old_pos) {                                                 // Check change in received data
-    ptr = (uint8_t *)&commandR_raw;                                     // Initialize the pointer with command_raw address
-    if (pos > old_pos && (pos - old_pos) == commandR_len) {             // "Linear" buffer mode: check if current position is over previous one AND data length equals expected length
-      memcpy(ptr, &rx_buffer_R[old_pos], commandR_len);                 // Copy data. This is possible only if command_raw is contiguous! (meaning all the structure members have the same size)
-      usart_process_command(&commandR_raw, &commandR, 3);               // Process data
-    } else if ((rx_buffer_R_len - old_pos + pos) == commandR_len) {     // "Overflow" buffer mode: check if data length equals expected length
-      memcpy(ptr, &rx_buffer_R[old_pos], rx_buffer_R_len - old_pos);    // First copy data from the end of buffer
-      if (pos > 0) {                                                    // Check and continue with beginning of buffer
-        ptr += rx_buffer_R_len - old_pos;                               // Move to correct position in command_raw
-        memcpy(ptr, &rx_buffer_R[0], pos);                              // Copy remaining data
-      }
-      usart_process_command(&commandR_raw, &commandR, 3);               // Process data
-    }
+  if (pos != old_pos &&                                                 // Check change in received data
+      busRxBurst(rx_buffer_R, rx_buffer_R_len, old_pos, pos, &commandR_raw, commandR_len)) {  // Data of expected length copied (busnode.c)
+    usart_process_command(&commandR_raw, &commandR, 3);                 // Process data
   }
   #endif // CONTROL_SERIAL_USART3
 
@@ -1261,36 +1592,85 @@ void usart_process_command(SerialCommand *command_in, SerialCommand *command_out
           #ifdef CONTROL_SERIAL_USART2
           timeoutFlgSerial_L = 0;         // Clear timeout flag
           timeoutCntSerial_L = 0;         // Reset timeout counter
+          inputCheckIn(CONTROL_SERIAL_USART2);
           #endif
         } else if (usart_idx == 3) {      // Sideboard USART3
           #ifdef CONTROL_SERIAL_USART3
           timeoutFlgSerial_R = 0;         // Clear timeout flag
           timeoutCntSerial_R = 0;         // Reset timeout counter
+          inputCheckIn(CONTROL_SERIAL_USART3);
           #endif
         }
       }
     }
   #else
-  uint16_t checksum;
-  if (command_in->start == SERIAL_START_FRAME) {
-    checksum = (uint16_t)(command_in->start ^ command_in->steer ^ command_in->speed);
-    if (command_in->checksum == checksum) {
-      *command_out = *command_in;
-      if (usart_idx == 2) {             // Sideboard USART2
-        #ifdef CONTROL_SERIAL_USART2
-        timeoutFlgSerial_L = 0;         // Clear timeout flag
-        timeoutCntSerial_L = 0;         // Reset timeout counter
-        #endif
-      } else if (usart_idx == 3) {      // Sideboard USART3
-        #ifdef CONTROL_SERIAL_USART3
-        timeoutFlgSerial_R = 0;         // Clear timeout flag
-        timeoutCntSerial_R = 0;         // Reset timeout counter
-        #endif
-      }
+  #ifdef SERIAL_BUS
+  uint8_t rx = busCommandRx(command_in, sizeof(SerialCommand), busNode, &busStats);  // start frame, checksum and address (busnode.c)
+  if (rx == BUS_RX_OWN || rx == BUS_RX_BROADCAST) {
+  #else
+  uint16_t checksum = (uint16_t)(command_in->start ^ command_in->steer ^ command_in->speed
+  #ifdef MULTI_MODE_SERIAL
+                      ^ command_in->driveMode
+  #endif
+  #ifdef FEEDBACK_TIMESTAMP
+                      ^ command_in->syncId
+  #endif
+  );
+  if (command_in->start == SERIAL_START_FRAME && command_in->checksum == checksum) {
+  #endif
+    #ifdef FEEDBACK_TIMESTAMP
+    syncRxTime = buzzerTimer;         // idle line interrupt: one character time after the end of the frame
+    syncId     = command_in->syncId;
+    syncValid  = 1;
+    #endif
+    #ifdef MULTI_MODE_SERIAL
+    if (command_in->driveMode != command_out->driveMode && command_in->driveMode < MULTI_MODE_DRIVE_NR) {
+      drive_mode = command_in->driveMode; // Only react on changes, so the other sources can still switch the mode
+    }
+    #endif
+    *command_out = *command_in;
+    if (usart_idx == 2) {             // Sideboard USART2
+      #ifdef CONTROL_SERIAL_USART2
+      timeoutFlgSerial_L = 0;         // Clear timeout flag
+      timeoutCntSerial_L = 0;         // Reset timeout counter
+      inputCheckIn(CONTROL_SERIAL_USART2);
+      #endif
+    } else if (usart_idx == 3) {      // Sideboard USART3
+      #ifdef CONTROL_SERIAL_USART3
+      timeoutFlgSerial_R = 0;         // Clear timeout flag
+      timeoutCntSerial_R = 0;         // Reset timeout counter
+      inputCheckIn(CONTROL_SERIAL_USART3);
+      #endif
+    }
+    #ifdef SERIAL_BUS
+    if (rx == BUS_RX_OWN) {
+      busReplySend();
     }
+    #endif
   }
   #endif
 }
+#endif
+
+ /*
+ * Board time for the feedback, with the clock sync echo: the syncId of the last host command and the time from
+ * its reception to now. Times are buzzerTimer ticks (1/16 ms). The host takes (send time, board receive time,
+ * board time, host receive time) as one NTP sample. age is 0xFFFF without a command in the last 4 s.
+ */
+#ifdef FEEDBACK_TIMESTAMP
+void feedbackTimestamp(uint32_t *time, uint16_t *id, uint16_t *age)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint32_t rxTime;
+  uint8_t  valid;
+  __disable_irq();                      // consistent with a command arriving right now
+  *time  = buzzerTimer;
+  *id    = syncId;
+  rxTime = syncRxTime;
+  valid  = syncValid;
+  __set_PRIMASK(primask);
+  *age   = (valid && *time - rxTime < 0xFFFF) ? (uint16_t)(*time - rxTime) : 0xFFFF;
+}
 #endif
 
 /*
@@ -1309,11 +1689,13 @@ void usart_process_sideboard(SerialSideboard *Sideboard_in, SerialSideboard *Sid
         #ifdef SIDEBOARD_SERIAL_USART2
         timeoutCntSerial_L  = 0;        // Reset timeout counter
         timeoutFlgSerial_L = 0;         // Clear timeout flag
+        inputCheckIn(SIDEBOARD_SERIAL_USART2);
         #endif
       } else if (usart_idx == 3) {      // Sideboard USART3
         #ifdef SIDEBOARD_SERIAL_USART3
         timeoutCntSerial_R = 0;         // Reset timeout counter
         timeoutFlgSerial_R = 0;         // Clear timeout flag
+        inputCheckIn(SIDEBOARD_SERIAL_USART3);
         #endif
       }
     }
@@ -1321,6 +1703,26 @@ void usart_process_sideboard(SerialSideboard *Sideboard_in, SerialSideboard *Sid
 }
 #endif
 
+/*
+ * Process board link Rx data
+ * - if the linkRx_raw data is valid (correct START_FRAME and checksum) store it as the last master command or slave feedback
+ */
+#if defined(MULTI_BOARD_MASTER) || defined(MULTI_BOARD_SLAVE)
+void usart_process_link(void)
+{
+  if (linkRxValid(&boardLink, &linkRx_raw, sizeof(linkRx_raw))) {
+    #ifdef MULTI_BOARD_MASTER
+      linkFeedback = linkRx_raw;
+    #else
+      linkCommand  = linkRx_raw;
+      linkRxTime   = buzzerTimer;
+      linkRxNew    = 1;
+      watchdogCheckIn(WDG_TASK_INPUT);  // The master commands are the input of the slave
+    #endif
+  }
+}
+#endif
+
 
 /* =========================== Sideboard Functions =========================== */
 
@@ -1335,14 +1737,14 @@ void sideboardLeds(uint8_t *leds) {
     // enable == 0, blink led
     if (enable) {
       *leds |= LED4_SET;
-    } else if (!enable && (main_loop_counter % 20 == 0)) {
+    } else if (!enable && (main_loop_counter % (100 / DELAY_IN_MAIN_LOOP) == 0)) {
       *leds ^= LED4_SET;
     }
 
     // Backward Drive: use LED5 (upper Blue)
     // backwardDrive == 1, blink led
     // backwardDrive == 0, turn off led
-    if (backwardDrive && (main_loop_counter % 50 == 0)) {
+    if (backwardDrive && (main_loop_counter % (250 / DELAY_IN_MAIN_LOOP) == 0)) {
       *leds ^= LED5_SET;
     }
 
@@ -1475,6 +1877,10 @@ void sideboardSensors(uint8_t sensors) {
         if (sensor2_trig) {
           cruiseControl(sensor2_trig);
         }
+      #elif defined(MULTI_MODE_DRIVE)                               // Cycle through the drive modes
+        if (sensor2_trig && inIdx == inIdx_prev && (inIdx != sideboardIdx || sensor2_index)) {   // SWD: only when switched on
+          drive_mode = (drive_mode + 1) % MULTI_MODE_DRIVE_NR;      // The new limits are applied by driveModeUpdate()
+        }
       #else
         if (sensor2_trig) {
           switch (sensor2_index) {
@@ -1498,6 +1904,42 @@ void sideboardSensors(uint8_t sensors) {
 
 
 
+/* =========================== EEPROM Parameter Functions =========================== */
+
+ /*
+ * Load the registered parameters from the EEPROM. Parameters not in the EEPROM keep their value, an out of range bus
+ * node id falls back to SERIAL_BUS_NODE. The loaded values are remembered, so eeParamsSave() writes only what changed since.
+ */
+void eeParamsLoad(void) {
+  #if !defined(VARIANT_HOVERBOARD) && !defined(VARIANT_TRANSPOTTER)
+    eeStoreLoad(&eeStore);
+  #endif
+  #ifdef SERIAL_BUS
+    if (busNode < 1 || busNode > SERIAL_BUS_NODES) {   // 0 is the broadcast address, never answered
+      busNode = SERIAL_BUS_NODE;
+    }
+  #endif
+}
+
+ /*
+ * Save the registered parameters to the EEPROM: only the ones changed since the last load / save are written.
+ * Returns the number of successful EEPROM writes.
+ */
+uint8_t eeParamsSave(void) {
+  uint8_t writes = 0;
+  #if !defined(VARIANT_HOVERBOARD) && !defined(VARIANT_TRANSPOTTER)
+    HAL_FLASH_Unlock();
+    writes = eeStoreSave(&eeStore);
+    HAL_FLASH_Lock();
+    #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
+      dbgPrintf("%u EEprom writes, %u failed\r\n", writes, eeStore.failed);
+    #endif
+  #endif
+  return writes;
+}
+
+
+
 /* =========================== Poweroff Functions =========================== */
 
  /*
@@ -1515,24 +1957,9 @@ void saveConfig() {
   #if !defined(VARIANT_HOVERBOARD) && !defined(VARIANT_TRANSPOTTER)
     if (inp_cal_valid || cur_spd_valid) {
       #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-        printf("Saving configuration to EEprom\r\n");
+        dbgPrintf("Saving configuration to EEprom\r\n");
       #endif
-
-      HAL_FLASH_Unlock();
-      EE_WriteVariable(VirtAddVarTab[0] , (uint16_t)FLASH_WRITE_KEY);
-      EE_WriteVariable(VirtAddVarTab[1] , (uint16_t)rtP_Left.i_max);
-      EE_WriteVariable(VirtAddVarTab[2] , (uint16_t)rtP_Left.n_max);
-      for (uint8_t i=0; i<INPUTS_NR; i++) {
-        EE_WriteVariable(VirtAddVarTab[ 3+8*i] , (uint16_t)input1[i].typ);
-        EE_WriteVariable(VirtAddVarTab[ 4+8*i] , (uint16_t)input1[i].min);
-        EE_WriteVariable(VirtAddVarTab[ 5+8*i] , (uint16_t)input1[i].mid);
-        EE_WriteVariable(VirtAddVarTab[ 6+8*i] , (uint16_t)input1[i].max);
-        EE_WriteVariable(VirtAddVarTab[ 7+8*i] , (uint16_t)input2[i].typ);
-        EE_WriteVariable(VirtAddVarTab[ 8+8*i] , (uint16_t)input2[i].min);
-        EE_WriteVariable(VirtAddVarTab[ 9+8*i] , (uint16_t)input2[i].mid);
-        EE_WriteVariable(VirtAddVarTab[10+8*i] , (uint16_t)input2[i].max);
-      }
-      HAL_FLASH_Lock();
+      eeParamsSave();
     }
   #endif 
 }
@@ -1540,79 +1967,109 @@ void saveConfig() {
 
 void poweroff(void) {
   enable = 0;
+  if (poweroffAcv) {
+    return;
+  }
+  poweroffAcv = 1;
   #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-  printf("-- Motors disabled --\r\n");
+  dbgPrintf("-- Motors disabled --\r\n");
   #endif
-  buzzerCount = 0;  // prevent interraction with beep counter
-  buzzerPattern = 0;
   for (int i = 0; i < 8; i++) {
-    buzzerFreq = (uint8_t)i;
-    HAL_Delay(100);
+    beepTone((uint8_t)i, 100);
+  }
+}
+
+ /*
+ * Finish the poweroff sequence started by poweroff(): once the melody is played, save the config and release the power latch
+ */
+void poweroffUpdate(void) {
+  if (poweroffAcv && beepQueueIdle(&beeps)) {
+    saveConfig();
+    HAL_GPIO_WritePin(OFF_PORT, OFF_PIN, GPIO_PIN_RESET);
+    while(1) {}
   }
-  saveConfig();
-  HAL_GPIO_WritePin(OFF_PORT, OFF_PIN, GPIO_PIN_RESET);
-  while(1) {}
 }
 
 
+ /*
+ * Power button state machine, called every main loop cycle. The control loop keeps running while the button is held.
+ * buttonStep() (ui.c) decodes the presses, the transpotter and the hoverboard have their own.
+ */
 void poweroffPressCheck(void) {
+  uint8_t pressed = HAL_GPIO_ReadPin(BUTTON_PORT, BUTTON_PIN);
   #if !defined(VARIANT_HOVERBOARD) && !defined(VARIANT_TRANSPOTTER)
-    if(HAL_GPIO_ReadPin(BUTTON_PORT, BUTTON_PIN)) {
-      uint16_t cnt_press = 0;
-      while(HAL_GPIO_ReadPin(BUTTON_PORT, BUTTON_PIN)) {
-        HAL_Delay(10);
-        if (cnt_press++ == 5 * 100) { beepShort(5); }
-      }
-
-      if (cnt_press > 8) enable = 0;
-
-      if (cnt_press >= 5 * 100) {                         // Check if press is more than 5 sec
-        HAL_Delay(1000);
-        if (HAL_GPIO_ReadPin(BUTTON_PORT, BUTTON_PIN)) {  // Double press: Adjust Max Current, Max Speed
-          while(HAL_GPIO_ReadPin(BUTTON_PORT, BUTTON_PIN)) { HAL_Delay(10); }
-          beepLong(8);
-          updateCurSpdLim();
-          beepShort(5);
-        } else {                                          // Long press: Calibrate ADC Limits
-          #ifdef AUTO_CALIBRATION_ENA
-          beepLong(16); 
-          adcCalibLim();
-          beepShort(5);
-          #endif
-        }
-      } else if (cnt_press > 8) {                         // Short press: power off (80 ms debounce)
+    switch (buttonStep(&button, pressed, calibMode != CALIB_OFF, buzzerTimer)) {
+      case BUTTON_EVT_CONFIRM:                            // Confirm the running calibration
+        calibReq = CALIB_OFF;
+        break;
+      case BUTTON_EVT_HELD:                               // Long press reached
+        beepShort(5);
+        break;
+      case BUTTON_EVT_RELEASED:                           // Long press (more than 5 sec): wait 1 sec for a second press
+        enable = 0;
+        break;
+      case BUTTON_EVT_SHORT:                              // Short press: power off
+        enable = 0;
         #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
-          printf("Powering off, button has been pressed\r\n");
+          dbgPrintf("Powering off, button has been pressed\r\n");
         #endif
-      poweroff();
-      }
+        poweroff();
+        break;
+      case BUTTON_EVT_LONG:                               // Long press: Calibrate ADC Limits
+        adcCalibLim();
+        break;
+      case BUTTON_EVT_DOUBLE:                             // Double press: Adjust Max Current, Max Speed
+        updateCurSpdLim();
+        break;
     }
   #elif defined(VARIANT_TRANSPOTTER)
-    if(HAL_GPIO_ReadPin(BUTTON_PORT, BUTTON_PIN)) {
-      enable = 0;
-      while(HAL_GPIO_ReadPin(BUTTON_PORT, BUTTON_PIN)) { HAL_Delay(10); }
-      beepShort(5);
-      HAL_Delay(300);
-      if (HAL_GPIO_ReadPin(BUTTON_PORT, BUTTON_PIN)) {
-        while(HAL_GPIO_ReadPin(BUTTON_PORT, BUTTON_PIN)) { HAL_Delay(10); }
-        beepLong(5);
-        HAL_Delay(350);
-        poweroff();
-      } else {
-        setDistance += 0.25;
-        if (setDistance > 2.6) {
-          setDistance = 0.5;
+    uint32_t elapsed = (buzzerTimer - button.time) / UI_TICKS_MS;   // [ms] since the last state change
+    switch (button.state) {
+      case BUTTON_IDLE:
+        if (pressed) {
+          enable       = 0;
+          button.state = BUTTON_PRESSED;
         }
-        beepShort(setDistance / 0.25);
-        saveValue = setDistance * 1000;
-        saveValue_valid = 1;
-      }
-    }
-  #else
-    if (HAL_GPIO_ReadPin(BUTTON_PORT, BUTTON_PIN)) {
-      enable = 0;                                             // disable motors
-      while (HAL_GPIO_ReadPin(BUTTON_PORT, BUTTON_PIN)) {}    // wait until button is released
-      poweroff();                                             // release power-latch
+        break;
+      case BUTTON_PRESSED:
+        if (!pressed) {
+          beepShort(5);
+          button.state = BUTTON_WAIT;
+          button.time  = buzzerTimer;
+        }
+        break;
+      case BUTTON_WAIT:
+        if (elapsed >= 100 + 300) {                       // after the beep: a second press powers off
+          if (pressed) {
+            button.state = BUTTON_PRESSED2;
+          } else {
+            button.state = BUTTON_IDLE;
+            setDistance += 250;
+            if (setDistance > 2600) {
+              setDistance = 500;
+            }
+            beepShort(setDistance / 250);
+            saveValue = setDistance;
+            saveValue_valid = 1;
+          }
+        }
+        break;
+      case BUTTON_PRESSED2:
+        if (!pressed) {
+          button.state = BUTTON_IDLE;
+          beepLong(5);
+          beepTone(0, 350);
+          poweroff();
+        }
+        break;
+    }
+  #else
+    if (button.state == BUTTON_IDLE && pressed) {
+      enable       = 0;                                   // disable motors
+      button.state = BUTTON_PRESSED;
+    } else if (button.state == BUTTON_PRESSED && !pressed) {   // button released
+      button.state = BUTTON_IDLE;
+      poweroff();                                         // release power-latch
     }
   #endif
 }
@@ -1766,3 +2223,668 @@ void multipleTapDet(int16_t u, uint32_t timeNow, MultipleTap *x) {
 }
 
 
+
+/* =========================== Stall Detection Function =========================== */
+
+  /* stallDetect(int16_t iq, int16_t n_mot, int16_t i_max, StallDetect *x)
+  * This function detects a stalled / locked rotor: high current with near-zero speed for STALL_TIME.
+  * While stalled, the returned limit is folded back to STALL_I_FOLDBACK of i_max. When the wheel turns again or the
+  * current request drops for STALL_RECOVERY_TIME, it is ramped back to i_max and the stall is released.
+  * Only valid in FOC_CTRL, iq is not estimated in the other control types.
+  * Inputs:       iq = fixdt(1,16,4); n_mot = int16_t [rpm]; i_max = nominal current limit fixdt(1,16,4)
+  * Outputs:      x->b_stall; return = current limit fixdt(1,16,4)
+  */
+#ifdef STALL_DETECT_ENABLE
+  #define STALL_FOLD_MIN    ((STALL_I_FOLDBACK << 15) / 100)
+  #define STALL_FOLD_STEP   (((32768 - STALL_FOLD_MIN) * DELAY_IN_MAIN_LOOP) / STALL_FOLDBACK_TIME)
+#endif
+int16_t stallDetect(int16_t iq, int16_t n_mot, int16_t i_max, StallDetect *x) {
+  #ifdef STALL_DETECT_ENABLE
+    uint8_t b_cond;
+
+    if (!x->b_stall) {
+      b_cond = (ABS(iq) > (i_max * STALL_I_THRES) / 100) && (ABS(n_mot) < STALL_N_THRES);
+      x->cnt = b_cond ? x->cnt + 1 : 0;
+      if (x->cnt >= STALL_TIME / DELAY_IN_MAIN_LOOP) {            // Stall qualified
+        x->b_stall  = 1;
+        x->cnt      = 0;
+        x->fold     = 32768;
+        #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
+          dbgPrintf("Stall detected, current limit reduced\r\n");
+        #endif
+      }
+      return i_max;
+    }
+
+    // Obstruction cleared (wheel turns) OR not pushing anymore (current well below the foldback limit)
+    b_cond = (ABS(n_mot) > 2 * STALL_N_THRES) || (ABS(iq) < (i_max * STALL_I_FOLDBACK) / 200);
+    x->cnt = b_cond ? MIN(x->cnt + 1, STALL_RECOVERY_TIME / DELAY_IN_MAIN_LOOP) : 0;
+
+    if (x->cnt >= STALL_RECOVERY_TIME / DELAY_IN_MAIN_LOOP) {     // Recovery: ramp the current limit back
+      x->fold = MIN(x->fold + STALL_FOLD_STEP, 32768);
+      if (x->fold == 32768) {
+        x->b_stall = 0;
+        x->cnt     = 0;
+      }
+    } else {                                                      // Still stalled: fold back the current limit
+      x->fold = MAX((int32_t)x->fold - STALL_FOLD_STEP, STALL_FOLD_MIN);
+    }
+    return (int16_t)((i_max * x->fold) >> 15);
+  #else
+    return i_max;
+  #endif
+}
+
+ /*
+ * Runtime current limit rtP i_max of both motors: the I_MOT_MAX parameter, capped by the drive mode and folded back
+ * while stalled. Only written here, so SAVE, EXPORT and the poweroff save keep the configured I_MOT_MAX.
+ */
+void curLimUpdate(void) {
+  int16_t i_max = iMotMax;
+  #ifdef MULTI_MODE_DRIVE
+    i_max = MIN(i_max, driveModeIMax);
+  #endif
+  #ifdef STALL_DETECT_ENABLE
+    rtP_Left.i_max  = stallDetect(rtY_Left.iq,  rtY_Left.n_mot,  i_max, &stallLeft);
+    rtP_Right.i_max = stallDetect(rtY_Right.iq, rtY_Right.n_mot, i_max, &stallRight);
+  #else
+    rtP_Left.i_max  = rtP_Right.i_max = i_max;
+  #endif
+}
+
+
+
+/* =========================== Motor Diagnostics Functions =========================== */
+
+#ifdef MOTOR_DIAG_ENABLE
+ /*
+ * Evaluate the self test pulses of one motor. cur[k] holds the currents measured while phase k was pulsed,
+ * idx is the index of the motor's first phase current in cur[k] and pha1 the phase measured by it (0 = U).
+ * Pulsing phase k drives +I into phase k and -I/2 out of the other two phases.
+ */
+static void selfTestEval(int16_t cur[3][6], uint8_t idx, uint8_t pha1, MotorDiag *x) {
+  int16_t i1, i2, iPha[3];
+  int16_t max1 = 0, max2 = 0;
+
+  for (uint8_t k = 0; k < 3; k++) {
+    i1 = cur[k][idx];
+    i2 = cur[k][idx + 1];
+    iPha[pha1]            = i1;
+    iPha[(pha1 + 1) % 3]  = i2;
+    iPha[(pha1 + 2) % 3]  = -(i1 + i2);
+    if (ABS(cur[k][idx + 2]) > DIAG_TEST_I_SHORT || ABS(iPha[k]) > DIAG_TEST_I_SHORT) {
+      x->z_errCode |= DIAG_ERR_BRIDGE;                // shoot-through or a phase shorted to a rail
+    }
+    if (MAX(ABS(i1), ABS(i2)) < DIAG_TEST_I_MIN / 2) {
+      x->z_errCode |= (DIAG_ERR_PHA_U << k);          // no current anywhere: the pulsed phase is open
+    }
+    max1 = MAX(max1, ABS(i1));
+    max2 = MAX(max2, ABS(i2));
+  }
+
+  // One sensor stays silent while the other one sees the pulses. Only conclusive with all phases connected
+  if (!(x->z_errCode & (DIAG_ERR_PHA_U | DIAG_ERR_PHA_V | DIAG_ERR_PHA_W)) &&
+      ((max1 < DIAG_TEST_I_MIN / 4) != (max2 < DIAG_TEST_I_MIN / 4))) {
+    x->z_errCode |= DIAG_ERR_SENSOR;
+  }
+}
+#endif
+
+ /*
+ * Power-on self test: pulse each phase of both motors briefly against the other two and check the shunt current response.
+ * Finds open phases, shorted MOSFETs and dead current sensors. Must be called with the motors disabled.
+ */
+void motorSelfTest(void) {
+  #ifdef MOTOR_DIAG_ENABLE
+    int16_t  cur[3][6];
+    uint32_t tick;
+
+    for (uint8_t k = 0; k < 3; k++) {
+      selfTestPha = k + 1;
+      selfTestCnt = DIAG_TEST_PULSE;
+      tick = HAL_GetTick();
+      while (selfTestCnt && HAL_GetTick() - tick < 500) { }  // the ISR runs the pulse after the ADC offset calibration
+      if (selfTestCnt) {                                    // Timeout: stop the pulse before releasing the phase, skip the evaluation
+        __disable_irq();
+        selfTestCnt = 0;
+        __enable_irq();
+        selfTestPha = 0;
+        #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
+          dbgPrintf("Self test: timeout\r\n");
+        #endif
+        return;
+      }
+      for (uint8_t i = 0; i < 6; i++) {
+        cur[k][i] = selfTestCur[i];
+      }
+      HAL_Delay(10);                                        // let the phase current decay
+    }
+    selfTestPha = 0;
+
+    selfTestEval(cur, 0, 0, &diagLeft);                     // Left measures phases U, V
+    selfTestEval(cur, 3, 1, &diagRight);                    // Right measures phases V, W
+
+    #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
+      dbgPrintf("Self test: Left 0x%02X, Right 0x%02X\r\n", diagLeft.z_errCode, diagRight.z_errCode);
+    #endif
+  #endif
+}
+
+ /*
+ * Runtime diagnostics, called from the DMA ISR while the motor is driven.
+ * Shunt saturation: a phase current ADC stuck at the rail for DIAG_SAT_TIME samples.
+ * Phase imbalance: the average absolute phase currents are compared over windows of 4096 samples (~256 ms).
+ * A phase staying below DIAG_IMB_RATIO of the mean for 3 windows in a row is reported as lost.
+ * Inputs:       adc1, adc2 = raw phase current ADC; cur1, cur2 = phase currents; pha1 = phase measured by cur1 (0 = U)
+ * Outputs:      x->z_errCode
+ */
+void motorDiag(uint16_t adc1, uint16_t adc2, int16_t cur1, int16_t cur2, uint8_t pha1, int16_t n_mot, MotorDiag *x) {
+  #ifdef MOTOR_DIAG_ENABLE
+    int32_t mean;
+    uint8_t kMin;
+
+    if (adc1 < DIAG_SAT_MARGIN || adc1 > 4095 - DIAG_SAT_MARGIN || adc2 < DIAG_SAT_MARGIN || adc2 > 4095 - DIAG_SAT_MARGIN) {
+      if (++x->satCnt >= DIAG_SAT_TIME) {
+        x->z_errCode |= DIAG_ERR_SHUNT_SAT;
+      }
+    } else {
+      x->satCnt = 0;
+    }
+
+    if (ABS(n_mot) < DIAG_IMB_N_MIN) {                      // phase currents are not alternating: restart the window
+      x->imbSmp    = 0;
+      x->imbSum[0] = x->imbSum[1] = x->imbSum[2] = 0;
+      return;
+    }
+    x->imbSum[pha1]           += ABS(cur1);
+    x->imbSum[(pha1 + 1) % 3] += ABS(cur2);
+    x->imbSum[(pha1 + 2) % 3] += ABS(cur1 + cur2);
+    if (++x->imbSmp < 4096) {
+      return;
+    }
+
+    mean = (x->imbSum[0] + x->imbSum[1] + x->imbSum[2]) / 3;
+    kMin = (x->imbSum[0] < x->imbSum[1]) ? 0 : 1;
+    kMin = (x->imbSum[2] < x->imbSum[kMin]) ? 2 : kMin;
+    if (mean > ((int32_t)DIAG_IMB_I_MIN << 12) && x->imbSum[kMin] < (mean * DIAG_IMB_RATIO) / 100) {
+      if (++x->imbCnt >= 3) {
+        x->z_errCode |= DIAG_ERR_IMBALANCE | (DIAG_ERR_PHA_U << kMin);
+      }
+    } else {
+      x->imbCnt = 0;
+    }
+    x->imbSmp    = 0;
+    x->imbSum[0] = x->imbSum[1] = x->imbSum[2] = 0;
+  #endif
+}
+
+
+
+/* =========================== Drive Mode Functions =========================== */
+
+#ifdef MULTI_MODE_DRIVE
+ /*
+ * Apply the limits of the active drive mode immediately. Used at start-up
+ */
+void driveModeInit(void) {
+  drive_mode      = MIN(drive_mode, MULTI_MODE_DRIVE_NR - 1);
+  drive_mode_prev = drive_mode;
+  driveModeBlend  = 32768;
+  max_speed       = driveModes[drive_mode].max_speed;
+  rate            = driveModes[drive_mode].rate;
+  driveModeIMax   = driveModes[drive_mode].i_max;
+  rtP_Left.n_max  = rtP_Right.n_max = driveModes[drive_mode].n_max;
+}
+
+ /*
+ * Follow a runtime drive mode change: the limits are blended linearly from the values at the moment
+ * of the switch to the new profile within MULTI_MODE_SWITCH_TIME. Outside of a transition the limits
+ * are not touched, so they can still be adjusted via the Debug Serial Protocol or the limit update.
+ */
+void driveModeUpdate(void) {
+  const DriveMode *target;
+
+  if (drive_mode >= MULTI_MODE_DRIVE_NR) {
+    drive_mode = drive_mode_prev;                 // Reject invalid requests
+  }
+
+  if (drive_mode != drive_mode_prev) {            // New drive mode requested
+    driveModeFrom.max_speed = max_speed;
+    driveModeFrom.rate      = rate;
+    driveModeFrom.i_max     = driveModeIMax;      // rtP i_max is capped by I_MOT_MAX and folded back while stalled
+    driveModeFrom.n_max     = rtP_Left.n_max;
+    driveModeBlend          = 0;
+    drive_mode_prev         = drive_mode;
+    #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
+      dbgPrintf("Drive mode %i selected\r\n", drive_mode);
+    #endif
+  }
+
+  if (driveModeBlend < 32768) {
+    driveModeBlend  = MIN(driveModeBlend + DRIVE_MODE_BLEND_STEP, 32768);
+    target          = &driveModes[drive_mode];
+    max_speed       = driveModeFrom.max_speed + (((target->max_speed - driveModeFrom.max_speed) * driveModeBlend) >> 15);
+    rate            = driveModeFrom.rate      + (((target->rate      - driveModeFrom.rate)      * driveModeBlend) >> 15);
+    driveModeIMax   = driveModeFrom.i_max + (((target->i_max - driveModeFrom.i_max) * driveModeBlend) >> 15);
+    rtP_Left.n_max  = rtP_Right.n_max = driveModeFrom.n_max + (((target->n_max - driveModeFrom.n_max) * driveModeBlend) >> 15);
+  }
+}
+#endif
+
+
+
+/* =========================== Control Type Scheduler Functions =========================== */
+
+#ifdef CTRL_SCHED_ENABLE
+ /*
+ * Pick the control type for the operating point (speed band, DC link load), see ctrlsched.c. The type and the
+ * input target gain that keeps the phase voltage over the switch are used by the motor interrupt together.
+ * The type is written every loop: changes from the sideboard or the debug protocol are overridden.
+ */
+void ctrlSchedUpdate(void) {
+  int16_t iDcAbs = MAX(ABS(curL_DC), ABS(curR_DC));
+  uint8_t changed;
+
+  __disable_irq();
+  changed = ctrlSchedStep(&ctrlSched, speedAvgAbs, iDcAbs, ctrlModReq == VLT_MODE);
+  rtP_Left.z_ctrlTypSel = rtP_Right.z_ctrlTypSel = ctrlSched.ctrlTyp;
+  __enable_irq();
+
+  #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
+    if (changed) {
+      dbgPrintf("Ctrl type %i at %i rpm\r\n", ctrlSched.ctrlTyp, speedAvgAbs);
+    }
+  #else
+    (void)changed;
+  #endif
+}
+
+ /*
+ * Debug protocol callbacks of SCHED_N_MID / SCHED_N_HI: the other band edge gives way, n_mid + n_hyst < n_hi
+ */
+void ctrlSchedNMidSet(void) {
+  ctrlSchedBands(&ctrlSched, 0);
+}
+
+void ctrlSchedNHiSet(void) {
+  ctrlSchedBands(&ctrlSched, 1);
+}
+#endif
+
+
+
+/* =========================== Stack Monitor Functions =========================== */
+
+#ifdef STACK_MONITOR_ENABLE
+extern uint32_t _end;                   // end of .bss = start of the heap (linker script)
+extern uint32_t _estack;                // top of the stack (linker script)
+extern uint32_t _Min_Heap_Size;         // heap size reserved by the linker script
+#define STACK_PAINT         0xA5A5A5A5  // fill pattern of the unused stack
+#define STACK_BOTTOM        ((uint32_t *)((uint32_t)&_end + (uint32_t)&_Min_Heap_Size))
+uint16_t stackUsed;                     // stack high-water mark [bytes]. Main loop and interrupts share the same (MSP) stack
+uint16_t stackFree;                     // stack never used so far [bytes]
+#endif
+
+ /*
+ * Fill the RAM between the reserved heap and the current stack pointer with a known pattern.
+ * Must be called at the very beginning of main(), while the stack is still shallow.
+ */
+void stackPaint(void) {
+  #ifdef STACK_MONITOR_ENABLE
+    uint32_t *p   = STACK_BOTTOM;
+    uint32_t *top = (uint32_t *)(__get_MSP() - 32);   // leave the active frames untouched
+    while (p < top) {
+      *p++ = STACK_PAINT;
+    }
+  #endif
+}
+
+ /*
+ * Find the lowest stack word that was overwritten since stackPaint(): stack high-water mark.
+ * Reports once on the debug serial if the remaining margin drops below STACK_MARGIN_MIN.
+ */
+void stackCheck(void) {
+  #ifdef STACK_MONITOR_ENABLE
+    static uint8_t warned = 0;
+    uint32_t *p = STACK_BOTTOM;
+    while (p < &_estack && *p == STACK_PAINT) {
+      p++;
+    }
+    stackFree = (uint16_t)((uint32_t)p - (uint32_t)STACK_BOTTOM);
+    stackUsed = (uint16_t)((uint32_t)&_estack - (uint32_t)p);
+    if (stackFree < STACK_MARGIN_MIN && !warned) {
+      warned = 1;
+      #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
+        dbgPrintf("Stack margin low: %u bytes used, %u bytes free\r\n", stackUsed, stackFree);
+      #endif
+    }
+  #endif
+}
+
+
+/* =========================== Fault Capture Functions =========================== */
+
+extern FaultRecord faultRecord;         // written by faultCapture() before the reset (stm32f1xx_it.c)
+FaultRecord faultLast;                  // fault captured before the last reset, all zero if none
+
+ /*
+ * Report a fault record left in .noinit RAM by faultCapture() and clear it.
+ * Must be called once at boot, after the debug serial is initialized.
+ */
+void faultReport(void) {
+  if (faultRecord.magic != FAULT_MAGIC) {
+    return;
+  }
+  faultLast         = faultRecord;
+  faultRecord.magic = 0;
+  #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
+    dbgPrintf("Fault %u in ISR %u: PC 0x%08lX LR 0x%08lX PSR 0x%08lX\r\n",
+           faultLast.handler, faultLast.isr, faultLast.pc, faultLast.lr, faultLast.psr);
+    dbgPrintf("CFSR 0x%08lX HFSR 0x%08lX BFAR 0x%08lX MMFAR 0x%08lX\r\n",
+           faultLast.cfsr, faultLast.hfsr, faultLast.bfar, faultLast.mmfar);
+  #endif
+}
+
+
+/* =========================== Watchdog Functions =========================== */
+
+#define WDG_MISS_MAGIC      0x57444700  // marks a valid missed-task record, the low byte holds the missed tasks
+uint8_t resetReason;                    // reset flags of the last reset (RCC_CSR >> 26): 0x01 PIN, 0x02 POR, 0x04 SFT, 0x08 IWDG, 0x10 WWDG, 0x20 LPWR
+uint8_t wdgMissLast;                    // tasks that missed their deadline before the last IWDG reset: bit n = WDG_TASK n
+static uint32_t wdgMissRecord NOINIT;   // kept over the IWDG reset
+#ifdef WATCHDOG_ENABLE
+uint8_t wdgMiss;                        // tasks that missed their deadline: bit n = WDG_TASK n. Non-zero disables the motors
+static uint8_t wdgRun;
+static WdgSup  wdgSup;                  // check-in times in buzzerTimer ticks (16 kHz)
+
+// The input task checks in when input data arrives and while the input timeout holds the motors safe: its deadline
+// covers the longest input timeout
+#if defined(CONTROL_SERIAL_USART2) || defined(CONTROL_SERIAL_USART3) || defined(SIDEBOARD_SERIAL_USART2) || defined(SIDEBOARD_SERIAL_USART3)
+  #define WDG_INPUT_TIMEOUT_CNT SERIAL_TIMEOUT
+#else
+  #define WDG_INPUT_TIMEOUT_CNT TIMEOUT
+#endif
+#ifdef MULTI_BOARD_LINK
+  #define WDG_INPUT_TIMEOUT (MAX(WDG_INPUT_TIMEOUT_CNT, MULTI_BOARD_TIMEOUT) * DELAY_IN_MAIN_LOOP)
+#else
+  #define WDG_INPUT_TIMEOUT (WDG_INPUT_TIMEOUT_CNT * DELAY_IN_MAIN_LOOP)
+#endif
+#endif
+
+ /*
+ * Start the IWDG. Call right before the main loop: the boot sequence (melody, self test) is not supervised.
+ * Once started the IWDG cannot be stopped.
+ */
+void watchdogInit(void) {
+  #ifdef WATCHDOG_ENABLE
+    wdgSupInit(&wdgSup, buzzerTimer);
+    DBGMCU->CR |= DBGMCU_CR_DBG_IWDG_STOP;        // Hold the IWDG while the core is halted by the debugger
+    IWDG->KR    = 0xCCCC;                         // Start the IWDG, the LSI is enabled by hardware
+    IWDG->KR    = 0x5555;                         // Unlock PR and RLR
+    IWDG->PR    = IWDG_PR_PR_0 | IWDG_PR_PR_1;    // LSI / 32 = 1.25 kHz
+    IWDG->RLR   = WATCHDOG_TIMEOUT * 5 / 4;
+    while (IWDG->SR) {}                           // Wait until PR and RLR are updated
+    IWDG->KR    = 0xAAAA;
+    wdgRun      = 1;
+  #endif
+}
+
+ /*
+ * Report that a task completed one cycle
+ */
+void watchdogCheckIn(uint8_t task) {
+  #ifdef WATCHDOG_ENABLE
+    wdgSupCheckIn(&wdgSup, task, buzzerTimer);
+  #endif
+}
+
+ /*
+ * Input data of input 'idx' arrived: check in the input task if it is the active input
+ */
+void inputCheckIn(uint8_t idx) {
+  #ifdef WATCHDOG_ENABLE
+    if (idx == inIdx) {
+      wdgSupCheckIn(&wdgSup, WDG_TASK_INPUT, buzzerTimer);
+    }
+  #endif
+}
+
+ /*
+ * Check in all main loop tasks from inside a bounded blocking wait (calibration, power-on)
+ */
+void watchdogYield(void) {
+  #ifdef WATCHDOG_ENABLE
+    wdgSupCheckIn(&wdgSup, WDG_TASK_LOOP,  buzzerTimer);
+    wdgSupCheckIn(&wdgSup, WDG_TASK_INPUT, buzzerTimer);
+  #endif
+  beepUpdate();       // keep the queued beeps playing
+  dbgUpdate();        // and the debug output going
+}
+
+ /*
+ * Watchdog supervisor, called by the motor ISR after buzzerTimer is incremented.
+ * The motor ISR checks in by running the supervisor: if it stops, the IWDG is not refreshed.
+ * Once a task misses its deadline the motors are disabled and the IWDG is no longer refreshed.
+ */
+void watchdogSupervise(void) {
+  #ifdef WATCHDOG_ENABLE
+    if (!wdgRun || (buzzerTimer & 0xF)) {         // Evaluate once per ms
+      return;
+    }
+    uint32_t deadline[WDG_TASKS];
+    deadline[WDG_TASK_LOOP]  = (enable ? WDG_DEADLINE_RUN : WDG_DEADLINE_IDLE) * 16;
+    deadline[WDG_TASK_INPUT] = MAX(deadline[WDG_TASK_LOOP], (WDG_INPUT_TIMEOUT + WDG_DEADLINE_RUN) * 16);
+    uint8_t miss = wdgSupStep(&wdgSup, buzzerTimer, deadline);
+    if (miss && !wdgMiss) {
+      wdgMiss       = miss;
+      wdgMissRecord = WDG_MISS_MAGIC | miss;
+    }
+    if (!wdgMiss) {
+      IWDG->KR = 0xAAAA;                          // Refresh
+    }
+  #endif
+}
+
+ /*
+ * Read and clear the reset flags, report the reset reason and the tasks that caused a watchdog reset
+ */
+void resetReasonReport(void) {
+  resetReason = (uint8_t)(RCC->CSR >> 26);
+  RCC->CSR   |= RCC_CSR_RMVF;                     // Clear the reset flags for the next boot
+  if ((resetReason & 0x08) && (wdgMissRecord & 0xFFFFFF00) == WDG_MISS_MAGIC) {
+    wdgMissLast = (uint8_t)wdgMissRecord;
+  }
+  wdgMissRecord = 0;
+  dbgPrintf("Reset flags: 0x%02X, watchdog missed tasks: 0x%02X\r\n", resetReason, wdgMissLast);
+}
+
+
+/* =========================== Serial Bus Functions =========================== */
+
+ /*
+ * Addressed multi-drop bus (SERIAL_BUS): up to SERIAL_BUS_NODES boards share one half duplex RS-485 bus on USART3 and
+ * the host polls them one after the other, so only one transmitter is ever active. A command addressed to this node
+ * is answered right away from the Rx interrupt with the latest feedback frame: a poll takes the two frame times plus
+ * about a character. Broadcast commands are applied by all nodes and never answered. The Rx path only takes bursts
+ * of command length, so the replies of the other nodes and the echo of the own reply are dropped there.
+ */
+
+ /*
+ * Main loop: set the feedback frame for the next poll
+ */
+void busReplySet(const uint8_t *frame, uint16_t len) {
+  #ifdef SERIAL_BUS
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    memcpy(busReply, frame, len);
+    busReplyLen = len;
+    __set_PRIMASK(primask);
+  #endif
+}
+
+#ifdef SERIAL_BUS
+ /*
+ * Rx interrupt: reply to a poll. The frame is copied, so the main loop can set the next one during the transfer.
+ */
+static void busReplySend(void) {
+  if (!busReplyReady(busReplyLen, huart3.gState == HAL_UART_STATE_READY, &busStats)) {
+    return;
+  }
+  memcpy(busTx, busReply, busReplyLen);
+  #ifdef SERIAL_BUS_DE_PORT
+    HAL_GPIO_WritePin(SERIAL_BUS_DE_PORT, SERIAL_BUS_DE_PIN, GPIO_PIN_SET);
+  #endif
+  HAL_UART_Transmit_DMA(&huart3, busTx, busReplyLen);
+}
+#endif
+
+#ifdef SERIAL_BUS_DE_PORT
+ /*
+ * Transmission complete (USART TC, after the last stop bit): release the bus
+ */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+  if (huart->Instance == USART3) {
+    HAL_GPIO_WritePin(SERIAL_BUS_DE_PORT, SERIAL_BUS_DE_PIN, GPIO_PIN_RESET);
+  }
+}
+#endif
+
+
+
+/* =========================== Multi-Board Functions =========================== */
+
+ /*
+ * Send the board link frame, once per main loop cycle right after the mixer.
+ * Master: the commands of this cycle with the cycle counter. Slave: the feedback with the last master cycle counter.
+ */
+void multiBoardSend(void) {
+  #if defined(MULTI_BOARD_MASTER) || defined(MULTI_BOARD_SLAVE)
+    if (__HAL_DMA_GET_COUNTER(huart2.hdmatx) != 0) {   // Previous frame still in transmission
+      return;
+    }
+    #ifdef MULTI_BOARD_MASTER
+      linkTx.cmd1       = input1[inIdx].cmd;
+      linkTx.cmd2       = input2[inIdx].cmd;
+      #ifdef TORQUE_SPLIT_ENABLE
+        linkTx.wheelL   = splitSlaveCmd[0];
+        linkTx.wheelR   = splitSlaveCmd[1];
+      #endif
+      linkTx.tick       = ++linkTick;
+    #else
+      linkTx.leftSpeed  = (int16_t)rtY_Left.n_mot;
+      linkTx.rightSpeed = (int16_t)rtY_Right.n_mot;
+      linkTx.leftTicks  = (uint16_t)wheel_left_ticks;
+      linkTx.rightTicks = (uint16_t)wheel_right_ticks;
+      linkTx.batVoltage = (int16_t)batVoltageCalib;
+      linkTx.boardTemp  = (int16_t)board_temp_deg_c;
+      linkTx.tick       = linkCommand.tick;
+    #endif
+    linkSeal(&linkTx, sizeof(linkTx));
+    HAL_UART_Transmit_DMA(&huart2, (uint8_t *)&linkTx, sizeof(linkTx));
+  #endif
+}
+
+ /*
+ * Slave: align the main loop cycle to the master. On each new master command the cycle timer is moved
+ * so that the next cycle starts right away: both boards apply the command in the same 5 ms cycle,
+ * delayed only by the frame transfer time (~1 ms at 115200 baud).
+ */
+void multiBoardSync(uint32_t *timerPrev) {
+  #if defined(MULTI_BOARD_SLAVE)
+    if (linkRxNew) {
+      linkRxNew  = 0;
+      *timerPrev = linkRxTime - 16*DELAY_IN_MAIN_LOOP;
+    }
+  #endif
+}
+
+ /*
+ * 4WD torque distribution, after the mixer: torqueSplitStep() (multiboard.c) splits the demand of each side
+ * (2 x the mixer command) between the master (front) and the slave (rear) wheel of that side, away from a slipping wheel.
+ * Master: cmdL / cmdR become its own targets, the slave targets go out with the next multiBoardSend().
+ * Slave: cmdL / cmdR are replaced by the master targets while the link is alive.
+ */
+void torqueSplit(int16_t *cmdL, int16_t *cmdR) {
+  #if defined(TORQUE_SPLIT_ENABLE) && defined(MULTI_BOARD_MASTER)
+    int16_t cmd[2]  = {*cmdL, *cmdR};
+    int16_t nMst[2] = {(int16_t)rtY_Left.n_mot, (int16_t)rtY_Right.n_mot};
+    int16_t nSlv[2] = {linkFeedback.leftSpeed, linkFeedback.rightSpeed};
+    int16_t dir[2];                                     // motor direction of the demand, see SET OUTPUTS in main.c
+    #ifdef INVERT_L_DIRECTION
+      dir[0] = -*cmdL;
+    #else
+      dir[0] =  *cmdL;
+    #endif
+    #ifdef INVERT_R_DIRECTION
+      dir[1] =  *cmdR;
+    #else
+      dir[1] = -*cmdR;
+    #endif
+
+    if (boardLink.lost) {                               // Slave lost: it stops, keep the plain 2WD command
+      torqueSplitInit(&split, TORQUE_SPLIT_FRONT, TORQUE_SPLIT_MIN, TORQUE_SLIP_N);
+      splitSlaveCmd[0] = splitSlaveCmd[1] = 0;
+      return;
+    }
+    torqueSplitStep(&split, cmd, splitSlaveCmd, dir, nMst, nSlv, INPUT_MAX);
+    *cmdL = cmd[0];
+    *cmdR = cmd[1];
+  #elif defined(TORQUE_SPLIT_ENABLE) && defined(MULTI_BOARD_SLAVE)
+    if (!boardLink.lost) {
+      *cmdL = linkCommand.wheelL;
+      *cmdR = linkCommand.wheelR;
+    }
+  #endif
+}
+
+
+/* =========================== Bootloader Functions =========================== */
+
+ /*
+ * Confirm the running image of a boot slot build once it ran BOOT_CONFIRM_TIME without a watchdog miss.
+ * Until then the bootloader counts each boot as a trial and returns to the other slot after BOOT_ATTEMPTS of them.
+ * Programming the flash stalls the CPU for some 10 us, so the confirmation waits for standstill. Call once per second.
+ */
+void bootConfirm(void) {
+  #ifdef BOOT_SLOT
+    static uint8_t bootConfirmed;
+    const BootMeta *meta = (const BootMeta *)BOOT_META_ADDR(BOOT_SLOT);
+    if (bootConfirmed || main_loop_counter < BOOT_CONFIRM_TIME * 1000 / DELAY_IN_MAIN_LOOP || speedAvgAbs > 10) {
+      return;
+    }
+    #ifdef WATCHDOG_ENABLE
+      if (wdgMiss) {
+        return;
+      }
+    #endif
+    bootConfirmed = 1;
+    if (meta->magic != BOOT_META_MAGIC || meta->confirmed == 0x0000) {   // no meta record (flashed by ST-Link) or already confirmed
+      return;
+    }
+    HAL_FLASH_Unlock();
+    HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, (uint32_t)&meta->confirmed, 0x0000);
+    HAL_FLASH_Lock();
+    #if defined(DEBUG_SERIAL_USART2) || defined(DEBUG_SERIAL_USART3)
+      dbgPrintf("Boot slot %c confirmed\r\n", 'A' + BOOT_SLOT);
+    #endif
+  #endif
+}
+
+ /*
+ * Reset into the serial bootloader, which then waits for a firmware update instead of starting the application.
+ * Returns 0 without reset if the wheels are turning or the firmware was not built for a boot slot.
+ */
+uint8_t bootEnter(void) {
+  #ifdef BOOT_SLOT
+    if (speedAvgAbs > 10) {
+      return 0;
+    }
+    enable = 0;
+    __HAL_RCC_PWR_CLK_ENABLE();
+    __HAL_RCC_BKP_CLK_ENABLE();
+    HAL_PWR_EnableBkUpAccess();
+    BKP->DR1 = BOOT_REQ_MAGIC;                    // kept over the reset, read and cleared by the bootloader
+    NVIC_SystemReset();
+  #endif
+  return 0;
+}
@@ -0,0 +1,53 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Includes
+#include "watchdog.h"
+
+ /*
+ * Start the supervision: all tasks count as checked in at 'now'
+ */
+void wdgSupInit(WdgSup *w, uint32_t now) {
+  for (uint8_t i = 0; i < WDG_TASKS; i++) {
+    w->checkIn[i] = now;
+  }
+  w->miss = 0;
+}
+
+ /*
+ * Report that a task completed one cycle. Called from the main loop and the interrupts: a single 32 bit store
+ */
+void wdgSupCheckIn(WdgSup *w, uint8_t task, uint32_t now) {
+  w->checkIn[task] = now;
+}
+
+ /*
+ * Check the deadlines at 'now', same time unit as the check-ins. The time may wrap around.
+ * A task misses its deadline if its last check-in is more than deadline[task] old. The missed tasks are latched:
+ * a task that checks in again later does not clear them. Returns the missed tasks, the IWDG may be refreshed only
+ * while it is 0.
+ */
+uint8_t wdgSupStep(WdgSup *w, uint32_t now, const uint32_t deadline[WDG_TASKS]) {
+  for (uint8_t i = 0; i < WDG_TASKS; i++) {
+    if (now - w->checkIn[i] > deadline[i]) {
+      w->miss |= 1 << i;
+    }
+  }
+  return w->miss;
+}
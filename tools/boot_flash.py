@@ -0,0 +1,248 @@
+#!/usr/bin/env python3
+"""
+Firmware update tool for the serial bootloader (Bootloader/boot.c, protocol and flash layout in Inc/boot.h).
+
+The bootloader keeps two application slots. The new image always goes into the slot that does not hold the
+newest confirmed image, so a failed update rolls back to the running firmware.
+    boot_flash.py info /dev/ttyUSB0                                     print the slot states
+    boot_flash.py flash /dev/ttyUSB0 build_slotA/hover.bin build_slotB/hover.bin
+                                                                        upload the image built for the target slot
+    boot_flash.py flash /dev/ttyUSB0 new_A.bin new_B.bin --base old_A.bin old_B.bin
+                                                                        same, as delta to the image in the other slot
+Build both images with "make -e SLOT=A" and "make -e SLOT=B". The image is sent compressed (BOOT_CMD_WRITE_Z), with
+--base against the running firmware: the binary of the other slot is used if its CRC matches the slot, so an
+update of a similar build mostly sends copy commands. The bootloader listens for BOOT_WAIT after reset:
+power on the board while the tool is waiting, or use --enter to reset a running firmware with "$UPDATE"
+(DEBUG_SERIAL_PROTOCOL on the same port). Requires pyserial.
+"""
+
+import argparse
+import struct
+import sys
+import time
+import zlib
+
+BOOT_SOF        = 0xA5
+BOOT_REPLY      = 0x80
+BOOT_CHUNK_MAX  = 1024
+BOOT_SLOT_SIZE  = 0x1D000
+BOOT_PROTOCOL_VERSION = 2
+Z_LITERAL_MAX, Z_COPY_MIN, Z_COPY_MAX = 128, 3, 66
+Z_CANDIDATES    = 8             # match candidates tried per position and source
+
+CMD_SYNC, CMD_ERASE, CMD_WRITE, CMD_COMMIT, CMD_RUN, CMD_WRITE_Z = 1, 2, 3, 4, 5, 6
+ERRORS = {1: "frame error", 2: "invalid argument", 3: "invalid state", 4: "flash error", 5: "verify failed", 6: "unknown command"}
+
+
+def crc16(data, crc=0xFFFF):
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def frame(cmd, payload=b""):
+    body = struct.pack("<BH", cmd, len(payload)) + payload
+    return bytes([BOOT_SOF]) + body + struct.pack("<H", crc16(body))
+
+
+def compress(image, base=b""):
+    """BOOT_CMD_WRITE_Z stream (Inc/boot.h): greedy LZ77 over the image so far, copies from the delta base"""
+    out, literal = bytearray(), bytearray()
+    index, base_index = {}, {}
+    for pos in range(len(base) - Z_COPY_MIN + 1):
+        base_index.setdefault(base[pos:pos + Z_COPY_MIN], []).append(pos)
+    base_shift = 0                                  # base offset - image offset of the last copy from the base
+
+    def match(src, start, pos):
+        n = 0
+        while n < Z_COPY_MAX and pos + n < len(image) and start + n < len(src) and src[start + n] == image[pos + n]:
+            n += 1
+        return n
+
+    def flush():
+        for i in range(0, len(literal), Z_LITERAL_MAX):
+            part = literal[i:i + Z_LITERAL_MAX]
+            out.append(len(part) - 1)
+            out.extend(part)
+        literal.clear()
+
+    pos = 0
+    while pos < len(image):
+        key  = image[pos:pos + Z_COPY_MIN]
+        best = (0, None, 0)
+        for start in [pos + base_shift] + base_index.get(key, [])[-Z_CANDIDATES:]:
+            n = match(base, start, pos)
+            if n > best[0]:
+                best = (n, "base", start)
+        for start in reversed(index.get(key, [])[-Z_CANDIDATES:]):
+            n = match(image, start, pos)
+            if n > best[0] and pos - start <= 0xFFFF:
+                best = (n, "image", start)
+        n, src, start = best
+        if n < Z_COPY_MIN:
+            n = 1
+            literal.append(image[pos])
+        else:
+            flush()
+            if src == "base":
+                out.extend(struct.pack("<B", 0xC0 | (n - Z_COPY_MIN)) + struct.pack("<I", start)[:3])
+                base_shift = start - pos
+            else:
+                out.extend(struct.pack("<BH", 0x80 | (n - Z_COPY_MIN), pos - start))
+        for p in range(pos, pos + n):
+            index.setdefault(image[p:p + Z_COPY_MIN], []).append(p)
+        pos += n
+    flush()
+    return bytes(out)
+
+
+def decompress(stream, base=b""):
+    """Reference decoder of the BOOT_CMD_WRITE_Z stream, checks compress() before anything is sent"""
+    out, i = bytearray(), 0
+    while i < len(stream):
+        tok = stream[i]
+        if tok < 0x80:
+            out.extend(stream[i + 1:i + 2 + tok])
+            i += 2 + tok
+        elif tok < 0xC0:
+            dist = struct.unpack_from("<H", stream, i + 1)[0]
+            for _ in range((tok & 0x3F) + Z_COPY_MIN):
+                out.append(out[-dist])
+            i += 3
+        else:
+            start = struct.unpack("<I", stream[i + 1:i + 4] + b"\0")[0]
+            out.extend(base[start:start + (tok & 0x3F) + Z_COPY_MIN])
+            i += 4
+    return bytes(out)
+
+
+def request(port, cmd, payload=b"", timeout=2.0):
+    """Send a frame and return the reply data, raise on an error status"""
+    port.reset_input_buffer()
+    port.write(frame(cmd, payload))
+    end = time.time() + timeout
+    buf = b""
+    while time.time() < end:
+        buf += port.read(max(1, port.in_waiting))
+        start = buf.find(bytes([BOOT_SOF, cmd | BOOT_REPLY]))
+        if start < 0 or len(buf) < start + 4:
+            continue
+        length = struct.unpack_from("<H", buf, start + 2)[0]
+        if len(buf) < start + 4 + length + 2:
+            continue
+        body = buf[start + 1:start + 4 + length]
+        if crc16(body) != struct.unpack_from("<H", buf, start + 4 + length)[0]:
+            raise RuntimeError("reply CRC invalid")
+        status, data = body[3], body[4:]
+        if status:
+            raise RuntimeError("command %d: %s" % (cmd, ERRORS.get(status, "error %d" % status)))
+        return data
+    raise RuntimeError("command %d: no answer" % cmd)
+
+
+def sync(args):
+    import serial
+    if args.enter:
+        with serial.Serial(args.port, args.app_baud, timeout=0.5) as app:
+            app.write(b"$UPDATE\r\n")
+        time.sleep(0.1)
+    port = serial.Serial(args.port, args.baud, timeout=0.05)
+    print("waiting for the bootloader, power on the board...")
+    end = time.time() + args.wait
+    while time.time() < end:
+        try:
+            info = request(port, CMD_SYNC, timeout=0.1)
+            break
+        except RuntimeError:
+            pass
+    else:
+        raise RuntimeError("no bootloader found")
+    if info[0] != BOOT_PROTOCOL_VERSION:
+        raise RuntimeError("bootloader protocol version %d not supported" % info[0])
+    return port, info
+
+
+def print_info(info):
+    names = "AB"
+    active, target = info[1], info[2]
+    print("active slot: %s, update slot: %s" % (names[active] if active < 2 else "none", names[target]))
+    for i in range(2):
+        valid, confirmed, attempts, seq, size, crc = struct.unpack_from("<BBBIII", info, 3 + 15 * i)
+        if valid:
+            print("slot %s: image %d, %d bytes, CRC %08X, %s" % (names[i], seq, size, crc,
+                  "confirmed" if confirmed else "trial boots %d" % attempts))
+        else:
+            print("slot %s: empty" % names[i])
+
+
+def cmd_info(args):
+    port, info = sync(args)
+    print_info(info)
+    if not args.stay:
+        request(port, CMD_RUN)
+
+
+def cmd_flash(args):
+    port, info = sync(args)
+    print_info(info)
+    target = info[2]
+    with open((args.image_a, args.image_b)[target], "rb") as f:
+        image = f.read()
+    if not 8 <= len(image) <= BOOT_SLOT_SIZE:
+        raise RuntimeError("image size %d invalid" % len(image))
+    base = b""
+    if args.base:
+        valid, _, _, _, size, crc = struct.unpack_from("<BBBIII", info, 3 + 15 * (1 - target))
+        with open(args.base[1 - target], "rb") as f:
+            base = f.read()
+        if not valid or len(base) != size or zlib.crc32(base) != crc:
+            print("base image does not match slot %s, sending without delta" % "AB"[1 - target])
+            base = b""
+    if args.raw:
+        cmd, stream = CMD_WRITE, image + b"\xFF" * (len(image) & 1)
+    else:
+        cmd, stream = CMD_WRITE_Z, compress(image, base)
+        if decompress(stream, base) != image:
+            raise RuntimeError("compressor error")
+        print("sending %d of %d bytes%s" % (len(stream), len(image), " (delta)" if base else ""))
+    print("erasing slot %s" % "AB"[target])
+    request(port, CMD_ERASE, struct.pack("<BI", target, len(image)), timeout=5.0)
+    for offset in range(0, len(stream), BOOT_CHUNK_MAX):
+        request(port, cmd, struct.pack("<I", offset) + stream[offset:offset + BOOT_CHUNK_MAX], timeout=5.0)
+        print("\rwriting %3d%%" % (100 * min(offset + BOOT_CHUNK_MAX, len(stream)) // len(stream)), end="")
+    print()
+    request(port, CMD_COMMIT, struct.pack("<II", len(image), zlib.crc32(image)))
+    print("slot %s verified, the firmware confirms it after running healthy" % "AB"[target])
+    if not args.stay:
+        request(port, CMD_RUN)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub    = parser.add_subparsers(dest="cmd", required=True)
+    for name in ("info", "flash"):
+        p = sub.add_parser(name)
+        p.add_argument("port")
+        if name == "flash":
+            p.add_argument("image_a", help="binary built with make -e SLOT=A")
+            p.add_argument("image_b", help="binary built with make -e SLOT=B")
+            p.add_argument("--base", nargs=2, metavar=("BASE_A", "BASE_B"),
+                           help="binaries of the running firmware, for a delta update")
+            p.add_argument("--raw", action="store_true", help="send the image uncompressed (BOOT_CMD_WRITE)")
+        p.add_argument("--baud", type=int, default=460800, help="bootloader baud rate (BOOT_BAUD)")
+        p.add_argument("--app-baud", type=int, default=115200, help="firmware baud rate for --enter")
+        p.add_argument("--enter", action="store_true", help="reset a running firmware into the bootloader")
+        p.add_argument("--wait", type=float, default=30.0, help="[s] time to wait for the bootloader")
+        p.add_argument("--stay", action="store_true", help="stay in the bootloader when done")
+    args = parser.parse_args()
+    try:
+        {"info": cmd_info, "flash": cmd_flash}[args.cmd](args)
+    except (OSError, ValueError, RuntimeError) as e:
+        sys.exit("error: %s" % e)
+
+
+if __name__ == "__main__":
+    main()
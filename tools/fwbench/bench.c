@@ -0,0 +1,154 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Fixed scenario for the firmware on the stub HAL: the board starts with the inputs released, then the wheels turn at
+// 150 rpm (hall sensors) and the speed input ramps to 60 % within 0.5 s. ADC inputs are set in adc_buffer, a serial
+// control input gets a command frame every main loop. Other inputs (PPM, PWM, iBUS, Nunchuk, sideboards) see no data
+// and run their timeout path.
+
+#include <setjmp.h>
+#include <string.h>
+#include "stm32f1xx_hal.h"
+#include "defines.h"
+#include "setup.h"
+#include "config.h"
+#include "util.h"
+#include "stubhal.h"
+#include "fwbench.h"
+
+#define BENCH_POLE_PAIRS  15                                        // hub motor
+#define BENCH_RPM         150
+#define BENCH_HALL_STEP   (16000 * 60 / (BENCH_RPM * BENCH_POLE_PAIRS * 6))   // [motor ISR calls] per hall state
+#define BENCH_RAMP        (500 / DELAY_IN_MAIN_LOOP)                 // [main loops] speed input ramp
+
+extern volatile adc_buf_t adc_buffer;
+extern InputStruct        input1[];
+extern InputStruct        input2[];
+#if defined(CONTROL_SERIAL_USART2) || defined(CONTROL_SERIAL_USART3)
+extern UART_HandleTypeDef huart2;
+extern UART_HandleTypeDef huart3;
+#endif
+#ifdef SERIAL_BUS
+extern uint8_t            busNode;
+#endif
+
+int  fwMain(void);                      // main() of Src/main.c
+void mainLoop(void);
+void DMA1_Channel1_IRQHandler(void);
+void __real_watchdogInit(void);
+
+static jmp_buf  benchStarted;
+static uint32_t benchIsrCnt;            // motor ISR calls
+static uint32_t benchLoopCnt;           // main loops
+static uint8_t  benchHall;              // hall state 0..5
+
+// The start-up ends with the watchdog start right before the main loop (linked with --wrap=watchdogInit)
+void __wrap_watchdogInit(void) {
+  __real_watchdogInit();
+  longjmp(benchStarted, 1);
+}
+
+// Hall sensor inputs of both motors for state 0..5, the firmware reads them inverted
+static void benchHallSet(uint8_t state) {
+  static const uint8_t uvw[6] = {4, 6, 2, 3, 1, 5};
+  const uint8_t h = uvw[state];
+  LEFT_HALL_U_PORT->IDR  = (h & 4) ? LEFT_HALL_U_PORT->IDR  & ~LEFT_HALL_U_PIN  : LEFT_HALL_U_PORT->IDR  | LEFT_HALL_U_PIN;
+  LEFT_HALL_V_PORT->IDR  = (h & 2) ? LEFT_HALL_V_PORT->IDR  & ~LEFT_HALL_V_PIN  : LEFT_HALL_V_PORT->IDR  | LEFT_HALL_V_PIN;
+  LEFT_HALL_W_PORT->IDR  = (h & 1) ? LEFT_HALL_W_PORT->IDR  & ~LEFT_HALL_W_PIN  : LEFT_HALL_W_PORT->IDR  | LEFT_HALL_W_PIN;
+  RIGHT_HALL_U_PORT->IDR = (h & 4) ? RIGHT_HALL_U_PORT->IDR & ~RIGHT_HALL_U_PIN : RIGHT_HALL_U_PORT->IDR | RIGHT_HALL_U_PIN;
+  RIGHT_HALL_V_PORT->IDR = (h & 2) ? RIGHT_HALL_V_PORT->IDR & ~RIGHT_HALL_V_PIN : RIGHT_HALL_V_PORT->IDR | RIGHT_HALL_V_PIN;
+  RIGHT_HALL_W_PORT->IDR = (h & 1) ? RIGHT_HALL_W_PORT->IDR & ~RIGHT_HALL_W_PIN : RIGHT_HALL_W_PORT->IDR | RIGHT_HALL_W_PIN;
+}
+
+// Speed input of the scenario: released at start-up, then a ramp to 60 % [per mille]
+static int16_t benchSpeed(void) {
+  return (int16_t)(600 * (int32_t)MIN(benchLoopCnt, BENCH_RAMP) / BENCH_RAMP);
+}
+
+static void benchInputs(void) {
+  int16_t speed = benchSpeed();
+  adc_buffer.l_tx2 = (uint16_t)input1[0].mid;                                           // steer centred
+  adc_buffer.l_rx2 = (uint16_t)(input2[0].mid + (input2[0].max - input2[0].mid) * speed / 1000);
+
+  #if (defined(CONTROL_SERIAL_USART2) || defined(CONTROL_SERIAL_USART3)) && !defined(CONTROL_IBUS)
+    if (benchLoopCnt > 0) {
+      SerialCommand cmd;
+      memset(&cmd, 0, sizeof(cmd));
+      cmd.start = SERIAL_START_FRAME;
+      cmd.speed = speed;
+      #ifdef SERIAL_BUS
+      cmd.address = busNode;
+      #endif
+      const uint16_t *word = (const uint16_t *)&cmd;
+      for (uint32_t i = 0; i < sizeof(cmd) / 2 - 1; i++) {
+        cmd.checksum ^= word[i];
+      }
+      #ifdef CONTROL_SERIAL_USART2
+        stubUartRx(&huart2, (const uint8_t *)&cmd, sizeof(cmd));
+        usart2_rx_check();                // idle line interrupt
+      #else
+        stubUartRx(&huart3, (const uint8_t *)&cmd, sizeof(cmd));
+        usart3_rx_check();
+      #endif
+    }
+  #endif
+}
+
+int benchInit(void) {
+  if (stubInit() != 0) {
+    return -1;
+  }
+  adc_buffer.batt1 = (uint16_t)(BAT_CELLS * 370 * BAT_CALIB_ADC / BAT_CALIB_REAL_VOLTAGE);   // 3.7 V per cell
+  adc_buffer.temp  = (uint16_t)(TEMP_CAL_LOW_ADC + (25 - TEMP_CAL_LOW_DEG_C) * (TEMP_CAL_HIGH_ADC - TEMP_CAL_LOW_ADC) /
+                                (TEMP_CAL_HIGH_DEG_C - TEMP_CAL_LOW_DEG_C));
+  adc_buffer.rlA   = adc_buffer.rlB = adc_buffer.rrB = adc_buffer.rrC = 2048;            // no current
+  adc_buffer.dcl   = adc_buffer.dcr = 2048;
+  benchHallSet(0);
+  benchInputs();
+  if (setjmp(benchStarted) == 0) {
+    fwMain();
+    return -1;                          // not reached: the start-up ends in watchdogInit
+  }
+  benchInputs();                        // input limits loaded from the EEPROM
+  return 0;
+}
+
+void benchIsr(void) {
+  if (++benchIsrCnt % BENCH_HALL_STEP == 0) {
+    benchHall = (benchHall + 1) % 6;
+    benchHallSet(benchHall);
+  }
+  stubIpsr = DMA1_Channel1_IRQn + 16;
+  DMA1_Channel1_IRQHandler();
+  stubIpsr = 0;
+}
+
+void benchLoop(void) {
+  benchInputs();
+  mainLoop();
+  benchLoopCnt++;
+}
+
+int benchIsrPerLoop(void) {
+  return 16 * DELAY_IN_MAIN_LOOP;
+}
+
+const char *benchVariant(void) {
+  return BENCH_VARIANT;
+}
@@ -0,0 +1,29 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// The firmware motor controller for the host. As in tools/motorsim/controller.c: the generated code refuses a 64 bit
+// long in its word size checks, it does not use long itself
+
+#include <limits.h>
+#undef  ULONG_MAX
+#undef  LONG_MAX
+#define ULONG_MAX   0xFFFFFFFFU
+#define LONG_MAX    0x7FFFFFFF
+
+#include "BLDC_controller.c"
@@ -0,0 +1,64 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Cortex-M3 core header for the host build: the core intrinsics (Drivers/CMSIS/Include/cmsis_gcc.h) are ARM
+// assembly, here they act on the interrupt state of the stub HAL (stubhal.c). The register definitions follow from
+// the CMSIS header, their addresses are mapped by stubInit()
+
+#ifndef FWBENCH_CORE_CM3_H
+#define FWBENCH_CORE_CM3_H
+
+#include <stdint.h>
+
+#define __CORE_CMINSTR_H              // replaced by the definitions below
+#define __CORE_CMFUNC_H
+
+extern volatile uint32_t stubPrimask; // 1: interrupts disabled
+extern volatile uint32_t stubIpsr;    // active exception number, 0 in thread mode
+
+static inline void     __enable_irq(void)           { stubPrimask = 0; }
+static inline void     __disable_irq(void)          { stubPrimask = 1; }
+static inline uint32_t __get_PRIMASK(void)          { return stubPrimask; }
+static inline void     __set_PRIMASK(uint32_t x)    { stubPrimask = x; }
+static inline uint32_t __get_IPSR(void)             { return stubIpsr; }
+static inline uint32_t __get_CONTROL(void)          { return 0; }
+static inline void     __set_CONTROL(uint32_t x)    { (void)x; }
+static inline uint32_t __get_MSP(void)              { return 0; }
+static inline void     __set_MSP(uint32_t x)        { (void)x; }
+static inline uint32_t __get_PSP(void)              { return 0; }
+static inline void     __set_PSP(uint32_t x)        { (void)x; }
+static inline uint32_t __get_BASEPRI(void)          { return 0; }
+static inline void     __set_BASEPRI(uint32_t x)    { (void)x; }
+static inline uint32_t __get_FAULTMASK(void)        { return 0; }
+static inline void     __set_FAULTMASK(uint32_t x)  { (void)x; }
+static inline void     __NOP(void)                  { }
+static inline void     __WFI(void)                  { }
+static inline void     __WFE(void)                  { }
+static inline void     __SEV(void)                  { }
+static inline void     __ISB(void)                  { }
+static inline void     __DSB(void)                  { }
+static inline void     __DMB(void)                  { }
+static inline uint32_t __REV(uint32_t x)            { return __builtin_bswap32(x); }
+static inline uint32_t __RBIT(uint32_t x)           { uint32_t r = 0; for (int i = 0; i < 32; i++, x >>= 1) r = (r << 1) | (x & 1); return r; }
+#define __CLZ           __builtin_clz
+#define __BKPT(value)   ((void)(value))
+
+#include_next "core_cm3.h"
+
+#endif  // FWBENCH_CORE_CM3_H
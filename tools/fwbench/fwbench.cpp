@@ -0,0 +1,136 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Firmware benchmark on the host: the variant's sources (make VARIANT=...) against a stub HAL, run through a fixed
+// scenario (bench.c). Host instructions of the motor control ISR and the main loop body, per call:
+//   fwbench                          average and worst call over 200 ms after 1 s of start-up and speed ramp. The ISR
+//                                    is counted in every 4th main loop period (800 calls), single-stepping is slow
+// A repeatable measure to compare builds of a variant, not the target cycles. The output lines "<task> <stat> <n>"
+// are compared between commits by the CI.
+
+#include "fwbench.h"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+enum Segment { SEG_CALIB, SEG_ISR, SEG_LOOP, SEG_NR };
+static const char *segName[SEG_NR] = {"calib", "isr", "loop"};
+
+static volatile int benchSeg;           // segment that starts, read by the tracer
+
+struct Count {
+  uint64_t sum = 0, max = 0, min = UINT64_MAX, n = 0;
+  void add(uint64_t c) { sum += c; max = std::max(max, c); min = std::min(min, c); n++; }
+};
+
+// Segment markers of the traced child: the tracer single-steps from the start to the end marker only
+static void segStart(Segment s) {
+  benchSeg = s;
+  kill(getpid(), SIGUSR1);
+}
+static void segEnd() {
+  kill(getpid(), SIGUSR2);
+}
+
+// Instructions of the segments of fn, counted by single-stepping a forked copy of the process: exact and repeatable,
+// unlike timing on a shared machine. The marker overhead (empty segment) is subtracted. Returns false if the process
+// cannot be traced
+template <typename Fn> static bool countSegments(Fn fn, Count *count) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+    raise(SIGSTOP);
+    for (int i = 0; i < 8; i++) {
+      segStart(SEG_CALIB);
+      segEnd();
+    }
+    fn();
+    _exit(0);
+  }
+  int      status, seg = -1;
+  uint64_t n = 0;
+  waitpid(pid, &status, 0);
+  while (WIFSTOPPED(status)) {
+    int sig = WSTOPSIG(status);
+    if (sig == SIGUSR1) {
+      seg = (int)ptrace(PTRACE_PEEKDATA, pid, (void *)&benchSeg, nullptr);
+      n   = 0;
+    } else if (sig == SIGUSR2 && seg >= 0) {
+      count[seg].add(n);
+      seg = -1;
+    }
+    if (ptrace(seg >= 0 ? PTRACE_SINGLESTEP : PTRACE_CONT, pid, nullptr, nullptr) < 0) {
+      kill(pid, SIGKILL);
+      waitpid(pid, &status, 0);
+      return false;
+    }
+    waitpid(pid, &status, 0);
+    n++;
+  }
+  return count[SEG_CALIB].n > 0;
+}
+
+int main() {
+  if (benchInit() != 0) {
+    fprintf(stderr, "fwbench: the peripheral addresses cannot be mapped or the start-up did not finish\n");
+    return 1;
+  }
+  const int perLoop = benchIsrPerLoop();
+  for (int loop = 0; loop < 200; loop++) {          // 1 s: ADC offsets, enable, speed ramp
+    for (int k = 0; k < perLoop; k++) {
+      benchIsr();
+    }
+    benchLoop();
+  }
+
+  Count count[SEG_NR];
+  bool  traced = countSegments([&] {
+    for (int loop = 0; loop < 40; loop++) {         // 200 ms
+      for (int k = 0; k < perLoop; k++) {
+        if (loop % 4 == 0) {
+          segStart(SEG_ISR);
+          benchIsr();
+          segEnd();
+        } else {
+          benchIsr();
+        }
+      }
+      segStart(SEG_LOOP);
+      benchLoop();
+      segEnd();
+    }
+  }, count);
+  if (!traced) {
+    fprintf(stderr, "fwbench: cannot trace the process\n");
+    return 1;
+  }
+
+  uint64_t marker = count[SEG_CALIB].min;
+  printf("%s: host instructions per call, 200 ms at a constant wheel speed\n", benchVariant());
+  for (int s = SEG_ISR; s < SEG_NR; s++) {
+    printf("%-5s avg %8.1f\n", segName[s], (double)count[s].sum / count[s].n - marker);
+    printf("%-5s max %8llu\n", segName[s], (unsigned long long)(count[s].max - marker));
+  }
+  return 0;
+}
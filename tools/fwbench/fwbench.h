@@ -0,0 +1,39 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// C interface to the firmware built for the host against the stub HAL (bench.c, stubhal.c)
+
+#ifndef FWBENCH_H
+#define FWBENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int         benchInit(void);        // map the peripherals and run the firmware start-up up to the main loop. 0 = done
+void        benchIsr(void);         // one motor control ISR (DMA1_Channel1_IRQHandler), the halls turn at a constant speed
+void        benchLoop(void);        // one main loop body (mainLoop) with the scenario inputs of its time
+int         benchIsrPerLoop(void);  // motor ISR calls per main loop
+const char *benchVariant(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // FWBENCH_H
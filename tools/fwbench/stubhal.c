@@ -0,0 +1,203 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Stub HAL for the host build of the firmware. The peripheral registers, the flash and the core registers are plain
+// memory at their target addresses (stubInit), so the firmware accesses them unchanged. The HAL calls act on these
+// registers as far as the firmware depends on it: GPIO pins, UART DMA counters, flash program / erase. Everything
+// else returns HAL_OK at once, a transfer completes immediately.
+
+#include <string.h>
+#include <sys/mman.h>
+#include "stm32f1xx_hal.h"
+#include "util.h"
+#include "stubhal.h"
+
+volatile uint32_t stubPrimask;
+volatile uint32_t stubIpsr;
+FaultRecord       faultRecord;          // stm32f1xx_it.c is not built: fault capture is ARM assembly
+static uint32_t   stubTick;             // HAL_GetTick [ms]
+
+// Address ranges backed by memory: peripherals, flash, system memory (device id), core peripherals
+static const struct { uintptr_t base; size_t size; uint8_t fill; } stubMem[] = {
+  {PERIPH_BASE,       0x30000,  0x00},
+  {FLASH_BASE,        0x80000,  0xFF},
+  {0x1FFFF000,        0x1000,   0xFF},
+  {0xE0000000,        0x100000, 0x00} };
+
+int stubInit(void) {
+  for (size_t i = 0; i < sizeof(stubMem) / sizeof(stubMem[0]); i++) {
+    void *p = mmap((void *)stubMem[i].base, stubMem[i].size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (p != (void *)stubMem[i].base) {
+      return -1;
+    }
+    memset(p, stubMem[i].fill, stubMem[i].size);
+  }
+  return 0;
+}
+
+// UART receive DMA: the firmware reads the write position from the DMA counter of its circular buffer
+void stubUartRx(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t len) {
+  if (huart->hdmarx == NULL || huart->pRxBuffPtr == NULL) {
+    return;
+  }
+  for (uint16_t i = 0; i < len; i++) {
+    uint32_t pos = huart->RxXferSize - huart->hdmarx->Instance->CNDTR;
+    huart->pRxBuffPtr[pos] = data[i];
+    huart->hdmarx->Instance->CNDTR = (pos + 1 == huart->RxXferSize) ? huart->RxXferSize : huart->RxXferSize - pos - 1;
+  }
+}
+
+
+/* =========================== Weak MSP defaults (setup.c defines the ones it uses) =========================== */
+
+__weak void HAL_UART_MspInit(UART_HandleTypeDef *huart)     { (void)huart; }
+__weak void HAL_I2C_MspInit(I2C_HandleTypeDef *hi2c)        { (void)hi2c; }
+__weak void HAL_ADC_MspInit(ADC_HandleTypeDef *hadc)        { (void)hadc; }
+__weak void HAL_TIM_PWM_MspInit(TIM_HandleTypeDef *htim)    { (void)htim; }
+__weak void HAL_TIM_Base_MspInit(TIM_HandleTypeDef *htim)   { (void)htim; }
+
+
+/* =========================== Core, clock =========================== */
+
+HAL_StatusTypeDef HAL_Init(void)                                              { return HAL_OK; }
+uint32_t HAL_GetTick(void)                                                    { return stubTick; }
+void HAL_Delay(__IO uint32_t Delay)                                           { stubTick += Delay; }
+void HAL_NVIC_SetPriorityGrouping(uint32_t PriorityGroup)                     { (void)PriorityGroup; }
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t Pre, uint32_t Sub)         { (void)IRQn; (void)Pre; (void)Sub; }
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)                                       { (void)IRQn; }
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)                                      { (void)IRQn; }
+uint32_t HAL_SYSTICK_Config(uint32_t TicksNumb)                               { (void)TicksNumb; return 0; }
+void HAL_SYSTICK_CLKSourceConfig(uint32_t CLKSource)                          { (void)CLKSource; }
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *RCC_OscInitStruct)    { (void)RCC_OscInitStruct; return HAL_OK; }
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t FLatency) {
+  (void)RCC_ClkInitStruct; (void)FLatency;
+  return HAL_OK;
+}
+HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig(RCC_PeriphCLKInitTypeDef *PeriphClkInit) { (void)PeriphClkInit; return HAL_OK; }
+uint32_t HAL_RCC_GetHCLKFreq(void)                                            { return 64000000; }
+
+
+/* =========================== GPIO =========================== */
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)          { (void)GPIOx; (void)GPIO_Init; }
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin)                  { (void)GPIOx; (void)GPIO_Pin; }
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)        { return (GPIOx->IDR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET; }
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)               { GPIOx->ODR ^= GPIO_Pin; }
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {
+  if (PinState != GPIO_PIN_RESET) {
+    GPIOx->ODR |= GPIO_Pin;
+  } else {
+    GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+  }
+}
+
+
+/* =========================== Timers, ADC, DMA =========================== */
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim)                  { HAL_TIM_Base_MspInit(htim); return HAL_OK; }
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim)                 { (void)htim; return HAL_OK; }
+HAL_StatusTypeDef HAL_TIM_PWM_Init(TIM_HandleTypeDef *htim)                   { HAL_TIM_PWM_MspInit(htim); return HAL_OK; }
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel)    { (void)htim; (void)Channel; return HAL_OK; }
+HAL_StatusTypeDef HAL_TIMEx_PWMN_Start(TIM_HandleTypeDef *htim, uint32_t Channel) { (void)htim; (void)Channel; return HAL_OK; }
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef *sConfig, uint32_t Channel) {
+  (void)htim; (void)sConfig; (void)Channel;
+  return HAL_OK;
+}
+HAL_StatusTypeDef HAL_TIM_SlaveConfigSynchronization(TIM_HandleTypeDef *htim, TIM_SlaveConfigTypeDef *sSlaveConfig) {
+  (void)htim; (void)sSlaveConfig;
+  return HAL_OK;
+}
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef *htim, TIM_MasterConfigTypeDef *sMasterConfig) {
+  (void)htim; (void)sMasterConfig;
+  return HAL_OK;
+}
+HAL_StatusTypeDef HAL_TIMEx_ConfigBreakDeadTime(TIM_HandleTypeDef *htim, TIM_BreakDeadTimeConfigTypeDef *sBreakDeadTimeConfig) {
+  (void)htim; (void)sBreakDeadTimeConfig;
+  return HAL_OK;
+}
+HAL_StatusTypeDef HAL_ADC_Init(ADC_HandleTypeDef *hadc)                       { HAL_ADC_MspInit(hadc); return HAL_OK; }
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef *hadc)                      { (void)hadc; return HAL_OK; }
+HAL_StatusTypeDef HAL_ADC_ConfigChannel(ADC_HandleTypeDef *hadc, ADC_ChannelConfTypeDef *sConfig) { (void)hadc; (void)sConfig; return HAL_OK; }
+HAL_StatusTypeDef HAL_ADCEx_MultiModeConfigChannel(ADC_HandleTypeDef *hadc, ADC_MultiModeTypeDef *multimode) {
+  (void)hadc; (void)multimode;
+  return HAL_OK;
+}
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma)                       { (void)hdma; return HAL_OK; }
+HAL_StatusTypeDef HAL_DMA_DeInit(DMA_HandleTypeDef *hdma)                     { (void)hdma; return HAL_OK; }
+
+
+/* =========================== UART, I2C =========================== */
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart) {
+  HAL_UART_MspInit(huart);              // links the DMA handles
+  huart->gState = huart->RxState = HAL_UART_STATE_READY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size) {
+  (void)pData; (void)Size;
+  if (huart->hdmatx != NULL) {
+    huart->hdmatx->Instance->CNDTR = 0;   // sent at once
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size) {
+  huart->pRxBuffPtr  = pData;
+  huart->RxXferSize  = Size;
+  if (huart->hdmarx != NULL) {
+    huart->hdmarx->Instance->CNDTR = Size;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c)                       { HAL_I2C_MspInit(hi2c); return HAL_OK; }
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c)                     { (void)hi2c; return HAL_OK; }
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+  (void)hi2c; (void)DevAddress; (void)pData; (void)Size; (void)Timeout;
+  return HAL_OK;
+}
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+  (void)hi2c; (void)DevAddress; (void)Timeout;
+  memset(pData, 0, Size);
+  return HAL_OK;
+}
+
+
+/* =========================== Flash =========================== */
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)                                      { return HAL_OK; }
+HAL_StatusTypeDef HAL_FLASH_Lock(void)                                        { return HAL_OK; }
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data) {
+  int n = (TypeProgram == FLASH_TYPEPROGRAM_HALFWORD) ? 1 : (TypeProgram == FLASH_TYPEPROGRAM_WORD) ? 2 : 4;
+  for (int i = 0; i < n; i++, Data >>= 16) {
+    *(__IO uint16_t *)(uintptr_t)(Address + 2 * i) &= (uint16_t)Data;   // programming clears bits only
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError) {
+  if (pEraseInit->TypeErase == FLASH_TYPEERASE_PAGES) {
+    memset((void *)(uintptr_t)pEraseInit->PageAddress, 0xFF, pEraseInit->NbPages * FLASH_PAGE_SIZE);
+  }
+  *PageError = 0xFFFFFFFF;
+  return HAL_OK;
+}
@@ -0,0 +1,33 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Stub HAL of the host build (stubhal.c), C only: the HAL types come with config.h
+
+#ifndef STUBHAL_H
+#define STUBHAL_H
+
+#include "stm32f1xx_hal.h"
+
+extern volatile uint32_t stubPrimask;
+extern volatile uint32_t stubIpsr;
+
+int  stubInit(void);
+void stubUartRx(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t len);
+
+#endif  // STUBHAL_H
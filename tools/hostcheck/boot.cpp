@@ -0,0 +1,357 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Serial bootloader (Bootloader/bootcore.c) on a simulated flash image: update over the frame protocol, plain and
+// compressed, delta to the other slot, trial boots and rollback, interrupted and corrupt updates, argument checks.
+
+#include "hostcheck.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+const uint32_t FLASH_SIZE  = 256 * 1024;
+const uint32_t LOADER_SIZE = 16 * 1024;
+alignas(4) uint8_t flash[FLASH_SIZE];
+
+// Erase whole pages, the bootloader area is write protected
+uint8_t simErase(uint32_t addr, uint32_t size) {
+  if (addr < BOOT_LOADER_ADDR + LOADER_SIZE || addr + size > BOOT_LOADER_ADDR + FLASH_SIZE) return BOOT_ERR_FLASH;
+  uint32_t first = (addr - BOOT_LOADER_ADDR) & ~(BOOT_PAGE_SIZE - 1);
+  uint32_t end   = (addr - BOOT_LOADER_ADDR + size + BOOT_PAGE_SIZE - 1) & ~(BOOT_PAGE_SIZE - 1);
+  memset(&flash[first], 0xFF, end - first);
+  return BOOT_OK;
+}
+
+// STM32F1: a half-word is programmed once after the erase, only 0x0000 may be written over a programmed one
+uint8_t simProgram(uint32_t addr, const uint8_t *data, uint32_t size) {
+  if (addr < BOOT_LOADER_ADDR + LOADER_SIZE || addr + size > BOOT_LOADER_ADDR + FLASH_SIZE || (addr & 1) || (size & 1)) {
+    return BOOT_ERR_FLASH;
+  }
+  uint8_t *p = &flash[addr - BOOT_LOADER_ADDR];
+  for (uint32_t i = 0; i < size; i += 2) {
+    bool erased = p[i] == 0xFF && p[i + 1] == 0xFF;
+    if (!erased && (data[i] || data[i + 1])) return BOOT_ERR_FLASH;
+    p[i]     = data[i];
+    p[i + 1] = data[i + 1];
+  }
+  return BOOT_OK;
+}
+
+BootCore core;
+BootRx   rx;
+uint32_t sent;                                // [bytes] frames sent by the host
+
+// Power on: the slots are checked again, the host has to sync
+void reset() {
+  core         = BootCore();
+  core.flash   = flash;
+  core.erase   = simErase;
+  core.program = simProgram;
+  rx           = BootRx();
+  bootCoreInit(&core);
+}
+
+struct Reply {
+  int   status;                               // -1: no reply
+  Bytes data;
+};
+
+Reply request(uint8_t cmd, const Bytes &payload) {
+  Bytes frame = {BOOT_SOF, cmd, (uint8_t)payload.size(), (uint8_t)(payload.size() >> 8)};
+  frame.insert(frame.end(), payload.begin(), payload.end());
+  uint16_t crc = bootCrc16(&frame[1], frame.size() - 1);
+  frame.push_back((uint8_t)crc);
+  frame.push_back((uint8_t)(crc >> 8));
+  uint8_t  reply[BOOT_REPLY_MAX];
+  uint16_t len = 0;
+  for (uint8_t byte : frame) len = bootRxByte(&core, &rx, byte, 0, reply);
+  sent += frame.size();
+  if (!len || reply[1] != (cmd | BOOT_REPLY) || bootCrc16(&reply[1], len - 3) != (reply[len - 2] | reply[len - 1] << 8)) {
+    return {-1, {}};
+  }
+  return {reply[4], Bytes(&reply[5], &reply[len - 2])};
+}
+
+Bytes u32(uint32_t v) {
+  return {(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24)};
+}
+
+Bytes cat(Bytes a, const Bytes &b) {
+  a.insert(a.end(), b.begin(), b.end());
+  return a;
+}
+
+uint32_t crc32(const Bytes &b) {
+  return bootCrc32(b.data(), b.size());
+}
+
+// Firmware image linked for a slot: vector table, code from a small instruction set (compresses like code)
+// and literal pools with absolute addresses of the slot. Builds of the same version differ only there.
+Bytes image(uint8_t slot, uint32_t version, uint32_t size) {
+  Bytes b(size);
+  uint32_t seed = 12345, addr = BOOT_SLOT_ADDR(slot);
+  auto rnd = [&seed]() { seed = seed * 1103515245 + 12345; return seed >> 16; };
+  uint8_t insn[64][4];
+  for (auto &i : insn) for (uint8_t &c : i) c = (uint8_t)rnd();
+  for (uint32_t i = 8; i + 4 <= size; i += 4) {
+    uint32_t r = rnd();
+    if (i % 256 == 252) {
+      memcpy(&b[i], u32(addr + (r & 0xFFFE)).data(), 4);
+    } else {
+      memcpy(&b[i], insn[r % 64], 4);
+    }
+    if (i / 4096 == version) b[i] ^= 0x5A;  // the function that changed in this version
+  }
+  memcpy(&b[0], u32(BOOT_RAM_END).data(), 4);
+  memcpy(&b[4], u32(addr + 0x1F1).data(), 4);
+  return b;
+}
+
+// The encoder of tools/boot_flash.py: greedy LZ77 over the image so far and the delta base
+Bytes compress(const Bytes &img, const Bytes &base) {
+  Bytes out, literal;
+  std::map<uint32_t, std::vector<uint32_t>> index, baseIndex;
+  auto key = [](const Bytes &b, uint32_t p) { return b[p] | b[p + 1] << 8 | b[p + 2] << 16; };
+  for (uint32_t p = 0; p + BOOT_Z_COPY_MIN <= base.size(); p++) baseIndex[key(base, p)].push_back(p);
+  auto match = [&img](const Bytes &src, uint32_t start, uint32_t pos) {
+    uint32_t n = 0;
+    while (n < BOOT_Z_COPY_MAX && pos + n < img.size() && start + n < src.size() && src[start + n] == img[pos + n]) n++;
+    return n;
+  };
+  auto flush = [&]() {
+    for (size_t i = 0; i < literal.size(); i += BOOT_Z_LITERAL_MAX) {
+      size_t n = std::min(literal.size() - i, (size_t)BOOT_Z_LITERAL_MAX);
+      out.push_back((uint8_t)(n - 1));
+      out.insert(out.end(), literal.begin() + i, literal.begin() + i + n);
+    }
+    literal.clear();
+  };
+  uint32_t pos = 0, baseShift = 0;              // base offset - image offset of the last copy from the base
+  while (pos < img.size()) {
+    uint32_t best = 0, start = 0, k = pos + BOOT_Z_COPY_MIN <= img.size() ? key(img, pos) : 0xFFFFFFFF;
+    bool fromBase = false;
+    std::vector<uint32_t> cand = {pos + baseShift};
+    auto &bi = baseIndex[k];
+    cand.insert(cand.end(), bi.size() > 8 ? bi.end() - 8 : bi.begin(), bi.end());
+    for (uint32_t s : cand) {
+      uint32_t n = match(base, s, pos);
+      if (n > best) best = n, start = s, fromBase = true;
+    }
+    auto &ii = index[k];
+    for (size_t j = ii.size(); j-- > (ii.size() > 8 ? ii.size() - 8 : 0);) {
+      uint32_t n = match(img, ii[j], pos);
+      if (n > best && pos - ii[j] <= 0xFFFF) best = n, start = ii[j], fromBase = false;
+    }
+    if (best < BOOT_Z_COPY_MIN) {
+      best = 1;
+      literal.push_back(img[pos]);
+    } else {
+      flush();
+      out.push_back((uint8_t)((fromBase ? 0xC0 : 0x80) | (best - BOOT_Z_COPY_MIN)));
+      uint32_t arg = fromBase ? start : pos - start;
+      for (int j = 0; j < (fromBase ? 3 : 2); j++) out.push_back((uint8_t)(arg >> (8 * j)));
+      if (fromBase) baseShift = start - pos;
+    }
+    for (uint32_t p = pos; p < pos + best; p++) {
+      if (p + BOOT_Z_COPY_MIN <= img.size()) index[key(img, p)].push_back(p);
+    }
+    pos += best;
+  }
+  flush();
+  return out;
+}
+
+int failed;
+
+void expect(const char *what, bool ok, const char *fmt = "", uint32_t a = 0, uint32_t b = 0) {
+  printf("%-46s ", what);
+  printf(fmt, a, b);
+  printf("%s\n", ok ? "" : "  <- wrong");
+  failed += !ok;
+}
+
+bool status(const Reply &r, int want) {
+  return r.status == want;
+}
+
+// Full update of a slot: ERASE, WRITE or WRITE_Z frames, COMMIT. Returns the COMMIT status, or the first error
+int update(uint8_t slot, const Bytes &img, const Bytes *base, bool compressed, uint32_t stopAt = 0xFFFFFFFF) {
+  Reply r = request(BOOT_CMD_ERASE, cat({slot}, u32(img.size())));
+  if (r.status != BOOT_OK) return r.status;
+  Bytes data = compressed ? compress(img, base ? *base : Bytes()) : img;
+  if (!compressed && (data.size() & 1)) data.push_back(0xFF);
+  for (uint32_t off = 0; off < data.size(); off += BOOT_CHUNK_MAX) {
+    if (off >= stopAt) return -1;
+    Bytes chunk(data.begin() + off, data.begin() + std::min<size_t>(off + BOOT_CHUNK_MAX, data.size()));
+    r = request(compressed ? BOOT_CMD_WRITE_Z : BOOT_CMD_WRITE, cat(u32(off), chunk));
+    if (r.status != BOOT_OK) return r.status;
+  }
+  return request(BOOT_CMD_COMMIT, cat(u32(img.size()), u32(crc32(img)))).status;
+}
+
+bool slotHolds(uint8_t slot, const Bytes &img) {
+  return !memcmp(&flash[BOOT_SLOT_ADDR(slot) - BOOT_LOADER_ADDR], img.data(), img.size());
+}
+
+// The application confirms its image
+void confirm(uint8_t slot) {
+  static const uint8_t zero[2] = {0, 0};
+  simProgram(BOOT_META_ADDR(slot) + offsetof(BootMeta, confirmed), zero, 2);
+}
+
+}  // namespace
+
+int checkBoot() {
+  failed = 0;
+  memset(flash, 0xFF, sizeof(flash));
+  reset();
+  expect("empty flash: nothing to start", bootSlotStart(&core) == BOOT_NONE && bootSlotTarget(&core) == 0);
+
+  // Not a bootloader host: the port stays silent, nothing is executed
+  Reply r = request(BOOT_CMD_ERASE, cat({0}, u32(1000)));
+  expect("ERASE before SYNC: ignored", status(r, -1) && core.eraseSlot == BOOT_NONE);
+  uint8_t noise[] = {BOOT_SOF, 0x01, 0x00, 0x00, 0x12, 0x34};
+  uint8_t reply[BOOT_REPLY_MAX];
+  uint16_t len = 0;
+  for (uint8_t byte : noise) len |= bootRxByte(&core, &rx, byte, 0, reply);
+  expect("SYNC with a bad CRC before SYNC: no reply", len == 0);
+  r = request(BOOT_CMD_SYNC, {});
+  expect("SYNC", status(r, BOOT_OK) && r.data.size() == BOOT_INFO_LEN && r.data[0] == BOOT_PROTOCOL_VERSION,
+         "version %u", r.data.empty() ? 0 : r.data[0]);
+  r = request(BOOT_CMD_RUN, {});
+  expect("RUN without an image", status(r, BOOT_ERR_STATE));
+
+  // First image, uncompressed, to slot A
+  Bytes v1A = image(0, 1, 60000);
+  sent = 0;
+  int st = update(0, v1A, nullptr, false);
+  expect("v1 to slot A, WRITE", st == BOOT_OK && slotHolds(0, v1A), "%u bytes sent", sent);
+  reset();
+  uint8_t slot = bootSlotStart(&core);
+  expect("boot 1: slot A as trial", slot == 0 && bootSlotAttempts(&core, 0) == 1);
+  confirm(0);
+  reset();
+  slot = bootSlotStart(&core);
+  expect("boot 2: slot A confirmed, no attempt counted", slot == 0 && bootSlotAttempts(&core, 0) == 1 &&
+         bootSlotConfirmed(&core, 0));
+
+  // Arguments
+  request(BOOT_CMD_SYNC, {});
+  r = request(BOOT_CMD_ERASE, cat({0}, u32(1000)));
+  expect("ERASE of the confirmed slot A", status(r, BOOT_ERR_STATE));
+  r = request(BOOT_CMD_ERASE, cat({1}, u32(BOOT_SLOT_SIZE + 2)));
+  expect("ERASE larger than a slot", status(r, BOOT_ERR_ARG));
+  r = request(BOOT_CMD_ERASE, cat({1}, u32(1001)));
+  expect("ERASE slot B, 1001 bytes", status(r, BOOT_OK));
+  r = request(BOOT_CMD_WRITE, cat(u32(1000), {0x11, 0x22}));
+  expect("WRITE of the padded last half-word", status(r, BOOT_OK));
+  r = request(BOOT_CMD_WRITE, cat(u32(1002), {0x11, 0x22}));
+  expect("WRITE behind the image", status(r, BOOT_ERR_ARG));
+  r = request(BOOT_CMD_WRITE, cat(u32(0xFFFFFFFC), {1, 2, 3, 4, 5, 6, 7, 8}));
+  expect("WRITE with an offset wrapping around", status(r, BOOT_ERR_ARG) &&
+         flash[BOOT_SLOT_B_ADDR - 4 - BOOT_LOADER_ADDR] == 0xFF);
+  r = request(BOOT_CMD_WRITE, cat(u32(1), {1, 2}));
+  expect("WRITE at an odd offset", status(r, BOOT_ERR_ARG));
+  r = request(0x7F, {});
+  expect("unknown command", status(r, BOOT_ERR_CMD));
+  Bytes bad = {BOOT_SOF, BOOT_CMD_SYNC, 0, 0, 0, 0};
+  len = 0;
+  for (uint8_t byte : bad) len = bootRxByte(&core, &rx, byte, 0, reply);
+  expect("bad frame CRC after SYNC", len && reply[4] == BOOT_ERR_FRAME);
+
+  // Compressed delta update to slot B, from the image in slot A
+  Bytes v2B = image(1, 2, 60001);
+  sent = 0;
+  st = update(1, v2B, &v1A, true);
+  expect("v2 to slot B, WRITE_Z delta to slot A", st == BOOT_OK && slotHolds(1, v2B), "%u bytes sent for %u",
+         sent, v2B.size());
+  bool small = sent < v2B.size() / 4;
+  expect("delta update below a quarter of the image", small);
+  reset();
+  for (int boot = 1; boot <= BOOT_ATTEMPTS; boot++) {
+    slot = bootSlotStart(&core);
+    reset();
+    if (slot != 1) break;
+  }
+  expect("v2 not confirmed: three trial boots of slot B", slot == 1 && bootSlotAttempts(&core, 1) == BOOT_ATTEMPTS);
+  slot = bootSlotStart(&core);
+  expect("boot 4: rolled back to slot A", slot == 0);
+
+  // Interrupted and corrupt updates leave slot A booting
+  request(BOOT_CMD_SYNC, {});
+  Bytes v3B = image(1, 3, 70000);
+  st = update(1, v3B, nullptr, true, 8 * BOOT_CHUNK_MAX);
+  reset();
+  expect("v3 interrupted: slot B invalid, slot A boots", !core.valid[1] && bootSlotStart(&core) == 0);
+  request(BOOT_CMD_SYNC, {});
+  Bytes corrupt = v3B;
+  corrupt[5000] ^= 1;
+  r = request(BOOT_CMD_ERASE, cat({1}, u32(v3B.size())));
+  for (uint32_t off = 0; off < corrupt.size(); off += BOOT_CHUNK_MAX) {
+    request(BOOT_CMD_WRITE, cat(u32(off), Bytes(corrupt.begin() + off,
+                                                corrupt.begin() + std::min<size_t>(off + BOOT_CHUNK_MAX, corrupt.size()))));
+  }
+  r = request(BOOT_CMD_COMMIT, cat(u32(v3B.size()), u32(crc32(v3B))));
+  reset();
+  expect("v3 corrupt: COMMIT fails, slot A boots", status(r, BOOT_ERR_VERIFY) && bootSlotStart(&core) == 0);
+  request(BOOT_CMD_SYNC, {});
+  r = request(BOOT_CMD_ERASE, cat({1}, u32(v3B.size())));
+  Bytes z = compress(v3B, Bytes());
+  request(BOOT_CMD_WRITE_Z, cat(u32(0), Bytes(z.begin(), z.begin() + 100)));
+  r = request(BOOT_CMD_WRITE_Z, cat(u32(200), Bytes(z.begin() + 200, z.begin() + 300)));
+  Reply again = request(BOOT_CMD_WRITE_Z, cat(u32(100), Bytes(z.begin() + 100, z.begin() + 200)));
+  expect("WRITE_Z after a lost frame, then any WRITE_Z", status(r, BOOT_ERR_ARG) && status(again, BOOT_ERR_STATE));
+  r = request(BOOT_CMD_ERASE, cat({1}, u32(100)));
+  Bytes far = {0x80 | 5, 0x10, 0x00};           // copy from 16 bytes back, nothing decoded yet
+  r = request(BOOT_CMD_WRITE_Z, cat(u32(0), far));
+  expect("WRITE_Z copy before the image start", status(r, BOOT_ERR_ARG));
+  r = request(BOOT_CMD_ERASE, cat({1}, u32(100)));
+  Bytes over = {0x7F};
+  over.resize(1 + 128, 0x42);
+  r = request(BOOT_CMD_WRITE_Z, cat(u32(0), over));
+  expect("WRITE_Z behind the image", status(r, BOOT_ERR_ARG));
+
+  // v3 compressed without a base into slot B, confirmed: the next update goes to slot A, delta to slot B
+  sent = 0;
+  st = update(1, v3B, nullptr, true);
+  expect("v3 to slot B, WRITE_Z", st == BOOT_OK && slotHolds(1, v3B), "%u bytes sent for %u", sent, v3B.size());
+  reset();
+  slot = bootSlotStart(&core);
+  confirm(slot);
+  reset();
+  expect("v3 confirmed: update target slot A", slot == 1 && bootSlotTarget(&core) == 0);
+  request(BOOT_CMD_SYNC, {});
+  Bytes v4A = image(0, 4, 70000);
+  sent = 0;
+  st = update(0, v4A, &v3B, true);
+  expect("v4 to slot A, WRITE_Z delta to slot B", st == BOOT_OK && slotHolds(0, v4A), "%u bytes sent for %u",
+         sent, v4A.size());
+  reset();
+  expect("boot: slot A with v4", bootSlotStart(&core) == 0 && bootSlotAttempts(&core, 0) == 1);
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,142 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Debug formatter (Src/dbgfmt.c) against the C library snprintf: integer conversions with flags and widths,
+// strings and characters, output in chunks through the flush function, dbgFixdt() against floating point, and the
+// format throughput of both.
+
+#include "hostcheck.h"
+
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace {
+
+std::string chunked;
+
+void collect(const char *s, uint16_t n) { chunked.append(s, n); }
+
+int failed;
+
+__attribute__((format(printf, 1, 2))) void compare(const char *fmt, ...) {
+  char    ref[128], out[128], small[6];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(ref, sizeof(ref), fmt, ap);
+  va_end(ap);
+  va_start(ap, fmt);
+  uint16_t n = dbgFormat(out, sizeof(out), nullptr, fmt, ap);
+  va_end(ap);
+  chunked.clear();
+  va_start(ap, fmt);
+  dbgFormat(small, sizeof(small), collect, fmt, ap);
+  va_end(ap);
+  if (strcmp(ref, out) || chunked != ref || n != strlen(ref)) {
+    printf("  \"%s\": printf \"%s\", dbgFormat \"%s\", in chunks \"%s\"\n", fmt, ref, out, chunked.c_str());
+    failed++;
+  }
+}
+
+__attribute__((format(printf, 1, 2))) int libcFormat(const char *fmt, ...) {
+  char    buf[128];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  return n;
+}
+
+__attribute__((format(printf, 1, 2))) int dbgFormatVa(const char *fmt, ...) {
+  char    buf[128];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = dbgFormat(buf, sizeof(buf), nullptr, fmt, ap);
+  va_end(ap);
+  return n;
+}
+
+}  // namespace
+
+int checkDbgFmt() {
+  failed = 0;
+  const long values[] = {0, 1, -1, 7, -42, 999, 4096, -32768, 32767, 65535, 100000, -100000, LONG_MAX, LONG_MIN};
+  int cases = 0;
+  for (long v : values) {
+    int  i = (int)v;
+    long l = (long)(int32_t)v;    // long is 32 bit on the target
+    compare("%d|%i|%5d|%-5d|%05d|%1d", i, i, i, i, i, i);
+    compare("%u|%x|%X|%08X|%-6x|", (unsigned)i, (unsigned)i, (unsigned)i, (unsigned)i, (unsigned)i);
+    compare("%li|%ld|%12li|%-12li|%012li", l, l, l, l, l);
+    compare("%lu|%lx|%08lX", (unsigned long)(uint32_t)l, (unsigned long)(uint32_t)l, (unsigned long)(uint32_t)l);
+    cases += 4;
+  }
+  const char *strs[] = {"", "a", "I_MOT_MAX", "a longer name than the width"};
+  for (const char *s : strs) {
+    compare("%s|%10s|%-10s|%2s|", s, s, s, s);
+    compare("%c|%3c|%-3c|%%|", s[0] ? s[0] : 'x', 'y', 'z');
+    cases += 2;
+  }
+  compare("# name:\"%s\" value:%li init:%li min:%li max:%li\r\n", "I_MOT_MAX", 15L, 15L, 1L, 40L);
+  compare("Limits (%i)\r\nCurrent: fixdt:%li factor%i i_max:%i \r\n", 3, -65536L, 40000, 2400);
+  cases += 2;
+  printf("%d format strings with %zu values: %d differ from printf\n", cases, sizeof(values) / sizeof(values[0]),
+         failed);
+
+  // dbgFixdt against the rounded floating point value
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int32_t> any(INT32_MIN, INT32_MAX);
+  int fixFailed = 0;
+  for (int k = 0; k < 200000; k++) {
+    int32_t v   = k < 8 ? (int32_t[]){0, 1, -1, 8, -8, 15, INT32_MIN, INT32_MAX}[k] : any(rng) >> (k % 24);
+    uint8_t q   = (uint8_t)(k % 32);
+    uint8_t dec = (uint8_t)(k % 5);
+    char    buf[DBG_FIXDT_LEN], ref[64];
+    double  x   = std::ldexp((double)v, -q);
+    double  r   = std::round(std::fabs(x) * std::pow(10, dec)) / std::pow(10, dec);
+    snprintf(ref, sizeof(ref), "%s%.*f", v < 0 ? "-" : "", dec, r);
+    const char *out = dbgFixdt(buf, v, q, dec);
+    if (strcmp(out, ref)) {
+      if (fixFailed++ < 5) printf("  dbgFixdt(%d, %u, %u) = \"%s\", expected \"%s\"\n", v, q, dec, out, ref);
+    }
+  }
+  printf("dbgFixdt: 200000 values, %d differ from the rounded floating point value\n", fixFailed);
+
+  // Throughput on the most common debug line
+  const int n = 200000;
+  auto time = [&](int (*fn)(const char *, ...)) {
+    volatile int sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int k = 0; k < n; k++) {
+      sink = sink + fn("in1:%i in2:%i cmdL:%i cmdR:%i BatADC:%i BatV:%i TempADC:%i Temp:%i \r\n",
+                       k & 1023, -k & 511, k % 1000, -(k % 1000), 1500 + (k & 63), 3612, 1800 + (k & 15), 250);
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / n;
+  };
+  double tLibc = time(libcFormat);
+  double tDbg  = time(dbgFormatVa);
+  printf("debug line: vsnprintf %.0f ns, dbgFormat %.0f ns per line (host)\n", tLibc, tDbg);
+
+  return failed || fixFailed ? 1 : 0;
+}
@@ -0,0 +1,131 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// EEPROM parameter store (Src/eeparams.c) on a simulated EEPROM emulation that counts the flash writes: first save,
+// unchanged save, partial change, reload after a reset, failed write and parameters missing in an older EEPROM.
+
+#include "hostcheck.h"
+
+#include <cstdio>
+#include <map>
+
+namespace {
+
+const uint16_t key = 0x1001;                  // FLASH_WRITE_KEY
+
+std::map<uint16_t, uint16_t> flash;           // virtual address -> value
+int  flashWrites;
+bool flashFail;                               // the next write fails (page transfer error)
+
+uint16_t flashRead(uint16_t virtAddr, uint16_t *data) {
+  auto it = flash.find(virtAddr);
+  if (it == flash.end()) return 1;
+  *data = it->second;
+  return 0;
+}
+
+uint16_t flashWrite(uint16_t virtAddr, uint16_t data) {
+  if (flashFail) {
+    flashFail = false;
+    return 1;
+  }
+  flash[virtAddr] = data;
+  flashWrites++;
+  return 0;
+}
+
+int16_t  iMax, iMaxR, nMax, inMin;
+uint8_t  inTyp;
+const EEParam reg[] = {{1, 2, &iMax, &iMaxR}, {2, 2, &nMax, nullptr}, {3, 1, &inTyp, nullptr}, {4, 2, &inMin, nullptr}};
+const uint16_t virtAddr[5] = {1000, 1001, 1002, 1003, 1004};
+
+// A store as after a reset: config.h values, then the EEPROM loaded
+EEStore boot() {
+  EEStore s = {};
+  s.param    = reg;
+  s.nr       = sizeof(reg) / sizeof(reg[0]);
+  s.virtAddr = virtAddr;
+  s.key      = key;
+  s.read     = flashRead;
+  s.write    = flashWrite;
+  iMax = iMaxR = 15 << 4; nMax = 1000 << 4; inTyp = 3; inMin = -1000;
+  eeStoreLoad(&s);
+  return s;
+}
+
+#define EE_INDEX(id, addr, name, var, varR, init, initFormat, min, max, div, mul, fix, callback, help)  addr,
+const int regIndex[] = {EE_PARAMS(EE_INDEX)};
+
+int failed;
+
+void save(EEStore &s, const char *what, int wantWrites, int wantFailed) {
+  int before = flashWrites;
+  uint8_t writes = eeStoreSave(&s);
+  int flashed = flashWrites - before;
+  bool ok = writes == wantWrites && flashed == wantWrites && s.failed == wantFailed;
+  printf("%-42s %d writes (flash %d), %d failed, expected %d / %d%s\n", what, writes, flashed, s.failed, wantWrites,
+         wantFailed, ok ? "" : "  <- wrong");
+  failed += !ok;
+}
+
+}  // namespace
+
+int checkEEParams() {
+  failed = 0;
+  // The registry fills VirtAddVarTab (NB_OF_VAR = EE_PARAMS_END entries) without holes or duplicates
+  int uses[EE_PARAMS_END] = {1};              // index 0: FLASH_WRITE_KEY
+  for (int i : regIndex) uses[i]++;
+  bool dense = true;
+  for (int n : uses) dense &= n == 1;
+  printf("registry: %zu parameters, EEPROM indices 1..%d %s\n", sizeof(regIndex) / sizeof(regIndex[0]),
+         EE_PARAMS_END - 1, dense ? "each used once" : "with holes or duplicates  <- wrong");
+  failed += !dense;
+
+  EEStore s = boot();
+  save(s, "empty EEPROM: key and all parameters", 5, 0);
+  save(s, "nothing changed", 0, 0);
+  iMax = 20 << 4; inTyp = 2;
+  save(s, "two parameters changed", 2, 0);
+  inTyp = 3; inTyp = 2;
+  save(s, "changed and changed back", 0, 0);
+
+  s = boot();
+  bool loaded = iMax == 20 << 4 && iMaxR == 20 << 4 && inTyp == 2 && s.keySynced;
+  printf("after a reset: I_MOT_MAX %d (right %d), IN1_TYP %d loaded%s\n", iMax >> 4, iMaxR >> 4, inTyp,
+         loaded ? "" : "  <- wrong");
+  failed += !loaded;
+  save(s, "after a reset, nothing changed", 0, 0);
+
+  nMax = 800 << 4;
+  flashFail = true;
+  save(s, "write fails", 0, 1);
+  save(s, "retried on the next save", 1, 0);
+
+  flash.erase(1004);                          // parameter added after the EEPROM was written
+  s = boot();
+  save(s, "parameter missing in the EEPROM", 1, 0);
+
+  flash.clear();
+  flashFail = true;
+  s = boot();
+  save(s, "key write fails", 4, 1);
+  save(s, "key retried", 1, 0);
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,77 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Transpotter follow controller (Src/follow.c) against the same PD law and filters in floating point, on a keeper
+// walking at a varying distance and angle with ADC noise on the gametrak inputs.
+
+#include "hostcheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+namespace {
+
+struct FollowRef {
+  double kp, kd, aD, aCmd, rotP, rate;
+  double errPrev = 0, der = 0, cmdL = 0, cmdR = 0;
+
+  explicit FollowRef(const Follow &f)
+      : kp(f.kp / 16384.0), kd(f.kd / 65536.0), aD(f.dFilt / 65536.0), aCmd(f.cmdFilt / 65536.0),
+        rotP(f.rotP / 16384.0), rate(f.rate) {}
+
+  void step(double err, double steering) {
+    der     += aD * (std::clamp((err - errPrev) * rate, -32000.0, 32000.0) - der);
+    errPrev  = err;
+    double follow = kp * err + kd * der;
+    double rot    = steering * std::max(std::fabs(err), 50.0) * rotP;
+    cmdL    += aCmd * (-std::clamp(follow + rot, -850.0, 850.0) - cmdL);
+    cmdR    += aCmd * (-std::clamp(follow - rot, -850.0, 850.0) - cmdR);
+  }
+};
+
+}  // namespace
+
+int checkFollow() {
+  const double tol = 3;           // [cmd] of 850: truncation of the fixed-point products and filters
+  Follow f;
+  followInit(&f);
+  FollowRef ref(f);
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> noise(-4, 4);
+  const int distanceSet = 1345;   // [ADC counts] 1 m
+  double maxErr = 0, maxCmd = 0;
+  for (int k = 0; k < 60 * f.rate; k++) {
+    double t = (double)k / f.rate;
+    // Keeper speeds up and slows down around the setpoint, turns left and right, stops now and then
+    int distanceRaw = (int)(distanceSet + 180 + 300 * std::sin(0.7 * t) + 120 * std::sin(2.3 * t)) + noise(rng);
+    int steerRaw    = (int)(2048 + 1200 * std::sin(0.4 * t)) + noise(rng);
+    int distance    = std::clamp(distanceRaw - 180, 0, 4095);
+    int16_t steering = (int16_t)((steerRaw - 2048) * 8);
+    int16_t cmdL, cmdR;
+    followStep(&f, distance - distanceSet, steering, &cmdL, &cmdR);
+    ref.step(distance - distanceSet, steering / 16384.0);
+    maxErr = std::max({maxErr, std::fabs(cmdL - ref.cmdL), std::fabs(cmdR - ref.cmdR)});
+    maxCmd = std::max({maxCmd, std::fabs(ref.cmdL), std::fabs(ref.cmdR)});
+  }
+  printf("60 s at %d Hz: commands up to %.0f, largest deviation from the floating point law %.2f (limit %.0f)\n",
+         f.rate, maxCmd, maxErr, tol);
+  return maxErr <= tol ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Host checks of the HAL-free firmware modules:
+//   hostcheck boot                 serial bootloader on a simulated flash: updates, compressed and delta, rollback
+//   hostcheck dbgfmt               debug formatter against printf, format throughput
+//   hostcheck eeparams             EEPROM parameter store: flash writes per save on a simulated EEPROM
+//   hostcheck follow               transpotter follow controller against the same law in floating point
+//   hostcheck multiboard           board link timeout with a master and a slave over a simulated cable
+//   hostcheck ui                   power button and beeper in a simulated main loop, loop deadline
+//   hostcheck watchdog             watchdog task deadlines on a simulated time line
+//   hostcheck all                  all of the above
+
+#include "hostcheck.h"
+
+#include <cstdio>
+#include <cstring>
+
+struct Check {
+  const char *name;
+  int (*run)();
+};
+
+static const Check checks[] = {
+  {"boot",       checkBoot},
+  {"dbgfmt",     checkDbgFmt},
+  {"eeparams",   checkEEParams},
+  {"follow",     checkFollow},
+  {"multiboard", checkMultiBoard},
+  {"ui",         checkUi},
+  {"watchdog",   checkWatchdog},
+};
+
+int main(int argc, char **argv) {
+  if (argc == 2) {
+    int failed = 0, found = 0;
+    for (const Check &c : checks) {
+      if (!strcmp(argv[1], "all") || !strcmp(argv[1], c.name)) {
+        printf("== %s\n", c.name);
+        int rc = c.run();
+        printf("%s: %s\n", c.name, rc ? "FAIL" : "PASS");
+        failed += rc != 0;
+        found++;
+      }
+    }
+    if (found) return failed ? 1 : 0;
+  }
+  fprintf(stderr, "usage: hostcheck all");
+  for (const Check &c : checks) fprintf(stderr, " | %s", c.name);
+  fprintf(stderr, "\n");
+  return 2;
+}
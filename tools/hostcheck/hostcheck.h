@@ -0,0 +1,45 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Host checks of the HAL-free firmware modules (Src/follow.c, Src/watchdog.c, Src/dbgfmt.c, Src/eeparams.c, Src/multiboard.c, Src/ui.c, ...)
+// and of the bootloader core (Bootloader/bootcore.c). Each check prints what it measured and
+// returns 0 on success.
+
+#ifndef HOSTCHECK_H
+#define HOSTCHECK_H
+
+extern "C" {
+#include "bootcore.h"
+#include "dbgfmt.h"
+#include "eeparams.h"
+#include "follow.h"
+#include "multiboard.h"
+#include "ui.h"
+#include "watchdog.h"
+}
+
+int checkBoot();
+int checkDbgFmt();
+int checkEEParams();
+int checkFollow();
+int checkMultiBoard();
+int checkUi();
+int checkWatchdog();
+
+#endif
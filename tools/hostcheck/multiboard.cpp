@@ -0,0 +1,122 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Board link (Src/multiboard.c) with a master and a slave instance over a simulated cable, 5 ms main loop cycles.
+// The motors of a board are gated like handleTimeout() does: own input timeout or link lost. The slave has no input of
+// its own (no CONTROL_SERIAL / SIDEBOARD): it has to stop when the master frames stop and drive again when they return.
+
+#include "hostcheck.h"
+
+#include <cstdio>
+
+namespace {
+
+const uint16_t timeout = 20;          // MULTI_BOARD_TIMEOUT: 100 ms in 5 ms cycles
+
+struct Board {
+  LinkState link;
+  uint8_t   inputTimeout = 0;         // own input timeout (serial, ADC, ...): none on the slave
+  uint8_t   drive        = 0;         // motors not gated
+
+  Board() { linkInit(&link, timeout); }
+  void step() {
+    uint8_t lost = linkTimeoutStep(&link);
+    drive = !inputTimeout && !lost;
+  }
+};
+
+struct Cable {                        // one frame per cycle and direction
+  bool cmdCut = false, fbCut = false, corrupt = false;
+};
+
+int failed;
+
+void expect(const char *what, int cycle, const Board &master, const Board &slave, int wantMaster, int wantSlave) {
+  bool ok = master.drive == wantMaster && slave.drive == wantSlave;
+  printf("%-46s cycle %4d: master %s, slave %s%s\n", what, cycle, master.drive ? "drives" : "stops ",
+         slave.drive ? "drives" : "stops ", ok ? "" : "  <- wrong");
+  failed += !ok;
+}
+
+}  // namespace
+
+int checkMultiBoard() {
+  failed = 0;
+  Board master, slave;
+  Cable cable;
+  uint16_t tick = 0;
+  int      cycle = 0;
+  auto run = [&](int cycles) {
+    for (int k = 0; k < cycles; k++, cycle++) {
+      SerialLinkCommand cmd = {};     // multiBoardSend() of the master
+      cmd.cmd1 = 300;
+      cmd.tick = ++tick;
+      linkSeal(&cmd, sizeof(cmd));
+      if (cable.corrupt) cmd.cmd1 ^= 1;
+      if (!cable.cmdCut) linkRxValid(&slave.link, &cmd, sizeof(cmd));
+
+      SerialLinkFeedback fb = {};     // multiBoardSend() of the slave
+      fb.tick = tick;
+      linkSeal(&fb, sizeof(fb));
+      if (!cable.fbCut) linkRxValid(&master.link, &fb, sizeof(fb));
+
+      master.step();                  // handleTimeout() of both boards
+      slave.step();
+    }
+  };
+
+  run(1);
+  expect("first frames", cycle, master, slave, 1, 1);
+  run(100);
+  expect("link up", cycle, master, slave, 1, 1);
+
+  cable.cmdCut = true;                // master -> slave wire cut
+  run(timeout - 1);
+  expect("commands lost, within the timeout", cycle, master, slave, 1, 1);
+  run(1);
+  expect("commands lost for the timeout", cycle, master, slave, 1, 0);
+  run(200);
+  expect("commands lost for 1 s", cycle, master, slave, 1, 0);
+  cable.cmdCut = false;
+  run(1);
+  expect("commands back: the slave drives again", cycle, master, slave, 1, 1);
+
+  cable.corrupt = true;               // checksum errors count as lost frames
+  run(timeout);
+  expect("corrupted commands for the timeout", cycle, master, slave, 1, 0);
+  cable.corrupt = false;
+  run(1);
+  expect("valid commands again", cycle, master, slave, 1, 1);
+
+  cable.fbCut = true;                 // slave -> master wire cut
+  run(timeout);
+  expect("feedback lost for the timeout", cycle, master, slave, 0, 1);
+  cable.fbCut = false;
+  run(1);
+  expect("feedback back: the master drives again", cycle, master, slave, 1, 1);
+
+  master.inputTimeout = 1;            // host command timeout on the master: only the master stops itself, the
+  run(50);                            // slave follows the master commands (0 in the safe state)
+  expect("master input timeout", cycle, master, slave, 0, 1);
+  master.inputTimeout = 0;
+  run(1);
+  expect("master input back", cycle, master, slave, 1, 1);
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Power button and beeper (Src/ui.c) in a simulated main loop of 5 ms, with the actions poweroffPressCheck() and
+// poweroff() take. Every cycle checks in to the watchdog supervision (Src/watchdog.c): while the tones play, the
+// button is held and the poweroff melody runs, no loop cycle may take longer than the run deadline. The press
+// events have to come at the times of the blocking code they replace.
+
+#include "hostcheck.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+const uint32_t loopMs     = 5;                      // DELAY_IN_MAIN_LOOP
+const uint32_t deadline[WDG_TASKS] = {50 * UI_TICKS_MS, 0xFFFFFFFFu};   // WDG_DEADLINE_RUN, no input task
+
+struct Event {
+  uint32_t ms;
+  uint8_t  val;                                     // BUTTON_EVT_, buzzer frequency
+};
+
+struct Loop {
+  BeepQueue beeps   = {};
+  Button    button;
+  WdgSup    wdg;
+  uint32_t  now     = 0;                            // [ticks]
+  uint32_t  cycles  = 0;
+  double    maxStep = 0;                            // [ms] longest cycle, wall clock of the ui functions included
+  uint8_t   buzzer  = 0;                            // buzzerFreq
+  uint8_t   calib   = 0;                            // calibration running
+  uint8_t   poweroff = 0;                           // poweroff sequence running
+  uint32_t  latchMs = 0;                            // time the power latch would be released, 0: not yet
+  std::vector<Event> events;
+  std::vector<Event> tones;                         // buzzer changes: time, frequency
+
+  Loop() {
+    buttonInit(&button);
+    wdgSupInit(&wdg, now);
+  }
+  void tone(uint8_t freq, uint16_t ms) { beepQueuePush(&beeps, freq, ms); }
+
+  // One main loop cycle with the button level
+  void step(uint8_t pressed) {
+    auto t0 = std::chrono::steady_clock::now();
+    uint8_t evt = buttonStep(&button, pressed, calib, now);
+    switch (evt) {                                  // as poweroffPressCheck()
+      case BUTTON_EVT_CONFIRM: calib = 0;                   break;
+      case BUTTON_EVT_HELD:    tone(5, 100);                break;
+      case BUTTON_EVT_SHORT:                                // poweroff(): melody, then the latch
+        poweroff = 1;
+        for (int i = 0; i < 8; i++) tone((uint8_t)i, 100);
+        break;
+    }
+    if (evt != BUTTON_EVT_NONE) events.push_back({now / UI_TICKS_MS, evt});
+    uint8_t freq;
+    if (beepQueueStep(&beeps, now, &freq)) {        // beepUpdate()
+      buzzer = freq;
+      tones.push_back({now / UI_TICKS_MS, freq});
+    }
+    if (poweroff && !latchMs && beepQueueIdle(&beeps)) {   // poweroffUpdate()
+      latchMs = now / UI_TICKS_MS;
+    }
+    double stepMs = loopMs + std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    maxStep = std::max(maxStep, stepMs);
+    now    += (uint32_t)(stepMs * UI_TICKS_MS);
+    wdgSupCheckIn(&wdg, WDG_TASK_LOOP, now);
+    wdgSupStep(&wdg, now, deadline);
+    cycles++;
+  }
+  void run(uint32_t ms, uint8_t pressed) {
+    for (uint32_t end = now / UI_TICKS_MS + ms; now / UI_TICKS_MS < end;) step(pressed);
+  }
+};
+
+const char *evtName[] = {"none", "confirm", "held", "short", "released", "long", "double"};
+
+int failed;
+
+// The event 'evt' was reported once, 'ms' after 'from' within one loop cycle
+void expect(const Loop &l, uint32_t from, uint8_t evt, uint32_t ms) {
+  int n = 0;
+  uint32_t at = 0;
+  for (const Event &e : l.events) {
+    if (e.ms >= from && e.val == evt) {
+      n++;
+      at = e.ms;
+    }
+  }
+  bool ok = n == 1 && at >= from + ms && at <= from + ms + 2 * loopMs;
+  printf("%-10s expected after %5u ms, got %d event%s after %5u ms%s\n", evtName[evt], ms, n, n == 1 ? " " : "s",
+         at - from, ok ? "" : "  <- wrong");
+  failed += !ok;
+}
+
+}  // namespace
+
+int checkUi() {
+  failed = 0;
+  Loop l;
+
+  // Power on melody: 9 tones of 100 ms, the loop keeps running
+  for (int i = 8; i >= 0; i--) l.tone((uint8_t)i, 100);
+  l.run(1000, 0);
+  bool melody = l.tones.size() == 10 && l.tones.back().val == 0 && beepQueueIdle(&l.beeps);
+  for (size_t i = 0; melody && i + 1 < l.tones.size(); i++) {
+    uint32_t len = l.tones[i + 1].ms - l.tones[i].ms;
+    melody = l.tones[i].val == 8 - i && len >= 100 && len <= 100 + loopMs;
+  }
+  printf("power on melody: %zu buzzer changes, 100 ms each: %s\n", l.tones.size(), melody ? "yes" : "no");
+  failed += !melody;
+
+  // Bounce below the debounce time: nothing
+  l.run(40, 1);
+  l.run(1000, 0);
+  printf("bounce     %zu events%s\n", l.events.size(), l.events.empty() ? "" : "  <- wrong");
+  failed += !l.events.empty();
+
+  // Long press, no second press: beep at 5 s, calibrate the limits 1 s after the release
+  uint32_t t = l.now / UI_TICKS_MS;
+  l.run(6000, 1);
+  l.run(2000, 0);
+  expect(l, t, BUTTON_EVT_HELD, 5000);
+  expect(l, t, BUTTON_EVT_RELEASED, 6000);
+  expect(l, t, BUTTON_EVT_LONG, 7000);
+
+  // Long press, second press within 1 s: adjust the limits on its release
+  t = l.now / UI_TICKS_MS;
+  l.run(5500, 1);
+  l.run(500, 0);
+  l.run(1500, 1);
+  l.run(500, 0);
+  expect(l, t, BUTTON_EVT_RELEASED, 5500);
+  expect(l, t, BUTTON_EVT_DOUBLE, 7500);
+
+  // A press while a calibration runs confirms it, held as long as it is
+  l.calib = 1;
+  t = l.now / UI_TICKS_MS;
+  l.run(7000, 1);
+  l.run(500, 0);
+  expect(l, t, BUTTON_EVT_CONFIRM, 0);
+  printf("calibration %s\n", l.calib ? "still running  <- wrong" : "confirmed");
+  failed += l.calib;
+
+  // Short press: poweroff melody of 8 tones, the latch is released after it
+  t = l.now / UI_TICKS_MS;
+  l.run(300, 1);
+  l.run(1500, 0);
+  expect(l, t, BUTTON_EVT_SHORT, 300);
+  uint32_t latch = l.latchMs - t;
+  bool latchOk = l.latchMs && latch >= 300 + 800 && latch <= 300 + 800 + 3 * loopMs;
+  printf("power latch released %u ms after the press%s\n", latch, latchOk ? "" : "  <- wrong");
+  failed += !latchOk;
+
+  bool deadlineOk = l.wdg.miss == 0 && l.maxStep <= deadline[WDG_TASK_LOOP] / UI_TICKS_MS;
+  printf("%u loop cycles, longest %.3f ms, deadline %u ms: %s\n", l.cycles, l.maxStep,
+         deadline[WDG_TASK_LOOP] / UI_TICKS_MS, deadlineOk ? "met" : "MISSED");
+  failed += !deadlineOk;
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,80 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Watchdog supervision (Src/watchdog.c) on a simulated 16 kHz time line: per-task deadlines, the deadline boundary,
+// latching of a miss and the wrap-around of the time base.
+
+#include "hostcheck.h"
+
+#include <cstdio>
+
+namespace {
+
+const uint32_t deadline[WDG_TASKS] = {50 * 16, 1000 * 16};   // loop 50 ms, input 1 s in 16 kHz ticks
+
+// Runs 'ticks' of time from 'now', the loop checks in every 'loopPeriod' ticks and the input every 'inputPeriod'
+// ticks (0: never). Returns the miss bits after the last step
+uint8_t run(WdgSup &w, uint32_t &now, uint32_t ticks, uint32_t loopPeriod, uint32_t inputPeriod) {
+  uint8_t miss = 0;
+  for (uint32_t k = 0; k < ticks; k++, now++) {
+    if (loopPeriod  && now % loopPeriod  == 0) wdgSupCheckIn(&w, WDG_TASK_LOOP,  now);
+    if (inputPeriod && now % inputPeriod == 0) wdgSupCheckIn(&w, WDG_TASK_INPUT, now);
+    miss = wdgSupStep(&w, now, deadline);
+  }
+  return miss;
+}
+
+int expect(const char *name, uint8_t miss, uint8_t want) {
+  printf("%-44s miss 0x%02X (expected 0x%02X)\n", name, miss, want);
+  return miss == want ? 0 : 1;
+}
+
+}  // namespace
+
+int checkWatchdog() {
+  int failed = 0;
+  WdgSup w;
+  uint32_t now = 0;
+
+  wdgSupInit(&w, now);
+  failed += expect("all tasks check in", run(w, now, 10 * 16000, 5 * 16, 20 * 16), 0);
+
+  wdgSupInit(&w, now);
+  failed += expect("input stops, loop runs: 0.9 s", run(w, now, 900 * 16, 5 * 16, 0), 0);
+  failed += expect("input stops, loop runs: 1.1 s", run(w, now, 200 * 16, 5 * 16, 0), 1 << WDG_TASK_INPUT);
+  failed += expect("input resumes: miss stays latched", run(w, now, 16000, 5 * 16, 20 * 16), 1 << WDG_TASK_INPUT);
+
+  wdgSupInit(&w, now);
+  failed += expect("loop stalls", run(w, now, 100 * 16, 0, 20 * 16), 1 << WDG_TASK_LOOP);
+
+  // A check-in exactly one deadline ago is in time, one tick later is a miss
+  wdgSupInit(&w, now);
+  wdgSupCheckIn(&w, WDG_TASK_INPUT, now + deadline[WDG_TASK_LOOP]);
+  failed += expect("loop at its deadline", wdgSupStep(&w, now + deadline[WDG_TASK_LOOP], deadline), 0);
+  failed += expect("loop one tick past its deadline", wdgSupStep(&w, now + deadline[WDG_TASK_LOOP] + 1, deadline),
+                   1 << WDG_TASK_LOOP);
+
+  // The 32 bit time base wraps after 74 hours at 16 kHz
+  now = 0xFFFFFFFFu - 16000;
+  wdgSupInit(&w, now);
+  failed += expect("all tasks check in over the wrap-around", run(w, now, 2 * 16000, 5 * 16, 20 * 16), 0);
+  failed += expect("input stops after the wrap-around", run(w, now, 2 * 16000, 5 * 16, 0), 1 << WDG_TASK_INPUT);
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,231 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bus.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace hoverserial {
+
+/* =========================== Bus Master =========================== */
+
+static Layout busLayout(Layout layout) {
+  layout.bus = true;
+  return layout;
+}
+
+BusMaster::BusMaster(Layout layout, int baud, const std::vector<uint8_t> &nodes, uint64_t replyTimeout,
+                     uint64_t cyclePeriod)
+    : layout_(busLayout(layout)), parser_(layout_), charTime_(10e9 / baud), nodes_(nodes),
+      replyTimeout_(replyTimeout), cyclePeriod_(cyclePeriod) {
+  for (uint8_t id : nodes_) {
+    if (id == BUS_BROADCAST || id > BUS_NODES) {
+      throw std::system_error(EINVAL, std::generic_category(), "bus node id out of range");
+    }
+  }
+  if (!replyTimeout_) {
+    replyTimeout_ = frameTime(layout_.commandSize() + 1 + layout_.feedbackSize()) + 3000000;
+  }
+}
+
+void BusMaster::setCommand(uint8_t node, int16_t steer, int16_t speed, uint16_t driveMode) {
+  if (node != BUS_BROADCAST && node <= BUS_NODES) {
+    commands_[node] = {steer, speed, driveMode};
+  }
+}
+
+void BusMaster::broadcast(int16_t steer, int16_t speed, uint16_t driveMode) {
+  commands_[BUS_BROADCAST] = {steer, speed, driveMode};
+  broadcastPending_        = true;
+}
+
+size_t BusMaster::next(uint64_t now, uint8_t *out) {
+  if (now < deadline_) {
+    return 0;
+  }
+  if (waiting_ >= 0) {
+    nodeStats_[waiting_].timeouts++;
+    waiting_ = -1;
+    parser_.reset();                            // drop a partial reply
+  }
+  if (nodes_.empty()) {
+    return 0;
+  }
+  uint16_t address;
+  if (broadcastPending_) {
+    address           = BUS_BROADCAST;
+    broadcastPending_ = false;
+    stats_.broadcasts++;
+  } else {
+    if (index_ == 0 && cyclePeriod_) {
+      if (cycleStart_ && now < cycleStart_ + cyclePeriod_) {
+        deadline_ = cycleStart_ + cyclePeriod_;
+        return 0;
+      }
+      cycleStart_ = (cycleStart_ && now < cycleStart_ + 2 * cyclePeriod_) ? cycleStart_ + cyclePeriod_ : now;
+    }
+    address  = nodes_[index_];
+    waiting_ = address;
+    pollTime_ = now;
+    nodeStats_[address].polls++;
+    if (++index_ == nodes_.size()) {
+      index_ = 0;
+      stats_.cycles++;
+    }
+  }
+  const Command &cmd = commands_[address];
+  size_t len = encodeCommand(layout_, cmd.steer, cmd.speed, cmd.driveMode, out, 0, address);
+  // Gap after a broadcast, so the nodes do not take it and the next poll as one burst despite the USB latency jitter
+  deadline_ = now + ((address == BUS_BROADCAST) ? frameTime(len) + BUS_BROADCAST_GAP : replyTimeout_);
+  if (!stats_.startTime) {
+    stats_.startTime = now;
+  }
+  stats_.lastTime  = now;
+  stats_.lineTime += frameTime(len);
+  return len;
+}
+
+void BusMaster::receive(const uint8_t *data, size_t len, uint64_t now, const FeedbackHandler &handler) {
+  uint64_t errors = parser_.stats().checksumErrors;
+  parser_.parse(data, len, now, [&](const Feedback &fb) {
+    stats_.lineTime += frameTime(layout_.feedbackSize());
+    stats_.lastTime  = now;
+    if (fb.address == BUS_BROADCAST || fb.address > BUS_NODES) {
+      return;
+    }
+    BusNodeStats &ns = nodeStats_[fb.address];
+    if ((int)fb.address != waiting_) {
+      ns.late++;
+      return;
+    }
+    uint64_t rtt = now - pollTime_;
+    ns.replies++;
+    ns.rttSum += rtt;
+    ns.rttMax  = std::max(ns.rttMax, rtt);
+    ns.latest  = fb;
+    waiting_   = -1;
+    deadline_  = now;                           // bus free: poll the next node right away
+    if (handler) {
+      handler(fb);
+    }
+  });
+  if (parser_.stats().checksumErrors != errors && waiting_ >= 0) {
+    nodeStats_[waiting_].errors += parser_.stats().checksumErrors - errors;
+  }
+}
+
+
+/* =========================== Bus Driver =========================== */
+
+BusDriver::BusDriver(const std::string &path, int baud, Layout layout, const std::vector<uint8_t> &nodes,
+                     uint64_t replyTimeout, uint64_t cyclePeriod)
+    : master_(layout, baud, nodes, replyTimeout, cyclePeriod) {
+  port_.open(path, baud);
+  epoll_.reset(epoll_create1(EPOLL_CLOEXEC));
+  timer_.reset(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC));
+  if (epoll_.get() < 0 || timer_.get() < 0) {
+    throw std::system_error(errno, std::generic_category(), "epoll/timerfd");
+  }
+  epoll_event ev = epoll_event();
+  ev.events  = EPOLLIN;
+  ev.data.fd = port_.fd();
+  bool ok = epoll_ctl(epoll_.get(), EPOLL_CTL_ADD, port_.fd(), &ev) == 0;
+  ev.data.fd = timer_.get();
+  ok = ok && epoll_ctl(epoll_.get(), EPOLL_CTL_ADD, timer_.get(), &ev) == 0;
+  if (!ok) {
+    throw std::system_error(errno, std::generic_category(), "epoll");
+  }
+}
+
+ /*
+ * Write the next frame if it is due, then arm the timer on the new deadline. While a frame is partly written the
+ * schedule waits for it (EPOLLOUT, no timer): the nodes would take the rest glued to the next frame as garbage.
+ */
+void BusDriver::service() {
+  if (txPos_ == txLen_) {
+    txLen_ = master_.next(monotonicNs(), tx_);
+    txPos_ = 0;
+    if (txLen_) {
+      writeTx();
+      if (txLen_) {
+        master_.frameStats().commandsSent++;
+      } else {
+        master_.frameStats().commandsDropped++;   // Tx buffer full: the node times out, the schedule moves on
+      }
+    }
+  }
+  uint64_t deadline = (txPos_ < txLen_) ? 0 : std::max<uint64_t>(master_.deadline(), 1);
+  itimerspec its = {{0, 0}, {(time_t)(deadline / 1000000000u), (long)(deadline % 1000000000u)}};
+  timerfd_settime(timer_.get(), TFD_TIMER_ABSTIME, &its, nullptr);
+}
+
+// Write the rest of the frame, as Driver::writeTx(): a frame of which nothing was written is dropped whole (txLen_ = 0)
+void BusDriver::writeTx() {
+  ssize_t n = write(port_.fd(), &tx_[txPos_], txLen_ - txPos_);
+  if (n > 0) {
+    txPos_ += (size_t)n;
+  } else if (txPos_ == 0) {
+    txLen_ = 0;
+  }
+  bool pending = txPos_ < txLen_;
+  if (pending != txWait_) {
+    epoll_event ev = epoll_event();
+    ev.events  = pending ? (uint32_t)(EPOLLIN | EPOLLOUT) : (uint32_t)EPOLLIN;
+    ev.data.fd = port_.fd();
+    epoll_ctl(epoll_.get(), EPOLL_CTL_MOD, port_.fd(), &ev);
+    txWait_ = pending;
+  }
+}
+
+int BusDriver::poll(int timeoutMs) {
+  uint64_t replies = master_.frameStats().frames;
+  service();
+  epoll_event events[2];
+  int n = epoll_wait(epoll_.get(), events, 2, timeoutMs);
+  if (n < 0) {
+    return (errno == EINTR) ? 0 : -1;
+  }
+  for (int i = 0; i < n; i++) {
+    if (events[i].data.fd == timer_.get()) {
+      uint64_t expirations;                     // the deadline passed, service() below sends
+      ssize_t  ignored = read(timer_.get(), &expirations, sizeof(expirations));
+      (void)ignored;
+    } else if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+      return -1;
+    } else {
+      if (events[i].events & EPOLLOUT) {
+        writeTx();
+      }
+      uint8_t buf[4096];
+      ssize_t r;
+      while ((r = read(port_.fd(), buf, sizeof(buf))) > 0) {
+        master_.receive(buf, (size_t)r, monotonicNs(), handler_);
+      }
+    }
+  }
+  service();
+  return (int)(master_.frameStats().frames - replies);
+}
+
+}  // namespace hoverserial
@@ -0,0 +1,141 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Host side of the addressed multi-drop bus (SERIAL_BUS in config.h): up to 31 boards on one half duplex RS-485 bus
+// behind a single host port. The host is the only master: it polls the nodes in turn with a command addressed to
+// one node, which answers right away with its feedback frame (address after the start word). Only after the reply,
+// or its timeout, the next poll goes out, so two transmitters are never active at once. Broadcast commands
+// (address 0) reach all nodes and are never answered.
+// Use an adapter that disables its receiver while transmitting (no local echo) and, for FTDI, low_latency mode.
+
+#ifndef HOVERSERIAL_BUS_H
+#define HOVERSERIAL_BUS_H
+
+#include "hoverserial.h"
+
+#include <vector>
+
+namespace hoverserial {
+
+constexpr uint16_t BUS_BROADCAST     = 0;         // SERIAL_BUS_BROADCAST
+constexpr uint16_t BUS_NODES         = 31;        // SERIAL_BUS_NODES
+constexpr uint64_t BUS_BROADCAST_GAP = 1000000;   // [ns] idle time after a broadcast
+
+struct BusNodeStats {
+  uint64_t  polls    = 0;
+  uint64_t  replies  = 0;
+  uint64_t  timeouts = 0;                     // no reply within the reply timeout
+  uint64_t  errors   = 0;                     // checksum errors while polling this node
+  uint64_t  late     = 0;                     // replies after their timeout
+  uint64_t  rttSum   = 0;                     // [ns] poll write to reply read
+  uint64_t  rttMax   = 0;
+  Feedback  latest   = Feedback();
+};
+
+struct BusStats {
+  uint64_t  cycles     = 0;                   // polling rounds over all nodes
+  uint64_t  broadcasts = 0;
+  uint64_t  lineTime   = 0;                   // [ns] line occupied by frames, both directions
+  uint64_t  startTime  = 0;                   // [ns] first frame sent
+  uint64_t  lastTime   = 0;                   // [ns] last frame sent or received
+  double utilization() const { return lastTime > startTime ? (double)lineTime / (lastTime - startTime) : 0; }
+};
+
+ /*
+ * Polling schedule, without I/O: next() gives the frame to write, receive() takes what was read.
+ * A round polls every node once; with a cycle period the rounds start at that rate, else back to back.
+ */
+class BusMaster {
+public:
+  // replyTimeout 0: both frame times plus 3 ms for the USB adapter
+  BusMaster(Layout layout, int baud, const std::vector<uint8_t> &nodes, uint64_t replyTimeout = 0,
+            uint64_t cyclePeriod = 0);
+
+  void     setCommand(uint8_t node, int16_t steer, int16_t speed, uint16_t driveMode = 0);
+  void     broadcast(int16_t steer, int16_t speed, uint16_t driveMode = 0);  // sent once, before the next poll
+  size_t   next(uint64_t now, uint8_t *out);  // frame to write at now [ns], 0: nothing before deadline()
+  uint64_t deadline() const { return deadline_; }
+  void     receive(const uint8_t *data, size_t len, uint64_t now, const FeedbackHandler &handler);
+
+  const std::vector<uint8_t> &nodes() const { return nodes_; }
+  const BusNodeStats &node(uint8_t id) const { return nodeStats_[id]; }
+  const BusStats &stats() const { return stats_; }
+  Stats &frameStats() { return parser_.stats(); }
+  uint64_t frameTime(size_t bytes) const { return (uint64_t)(bytes * charTime_); }
+
+private:
+  struct Command {
+    int16_t   steer;
+    int16_t   speed;
+    uint16_t  driveMode;
+  };
+
+  Layout               layout_;
+  FrameParser          parser_;
+  double               charTime_;             // [ns] 8N1
+  std::vector<uint8_t> nodes_;
+  uint64_t             replyTimeout_;
+  uint64_t             cyclePeriod_;
+  Command              commands_[BUS_NODES + 1] = {};   // [0]: pending broadcast
+  bool                 broadcastPending_ = false;
+  size_t               index_ = 0;            // next node in nodes_
+  int                  waiting_ = -1;         // node polled, reply pending
+  uint64_t             pollTime_ = 0;
+  uint64_t             deadline_ = 0;
+  uint64_t             cycleStart_ = 0;
+  BusNodeStats         nodeStats_[BUS_NODES + 1];
+  BusStats             stats_;
+};
+
+ /*
+ * epoll driven bus master on a serial port: writes each poll as soon as the schedule allows, with a timerfd
+ * on the schedule deadline. Single threaded like Driver.
+ */
+class BusDriver {
+public:
+  BusDriver(const std::string &path, int baud, Layout layout, const std::vector<uint8_t> &nodes,
+            uint64_t replyTimeout = 0, uint64_t cyclePeriod = 0);
+  BusDriver(const BusDriver &) = delete;
+  BusDriver &operator=(const BusDriver &) = delete;
+
+  BusMaster &master() { return master_; }
+  void onFeedback(FeedbackHandler handler) { handler_ = std::move(handler); }
+  int  poll(int timeoutMs);                   // returns the replies received or -1
+  void run() { while (running_ && poll(100) >= 0) {} }
+  void stop() { running_ = false; }
+
+private:
+  void service();
+  void writeTx();
+
+  SerialPort      port_;
+  BusMaster       master_;
+  FeedbackHandler handler_;
+  FileDesc        epoll_;
+  FileDesc        timer_;
+  uint8_t         tx_[16];                      // frame being written
+  size_t          txLen_ = 0;
+  size_t          txPos_ = 0;                   // bytes of tx_ on the wire
+  bool            txWait_ = false;              // EPOLLOUT armed for the rest of tx_
+  volatile bool   running_ = true;
+};
+
+}  // namespace hoverserial
+
+#endif
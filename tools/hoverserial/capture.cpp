@@ -0,0 +1,255 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "capture.h"
+
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace hoverserial {
+
+static const size_t HEADER_SIZE       = 32;
+static const size_t BLOCK_HEADER_SIZE = 32;
+
+static void wr16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static void wr32(uint8_t *p, uint32_t v) { wr16(p, (uint16_t)v); wr16(p + 2, (uint16_t)(v >> 16)); }
+static void wr64(uint8_t *p, uint64_t v) { wr32(p, (uint32_t)v); wr32(p + 4, (uint32_t)(v >> 32)); }
+static uint16_t rd16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t rd32(const uint8_t *p) { return rd16(p) | ((uint32_t)rd16(p + 2) << 16); }
+static uint64_t rd64(const uint8_t *p) { return rd32(p) | ((uint64_t)rd32(p + 4) << 32); }
+
+// Field name, signedness and member for each SerialFeedback word after the start word (main.c)
+struct FieldDef {
+  const char *name;
+  uint8_t     isSigned;
+  size_t      offset;
+  int         group;                            // 0: always, 1: driveMode, 2: multiBoard, 3: timestamp, 4: bus
+};
+#define FIELD(name, isSigned, group) {#name, isSigned, offsetof(Feedback, name), group}
+static const FieldDef fieldDefs[] = {
+  FIELD(address,         0, 4),
+  FIELD(leftSpeed,       1, 0),
+  FIELD(rightSpeed,      1, 0),
+  FIELD(leftTicks,       0, 0),
+  FIELD(rightTicks,      0, 0),
+  FIELD(batVoltage,      1, 0),
+  FIELD(boardTemp,       1, 0),
+  FIELD(driveMode,       0, 1),
+  FIELD(tick,            0, 2),
+  FIELD(slaveLeftSpeed,  1, 2),
+  FIELD(slaveRightSpeed, 1, 2),
+  FIELD(slaveLeftTicks,  0, 2),
+  FIELD(slaveRightTicks, 0, 2),
+  FIELD(slaveBatVoltage, 1, 2),
+  FIELD(slaveBoardTemp,  1, 2),
+  FIELD(slaveTick,       0, 2),
+  {"timeL", 0, offsetof(Feedback, boardTime),     3},   // little endian host
+  {"timeH", 0, offsetof(Feedback, boardTime) + 2, 3},
+  FIELD(syncId,          0, 3),
+  FIELD(syncAge,         0, 3),
+};
+
+constexpr Layout allFields = {true, true, true, true};
+static_assert(2 * (sizeof(fieldDefs) / sizeof(fieldDefs[0]) + 2) == allFields.feedbackSize(),
+              "fieldDefs does not match the feedback frame: one entry per word between start and checksum");
+
+static bool fieldUsed(const FieldDef &def, const Layout &layout) {
+  return def.group == 0 || (def.group == 1 && layout.driveMode) || (def.group == 2 && layout.multiBoard) ||
+         (def.group == 3 && layout.timestamp) || (def.group == 4 && layout.bus);
+}
+
+std::vector<CaptureField> feedbackFields(const Layout &layout) {
+  std::vector<CaptureField> fields;
+  for (const FieldDef &def : fieldDefs) {
+    if (fieldUsed(def, layout)) {
+      CaptureField f = CaptureField();
+      strncpy(f.name, def.name, sizeof(f.name) - 1);
+      f.isSigned = def.isSigned;
+      fields.push_back(f);
+    }
+  }
+  return fields;
+}
+
+
+/* =========================== Capture Writer =========================== */
+
+CaptureWriter::CaptureWriter(const std::string &path, const Layout &layout, uint32_t blockFrames)
+    : layout_(layout), blockFrames_(blockFrames), startMono_(monotonicNs()) {
+  std::vector<CaptureField> fields = feedbackFields(layout);
+  fieldCount_ = fields.size();
+  fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    throw std::system_error(errno, std::generic_category(), path);
+  }
+  timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  std::vector<uint8_t> header(HEADER_SIZE + fields.size() * sizeof(CaptureField));
+  memcpy(&header[0], "HOVCAP\0\0", 8);
+  wr16(&header[8],  CAPTURE_VERSION);
+  wr16(&header[10], (uint16_t)fields.size());
+  wr32(&header[12], blockFrames_);
+  wr64(&header[16], (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec);
+  memcpy(&header[HEADER_SIZE], fields.data(), fields.size() * sizeof(CaptureField));
+  if (write(fd_, header.data(), header.size()) != (ssize_t)header.size()) {
+    throw std::system_error(errno, std::generic_category(), path);
+  }
+  block_.reserve(BLOCK_HEADER_SIZE + blockFrames_ * (8 + 2 * fieldCount_));
+}
+
+CaptureWriter::~CaptureWriter() {
+  flush();
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+void CaptureWriter::append(const Feedback &fb) {
+  uint64_t time = (fb.rxTime > startMono_) ? fb.rxTime - startMono_ : 0;   // frames read before the capture started
+  if (blockCount_ && time - firstTime_ >= BLOCK_FLUSH_TIME) {
+    flush();
+  }
+  if (!blockCount_) {
+    block_.assign(BLOCK_HEADER_SIZE, 0);
+    firstTime_ = time;
+  }
+  size_t pos = block_.size();
+  block_.resize(pos + 8 + 2 * fieldCount_);
+  wr64(&block_[pos], time);
+  pos += 8;
+  for (const FieldDef &def : fieldDefs) {
+    if (fieldUsed(def, layout_)) {
+      uint16_t value;
+      memcpy(&value, (const uint8_t *)&fb + def.offset, sizeof(value));
+      wr16(&block_[pos], value);
+      pos += 2;
+    }
+  }
+  lastTime_ = time;
+  frames_++;
+  if (++blockCount_ >= blockFrames_) {
+    flush();
+  }
+}
+
+void CaptureWriter::flush() {
+  if (!blockCount_) {
+    return;
+  }
+  wr32(&block_[0],  BLOCK_MAGIC);
+  wr32(&block_[4],  blockCount_);
+  wr64(&block_[8],  firstTime_);
+  wr64(&block_[16], lastTime_);
+  if (write(fd_, block_.data(), block_.size()) != (ssize_t)block_.size()) {
+    throw std::system_error(errno, std::generic_category(), "capture write");
+  }
+  blockCount_ = 0;
+}
+
+
+/* =========================== Capture Reader =========================== */
+
+CaptureReader::CaptureReader(const std::string &path) {
+  FileDesc fd(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+  if (fd.get() < 0) {
+    throw std::runtime_error(path + ": " + strerror(errno));
+  }
+  struct stat st;
+  if (fstat(fd.get(), &st) < 0) {
+    throw std::runtime_error(path + ": " + strerror(errno));
+  }
+  size_ = (size_t)st.st_size;
+  if (size_ >= HEADER_SIZE) {
+    void *map = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd.get(), 0);
+    map_ = (map == MAP_FAILED) ? nullptr : (const uint8_t *)map;
+  }
+  if (!map_ || memcmp(map_, "HOVCAP\0\0", 8) || rd16(map_ + 8) != CAPTURE_VERSION) {
+    throw std::runtime_error(path + ": not a capture file or unsupported version");
+  }
+  madvise((void *)map_, size_, MADV_SEQUENTIAL);
+
+  size_t fieldCount = rd16(map_ + 10);
+  startTime_  = rd64(map_ + 16);
+  recordSize_ = 8 + 2 * fieldCount;
+  size_t off  = HEADER_SIZE + fieldCount * sizeof(CaptureField);
+  if (off > size_) {
+    throw std::runtime_error(path + ": header truncated");
+  }
+  fields_.resize(fieldCount);
+  memcpy(fields_.data(), map_ + HEADER_SIZE, fieldCount * sizeof(CaptureField));
+  for (CaptureField &f : fields_) {
+    f.name[sizeof(f.name) - 1] = 0;
+  }
+
+  // Index the blocks from their headers
+  while (off + BLOCK_HEADER_SIZE <= size_) {
+    const uint8_t *hdr = map_ + off;
+    uint32_t frames = rd32(hdr + 4);
+    if (rd32(hdr) != BLOCK_MAGIC || off + BLOCK_HEADER_SIZE + (uint64_t)frames * recordSize_ > size_) {
+      break;
+    }
+    blocks_.push_back({hdr + BLOCK_HEADER_SIZE, frames, rd64(hdr + 8), rd64(hdr + 16)});
+    frames_ += frames;
+    off     += BLOCK_HEADER_SIZE + frames * recordSize_;
+  }
+  truncated_ = (off != size_);
+}
+
+CaptureReader::~CaptureReader() {
+  if (map_) {
+    munmap((void *)map_, size_);
+  }
+}
+
+int CaptureReader::fieldIndex(const std::string &name) const {
+  for (size_t i = 0; i < fields_.size(); i++) {
+    if (name == fields_[i].name) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+// Binary search on the block index: first block that ends at or after from
+size_t CaptureReader::firstBlock(uint64_t from) const {
+  size_t lo = 0, hi = blocks_.size();
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (blocks_[mid].lastTime < from) lo = mid + 1; else hi = mid;
+  }
+  return lo;
+}
+
+// Binary search on the fixed size records of a block: first record at or after from
+uint32_t CaptureReader::firstRecord(const Block &blk, uint64_t from) const {
+  uint32_t lo = 0, hi = blk.frames;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (rd64(blk.records + mid * recordSize_) < from) lo = mid + 1; else hi = mid;
+  }
+  return lo;
+}
+
+}  // namespace hoverserial
@@ -0,0 +1,137 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Append-only binary capture of the feedback stream, all values little endian:
+//   file header   magic "HOVCAP\0\0", version(u16), fieldCount(u16), blockFrames(u32), startTime(u64), reserved(u64)
+//   fields        fieldCount * {name(char[22]), isSigned(u8), reserved(u8)}, in SerialFeedback order
+//   blocks        {magic "HBLK"(u32), frames(u32), firstTime(u64), lastTime(u64), reserved(u64)} + frames * record
+//   record        time(u64) value(u16) * fieldCount
+// startTime is CLOCK_REALTIME [ns] at the start of the capture, record times are [ns] since then. The block headers
+// are the index: a reader walks them to find a time range without touching the records. A block is written in one
+// write() once full or BLOCK_FLUSH_TIME old, an interrupted capture only loses its last block.
+
+#ifndef HOVERSERIAL_CAPTURE_H
+#define HOVERSERIAL_CAPTURE_H
+
+#include "hoverserial.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace hoverserial {
+
+constexpr uint16_t CAPTURE_VERSION  = 1;
+constexpr uint32_t BLOCK_MAGIC      = 0x4B4C4248;     // "HBLK"
+constexpr uint64_t BLOCK_FLUSH_TIME = 5000000000ull;  // [ns] max age of the pending block
+
+struct CaptureField {
+  char      name[22];
+  uint8_t   isSigned;
+  uint8_t   reserved;
+};
+
+// Fields of a feedback frame for a layout, in the order of SerialFeedback in main.c. The table in capture.cpp is kept
+// in step with it by hand, its size is checked against Layout::feedbackSize() at compile time.
+std::vector<CaptureField> feedbackFields(const Layout &layout);
+
+class CaptureWriter {
+public:
+  CaptureWriter(const std::string &path, const Layout &layout, uint32_t blockFrames = 1024);
+  CaptureWriter(const CaptureWriter &) = delete;
+  CaptureWriter &operator=(const CaptureWriter &) = delete;
+  ~CaptureWriter();
+
+  void append(const Feedback &fb);              // fb.rxTime: CLOCK_MONOTONIC [ns] as set by the parser
+  void flush();                                 // write the pending block
+  uint64_t frames() const { return frames_; }
+
+private:
+  int                     fd_ = -1;
+  Layout                  layout_;
+  size_t                  fieldCount_;
+  uint32_t                blockFrames_;
+  uint64_t                startMono_;
+  std::vector<uint8_t>    block_;
+  uint32_t                blockCount_ = 0;
+  uint64_t                firstTime_ = 0;
+  uint64_t                lastTime_ = 0;
+  uint64_t                frames_ = 0;
+};
+
+class CaptureReader {
+public:
+  struct Block {
+    const uint8_t *records;
+    uint32_t       frames;
+    uint64_t       firstTime;
+    uint64_t       lastTime;
+  };
+
+  explicit CaptureReader(const std::string &path);  // throws std::runtime_error
+  CaptureReader(const CaptureReader &) = delete;
+  CaptureReader &operator=(const CaptureReader &) = delete;
+  ~CaptureReader();
+
+  const std::vector<CaptureField> &fields() const { return fields_; }
+  const std::vector<Block> &blocks() const { return blocks_; }
+  int      fieldIndex(const std::string &name) const;   // -1 if not found
+  uint64_t frames() const { return frames_; }
+  uint64_t startTime() const { return startTime_; }
+  size_t   recordSize() const { return recordSize_; }
+  bool     truncated() const { return truncated_; }      // trailing incomplete block ignored
+
+  // Call f(time, values) for each record with from <= time <= to [ns since startTime]
+  template <typename F> void forEach(uint64_t from, uint64_t to, F f) const {
+    std::vector<int32_t> values(fields_.size());
+    for (size_t b = firstBlock(from); b < blocks_.size() && blocks_[b].firstTime <= to; b++) {
+      const Block &blk = blocks_[b];
+      for (uint32_t i = firstRecord(blk, from); i < blk.frames; i++) {
+        const uint8_t *rec = blk.records + i * recordSize_;
+        uint64_t time;
+        memcpy(&time, rec, sizeof(time));
+        if (time > to) {
+          return;
+        }
+        for (size_t k = 0; k < fields_.size(); k++) {
+          uint16_t raw = (uint16_t)(rec[8 + 2 * k] | (rec[9 + 2 * k] << 8));
+          values[k] = fields_[k].isSigned ? (int32_t)(int16_t)raw : (int32_t)raw;
+        }
+        f(time, values.data());
+      }
+    }
+  }
+
+private:
+  size_t   firstBlock(uint64_t from) const;
+  uint32_t firstRecord(const Block &blk, uint64_t from) const;
+
+  const uint8_t            *map_ = nullptr;
+  size_t                    size_ = 0;
+  std::vector<CaptureField> fields_;
+  std::vector<Block>        blocks_;
+  uint64_t                  startTime_ = 0;
+  uint64_t                  frames_ = 0;
+  size_t                    recordSize_ = 0;
+  bool                      truncated_ = false;
+};
+
+}  // namespace hoverserial
+
+#endif
@@ -0,0 +1,556 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Benchmarks and capture tool for the hoverserial library:
+//   hoverbench record  <port> <file> <seconds> [baud]   capture the raw feedback stream of a board
+//   hoverbench replay  <file> [-d] [-m]                  parser throughput and error counts on a recorded stream
+//   hoverbench latency [rate] [seconds] [-d] [-m]        end-to-end latency through a pty, frames generated at rate [Hz]
+//   hoverbench txfull [-d] [-m] [-s] [-a]                commands into a pty nobody reads: the stream stays framed,
+//                                                        -a: the polls of a BusDriver
+//   hoverbench sync [seconds] [jitter_ms] [drift_ppm]    clock sync error on a simulated link, in simulated time
+//   hoverbench bus [nodes] [seconds] [period_ms] [error_rate] [-o]
+//                                                        SERIAL_BUS polling on a simulated shared bus, -o: last node offline
+// -d: MULTI_MODE_DRIVE build with CONTROL_SERIAL, -m: MULTI_BOARD_MASTER build, -s: FEEDBACK_TIMESTAMP build, -a: SERIAL_BUS build
+
+#include "bus.h"
+#include "hoverserial.h"
+
+extern "C" {
+#include "busnode.h"
+}
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <queue>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace hoverserial;
+
+static Layout parseLayout(int argc, char **argv) {
+  Layout layout;
+  for (int i = 1; i < argc; i++) {
+    layout.driveMode  |= !strcmp(argv[i], "-d");
+    layout.multiBoard |= !strcmp(argv[i], "-m");
+    layout.timestamp  |= !strcmp(argv[i], "-s");
+    layout.bus        |= !strcmp(argv[i], "-a");
+  }
+  return layout;
+}
+
+static void printStats(const Stats &s) {
+  printf("bytes:%llu frames:%llu checksum errors:%llu skipped bytes:%llu\n", (unsigned long long)s.bytes,
+         (unsigned long long)s.frames, (unsigned long long)s.checksumErrors, (unsigned long long)s.skippedBytes);
+}
+
+static int record(const char *path, const char *file, double seconds, int baud) {
+  SerialPort port;
+  port.open(path, baud);
+  std::ofstream out(file, std::ios::binary);
+  uint64_t end = monotonicNs() + (uint64_t)(seconds * 1e9);
+  size_t   total = 0;
+  uint8_t  buf[4096];
+  while (monotonicNs() < end) {
+    ssize_t n = read(port.fd(), buf, sizeof(buf));
+    if (n > 0) {
+      out.write((const char *)buf, n);
+      total += n;
+    } else {
+      usleep(1000);
+    }
+  }
+  printf("recorded %zu bytes to %s\n", total, file);
+  return 0;
+}
+
+static int replay(const char *file, Layout layout) {
+  std::ifstream in(file, std::ios::binary);
+  std::vector<uint8_t> stream((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  if (stream.empty()) {
+    fprintf(stderr, "%s: empty or missing\n", file);
+    return 1;
+  }
+  // Feed the stream in reads of varying size, like a serial port does, until about 256 MB are parsed
+  FrameParser parser(layout);
+  int64_t  sum = 0;
+  size_t   rounds = std::max<size_t>(1, (256u << 20) / stream.size());
+  uint64_t start = monotonicNs();
+  for (size_t r = 0; r < rounds; r++) {
+    for (size_t pos = 0, chunk = 1; pos < stream.size(); pos += chunk, chunk = chunk % 61 + 7) {
+      chunk = std::min(chunk, stream.size() - pos);
+      parser.parse(&stream[pos], chunk, 0, [&sum](const Feedback &fb) { sum += fb.leftSpeed; });
+    }
+  }
+  double sec = (monotonicNs() - start) * 1e-9;
+  Stats  s   = parser.stats();
+  printf("replayed %zu x %zu bytes in %.3f s: %.1f MB/s, %.2f Mframes/s\n", rounds, stream.size(), sec,
+         s.bytes / sec / 1e6, s.frames / sec / 1e6);
+  s.bytes /= rounds; s.frames /= rounds; s.checksumErrors /= rounds; s.skippedBytes /= rounds;
+  printf("per pass: ");
+  printStats(s);
+  return sum == 0x7FFFFFFFFFFFFFFF;             // keep the handler from being optimized away
+}
+
+static int latency(double rate, double seconds, Layout layout) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+    perror("pty");
+    return 1;
+  }
+  Driver driver(ptsname(master), 115200, layout, 0);
+  std::vector<uint64_t> sent(65536), lat;
+  std::atomic<bool> done(false);
+
+  // Writer: one feedback frame per period, the frame number travels in leftTicks
+  std::thread writer([&]() {
+    std::vector<uint8_t> frame(layout.feedbackSize());
+    uint64_t period = (uint64_t)(1e9 / rate), next = monotonicNs();
+    uint64_t end = next + (uint64_t)(seconds * 1e9);
+    for (uint16_t seq = 0; monotonicNs() < end; seq++) {
+      std::fill(frame.begin(), frame.end(), 0);
+      frame[0] = START_FRAME & 0xFF; frame[1] = START_FRAME >> 8;
+      frame[6] = (uint8_t)seq;       frame[7] = (uint8_t)(seq >> 8);
+      uint16_t checksum = START_FRAME ^ seq;
+      frame[frame.size() - 2] = (uint8_t)checksum; frame[frame.size() - 1] = (uint8_t)(checksum >> 8);
+      sent[seq] = monotonicNs();
+      if (write(master, frame.data(), frame.size()) < 0) break;
+      next += period;
+      while (monotonicNs() < next) {}
+    }
+    done = true;
+  });
+  driver.onFeedback([&](const Feedback &fb) { lat.push_back(fb.rxTime - sent[fb.leftTicks]); });
+  while (!done) {
+    driver.poll(10);
+  }
+  driver.poll(50);
+  writer.join();
+  close(master);
+
+  if (lat.empty()) {
+    printf("no frames received\n");
+    return 1;
+  }
+  std::sort(lat.begin(), lat.end());
+  printf("%zu frames at %.0f Hz, latency [us] min %.1f median %.1f p99 %.1f max %.1f\n", lat.size(), rate,
+         lat.front() / 1e3, lat[lat.size() / 2] / 1e3, lat[lat.size() * 99 / 100] / 1e3, lat.back() / 1e3);
+  printStats(driver.stats());
+  return 0;
+}
+
+static const Stats &txStats(Driver &driver) { return driver.stats(); }
+static const Stats &txStats(BusDriver &driver) { return driver.master().frameStats(); }
+
+// Commands at 2 kHz into a pty that is not read for a while: the Tx buffer fills and takes a frame only partly.
+// The rest has to follow, so every frame on the wire is complete and each counted command arrived.
+// -a: the polls of a BusDriver of 8 nodes that never reply, one per 0.2 ms reply timeout. The schedule waits for a
+// partly written poll instead of dropping the next ones: the port counts as full once no poll is sent for 200 polls.
+template <class D>
+static int txFull(D &driver, int master, const Layout &layout) {
+  std::vector<uint8_t> wire;
+  uint8_t buf[4096];
+  auto drain = [&]() {
+    ssize_t n;
+    while ((n = read(master, buf, sizeof(buf))) > 0) wire.insert(wire.end(), buf, buf + n);
+  };
+  const Stats &s = txStats(driver);
+  uint64_t end = monotonicNs() + 10000000000ull, sent = 0;
+  int      stalled = 0;
+  while (s.commandsDropped < 100 && stalled < 200 && monotonicNs() < end) {   // nobody reads
+    driver.poll(1);
+    stalled = (s.commandsSent == sent) ? stalled + 1 : 0;
+    sent    = s.commandsSent;
+  }
+  bool full = s.commandsDropped > 0 || stalled >= 200;
+  for (int i = 0; i < 500; i++) {
+    drain();
+    driver.poll(1);
+  }
+  if constexpr (std::is_same<D, Driver>::value) {
+    driver.stopCommands();
+  }
+  for (int i = 0; i < 100 && (i < 20 || wire.size() % layout.commandSize()); i++) {   // the bus keeps polling:
+    driver.poll(1);                                                                   // up to a frame boundary
+    drain();
+  }
+  close(master);
+
+  size_t size = layout.commandSize(), frames = 0, broken = 0;
+  for (size_t i = 0; i + size <= wire.size(); i += size) {
+    uint16_t checksum = 0;
+    for (size_t k = 0; k + 2 < size; k += 2) checksum ^= wire[i + k] | wire[i + k + 1] << 8;
+    bool ok = (wire[i] | wire[i + 1] << 8) == START_FRAME && checksum == (wire[i + size - 2] | wire[i + size - 1] << 8);
+    frames += ok;
+    broken += !ok;
+  }
+  bool pass = broken == 0 && wire.size() % size == 0 && frames == s.commandsSent && full;
+  printf("%llu commands sent, %llu dropped while the port was full%s, %zu frames on the wire, %zu broken, "
+         "%zu bytes left\n", (unsigned long long)s.commandsSent, (unsigned long long)s.commandsDropped,
+         stalled >= 200 ? " (schedule stalled)" : "", frames, broken, wire.size() % size);
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
+
+struct ErrorStats {
+  double rms, max;  // [ns]
+};
+
+static ErrorStats printError(const char *name, std::vector<double> &err) {
+  double sum = 0, sq = 0;
+  for (double e : err) {
+    sum += e;
+    sq  += e * e;
+  }
+  std::sort(err.begin(), err.end(), [](double a, double b) { return std::fabs(a) < std::fabs(b); });
+  printf("%-14s error [us] mean %8.1f rms %8.1f p99 %8.1f max %8.1f\n", name, sum / err.size() / 1e3,
+         std::sqrt(sq / err.size()) / 1e3, std::fabs(err[err.size() * 99 / 100]) / 1e3, std::fabs(err.back()) / 1e3);
+  return {std::sqrt(sq / err.size()), std::fabs(err.back())};
+}
+
+ /*
+ * Board clock with an offset, a drift and the 1/16 ms resolution, starting right before its 32-bit wrap around.
+ * Commands every 20 ms of host time, feedback every 20 ms of board time, each way a USB latency of 0.3 ms plus an
+ * exponential jitter. Compares the synced board time of each frame after the first 10 s with its true host time,
+ * next to the read time of the frame as the naive alternative.
+ * Passes if the drift estimate is within 1 ppm per ms of jitter (at least 1 ppm), no synced error exceeds a tenth of the jitter plus two board ticks and
+ * the synced rms error is below a tenth of the read time rms error.
+ */
+static int syncSim(double seconds, double jitterMs, double driftPpm) {
+  Layout layout;
+  layout.timestamp = true;
+  const int    baud     = 115200;
+  const double charTime = 10e9 / baud;
+  const double rate     = 1 + driftPpm * 1e-6;
+  const double host0    = 1e12;                                  // host time at board time board0
+  const double board0   = (double)0xFFFF0000u * BOARD_TICK;
+  auto boardAt = [&](double host) { return board0 + (host - host0) * rate; };
+  auto hostAt  = [&](double board) { return host0 + (board - board0) / rate; };
+
+  std::mt19937_64 rng(1);
+  std::exponential_distribution<double> jitter(1.0 / (jitterMs * 1e6));
+  auto latency = [&]() { return 300000.0 + jitter(rng); };
+
+  // Commands: write time and board tick of the idle line interrupt, in line order
+  std::vector<double>   cmdSent;
+  std::vector<uint32_t> cmdRx;
+  double arrive = 0;
+  for (double t = host0; t < host0 + seconds * 1e9; t += 20e6) {
+    arrive = std::max(arrive, t + latency() + (layout.commandSize() + 1) * charTime);
+    cmdSent.push_back(t);
+    cmdRx.push_back((uint32_t)(uint64_t)(boardAt(arrive) / BOARD_TICK));
+  }
+
+  ClockSync clock(layout, baud);
+  std::vector<double> syncErr, rxErr;
+  size_t sent = 0, received = 0;
+  double rxTime = 0;
+  for (double b = board0 + 7e6; hostAt(b) < host0 + seconds * 1e9; b += 20e6) {
+    double   stamp = hostAt(b);
+    Feedback fb    = Feedback();
+    fb.boardTime   = (uint32_t)(uint64_t)(b / BOARD_TICK);
+    rxTime         = std::max(rxTime, stamp + layout.feedbackSize() * charTime + latency());
+    fb.rxTime      = (uint64_t)rxTime;
+    while (sent < cmdSent.size() && cmdSent[sent] <= rxTime) {
+      clock.sent((uint16_t)(sent + 1), (uint64_t)cmdSent[sent]);
+      sent++;
+    }
+    while (received < cmdRx.size() && (int32_t)(fb.boardTime - cmdRx[received]) >= 0) {
+      received++;
+    }
+    fb.syncId  = (uint16_t)received;
+    fb.syncAge = received ? (uint16_t)(fb.boardTime - cmdRx[received - 1]) : NO_SYNC;
+    clock.received(fb);
+    if (stamp - host0 > 10e9 && clock.synced()) {
+      syncErr.push_back((double)(int64_t)(clock.toHost(fb.boardTime) - (uint64_t)stamp));
+      rxErr.push_back(rxTime - stamp);
+    }
+  }
+  if (syncErr.empty()) {
+    printf("no synced frames, simulate more than 10 s\n");
+    return 1;
+  }
+  printf("%llu samples over %.0f s, jitter %.2f ms, drift %.1f ppm (estimate %.2f ppm), min delay %.0f us\n",
+         (unsigned long long)clock.samples(), seconds, jitterMs, driftPpm, clock.drift(), clock.delay() / 1e3);
+  ErrorStats synced = printError("synced", syncErr);
+  ErrorStats naive  = printError("read time", rxErr);
+  bool pass = std::fabs(clock.drift() - driftPpm) <= std::max(jitterMs, 1.0) && synced.max <= jitterMs * 1e5 + 2 * BOARD_TICK &&
+              synced.rms * 10 <= naive.rms;
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
+
+// Feedback frame of a bus node: address, speed and steer echo of the last command, reply counter in leftTicks
+static std::vector<uint8_t> busReply(const Layout &layout, uint16_t node, int16_t speed, int16_t steer, uint16_t count) {
+  std::vector<uint16_t> words(layout.feedbackSize() / 2, 0);
+  words[0] = START_FRAME;
+  words[1] = node;
+  words[2] = (uint16_t)speed;
+  words[3] = (uint16_t)steer;
+  words[4] = count;
+  for (size_t i = 0; i + 1 < words.size(); i++) {
+    words.back() ^= words[i];
+  }
+  std::vector<uint8_t> frame(layout.feedbackSize());
+  memcpy(frame.data(), words.data(), frame.size());   // little endian host
+  return frame;
+}
+
+ /*
+ * Shared bus: the BusMaster against N nodes that run the firmware rules of Src/busnode.c, as usart3_rx_check,
+ * usart_process_command and busReplySend do. Event driven in simulated time:
+ * - the line carries one frame per transmitter, overlapping frames are collisions and arrive garbled
+ * - every byte on the line goes to the Rx DMA ring buffer of each node. Once the line is idle for a character a node
+ *   takes the burst (busRxBurst), checks and counts the command (busCommandRx), and for a poll replies 5..30 us later
+ *   with the frame of its last 5 ms main loop cycle unless its previous reply is still out (busReplyReady)
+ * - the USB adapter forwards host writes after 0.10..0.35 ms in order, and line data after 0.1..1.1 ms
+ * - error_rate: probability of a garbled frame
+ * The host broadcasts a stop every second. Checks: no collisions, every node answers every poll it got,
+ * no node takes a command addressed to another one (steer carries the node id).
+ */
+static int busSim(int nodeCount, double seconds, double periodMs, double errorRate, bool offline, Layout layout) {
+  layout.bus = true;
+  const int    baud     = 115200;
+  const double charTime = 10e9 / baud;
+  std::vector<uint8_t> ids;
+  for (int i = 1; i <= nodeCount; i++) ids.push_back((uint8_t)i);
+  BusMaster master(layout, baud, ids, 0, (uint64_t)(periodMs * 1e6));
+
+  struct Node {
+    bool      online = true;
+    ::BusStats stats = {};                                       // counted by the firmware rules
+    uint8_t   ring[128] = {};                                    // Rx DMA ring buffer (SERIAL_BUFFER_SIZE)
+    uint32_t  rxPos = 0, oldPos = 0;                             // DMA write position, old_pos of usart3_rx_check
+    uint64_t  misrouted = 0;
+    double    txUntil = 0;
+    double    phase = 0;                                         // main loop phase [ns]
+    std::vector<std::pair<double, std::pair<int16_t, int16_t>>> applied;   // (time, (speed, steer))
+  };
+  std::vector<Node> nodes(nodeCount + 1);
+  std::mt19937_64 rng(1);
+  std::uniform_real_distribution<double> uni(0, 1);
+  for (Node &n : nodes) n.phase = uni(rng) * 5e6;
+  if (offline) nodes[nodeCount].online = false;
+
+  // Events: 0 host service, 1 line frame start, 2 line frame end, 3 line idle check, 4 host read
+  struct Event {
+    double  time;
+    int     type;
+    size_t  frame;
+    bool operator<(const Event &e) const { return time > e.time; }
+  };
+  struct Frame {
+    int                  src;                                    // 0: host, else node id
+    double               start, end;
+    std::vector<uint8_t> bytes;
+    bool                 garbled;
+  };
+  std::priority_queue<Event> events;
+  std::vector<Frame> frames;
+  double hostTimer = 0, adapterFree = 0, hostRxLast = 0, lineEnd = 0;
+  int    active = 0;
+  uint64_t collisions = 0, garbled = 0, hostBroadcasts = 0;
+  std::vector<uint8_t> burst;
+
+  auto transmit = [&](int src, double at, std::vector<uint8_t> bytes) {
+    frames.push_back({src, at, at + bytes.size() * charTime, std::move(bytes), false});
+    events.push({at, 1, frames.size() - 1});
+  };
+  const double end = seconds * 1e9;
+  double nextBroadcast = 1e9;
+  events.push({0, 0, 0});
+  while (!events.empty() && events.top().time < end) {
+    Event ev = events.top();
+    events.pop();
+    double t = ev.time;
+    if (ev.type == 0) {                                          // host: write what the schedule allows
+      if (t != hostTimer) continue;                              // superseded
+      if (t >= nextBroadcast) {
+        master.broadcast(0, 0);
+        hostBroadcasts++;
+        nextBroadcast += 1e9;
+      }
+      uint8_t buf[16];
+      for (size_t i = 0; i < ids.size(); i++) {
+        master.setCommand(ids[i], ids[i], (int16_t)(t / 1e6));  // steer: node id, speed: time [ms]
+      }
+      if (size_t len = master.next((uint64_t)t, buf)) {
+        adapterFree = std::max(t + 100000 + uni(rng) * 250000, adapterFree);
+        transmit(0, adapterFree, std::vector<uint8_t>(buf, buf + len));
+        adapterFree += len * charTime;
+      }
+      hostTimer = std::max((double)master.deadline(), t + 1000);
+      events.push({hostTimer, 0, 0});
+    } else if (ev.type == 1) {                                   // frame start: collision if the line is in use
+      Frame &f = frames[ev.frame];
+      for (size_t i = frames.size(); i-- > 0 && ev.frame - i < 8;) {
+        if (i != ev.frame && frames[i].start <= f.start && frames[i].end > f.start) {
+          if (!frames[i].garbled || !f.garbled) collisions++;
+          frames[i].garbled = f.garbled = true;
+        }
+      }
+      if (uni(rng) < errorRate) f.garbled = true;
+      if (f.start - lineEnd >= charTime && !active) burst.clear();   // idle since the last frame: new burst
+      active++;
+      events.push({f.end, 2, ev.frame});
+    } else if (ev.type == 2) {                                   // frame end: to the nodes' burst and the host
+      Frame &f = frames[ev.frame];
+      active--;
+      lineEnd = std::max(lineEnd, t);
+      if (f.garbled) {
+        garbled++;
+        for (uint8_t &c : f.bytes) c ^= (uint8_t)(1 + uni(rng) * 254);
+      }
+      burst.insert(burst.end(), f.bytes.begin(), f.bytes.end());
+      events.push({t + charTime, 3, 0});
+      if (f.src != 0) {
+        hostRxLast = std::max(t + 100000 + uni(rng) * 1e6, hostRxLast);
+        events.push({hostRxLast, 4, ev.frame});
+      }
+    } else if (ev.type == 3) {                                   // idle line interrupt on all nodes
+      if (active || t < lineEnd + charTime || burst.empty()) continue;
+      std::vector<uint8_t> rx;
+      rx.swap(burst);
+      for (int id = 1; id <= nodeCount; id++) {
+        Node &node = nodes[id];
+        if (!node.online) continue;
+        for (uint8_t c : rx) {                                   // DMA: circular, pos is 0 again after the end
+          node.ring[node.rxPos] = c;
+          node.rxPos = (node.rxPos + 1) % sizeof(node.ring);
+        }
+        uint16_t words[8];
+        bool got = node.rxPos != node.oldPos &&
+                   busRxBurst(node.ring, sizeof(node.ring), node.oldPos, node.rxPos, words, layout.commandSize());
+        node.oldPos = node.rxPos;
+        if (!got) continue;
+        uint8_t cmd = busCommandRx(words, layout.commandSize(), (uint8_t)id, &node.stats);
+        if (cmd != BUS_RX_OWN && cmd != BUS_RX_BROADCAST) continue;
+        node.applied.push_back({t, {(int16_t)words[3], (int16_t)words[2]}});
+        if (node.applied.size() > 8) node.applied.erase(node.applied.begin());
+        if (cmd == BUS_RX_BROADCAST) continue;
+        node.misrouted += ((int16_t)words[2] != id);
+        // Reply with the frame of the last main loop cycle, none before the first one
+        uint16_t replyLen = (t >= node.phase) ? (uint16_t)layout.feedbackSize() : 0;
+        if (!busReplyReady(replyLen, node.txUntil <= t, &node.stats)) continue;
+        double cycle = std::floor((t - node.phase) / 5e6) * 5e6 + node.phase;
+        std::pair<int16_t, int16_t> state(0, 0);
+        for (auto &a : node.applied) {
+          if (a.first <= cycle) state = a.second;
+        }
+        double at = t + 5000 + uni(rng) * 25000;
+        std::vector<uint8_t> reply = busReply(layout, (uint16_t)id, state.first, state.second, node.stats.reply);
+        node.txUntil = at + reply.size() * charTime;
+        transmit(id, at, std::move(reply));
+      }
+    } else if (ev.type == 4) {                                   // host read
+      Frame &f = frames[ev.frame];
+      master.receive(f.bytes.data(), f.bytes.size(), (uint64_t)t, nullptr);
+      hostTimer = std::max((double)master.deadline(), t);
+      events.push({hostTimer, 0, 0});
+    }
+    if (frames.size() > 4096 && active == 0) {                   // keep the frame log short, no event refers to it
+      bool pending = false;
+      std::priority_queue<Event> copy = events;
+      for (; !copy.empty(); copy.pop()) pending |= (copy.top().type != 0 && copy.top().type != 3);
+      if (!pending) frames.clear();
+    }
+  }
+
+  const hoverserial::BusStats &bs = master.stats();
+  double round = bs.cycles ? (bs.lastTime - bs.startTime) / 1e6 / bs.cycles : 0;
+  printf("%d nodes, %d baud, %.0f s: %llu rounds of %.2f ms (%.1f Hz per node), %llu broadcasts, "
+         "line utilization %.1f %%\n", nodeCount, baud, seconds, (unsigned long long)bs.cycles, round,
+         round ? 1000 / round : 0, (unsigned long long)bs.broadcasts, bs.utilization() * 100);
+  printf("collisions %llu, garbled frames %llu\n", (unsigned long long)collisions, (unsigned long long)garbled);
+  printf("node     polls   replies  timeouts  errors  late  rtt avg/max [us] | own  bcast  other  busy  misrouted\n");
+  bool ok = (collisions == 0);
+  for (int id = 1; id <= nodeCount; id++) {
+    const BusNodeStats &s = master.node((uint8_t)id);
+    const Node &n = nodes[id];
+    printf("%4d %9llu %9llu %9llu %7llu %5llu %8.0f /%6.0f    | %llu %6llu %6llu %5llu %5llu%s\n", id,
+           (unsigned long long)s.polls, (unsigned long long)s.replies, (unsigned long long)s.timeouts,
+           (unsigned long long)s.errors, (unsigned long long)s.late, s.replies ? s.rttSum / 1e3 / s.replies : 0,
+           s.rttMax / 1e3, (unsigned long long)n.stats.own, (unsigned long long)n.stats.broadcast,
+           (unsigned long long)n.stats.other, (unsigned long long)n.stats.busy, (unsigned long long)n.misrouted,
+           n.online ? "" : "  (offline)");
+    ok &= !n.misrouted && (n.online ? n.stats.reply == n.stats.own : s.timeouts + 1 >= s.polls);
+    if (n.online && !errorRate) {
+      ok &= (s.replies + 1 >= s.polls) && n.stats.broadcast + 1u >= hostBroadcasts && n.stats.broadcast <= hostBroadcasts;
+    }
+  }
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+  try {
+    if (argc >= 5 && !strcmp(argv[1], "record")) {
+      return record(argv[2], argv[3], atof(argv[4]), argc > 5 ? atoi(argv[5]) : 115200);
+    }
+    if (argc >= 3 && !strcmp(argv[1], "replay")) {
+      return replay(argv[2], parseLayout(argc, argv));
+    }
+    if (argc >= 2 && !strcmp(argv[1], "latency")) {
+      double rate    = (argc > 2 && argv[2][0] != '-') ? atof(argv[2]) : 1000;
+      double seconds = (argc > 3 && argv[3][0] != '-') ? atof(argv[3]) : 5;
+      return latency(rate, seconds, parseLayout(argc, argv));
+    }
+    if (argc >= 2 && !strcmp(argv[1], "txfull")) {
+      Layout layout = parseLayout(argc, argv);
+      int    master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+      if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+        perror("pty");
+        return 1;
+      }
+      if (layout.bus) {
+        BusDriver driver(ptsname(master), 115200, layout, {1, 2, 3, 4, 5, 6, 7, 8}, 200000);
+        for (uint8_t id = 1; id <= 8; id++) driver.master().setCommand(id, 100, 200);
+        return txFull(driver, master, layout);
+      }
+      Driver driver(ptsname(master), 115200, layout, 2000.0);
+      driver.setCommand(100, 200);
+      return txFull(driver, master, layout);
+    }
+    if (argc >= 2 && !strcmp(argv[1], "bus")) {
+      auto arg = [&](int i, double def) { return (argc > i && argv[i][0] != '-') ? atof(argv[i]) : def; };
+      bool offline = false;
+      for (int i = 2; i < argc; i++) offline |= !strcmp(argv[i], "-o");
+      return busSim((int)arg(2, 8), arg(3, 30), arg(4, 0), arg(5, 0), offline, parseLayout(argc, argv));
+    }
+    if (argc >= 2 && !strcmp(argv[1], "sync")) {
+      return syncSim(argc > 2 ? atof(argv[2]) : 120, argc > 3 ? atof(argv[3]) : 1, argc > 4 ? atof(argv[4]) : 50);
+    }
+  } catch (const std::exception &e) {
+    fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+  fprintf(stderr, "usage: hoverbench record <port> <file> <seconds> [baud] | replay <file> [-d] [-m] [-s] [-a] | "
+                  "latency [rate] [seconds] [-d] [-m] [-s] [-a] | txfull [-d] [-m] [-s] [-a] | sync [seconds] [jitter_ms] [drift_ppm] | "
+                  "bus [nodes] [seconds] [period_ms] [error_rate] [-o]\n");
+  return 2;
+}
@@ -0,0 +1,192 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Feedback capture tool, file format in capture.h:
+//   hovercap record <port> <file> [-b baud] [-d] [-m] [-s] [-a] capture the feedback of a board until Ctrl-C
+//   hovercap import <raw> <file> [-p period_ms] [-d] [-m] [-s] [-a]
+//                                                              convert a raw stream (hoverbench record), times from the period
+//   hovercap info   <file>                                     fields, frames, duration and block index
+//   hovercap export <file> [-f from_s] [-t to_s] [-c field,..] [-w field<op>value] [-n every]
+//                                                              CSV to stdout, op is one of < > = !
+// -d: MULTI_MODE_DRIVE build with CONTROL_SERIAL, -m: MULTI_BOARD_MASTER build, -s: FEEDBACK_TIMESTAMP build, -a: SERIAL_BUS build
+
+#include "capture.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+using namespace hoverserial;
+
+static volatile sig_atomic_t stopReq = 0;
+
+static void onSignal(int) {
+  stopReq = 1;
+}
+
+// Value of option -x, or def
+static const char *option(int argc, char **argv, const char *name, const char *def) {
+  for (int i = 2; i < argc - 1; i++) {
+    if (!strcmp(argv[i], name)) {
+      return argv[i + 1];
+    }
+  }
+  return def;
+}
+
+static bool flag(int argc, char **argv, const char *name) {
+  for (int i = 2; i < argc; i++) {
+    if (!strcmp(argv[i], name)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static Layout parseLayout(int argc, char **argv) {
+  Layout layout;
+  layout.driveMode  = flag(argc, argv, "-d");
+  layout.multiBoard = flag(argc, argv, "-m");
+  layout.timestamp  = flag(argc, argv, "-s");
+  layout.bus        = flag(argc, argv, "-a");
+  return layout;
+}
+
+static int record(int argc, char **argv) {
+  Layout        layout = parseLayout(argc, argv);
+  Driver        driver(argv[2], atoi(option(argc, argv, "-b", "115200")), layout, 0);   // listen only
+  CaptureWriter writer(argv[3], layout);
+  driver.onFeedback([&writer](const Feedback &fb) { writer.append(fb); });
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  while (!stopReq && driver.poll(200) >= 0) {}
+  writer.flush();
+  fprintf(stderr, "captured %llu frames, ", (unsigned long long)writer.frames());
+  const Stats &s = driver.stats();
+  fprintf(stderr, "checksum errors %llu, skipped bytes %llu\n", (unsigned long long)s.checksumErrors,
+          (unsigned long long)s.skippedBytes);
+  return 0;
+}
+
+static int import(int argc, char **argv) {
+  std::ifstream in(argv[2], std::ios::binary);
+  std::vector<uint8_t> raw((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  Layout        layout = parseLayout(argc, argv);
+  uint64_t      period = (uint64_t)(atof(option(argc, argv, "-p", "20")) * 1e6);
+  FrameParser   parser(layout);
+  CaptureWriter writer(argv[3], layout);
+  uint64_t      time   = monotonicNs();
+  parser.parse(raw.data(), raw.size(), 0, [&](const Feedback &fb) {
+    Feedback timed = fb;
+    timed.rxTime   = time;
+    time          += period;
+    writer.append(timed);
+  });
+  writer.flush();
+  printf("imported %llu frames\n", (unsigned long long)writer.frames());
+  return 0;
+}
+
+static int info(char **argv) {
+  CaptureReader cap(argv[2]);
+  time_t start = (time_t)(cap.startTime() / 1000000000u);
+  char   date[32];
+  strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&start));
+  uint64_t duration = cap.blocks().empty() ? 0 : cap.blocks().back().lastTime;
+  printf("start: %s\nframes: %llu\nduration: %.3f s\nblocks: %zu%s\nfields:", date, (unsigned long long)cap.frames(),
+         duration * 1e-9, cap.blocks().size(), cap.truncated() ? " (incomplete last block ignored)" : "");
+  for (const CaptureField &f : cap.fields()) {
+    printf(" %s%s", f.name, f.isSigned ? "" : "(u)");
+  }
+  printf("\n");
+  return 0;
+}
+
+static int exportCsv(int argc, char **argv) {
+  CaptureReader cap(argv[2]);
+  uint64_t from  = (uint64_t)(atof(option(argc, argv, "-f", "0")) * 1e9);
+  const char *to = option(argc, argv, "-t", nullptr);
+  uint64_t until = to ? (uint64_t)(atof(to) * 1e9) : UINT64_MAX;
+  long     every = std::max(1L, atol(option(argc, argv, "-n", "1")));
+
+  // Columns
+  std::vector<int> cols;
+  std::stringstream list(option(argc, argv, "-c", ""));
+  for (std::string name; std::getline(list, name, ',');) {
+    if (cap.fieldIndex(name) < 0) {
+      throw std::runtime_error("unknown field " + name);
+    }
+    cols.push_back(cap.fieldIndex(name));
+  }
+  if (cols.empty()) {
+    for (size_t i = 0; i < cap.fields().size(); i++) cols.push_back((int)i);
+  }
+
+  // Filter: field<op>value
+  int  whereField = -1;
+  char whereOp    = 0;
+  long whereValue = 0;
+  if (const char *where = option(argc, argv, "-w", nullptr)) {
+    const char *op = strpbrk(where, "<>=!");
+    if (!op || (whereField = cap.fieldIndex(std::string(where, op - where))) < 0) {
+      throw std::runtime_error(std::string("invalid filter ") + where);
+    }
+    whereOp    = *op;
+    whereValue = atol(op + 1);
+  }
+
+  printf("time");
+  for (int c : cols) printf(",%s", cap.fields()[c].name);
+  printf("\n");
+  long n = 0;
+  cap.forEach(from, until, [&](uint64_t time, const int32_t *values) {
+    if (whereField >= 0) {
+      long v = values[whereField];
+      bool pass = (whereOp == '<') ? v < whereValue : (whereOp == '>') ? v > whereValue :
+                  (whereOp == '=') ? v == whereValue : v != whereValue;
+      if (!pass) return;
+    }
+    if (n++ % every) return;
+    printf("%.6f", time * 1e-9);
+    for (int c : cols) printf(",%d", values[c]);
+    printf("\n");
+  });
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  try {
+    if (argc >= 4 && !strcmp(argv[1], "record")) return record(argc, argv);
+    if (argc >= 4 && !strcmp(argv[1], "import")) return import(argc, argv);
+    if (argc >= 3 && !strcmp(argv[1], "info"))   return info(argv);
+    if (argc >= 3 && !strcmp(argv[1], "export")) return exportCsv(argc, argv);
+  } catch (const std::exception &e) {
+    fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+  fprintf(stderr, "usage: hovercap record <port> <file> [-b baud] [-d] [-m] [-s] [-a]\n"
+                  "       hovercap import <raw> <file> [-p period_ms] [-d] [-m] [-s] [-a]\n"
+                  "       hovercap info <file>\n"
+                  "       hovercap export <file> [-f from_s] [-t to_s] [-c field,..] [-w field<op>value] [-n every]\n");
+  return 2;
+}
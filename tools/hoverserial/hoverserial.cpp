@@ -0,0 +1,449 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "hoverserial.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace hoverserial {
+
+static inline uint16_t rd16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline void wr16(uint8_t *p, uint16_t value) {
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+}
+
+static inline bool isStart(const uint8_t *p) {
+  return p[0] == (START_FRAME & 0xFF) && p[1] == (START_FRAME >> 8);
+}
+
+uint64_t monotonicNs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+
+/* =========================== Frame Parser =========================== */
+
+FrameParser::FrameParser(Layout layout) : layout_(layout), size_(layout.feedbackSize()) {}
+
+bool FrameParser::valid(const uint8_t *frame) const {
+  uint16_t checksum = 0;
+  for (size_t i = 0; i < size_ - 2; i += 2) {
+    checksum ^= rd16(frame + i);
+  }
+  return isStart(frame) && checksum == rd16(frame + size_ - 2);
+}
+
+void FrameParser::decode(const uint8_t *frame, uint64_t rxTime, const FeedbackHandler &handler) {
+  Feedback fb = Feedback();
+  const uint8_t *p = frame + 2;
+  if (layout_.bus) {
+    fb.address  = rd16(p);           p += 2;
+  }
+  fb.leftSpeed  = (int16_t)rd16(p);  p += 2;
+  fb.rightSpeed = (int16_t)rd16(p);  p += 2;
+  fb.leftTicks  = rd16(p);           p += 2;
+  fb.rightTicks = rd16(p);           p += 2;
+  fb.batVoltage = (int16_t)rd16(p);  p += 2;
+  fb.boardTemp  = (int16_t)rd16(p);  p += 2;
+  if (layout_.driveMode) {
+    fb.driveMode = rd16(p);          p += 2;
+  }
+  if (layout_.multiBoard) {
+    fb.tick            = rd16(p);          p += 2;
+    fb.slaveLeftSpeed  = (int16_t)rd16(p); p += 2;
+    fb.slaveRightSpeed = (int16_t)rd16(p); p += 2;
+    fb.slaveLeftTicks  = rd16(p);          p += 2;
+    fb.slaveRightTicks = rd16(p);          p += 2;
+    fb.slaveBatVoltage = (int16_t)rd16(p); p += 2;
+    fb.slaveBoardTemp  = (int16_t)rd16(p); p += 2;
+    fb.slaveTick       = rd16(p);          p += 2;
+  }
+  if (layout_.timestamp) {
+    fb.boardTime = rd16(p) | ((uint32_t)rd16(p + 2) << 16); p += 4;
+    fb.syncId    = rd16(p);          p += 2;
+    fb.syncAge   = rd16(p);
+  }
+  fb.rxTime = rxTime;
+  stats_.frames++;
+  if (handler) {
+    handler(fb);
+  }
+}
+
+size_t FrameParser::parse(const uint8_t *data, size_t len, uint64_t rxTime, const FeedbackHandler &handler) {
+  uint64_t frames = stats_.frames;
+  stats_.bytes += len;
+
+  // Finish a frame split over the previous read. The carry is the head of the stream: drop from its front until it
+  // starts with a start word, fill it up to a frame, then emit it or drop one byte and search again.
+  while (carryLen_) {
+    if (carryLen_ >= 2 && !isStart(carry_)) {
+      memmove(carry_, carry_ + 1, --carryLen_);
+      stats_.skippedBytes++;
+    } else if (carryLen_ < size_) {
+      if (!len) {
+        return stats_.frames - frames;
+      }
+      size_t take = std::min(size_ - carryLen_, len);
+      memcpy(carry_ + carryLen_, data, take);
+      carryLen_ += take;
+      data      += take;
+      len       -= take;
+    } else if (valid(carry_)) {
+      decode(carry_, rxTime, handler);
+      carryLen_ = 0;
+    } else {
+      stats_.checksumErrors++;
+      stats_.skippedBytes++;
+      memmove(carry_, carry_ + 1, --carryLen_);
+    }
+  }
+
+  // Decode in place
+  size_t i = 0;
+  while (i + 1 < len) {
+    if (isStart(data + i)) {
+      if (len - i < size_) {
+        break;                                  // frame continues in the next read
+      }
+      if (valid(data + i)) {
+        decode(data + i, rxTime, handler);
+        i += size_;
+        continue;
+      }
+      stats_.checksumErrors++;
+    }
+    stats_.skippedBytes++;
+    i++;
+  }
+  if (i + 1 == len && data[i] != (START_FRAME & 0xFF)) {
+    stats_.skippedBytes++;
+    i++;
+  }
+  carryLen_ = len - i;
+  memcpy(carry_, data + i, carryLen_);
+  return stats_.frames - frames;
+}
+
+size_t encodeCommand(const Layout &layout, int16_t steer, int16_t speed, uint16_t driveMode, uint8_t *out,
+                     uint16_t syncId, uint16_t address) {
+  uint16_t words[7];
+  size_t   n = 0;
+  words[n++] = START_FRAME;
+  if (layout.bus) {
+    words[n++] = address;
+  }
+  words[n++] = (uint16_t)steer;
+  words[n++] = (uint16_t)speed;
+  if (layout.driveMode) {
+    words[n++] = driveMode;
+  }
+  if (layout.timestamp) {
+    words[n++] = syncId;
+  }
+  uint16_t checksum = 0;
+  for (size_t i = 0; i < n; i++) {
+    checksum ^= words[i];
+    wr16(out + 2 * i, words[i]);
+  }
+  wr16(out + 2 * n, checksum);
+  return 2 * (n + 1);
+}
+
+
+/* =========================== Serial Port =========================== */
+
+static speed_t baudConstant(int baud) {
+  switch (baud) {
+    case 9600:    return B9600;
+    case 19200:   return B19200;
+    case 38400:   return B38400;
+    case 57600:   return B57600;
+    case 115200:  return B115200;
+    case 230400:  return B230400;
+    case 460800:  return B460800;
+    case 921600:  return B921600;
+    default:      throw std::system_error(EINVAL, std::generic_category(), "unsupported baud rate");
+  }
+}
+
+void FileDesc::reset(int fd) {
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+  fd_ = fd;
+}
+
+void SerialPort::open(const std::string &path, int baud) {
+  close();
+  fd_ = ::open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (fd_ < 0) {
+    throw std::system_error(errno, std::generic_category(), path);
+  }
+  termios tio;
+  if (tcgetattr(fd_, &tio) < 0) {
+    int err = errno;
+    close();
+    throw std::system_error(err, std::generic_category(), path);
+  }
+  cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cflag &= ~(CSTOPB | CRTSCTS);             // 8N1, no flow control
+  tio.c_cc[VMIN]  = 0;
+  tio.c_cc[VTIME] = 0;
+  cfsetispeed(&tio, baudConstant(baud));
+  cfsetospeed(&tio, baudConstant(baud));
+  if (tcsetattr(fd_, TCSANOW, &tio) < 0) {
+    int err = errno;
+    close();
+    throw std::system_error(err, std::generic_category(), path);
+  }
+  tcflush(fd_, TCIOFLUSH);
+}
+
+void SerialPort::close() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+
+/* =========================== Clock Sync =========================== */
+
+ClockSync::ClockSync(Layout layout, int baud, uint64_t binTime, size_t bins) : binTime_(binTime), bins_(bins) {
+  double charTime = 10e9 / baud;                       // 8N1
+  txFrame_ = (layout.commandSize() + 1) * charTime;    // the board stamps the command on the idle line interrupt
+  rxFrame_ = layout.feedbackSize() * charTime;         // and the feedback right before its DMA transfer
+  for (size_t i = 0; i < 256; i++) {
+    sentId_[i] = (uint16_t)~i;                         // no match before the first command
+  }
+}
+
+void ClockSync::sent(uint16_t syncId, uint64_t hostTime) {
+  sentId_[syncId & 0xFF]   = syncId;
+  sentTime_[syncId & 0xFF] = hostTime;
+}
+
+int64_t ClockSync::unwrap(uint32_t boardTime) const {
+  return haveBoard_ ? lastBoard_ + (int32_t)(boardTime - (uint32_t)lastBoard_) : boardTime;
+}
+
+bool ClockSync::received(const Feedback &fb) {
+  uint8_t slot = fb.syncId & 0xFF;
+  if (fb.syncAge == NO_SYNC || sentId_[slot] != fb.syncId || !sentTime_[slot]) {
+    return false;
+  }
+  lastBoard_ = unwrap(fb.boardTime);
+  haveBoard_ = true;
+  if (!ref_) {
+    ref_ = sentTime_[slot];
+  }
+  double t1 = (double)(int64_t)(sentTime_[slot] - ref_) + txFrame_;
+  double t4 = (double)(int64_t)(fb.rxTime - ref_) - rxFrame_;
+  double t3 = (double)lastBoard_ * BOARD_TICK;
+  double t2 = t3 - (double)fb.syncAge * BOARD_TICK;
+  Sample s  = {(t1 + t4) / 2, ((t2 - t1) + (t3 - t4)) / 2, (t4 - t1) - (t3 - t2)};
+  if (s.host < 0 || s.delay < -2.0 * BOARD_TICK || s.host < lastHost_ - 1e9) {
+    return false;                                      // syncId of another host, or a stale command
+  }
+  lastHost_ = s.host;
+  samples_++;
+
+  // Keep the minimum delay sample per bin
+  if (window_.empty() || (uint64_t)(s.host / binTime_) != (uint64_t)(window_.back().host / binTime_)) {
+    window_.push_back(s);
+    if (window_.size() > bins_) {
+      window_.erase(window_.begin());
+    }
+  } else if (s.delay < window_.back().delay) {
+    window_.back() = s;
+  }
+  fit();
+  return true;
+}
+
+// Least squares line offset = a + b * host through the closed bins. The open bin may not have a good sample yet,
+// it only counts until the first bin is closed.
+void ClockSync::fit() {
+  size_t used = std::max<size_t>(1, window_.size() - 1);
+  double n = (double)used, mh = 0, mo = 0;
+  minDelay_ = window_.front().delay;
+  for (size_t i = 0; i < used; i++) {
+    mh += window_[i].host / n;
+    mo += window_[i].offset / n;
+    minDelay_ = std::min(minDelay_, window_[i].delay);
+  }
+  double shh = 0, sho = 0;
+  for (size_t i = 0; i < used; i++) {
+    shh += (window_[i].host - mh) * (window_[i].host - mh);
+    sho += (window_[i].host - mh) * (window_[i].offset - mo);
+  }
+  drift_  = (used > 1 && shh > 0) ? sho / shh : 0;
+  offset_ = mo - drift_ * mh;
+  fitted_ = true;
+}
+
+double ClockSync::offset() const {
+  return offset_ + drift_ * lastHost_;
+}
+
+// Board time b = h + offset_ + drift_ * h, solved for the host time h
+uint64_t ClockSync::toHost(uint32_t boardTime) const {
+  double b = (double)unwrap(boardTime) * BOARD_TICK;
+  return ref_ + (int64_t)std::llround((b - offset_) / (1 + drift_));
+}
+
+
+/* =========================== Driver =========================== */
+
+Driver::Driver(const std::string &path, int baud, Layout layout, double commandRate)
+    : parser_(layout), clock_(layout, baud) {
+  port_.open(path, baud);
+  epoll_.reset(epoll_create1(EPOLL_CLOEXEC));
+  timer_.reset(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC));
+  if (epoll_.get() < 0 || timer_.get() < 0) {
+    throw std::system_error(errno, std::generic_category(), "epoll/timerfd");
+  }
+  epoll_event ev = epoll_event();
+  ev.events  = EPOLLIN;
+  ev.data.fd = port_.fd();
+  bool ok = epoll_ctl(epoll_.get(), EPOLL_CTL_ADD, port_.fd(), &ev) == 0;
+  ev.data.fd = timer_.get();
+  ok = ok && epoll_ctl(epoll_.get(), EPOLL_CTL_ADD, timer_.get(), &ev) == 0;
+  if (ok && commandRate > 0) {
+    long period = (long)(1e9 / commandRate);
+    itimerspec its = {{period / 1000000000, period % 1000000000}, {period / 1000000000, period % 1000000000}};
+    ok = timerfd_settime(timer_.get(), 0, &its, nullptr) == 0;
+  }
+  if (!ok) {
+    throw std::system_error(errno, std::generic_category(), "epoll/timerfd");
+  }
+}
+
+void Driver::setCommand(int16_t steer, int16_t speed, uint16_t driveMode) {
+  steer_      = steer;
+  speed_      = speed;
+  driveMode_  = driveMode;
+  commandSet_ = true;
+}
+
+void Driver::sendCommand() {
+  if (!commandSet_) {
+    return;
+  }
+  if (txPos_ < txLen_) {
+    parser_.stats().commandsDropped++;          // Previous frame still being written: skip this period
+    return;
+  }
+  txLen_ = encodeCommand(parser_.layout(), steer_, speed_, driveMode_, tx_, ++syncId_);
+  txPos_ = 0;
+  uint64_t now = monotonicNs();
+  writeTx();
+  if (txLen_) {
+    clock_.sent(syncId_, now);
+    parser_.stats().commandsSent++;
+  } else {
+    parser_.stats().commandsDropped++;          // Tx buffer full: skip this period rather than queue stale commands
+  }
+}
+
+ /*
+ * Write the rest of the command frame. Once a part of it is on the wire the rest has to follow, else the board
+ * sees a corrupt frame: a short write arms EPOLLOUT until the frame is complete. A frame of which nothing was
+ * written is dropped whole (txLen_ = 0).
+ */
+void Driver::writeTx() {
+  ssize_t n = write(port_.fd(), &tx_[txPos_], txLen_ - txPos_);
+  if (n > 0) {
+    txPos_ += (size_t)n;
+  } else if (txPos_ == 0) {
+    txLen_ = 0;
+  }
+  bool pending = txPos_ < txLen_;
+  if (pending != txWait_) {
+    epoll_event ev = epoll_event();
+    ev.events  = pending ? (uint32_t)(EPOLLIN | EPOLLOUT) : (uint32_t)EPOLLIN;
+    ev.data.fd = port_.fd();
+    epoll_ctl(epoll_.get(), EPOLL_CTL_MOD, port_.fd(), &ev);
+    txWait_ = pending;
+  }
+}
+
+void Driver::readPort() {
+  uint8_t buf[4096];
+  ssize_t n;
+  while ((n = read(port_.fd(), buf, sizeof(buf))) > 0) {
+    parser_.parse(buf, (size_t)n, monotonicNs(), [this](const Feedback &fb) {
+      latest_ = fb;
+      if (parser_.layout().timestamp) {
+        clock_.received(fb);
+        latest_.hostTime = clock_.synced() ? clock_.toHost(fb.boardTime) : 0;
+      }
+      if (handler_) {
+        handler_(latest_);
+      }
+    });
+  }
+}
+
+int Driver::poll(int timeoutMs) {
+  epoll_event events[2];
+  uint64_t frames = parser_.stats().frames;
+  int n = epoll_wait(epoll_.get(), events, 2, timeoutMs);
+  if (n < 0) {
+    return (errno == EINTR) ? 0 : -1;
+  }
+  for (int i = 0; i < n; i++) {
+    if (events[i].data.fd == timer_.get()) {
+      uint64_t expirations;
+      if (read(timer_.get(), &expirations, sizeof(expirations)) == sizeof(expirations)) {
+        sendCommand();                          // one command per poll even if periods were missed
+      }
+    } else if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+      return -1;
+    } else {
+      if (events[i].events & EPOLLOUT) {
+        writeTx();
+      }
+      if (events[i].events & EPOLLIN) {
+        readPort();
+      }
+    }
+  }
+  return (int)(parser_.stats().frames - frames);
+}
+
+}  // namespace hoverserial
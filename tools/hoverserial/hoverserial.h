@@ -0,0 +1,241 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Linux host driver for the serial command/feedback protocol of the firmware:
+// CONTROL_SERIAL_USARTx and FEEDBACK_SERIAL_USARTx in config.h, SerialCommand in util.h, SerialFeedback in main.c.
+// All frames are little endian 16-bit words: start (SERIAL_START_FRAME), fields, XOR checksum of all words before it.
+
+#ifndef HOVERSERIAL_H
+#define HOVERSERIAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace hoverserial {
+
+constexpr uint16_t START_FRAME = 0xABCD;    // SERIAL_START_FRAME
+constexpr uint32_t BOARD_TICK  = 62500;     // [ns] board time unit (buzzerTimer, 16 kHz)
+constexpr uint16_t NO_SYNC     = 0xFFFF;    // Feedback::syncAge without a recent command
+
+// Optional frame fields, must match the firmware build
+struct Layout {
+  bool bus        = false;                  // SERIAL_BUS: node address after the start word of command and feedback
+  bool driveMode  = false;                  // MULTI_MODE_DRIVE with CONTROL_SERIAL_USART2/3: driveMode word in command and feedback
+  bool multiBoard = false;                  // MULTI_BOARD_MASTER: slave board feedback appended to the feedback
+  bool timestamp  = false;                  // FEEDBACK_TIMESTAMP: syncId in the command, board time and sync echo in the feedback
+  constexpr size_t feedbackSize() const { return 2 * (8 + bus + driveMode + 8 * multiBoard + 4 * timestamp); }
+  constexpr size_t commandSize()  const { return 2 * (4 + bus + driveMode + timestamp); }
+};
+
+struct Feedback {
+  uint16_t  address;                        // Layout::bus only: node id of the sender
+  int16_t   leftSpeed;                      // [rpm]
+  int16_t   rightSpeed;                     // [rpm]
+  uint16_t  leftTicks;                      // Hall sensor ticks, wraps around
+  uint16_t  rightTicks;
+  int16_t   batVoltage;                     // [V * 100]
+  int16_t   boardTemp;                      // [deg C * 10]
+  uint16_t  driveMode;                      // Layout::driveMode only
+  uint16_t  tick;                           // Layout::multiBoard only: master main loop counter
+  int16_t   slaveLeftSpeed;
+  int16_t   slaveRightSpeed;
+  uint16_t  slaveLeftTicks;
+  uint16_t  slaveRightTicks;
+  int16_t   slaveBatVoltage;
+  int16_t   slaveBoardTemp;
+  uint16_t  slaveTick;                      // master tick of the last command applied by the slave
+  uint32_t  boardTime;                      // Layout::timestamp only: board time of the frame [1/16 ms], wraps around
+  uint16_t  syncId;                         // syncId of the last command the board received
+  uint16_t  syncAge;                        // [1/16 ms] from its reception to boardTime, NO_SYNC: none
+  uint64_t  rxTime;                         // [ns] CLOCK_MONOTONIC time of the read that completed the frame
+  uint64_t  hostTime;                       // [ns] CLOCK_MONOTONIC time of boardTime once the Driver clock is synced, else 0
+};
+
+struct Stats {
+  uint64_t  bytes          = 0;             // bytes received
+  uint64_t  frames         = 0;             // valid feedback frames
+  uint64_t  checksumErrors = 0;             // frames with a start word but a wrong checksum
+  uint64_t  skippedBytes   = 0;             // bytes dropped while resynchronizing
+  uint64_t  commandsSent   = 0;
+  uint64_t  commandsDropped= 0;             // paced commands not sent because the port was busy
+};
+
+using FeedbackHandler = std::function<void(const Feedback &)>;
+
+ /*
+ * Feedback frame parser with resynchronization. Frames that lie within one read buffer are decoded in place,
+ * only a frame split over two reads is assembled in a small carry buffer.
+ */
+class FrameParser {
+public:
+  explicit FrameParser(Layout layout = Layout());
+  size_t parse(const uint8_t *data, size_t len, uint64_t rxTime, const FeedbackHandler &handler);  // returns valid frames
+  void reset() { carryLen_ = 0; }
+  const Layout &layout() const { return layout_; }
+  Stats &stats() { return stats_; }
+
+private:
+  bool valid(const uint8_t *frame) const;
+  void decode(const uint8_t *frame, uint64_t rxTime, const FeedbackHandler &handler);
+
+  Layout    layout_;
+  size_t    size_;
+  uint8_t   carry_[64];
+  size_t    carryLen_ = 0;
+  Stats     stats_;
+};
+
+// Encode a command frame into out (Layout::commandSize() bytes), returns the frame size
+size_t encodeCommand(const Layout &layout, int16_t steer, int16_t speed, uint16_t driveMode, uint8_t *out,
+                     uint16_t syncId = 0, uint16_t address = 0);
+
+// Owner of a file descriptor (epoll, timerfd): closed on destruction, also when a constructor throws
+class FileDesc {
+public:
+  explicit FileDesc(int fd = -1) : fd_(fd) {}
+  FileDesc(const FileDesc &) = delete;
+  FileDesc &operator=(const FileDesc &) = delete;
+  ~FileDesc() { reset(); }
+  void reset(int fd = -1);
+  int  get() const { return fd_; }
+
+private:
+  int fd_;
+};
+
+// Raw, non-blocking serial port (termios). Also works on a pty
+class SerialPort {
+public:
+  SerialPort() = default;
+  SerialPort(const SerialPort &) = delete;
+  SerialPort &operator=(const SerialPort &) = delete;
+  ~SerialPort() { close(); }
+  void open(const std::string &path, int baud);   // throws std::system_error
+  void close();
+  int  fd() const { return fd_; }
+
+private:
+  int fd_ = -1;
+};
+
+ /*
+ * Host clock estimate of the board time (FEEDBACK_TIMESTAMP), NTP style. Each feedback frame echoes the syncId of the
+ * last command with the time since the board received it, which gives the four times of an NTP exchange:
+ * t1 command written, t2 = boardTime - syncAge, t3 = boardTime, t4 feedback read. Per sample
+ *   offset = ((t2 - t1) + (t3 - t4)) / 2      delay = (t4 - t1) - (t3 - t2)
+ * after removing the known serial frame times from t1 / t4. Queueing in the USB adapter and the host only ever
+ * adds delay, so the minimum delay sample of each bin (1 s) is the least disturbed one. A line fitted through the
+ * bins of the window gives the offset and the drift of the board clock (crystal tolerance, tens of ppm).
+ * The USB latency itself is assumed symmetric, any asymmetry shows up as a constant offset error.
+ */
+class ClockSync {
+public:
+  explicit ClockSync(Layout layout = Layout(), int baud = 115200, uint64_t binTime = 1000000000ull, size_t bins = 60);
+  void     sent(uint16_t syncId, uint64_t hostTime);   // command with syncId written at hostTime [ns]
+  bool     received(const Feedback &fb);               // take the sample echoed by fb, false if it has none
+  bool     synced() const { return fitted_; }
+  uint64_t toHost(uint32_t boardTime) const;           // [ns] CLOCK_MONOTONIC, boardTime within ~37 h of the last frame
+  double   offset() const;                             // [ns] board minus host clock at the last sample
+  double   drift() const { return drift_ * 1e6; }      // [ppm] board clock rate error
+  double   delay() const { return minDelay_; }         // [ns] minimum round trip delay in the window
+  uint64_t samples() const { return samples_; }
+
+private:
+  struct Sample {
+    double  host;                                      // [ns] host time of the exchange, relative to ref_
+    double  offset;                                    // [ns]
+    double  delay;                                     // [ns]
+  };
+  int64_t unwrap(uint32_t boardTime) const;            // board time [ticks] without wrap around
+  void    fit();
+
+  double              txFrame_;                        // [ns] command frame plus the idle character
+  double              rxFrame_;                        // [ns] feedback frame
+  uint64_t            binTime_;
+  size_t              bins_;
+  uint16_t            sentId_[256];
+  uint64_t            sentTime_[256] = {};
+  std::vector<Sample> window_;                         // best sample per bin, oldest first, last one still open
+  uint64_t            ref_ = 0;                        // host time of the first sample
+  int64_t             lastBoard_ = 0;
+  bool                haveBoard_ = false;
+  bool                fitted_ = false;
+  double              offset_ = 0;                     // [ns] fitted offset at host time 0 (ref_)
+  double              drift_ = 0;                      // fitted offset change per host ns
+  double              lastHost_ = 0;
+  double              minDelay_ = 0;
+  uint64_t            samples_ = 0;
+};
+
+ /*
+ * epoll driven driver: reads the feedback as it arrives and sends the latest command at a fixed rate,
+ * so the firmware serial timeout (SERIAL_TIMEOUT) never triggers and the link is never flooded.
+ * Single threaded: call poll() from the application loop, or run() in a thread of its own.
+ * With Layout::timestamp every command carries a new syncId and Feedback::hostTime is filled in once synced.
+ * A command the Tx buffer only partly took is finished on EPOLLOUT, the next period is skipped while it is pending.
+ */
+class Driver {
+public:
+  Driver(const std::string &path, int baud = 115200, Layout layout = Layout(), double commandRate = 50.0);
+  Driver(const Driver &) = delete;
+  Driver &operator=(const Driver &) = delete;
+
+  void setCommand(int16_t steer, int16_t speed, uint16_t driveMode = 0);
+  void stopCommands() { commandSet_ = false; }        // stop sending, the firmware times out and disables the motors
+  void onFeedback(FeedbackHandler handler) { handler_ = std::move(handler); }
+  int  poll(int timeoutMs);                       // wait for data or the command timer, returns valid frames or -1
+  void run() { while (running_ && poll(100) >= 0) {} }
+  void stop() { running_ = false; }
+
+  const Feedback &latest() const { return latest_; }
+  const Stats &stats() { return parser_.stats(); }
+  const ClockSync &clock() const { return clock_; }
+
+private:
+  void readPort();
+  void sendCommand();
+  void writeTx();
+
+  SerialPort      port_;
+  FrameParser     parser_;
+  FeedbackHandler handler_;
+  Feedback        latest_ = Feedback();
+  FileDesc        epoll_;
+  FileDesc        timer_;
+  ClockSync       clock_;
+  uint8_t         tx_[16];                      // command frame being written
+  size_t          txLen_ = 0;
+  size_t          txPos_ = 0;                   // bytes of tx_ on the wire
+  bool            txWait_ = false;              // EPOLLOUT armed for the rest of tx_
+  int16_t         steer_ = 0;
+  int16_t         speed_ = 0;
+  uint16_t        driveMode_ = 0;
+  bool            commandSet_ = false;
+  uint16_t        syncId_ = 0;
+  volatile bool   running_ = true;
+};
+
+uint64_t monotonicNs();
+
+}  // namespace hoverserial
+
+#endif
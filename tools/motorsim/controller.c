@@ -0,0 +1,115 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// The firmware motor controller, built for the host. The generated code refuses a 64 bit long in its word size
+// checks, it does not use long itself: present the target sizes to the checks only.
+
+#include <limits.h>
+#undef  ULONG_MAX
+#undef  LONG_MAX
+#define ULONG_MAX   0xFFFFFFFFU
+#define LONG_MAX    0x7FFFFFFF
+
+// make FIXED=<control type>: the controller specialized with CTRL_TYP_FIXED for that control type
+#ifdef BENCH_CTRL_TYP_FIXED
+  #include "config.h"
+  #undef  CTRL_TYP_SEL
+  #define CTRL_TYP_SEL  BENCH_CTRL_TYP_FIXED
+  #ifndef CTRL_TYP_FIXED
+    #define CTRL_TYP_FIXED
+  #endif
+#endif
+
+#include "BLDC_controller.c"
+
+#include "motorsim.h"
+
+// Parameters of the build, as set by BLDC_Init() (util.c)
+void buildParams(P *p, BuildConfig *cfg) {
+  p->b_angleMeasEna     = 0;
+  p->z_selPhaCurMeasABC = 0;
+  p->z_ctrlTypSel       = CTRL_TYP_SEL;
+  p->b_diagEna          = DIAG_ENA;
+  p->i_max              = (I_MOT_MAX * A2BIT_CONV) << 4;
+  p->n_max              = N_MOT_MAX << 4;
+  p->b_fieldWeakEna     = FIELD_WEAK_ENA;
+  p->id_fieldWeakMax    = (FIELD_WEAK_MAX * A2BIT_CONV) << 4;
+  p->a_phaAdvMax        = PHASE_ADV_MAX << 4;
+  p->r_fieldWeakHi      = FIELD_WEAK_HI << 4;
+  p->r_fieldWeakLo      = FIELD_WEAK_LO << 4;
+
+  cfg->a2bit            = A2BIT_CONV;
+  cfg->pwmFreq          = PWM_FREQ;
+  cfg->mainLoop         = DELAY_IN_MAIN_LOOP;
+  cfg->iMotMax          = I_MOT_MAX;
+  cfg->iDcMax           = I_DC_MAX;
+  cfg->nMotMax          = N_MOT_MAX;
+  cfg->ctrlModReq       = CTRL_MOD_REQ;
+  #ifdef CTRL_TYP_FIXED
+  cfg->ctrlTypFixed     = CTRL_TYP_SEL;
+  #else
+  cfg->ctrlTypFixed     = -1;
+  #endif
+}
+
+long sweepDivisionFree(int site, const char **name, long *inputs) {
+  long    bad = 0;
+  int32_t n;
+
+  switch (site) {
+    case 0:
+      *name = "Vq_max_XA          bpSpace 320";
+      for (n = INT16_MIN; n <= INT16_MAX; n++) {
+        bad += plook_u8s16_evencka_rcp((int16_T)n, 0, 13421773U, 45U) != plook_u8s16_evencka((int16_T)n, 0, 320U, 45U);
+      }
+      *inputs = 1L << 16;
+      break;
+    case 1:
+      *name = "iq_maxSca_XA       bpSpace 1311";
+      for (n = 0; n <= UINT16_MAX; n++) {
+        bad += plook_u8u16_evencka_rcp((uint16_T)n, 0U, 3276101U, 49U) != plook_u8u16_evencka((uint16_T)n, 0U, 1311U, 49U);
+      }
+      *inputs = 1L << 16;
+      break;
+    case 2:
+      *name = "a_elecAngle_XA     bpSpace 128";
+      for (n = INT16_MIN; n <= INT16_MAX; n++) {
+        bad += plook_u8s16_evencka_pow2((int16_T)n, 0, 7U, 180U) != plook_u8s16_evencka((int16_T)n, 0, 128U, 180U);
+      }
+      *inputs = 1L << 16;
+      break;
+    case 3:
+      *name = "a_elecPeriod       floor(n / 5760), |n| < 2^24";
+      for (n = -(1 << 24) + 1; n < (1 << 24); n++) {
+        bad += div_nde_s32_floor_rcp(n, 23860930U, 37U) != div_nde_s32_floor(n, 5760);
+      }
+      *inputs = (1L << 25) - 1;
+      break;
+    case 4:
+      *name = "Switch_PhaAdv      floor(n / 23040), int16 n";
+      for (n = INT16_MIN; n <= INT16_MAX; n++) {
+        bad += div_nde_s32_floor_rcp(n, 23860930U, 39U) != div_nde_s32_floor(n, 23040);
+      }
+      *inputs = 1L << 16;
+      break;
+    default:
+      return -1;
+  }
+  return bad;
+}
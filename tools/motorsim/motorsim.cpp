@@ -0,0 +1,613 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Hub motor model around the firmware motor controller (Src/BLDC_controller.c) and control type scheduler
+// (Src/ctrlsched.c), built with the settings of Inc/config.h:
+//   motorsim amp                     fundamental phase voltage per input target of COM, SIN and FOC (ctrlTypAmp)
+//   motorsim eff [slope_%]           input power and efficiency of each control type at steady speeds on a road load
+//   motorsim ramp [slope_%]          accelerate through the scheduler bands and slow down again: torque bumps at the
+//                                    control type switches with and without voltage matching, switches at a band edge
+//   motorsim sweep                   division-free prelookups and floor divisions against the generated divisions
+//   motorsim bench                   host instructions of the controller step per control type at a steady speed
+//   motorsim split                   4WD torque split (Src/multiboard.c) on a vehicle with four driven wheels and
+//                                    tire slip: one axle on a slippery patch, slip control against the fixed split
+
+#include "motorsim.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <vector>
+#include <csignal>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+enum {COM_CTRL, SIN_CTRL, FOC_CTRL};          // control types and the voltage and torque mode as in config.h
+static const int VLT_MODE = 1;
+static const int TRQ_MODE = 3;
+
+static const double PI = 3.14159265358979;
+static const char *ctrlTypName[3] = {"COM", "SIN", "FOC"};
+
+// Hub motor of a 6.5" hoverboard wheel on a 36 V battery, sinusoidal back-EMF, in the alpha/beta frame.
+// Mechanics: one wheel carries half of a 80 kg rider and board.
+struct Motor {
+  double R   = 0.14;        // [Ohm] phase resistance, MOSFET on-resistance included
+  double L   = 0.3e-3;      // [H] phase inductance
+  double ke  = 0.45;        // [V s/rad] phase back-EMF amplitude per mechanical speed
+  double pp  = 15;          // [-] pole pairs
+  double J   = 0.27;        // [kg m^2] wheel and rider share, reflected to the wheel
+  double kfe = 0.003;       // [N m s/rad] iron and bearing losses as a viscous drag
+  double vdc = 36;          // [V] battery
+  double hallOffset = -PI / 6;   // [rad] hall sector edges relative to the back-EMF (vec_hallToPos convention)
+
+  double ia = 0, ib = 0;    // [A] alpha / beta current
+  double w  = 0;            // [rad/s] mechanical speed
+  double th = 0;            // [rad] electrical angle
+
+  double torque() const { return 1.5 * ke * (ib * std::cos(th) - ia * std::sin(th)); }
+  double phaseA() const { return ia; }
+  double phaseB() const { return -0.5 * ia + 0.8660254 * ib; }
+
+  // Hall code (hallA << 2 | hallB << 1 | hallC) of the rotor position
+  uint8_t hall() const {
+    static const uint8_t posToHall[6] = {2, 3, 1, 5, 4, 6};   // inverse of vec_hallToPos
+    int pos = (int)std::floor((th + hallOffset) / (PI / 3));
+    return posToHall[((pos % 6) + 6) % 6];
+  }
+
+  // Advance by h with the phase voltages va, vb, vc [V] against the load torque [N m]
+  void step(double va, double vb, double vc, double load, double h) {
+    double valpha = (2.0 / 3) * (va - 0.5 * (vb + vc));
+    double vbeta  = (vb - vc) / std::sqrt(3.0);
+    double e      = ke * w;
+    ia += h * (valpha - R * ia + e * std::sin(th)) / L;
+    ib += h * (vbeta  - R * ib - e * std::cos(th)) / L;
+    w  += h * (torque() - kfe * w - load) / J;
+    th  = std::fmod(th + h * w * pp + 4 * PI, 2 * PI);
+  }
+};
+
+// Road load of one wheel: rolling resistance, air drag and slope [N m] at the wheel speed w [rad/s]
+struct Road {
+  double r     = 0.0825;    // [m] wheel radius
+  double mass  = 40;        // [kg] share of rider and board per wheel
+  double crr   = 0.01;      // [-] rolling resistance
+  double cda   = 0.25;      // [m^2] drag area share per wheel
+  double slope = 0;         // [%]
+
+  double torque(double w) const {
+    double v    = w * r;
+    double roll = crr * mass * 9.81 * (w > 0.1 ? 1 : w < -0.1 ? -1 : w / 0.1);
+    return r * (roll + 0.5 * 1.2 * cda * v * std::fabs(v) + mass * 9.81 * slope / 100);
+  }
+};
+
+// One motor with its controller as in bldc.c (PWM_FREQ step, PWM margin in FOC), the scheduler as in util.c
+struct Drive {
+  BuildConfig cfg;
+  RT_MODEL    rtm;
+  DW          dw;
+  ExtU        u;
+  ExtY        y;
+  P           p;
+  Motor       m;
+  Road        road;
+  CtrlSched   sched;
+  bool        schedEna = false;
+  int         pwm      = 0;                 // input target as pwml in main.c
+  uint64_t    steps    = 0;
+  std::vector<ExtU>    *inputLog = nullptr;       // if set, the controller inputs of each step are appended
+  std::function<double(double)> load;       // if set, load torque [N m] at the wheel speed instead of the road
+  double      vd = 0, vq = 0, idc = 0;      // last period: voltage in the rotor frame [V], DC link current [A]
+
+  // ctrlTyp < 0: the scheduler picks the control type
+  explicit Drive(int ctrlTyp) {
+    memset(&dw, 0, sizeof(dw));
+    memset(&u, 0, sizeof(u));
+    memset(&y, 0, sizeof(y));
+    buildParams(&p, &cfg);
+    ctrlSchedInit(&sched);
+    schedEna         = ctrlTyp < 0;
+    p.z_ctrlTypSel   = schedEna ? sched.ctrlTyp : (uint8_t)ctrlTyp;
+    rtm.defaultParam = &p;
+    rtm.dwork        = &dw;
+    rtm.inputs       = &u;
+    rtm.outputs      = &y;
+    BLDC_controller_initialize(&rtm);
+  }
+
+  double time() const { return (double)steps / cfg.pwmFreq; }
+
+  // One PWM period, the scheduler every main loop
+  void step() {
+    const int pwmRes = 64000000 / 2 / cfg.pwmFreq;
+    if (schedEna && steps % (cfg.pwmFreq * cfg.mainLoop / 1000) == 0) {
+      ctrlSchedStep(&sched, (int16_t)std::abs(y.n_mot), (int16_t)std::abs(u.i_DCLink), cfg.ctrlModReq == VLT_MODE);
+      p.z_ctrlTypSel = sched.ctrlTyp;
+    }
+    int tgt = schedEna ? (pwm * sched.gain) >> 14 : pwm;
+    uint8_t hall    = m.hall();
+    u.b_motEna      = 1;
+    u.z_ctrlModReq  = (uint8_t)cfg.ctrlModReq;
+    u.r_inpTgt      = (int16_t)std::max(-2000, std::min(2000, tgt));
+    u.b_hallA       = (hall >> 2) & 1;
+    u.b_hallB       = (hall >> 1) & 1;
+    u.b_hallC       = hall & 1;
+    u.i_phaAB       = (int16_t)std::lround(m.phaseA() * cfg.a2bit);
+    u.i_phaBC       = (int16_t)std::lround(m.phaseB() * cfg.a2bit);
+    if (inputLog) {
+      inputLog->push_back(u);
+    }
+    BLDC_controller_step(&rtm);
+
+    int    margin = (p.z_ctrlTypSel == FOC_CTRL) ? 110 : 0;
+    auto   duty   = [&](int v) { return std::max(margin, std::min(pwmRes - margin, v + pwmRes / 2)) / (double)pwmRes; };
+    double da = duty(y.DC_phaA), db = duty(y.DC_phaB), dc = duty(y.DC_phaC);
+    double ia = m.phaseA(), ib = m.phaseB();
+    idc        = da * ia + db * ib - dc * (ia + ib);
+    u.i_DCLink = (int16_t)std::lround(idc * cfg.a2bit);
+
+    double va = da * m.vdc, vb = db * m.vdc, vc = dc * m.vdc;
+    double valpha = (2.0 / 3) * (va - 0.5 * (vb + vc)), vbeta = (vb - vc) / std::sqrt(3.0);
+    vd = valpha * std::cos(m.th) + vbeta * std::sin(m.th);
+    vq = vbeta * std::cos(m.th) - valpha * std::sin(m.th);
+    const int sub = 4;
+    for (int i = 0; i < sub; i++) {
+      m.step(va, vb, vc, load ? load(m.w) : road.torque(m.w), 1.0 / cfg.pwmFreq / sub);
+    }
+    steps++;
+  }
+
+  void run(double seconds) {
+    for (uint64_t end = steps + (uint64_t)(seconds * cfg.pwmFreq); steps < end;) step();
+  }
+
+  // Throttle like a rider holding a speed [rpm]: slow PI on the input target, called every ms. The reference
+  // speeds up at 100 rpm/s, a step would saturate the input into the current limit and wind up the integrator
+  double integ = 0, ref = 0;
+  void hold(double speed) {
+    ref        = std::min(speed, ref + 0.1);
+    double err = ref * 2 * PI / 60 - m.w;
+    integ = std::max(-1000.0, std::min(1000.0, integ + 0.5 * err));
+    pwm   = (int)std::max(-1000.0, std::min(1000.0, 10 * err + integ));
+  }
+};
+
+static double rpm(double w) { return w * 60 / (2 * PI); }
+
+
+/* =========================== amp =========================== */
+
+// Fundamental phase voltage at a light load: rotor frame projection of the applied voltages
+static int amp() {
+  const int inp = 400;
+  double v[3];
+  for (int typ = 0; typ < 3; typ++) {
+    Drive d(typ);
+    d.pwm = inp;
+    d.run(4);
+    double sd = 0, sq = 0;
+    int    n  = 0;
+    for (; n < d.cfg.pwmFreq; n++) {
+      d.step();
+      sd += d.vd;
+      sq += d.vq;
+    }
+    v[typ] = std::hypot(sd / n, sq / n);
+    printf("%s: %6.3f V at input %d, %5.1f rpm\n", ctrlTypName[typ], v[typ], inp, rpm(d.m.w));
+  }
+  printf("ctrlTypAmp relative to FOC fixdt(0,16,14): {%ld, %ld, %ld}\n", std::lround(16384 * v[0] / v[2]),
+         std::lround(16384 * v[1] / v[2]), 16384L);
+  return 0;
+}
+
+
+/* =========================== eff =========================== */
+
+// Hold each speed for 6 s, average input and road power over the following 2 s
+static int eff(double slope) {
+  Drive probe(FOC_CTRL);
+  printf("road: 80 kg on two 6.5\" wheels, slope %.1f %%, N_MOT_MAX %d rpm\n", slope, probe.cfg.nMotMax);
+  printf(" rpm |  COM: Pin [W]  eff [%%] |  SIN: Pin [W]  eff [%%] |  FOC: Pin [W]  eff [%%] | best\n");
+  for (int n = 50; n <= probe.cfg.nMotMax + 150; n += 50) {
+    double pin[3];
+    printf("%4d |", n);
+    for (int typ = 0; typ < 3; typ++) {
+      Drive  d(typ);
+      double sumIn = 0, sumOut = 0, maxErr = 0;
+      d.road.slope = slope;
+      for (int ms = 0; ms < 8000; ms++) {
+        d.hold(n);
+        for (int k = 0; k < d.cfg.pwmFreq / 1000; k++) {
+          d.step();
+          if (ms >= 6000) {
+            sumIn  += d.idc * d.m.vdc;
+            sumOut += d.road.torque(d.m.w) * d.m.w;
+          }
+        }
+        if (ms >= 6000) {
+          maxErr = std::max(maxErr, std::fabs(rpm(d.m.w) - n));
+        }
+      }
+      bool reached = maxErr < 5;
+      pin[typ] = reached ? sumIn / (2 * d.cfg.pwmFreq) : 0;
+      if (reached) {
+        printf(" %13.1f %8.1f |", pin[typ], 100 * sumOut / sumIn);
+      } else {
+        printf("           not reached |");
+      }
+    }
+    int best = -1;
+    for (int typ = 0; typ < 3; typ++) {
+      if (pin[typ] > 0 && (best < 0 || pin[typ] < pin[best])) best = typ;
+    }
+    printf(" %s\n", best < 0 ? "-" : ctrlTypName[best]);
+  }
+  return 0;
+}
+
+
+/* =========================== ramp =========================== */
+
+struct Switch {
+  double  time, speed, bump;
+  uint8_t from, to;
+};
+
+// Torque averaged over 20 ms: filters the COM torque ripple
+struct TorqueAvg {
+  std::deque<double> buf;
+  double sum = 0;
+  size_t len;
+  explicit TorqueAvg(size_t n) : len(n) {}
+  double add(double t) {
+    buf.push_back(t);
+    sum += t;
+    if (buf.size() > len) {
+      sum -= buf.front();
+      buf.pop_front();
+    }
+    return sum / buf.size();
+  }
+};
+
+// Throttle ramp to full input, hold, ramp down to 0. bump: largest deviation of the averaged torque within 200 ms
+// after a switch from the trend of the 50 ms before it
+static std::vector<Switch> rampRun(double slope, bool match) {
+  Drive d(-1);
+  d.sched.matchEna = match;
+  d.road.slope     = slope;
+  TorqueAvg avg((size_t)(d.cfg.pwmFreq / 50));
+  std::vector<Switch> sw;
+  std::vector<double> trq;                  // averaged torque per ms
+  uint16_t switches = 0;
+  const int rampMs = 6000, holdMs = 4000;
+  for (int ms = 0; ms < 2 * rampMs + holdMs + 2000; ms++) {
+    double thr = (ms < rampMs) ? ms / (double)rampMs : (ms < rampMs + holdMs) ? 1 :
+                 std::max(0.0, 1 - (ms - rampMs - holdMs) / (double)rampMs);
+    d.pwm = (int)(thr * 1000);
+    double t = 0;
+    for (int k = 0; k < d.cfg.pwmFreq / 1000; k++) {
+      uint8_t typ = d.sched.ctrlTyp;
+      d.step();
+      t = avg.add(d.m.torque());
+      if (d.sched.switches != switches) {
+        switches = d.sched.switches;
+        sw.push_back({d.time(), rpm(d.m.w), 0, typ, d.sched.ctrlTyp});
+      }
+    }
+    trq.push_back(t);
+  }
+  for (Switch &s : sw) {
+    size_t at    = (size_t)(s.time * 1000);
+    double trend = (at >= 50) ? (trq[at] - trq[at - 50]) / 50 : 0;
+    for (size_t i = at; i < std::min(trq.size(), at + 200); i++) {
+      s.bump = std::max(s.bump, std::fabs(trq[i] - trq[at] - trend * (i - at)));
+    }
+  }
+  return sw;
+}
+
+// Settle at a band edge like a rider holding the speed, then disturb with a varying slope
+static int edgeRun(double slope, int edge) {
+  Drive d(-1);
+  d.road.slope = slope;
+  for (int ms = 0; ms < 10000; ms++) {
+    if (ms < 4000) {
+      d.hold(edge);
+    } else {
+      d.road.slope = slope + 2 * std::sin(2 * PI * ms / 700.0);
+    }
+    if (ms == 4000) {
+      d.sched.switches = 0;
+    }
+    d.run(0.001);
+  }
+  return d.sched.switches;
+}
+
+// Scheduler rules away from the motor: the input target gain outside VOLTAGE mode, band edges set at runtime
+static bool schedRules() {
+  CtrlSched s;
+  ctrlSchedInit(&s);
+  s.hold = s.dwell;
+  s.ctrlTyp = COM_CTRL;
+  ctrlSchedStep(&s, 0, 0, 1);                                  // VOLTAGE mode: matched switch COM -> FOC
+  uint16_t vltGain = s.gain;
+  s.hold = s.dwell;
+  s.ctrlTyp = COM_CTRL;
+  ctrlSchedStep(&s, 0, 0, 0);                                  // mode change to TRQ / SPD: FOC
+  bool ok = s.gain == 16384;
+  printf("mode switch to FOC: gain %u (VOLTAGE mode switch %u)%s\n", s.gain, vltGain, ok ? "" : "  <- not 1.0");
+
+  const int16_t set[][2] = {{1, 400}, {1, 20}, {0, 0}, {0, 500}};   // hiSet, value
+  for (auto &c : set) {
+    ctrlSchedInit(&s);
+    (c[0] ? s.n_hi : s.n_mid) = c[1];
+    ctrlSchedBands(&s, (uint8_t)c[0]);
+    bool good = s.n_mid >= 0 && s.n_mid + s.n_hyst < s.n_hi && (c[0] ? s.n_hi : s.n_mid) >= c[1];
+    printf("set %s %4d: n_mid %d n_hi %d%s\n", c[0] ? "n_hi " : "n_mid", c[1], s.n_mid, s.n_hi, good ? "" : "  <- wrong");
+    ok &= good;
+  }
+  return ok;
+}
+
+static int ramp(double slope) {
+  Drive probe(-1);
+  const CtrlSched &s = probe.sched;
+  double ratedTorque = 1.5 * probe.m.ke * probe.cfg.iMotMax;
+  double maxBump     = 0.15 * ratedTorque;  // [N m] largest bump of a matched switch
+  std::vector<Switch> runs[2];
+  bool   ok          = true;
+  printf("bands: %s < %d rpm < %s < %d rpm < %s, hysteresis %d rpm, low band above %d A DC, dwell %d ms\n",
+         ctrlTypName[s.typ[0]], s.n_mid, ctrlTypName[s.typ[1]], s.n_hi, ctrlTypName[s.typ[2]], s.n_hyst,
+         s.i_hi / probe.cfg.a2bit, s.dwell * probe.cfg.mainLoop);
+  for (int match = 1; match >= 0; match--) {
+    std::vector<Switch> &sw = runs[match] = rampRun(slope, match);
+    printf("%s voltage matching:\n", match ? "with" : "without");
+    for (size_t i = 0; i < sw.size(); i++) {
+      printf("  %6.3f s %5.0f rpm %s -> %s  torque bump %.3f N m (%.1f %% of rated)\n", sw[i].time, sw[i].speed,
+             ctrlTypName[sw[i].from], ctrlTypName[sw[i].to], sw[i].bump, 100 * sw[i].bump / ratedTorque);
+      if (i > 0 && (sw[i].time - sw[i - 1].time) * 1000 < s.dwell * probe.cfg.mainLoop - 1) {
+        printf("  switch within the dwell time\n");
+        ok = false;
+      }
+    }
+  }
+  int edgeSpeed = (s.typ[0] != s.typ[1]) ? s.n_mid : s.n_hi;     // first edge that switches
+  int edge      = edgeRun(slope, edgeSpeed);
+  printf("band edge: %d switches in 6 s at %d rpm with a +-2 %% slope disturbance\n", edge, edgeSpeed);
+  ok &= edge <= 1;
+  // Per switch: matching must not make it worse, and the matched bump stays below the limit
+  if (runs[1].size() != runs[0].size()) {
+    printf("%zu switches with matching, %zu without\n", runs[1].size(), runs[0].size());
+    ok = false;
+  }
+  for (size_t i = 0; i < std::min(runs[0].size(), runs[1].size()); i++) {
+    const Switch &a = runs[1][i], &b = runs[0][i];
+    bool good = a.from == b.from && a.to == b.to && a.bump <= b.bump && a.bump <= maxBump;
+    printf("%s -> %s: bump %.3f N m with matching, %.3f N m without, limit %.3f N m%s\n", ctrlTypName[a.from],
+           ctrlTypName[a.to], a.bump, b.bump, maxBump, good ? "" : "  <- worse");
+    ok &= good;
+  }
+  ok &= schedRules();
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
+
+
+/* =========================== sweep =========================== */
+
+static int sweep() {
+  const char *name;
+  long        inputs, bad, total = 0;
+  for (int site = 0; (bad = sweepDivisionFree(site, &name, &inputs)) >= 0; site++) {
+    printf("%-48s %9ld inputs, %ld mismatches\n", name, inputs, bad);
+    total += bad;
+  }
+  printf("%s\n", total ? "FAIL" : "PASS");
+  return total ? 1 : 0;
+}
+
+
+/* =========================== bench =========================== */
+
+// Instructions executed by fn, counted by single-stepping a forked copy of the process: exact and repeatable, unlike
+// timing on a shared machine. Returns 0 if the process cannot be traced
+template <typename Fn> static uint64_t countInstructions(Fn fn) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+    raise(SIGSTOP);
+    fn();
+    _exit(0);
+  }
+  uint64_t n = 0;
+  int status;
+  waitpid(pid, &status, 0);
+  while (WIFSTOPPED(status)) {
+    if (ptrace(PTRACE_SINGLESTEP, pid, nullptr, nullptr) < 0) {
+      kill(pid, SIGKILL);
+      waitpid(pid, &status, 0);
+      return 0;
+    }
+    waitpid(pid, &status, 0);
+    n++;
+  }
+  return n;
+}
+
+// Hold 150 rpm and log the controller inputs of 50 ms, then replay them from the same controller state without the
+// model. Host instructions per controller step: a repeatable measure to compare builds, not the target cycles.
+// A CTRL_TYP_FIXED build (make FIXED=...) runs its control type only
+static int bench() {
+  Drive probe(FOC_CTRL);
+  const char *build = probe.cfg.ctrlTypFixed < 0 ? "runtime" : "fixed";
+  for (int typ = 0; typ < 3; typ++) {
+    if (probe.cfg.ctrlTypFixed >= 0 && typ != probe.cfg.ctrlTypFixed) {
+      continue;
+    }
+    Drive d(typ);
+    std::vector<ExtU> in;
+    DW dwStart;
+    for (int ms = 0; ms < 3050; ms++) {
+      if (ms == 3000) {
+        dwStart    = d.dw;
+        d.inputLog = &in;
+      }
+      d.hold(150);
+      for (int k = 0; k < d.cfg.pwmFreq / 1000; k++) {
+        d.step();
+      }
+    }
+    d.inputLog = nullptr;
+    d.dw       = dwStart;
+    uint64_t n = countInstructions([&] {
+      for (const ExtU &u : in) {
+        d.u = u;
+        BLDC_controller_step(&d.rtm);
+      }
+    });
+    if (n == 0) {
+      fprintf(stderr, "bench: cannot trace the process\n");
+      return 1;
+    }
+    printf("%-8s %s %6.1f\n", build, ctrlTypName[typ], (double)n / in.size());
+  }
+  return 0;
+}
+
+
+/* =========================== split =========================== */
+
+// Rigid 4WD vehicle: the master board drives the front axle, the slave the rear axle, every wheel through a tire with
+// a friction coefficient of its own. Weight transfer to the rear under acceleration
+struct Vehicle {
+  double mass  = 160;       // [kg] two boards and a rider
+  double base  = 0.9;       // [m] wheelbase, centre of gravity in the middle
+  double hcg   = 0.6;       // [m] centre of gravity height
+  double slip0 = 0.06;      // [-] slip at which the tire force reaches 76 % of the friction limit (tanh)
+  double r     = 0.0825;    // [m] wheel radius
+  double v = 0, a = 0;      // [m/s] speed, [m/s^2] acceleration
+  double slope = 10;        // [%] uphill
+  double mu[2] = {0.8, 0.8};     // friction coefficient front, rear
+
+  double normal(int axle) const { return mass * 9.81 / 4 + (axle ? 1 : -1) * mass * a * hcg / base / 2; }
+  double force(int axle, double w) const {
+    double slip = (w * r - v) / std::max(std::fabs(v), 0.5);
+    return mu[axle] * normal(axle) * std::tanh(slip / slip0);
+  }
+};
+
+struct SplitResult {
+  double t1;                // [s] time to 1 m/s
+  double slipMax;           // [rpm] largest wheel speed above the vehicle speed
+  int    demandErr;         // cycles where the wheel targets of a side do not add up to the demand
+  int    shareMin;          // [%] smallest master axle share
+  int    shareMax;          // [%] largest master axle share
+};
+
+// Torque target 'cmd' (TRQ_MODE) for 4 s from standstill up the slope, the axle 'slippery' on mu 0.2. slipN = 32767: fixed nominal split
+static SplitResult splitRun(int cmd, int slippery, int16_t slipN) {
+  Vehicle veh;
+  std::vector<Drive> wheel;             // master left, master right, slave left, slave right
+  wheel.reserve(4);                     // the controller model points into each Drive: no reallocation
+  for (int i = 0; i < 4; i++) {
+    wheel.emplace_back(FOC_CTRL);
+    wheel[i].m.J = 0.03;                // wheel and rotor only, the rider is on the vehicle body
+    wheel[i].cfg.ctrlModReq = TRQ_MODE; // the split divides torque
+  }
+  for (int i = 0; i < 4; i++) {
+    wheel[i].load = [&veh, i](double w) { return veh.force(i / 2, w) * veh.r; };
+  }
+  veh.mu[slippery] = 0.2;
+  TorqueSplit split;
+  torqueSplitInit(&split, 50, 20, slipN);
+  const int cycle = wheel[0].cfg.pwmFreq * wheel[0].cfg.mainLoop / 1000;
+  const double h  = 1.0 / wheel[0].cfg.pwmFreq;
+  SplitResult res = {0, 0, 0, 50, 50};
+  int16_t nSlv[2] = {0, 0}, slvCmd[2] = {0, 0};
+  for (long k = 0; k < 4L * wheel[0].cfg.pwmFreq; k++) {
+    if (k % cycle == 0) {               // main loop of both boards, the link frames arrive one cycle later
+      for (int s = 0; s < 2; s++) {
+        wheel[2 + s].pwm = slvCmd[s];   // slave applies the targets of the last master frame
+      }
+      int16_t c[2]    = {(int16_t)cmd, (int16_t)cmd};
+      int16_t nMst[2] = {wheel[0].y.n_mot, wheel[1].y.n_mot};
+      torqueSplitStep(&split, c, slvCmd, c, nMst, nSlv, 1000);
+      for (int s = 0; s < 2; s++) {
+        wheel[s].pwm  = c[s];
+        res.demandErr += c[s] + slvCmd[s] != 2 * cmd;
+        res.shareMin   = std::min(res.shareMin, (int)((split.share[s] * 100 + (1 << 14)) >> 15));
+        res.shareMax   = std::max(res.shareMax, (int)((split.share[s] * 100 + (1 << 14)) >> 15));
+        nSlv[s]        = wheel[2 + s].y.n_mot;
+      }
+    }
+    double f = 0;
+    for (Drive &d : wheel) {
+      d.step();
+      f += veh.force(&d - &wheel[0] >= 2, d.m.w);
+      res.slipMax = std::max(res.slipMax, rpm(d.m.w - veh.v / veh.r));
+    }
+    veh.a  = (f - (0.01 + veh.slope / 100) * veh.mass * 9.81 - 0.6 * veh.v * std::fabs(veh.v)) / veh.mass;
+    veh.v += h * veh.a;
+    if (res.t1 == 0 && veh.v >= 1) {
+      res.t1 = k * h;
+    }
+  }
+  return res;
+}
+
+static int splitSim() {
+  bool ok = true;
+  const char *axle[2] = {"front", "rear"};
+  printf("4WD torque split: 50 %% nominal, 20 %% minimum per axle, slip at 40 rpm; 10 %% uphill from standstill, one axle on mu 0.2\n");
+  for (int cmd : {600, 900}) {
+    for (int slippery = 0; slippery < 2; slippery++) {
+      SplitResult fixed = splitRun(cmd, slippery, 32767);
+      SplitResult ctrl  = splitRun(cmd, slippery, 40);
+      printf("cmd %4d, %-5s slippery: fixed split 1 m/s in %.2f s, slip %3.0f rpm | slip control 1 m/s in %.2f s, "
+             "slip %3.0f rpm, share %d..%d %% | demand mismatches %d\n", cmd, axle[slippery], fixed.t1,
+             fixed.slipMax, ctrl.t1, ctrl.slipMax, ctrl.shareMin, ctrl.shareMax, ctrl.demandErr + fixed.demandErr);
+      // never slower, and where a wheel spins with the fixed split the slip control holds it lower
+      ok &= ctrl.demandErr == 0 && fixed.demandErr == 0 && ctrl.t1 > 0 && ctrl.t1 <= fixed.t1 + 0.001;
+      ok &= fixed.slipMax > 100 ? ctrl.slipMax < 0.95 * fixed.slipMax : ctrl.slipMax <= fixed.slipMax + 1;
+    }
+  }
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
+
+
+int main(int argc, char **argv) {
+  if (argc >= 2 && !strcmp(argv[1], "amp"))   return amp();
+  if (argc >= 2 && !strcmp(argv[1], "eff"))   return eff(argc > 2 ? atof(argv[2]) : 0);
+  if (argc >= 2 && !strcmp(argv[1], "ramp"))  return ramp(argc > 2 ? atof(argv[2]) : 0);
+  if (argc >= 2 && !strcmp(argv[1], "sweep")) return sweep();
+  if (argc >= 2 && !strcmp(argv[1], "bench")) return bench();
+  if (argc >= 2 && !strcmp(argv[1], "split")) return splitSim();
+  fprintf(stderr, "usage: motorsim amp | eff [slope_%%] | ramp [slope_%%] | sweep | bench | split\n");
+  return 2;
+}
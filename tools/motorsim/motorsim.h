@@ -0,0 +1,55 @@
+/**
+  * This file is part of the hoverboard-firmware-hack project.
+  *
+  * Copyright (C) 2020-2021 Emanuel FERU <aerdronix@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// C interface to the firmware sources built for the host (controller.c, Src/ctrlsched.c, Src/multiboard.c)
+
+#ifndef MOTORSIM_H
+#define MOTORSIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "BLDC_controller.h"
+#include "ctrlsched.h"
+#include "multiboard.h"
+
+// Settings of the build (Inc/config.h) the model needs
+typedef struct {
+  int   a2bit;          // [ADC counts/A] A2BIT_CONV
+  int   pwmFreq;        // [Hz] PWM_FREQ, controller step rate
+  int   mainLoop;       // [ms] DELAY_IN_MAIN_LOOP, scheduler step
+  int   iMotMax;        // [A] I_MOT_MAX
+  int   iDcMax;         // [A] I_DC_MAX, current chopping
+  int   nMotMax;        // [rpm] N_MOT_MAX
+  int   ctrlModReq;     // [-] CTRL_MOD_REQ
+  int   ctrlTypFixed;   // [-] CTRL_TYP_SEL of a CTRL_TYP_FIXED build, -1 runtime-switchable
+} BuildConfig;
+
+void buildParams(P *p, BuildConfig *cfg);
+
+// Division-free call site 'site' of the controller against the generated division it replaces, over its whole
+// input range. Returns the number of mismatches, -1 past the last site
+long sweepDivisionFree(int site, const char **name, long *inputs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""
+Parameter profile tool for the Debug Serial Protocol (DEBUG_SERIAL_PROTOCOL).
+
+Transfers the whole parameter set as one CRC protected, versioned profile:
+    param_profile.py export /dev/ttyUSB0 robot.bin    read the parameters of a board into a file
+    param_profile.py import /dev/ttyUSB0 robot.bin    load a profile into a board and save it to EEPROM
+    param_profile.py show robot.bin                   print the content of a profile
+
+Profile format (little endian): version(u8) count(u8) layout(u16) value(i16) * count crc(u16)
+The layout is the CRC of the parameter names: a board only accepts a profile of the same parameter table.
+CRC: CRC-16/CCITT-FALSE. Requires pyserial.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+PROFILE_VERSION = 1
+CHUNK_SIZE      = 48        # [bytes] per IMPORT line, the line has to fit in the board Rx buffer (SERIAL_BUFFER_SIZE)
+
+
+def crc16(data, crc=0xFFFF):
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def check(blob):
+    if len(blob) < 6 or blob[0] != PROFILE_VERSION or len(blob) != 4 + 2 * blob[1] + 2:
+        raise ValueError("profile size or version invalid")
+    if crc16(blob[:-2]) != struct.unpack_from("<H", blob, len(blob) - 2)[0]:
+        raise ValueError("profile CRC invalid")
+    return blob
+
+
+def open_port(args):
+    import serial
+    port = serial.Serial(args.port, args.baud, timeout=args.timeout)
+    port.reset_input_buffer()
+    return port
+
+
+def request(port, line, expect):
+    """Send a command line and return the first answer line starting with one of expect"""
+    port.write(line.encode() + b"\r\n")
+    end = time.time() + port.timeout
+    while time.time() < end:
+        answer = port.readline().decode(errors="replace").strip()
+        if answer.startswith("!"):
+            raise RuntimeError("%s: %s" % (line, answer))
+        if answer.startswith(expect):
+            return answer
+    raise RuntimeError("%s: no answer" % line)
+
+
+def cmd_export(args):
+    port   = open_port(args)
+    answer = request(port, "$EXPORT", ("%",))
+    blob   = check(bytes.fromhex(answer[1:].strip()))
+    with open(args.file, "wb") as f:
+        f.write(blob)
+    print("exported %d parameters to %s" % (blob[1], args.file))
+
+
+def cmd_import(args):
+    with open(args.file, "rb") as f:
+        blob = check(f.read())
+    port = open_port(args)
+    for i in range(0, len(blob), CHUNK_SIZE):
+        port.write(b"$IMPORT " + blob[i:i + CHUNK_SIZE].hex().upper().encode() + b"\r\n")
+        time.sleep(0.05)            # one line per Rx idle event
+    request(port, "$IMPORT", ("OK",))
+    if not args.no_save:
+        request(port, "$SAVE", ("OK",))
+    print("imported %d parameters%s" % (blob[1], "" if args.no_save else " and saved to EEPROM"))
+
+
+def cmd_show(args):
+    with open(args.file, "rb") as f:
+        blob = check(f.read())
+    version, count, layout = struct.unpack_from("<BBH", blob)
+    print("version:%d parameters:%d layout:%04X" % (version, count, layout))
+    for i, value in enumerate(struct.unpack_from("<%dh" % count, blob, 4)):
+        print("%3d: %d" % (i, value))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub    = parser.add_subparsers(dest="cmd", required=True)
+    for name in ("export", "import"):
+        p = sub.add_parser(name)
+        p.add_argument("port")
+        p.add_argument("file")
+        p.add_argument("--baud", type=int, default=115200)
+        p.add_argument("--timeout", type=float, default=2.0)
+        if name == "import":
+            p.add_argument("--no-save", action="store_true", help="apply without saving to EEPROM")
+    p = sub.add_parser("show")
+    p.add_argument("file")
+    args = parser.parse_args()
+    try:
+        {"export": cmd_export, "import": cmd_import, "show": cmd_show}[args.cmd](args)
+    except (OSError, ValueError, RuntimeError) as e:
+        sys.exit("error: %s" % e)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,29 @@
+"""
+PlatformIO pre-build script of the BOOT_SLOT_A/B envs in platformio.ini, the counterpart of "make -e SLOT=A/B":
+links the firmware for a slot of the serial bootloader (flash layout in Inc/boot.h). The linker script is
+STM32F103RCTx_FLASH.ld with the flash origin and size of the slot, written to the build directory.
+"""
+
+import os
+import re
+
+Import("env")                                   # noqa: F821, provided by PlatformIO
+
+SLOT_SIZE = 0x1D000                             # BOOT_SLOT_SIZE
+SLOTS     = {"A": 0x08006000, "B": 0x08023000}  # BOOT_SLOT_A_ADDR, BOOT_SLOT_B_ADDR
+
+slot   = env.GetProjectOption("custom_boot_slot")
+origin = SLOTS[slot]
+
+with open(os.path.join(env.subst("$PROJECT_DIR"), "STM32F103RCTx_FLASH.ld")) as f:
+    script = f.read()
+script = re.sub(r"^FLASH \(rx\).*$", "FLASH (rx)      : ORIGIN = 0x%X, LENGTH = %dK" % (origin, SLOT_SIZE // 1024),
+                script, flags=re.M)
+build = env.subst("$BUILD_DIR")
+os.makedirs(build, exist_ok=True)
+ldscript = os.path.join(build, "slot.ld")
+with open(ldscript, "w") as f:
+    f.write(script)
+
+env.Append(CPPDEFINES=[("BOOT_SLOT", "AB".index(slot)), ("VECT_TAB_OFFSET", "0x%XU" % (origin - 0x08000000))],
+           LINKFLAGS=["-T" + ldscript])
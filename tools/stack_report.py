@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""
+Worst case stack usage per entry point, from the -fstack-usage frames (.su) and the call graph of the disassembly.
+
+    stack_report.py build/hover.elf build/*.su            (make stack)
+
+Entry points: main and every *_Handler / *_IRQHandler. The path with the largest sum of frames is reported, an
+interrupt adds the 32 byte exception frame. All interrupts run at priority 0 and do not nest, so the stack has to
+hold main plus the largest interrupt. Exit status 1 if that exceeds --stack.
+Not followed: indirect calls (function pointers, marked with '*') and functions without a .su frame (library
+assembly, marked with '?'). Recursion is reported and counted once.
+"""
+
+import argparse
+import re
+import subprocess
+import sys
+
+EXC_FRAME = 32                  # [bytes] registers stacked by the core on exception entry
+ENTRY     = re.compile(r"^(main|\w+_(IRQ)?Handler)$")
+FUNC      = re.compile(r"^[0-9a-f]+ <([^>]+)>:$")
+BRANCH    = re.compile(r"^\s*[0-9a-f]+:\s+(bl|blx|b|b\.w|b\.n|b[a-z]{2}\.w|b[a-z]{2}\.n|b[a-z]{2}|"
+                       r"call|callq|jmp|jmpq)\s+(.*)$")
+TARGET    = re.compile(r"<([^>+]+)>")
+INDIRECT  = re.compile(r"^(r\d+|ip|lr|\*.*)$")
+
+
+def read_frames(files):
+    frames = {}
+    for name in files:
+        with open(name) as f:
+            for line in f:
+                loc, size, _ = line.rstrip("\n").split("\t")
+                func = loc.rsplit(":", 1)[-1]
+                frames[func] = max(frames.get(func, 0), int(size))
+    return frames
+
+
+def read_calls(elf, objdump):
+    calls, indirect, recursive, func = {}, set(), set(), None
+    out = subprocess.run([objdump, "-d", "--no-show-raw-insn", elf], capture_output=True, text=True,
+                         check=True).stdout
+    for line in out.splitlines():
+        m = FUNC.match(line)
+        if m:
+            func = m.group(1)
+            calls.setdefault(func, set())
+            continue
+        m = BRANCH.match(line)
+        if not m or func is None:
+            continue
+        op = m.group(2).split(";")[0].strip()
+        if INDIRECT.match(op):
+            if m.group(1) in ("blx", "call", "callq"):
+                indirect.add(func)
+            continue
+        t = TARGET.search(op)
+        if t and t.group(1) != func:
+            calls[func].add(t.group(1))
+        elif t and m.group(1) in ("bl", "call", "callq"):
+            recursive.add(func)
+    return calls, indirect, recursive
+
+
+def worst(func, calls, frames, memo, active, notes):
+    if func in memo:
+        return memo[func]
+    if func in active:
+        notes.add("recursion in " + func)
+        return 0, []
+    active.add(func)
+    best, path = 0, []
+    for callee in calls.get(func, ()):
+        if callee not in calls:         # branch to a label of the same function (no symbol of its own)
+            continue
+        size, sub = worst(callee, calls, frames, memo, active, notes)
+        if size > best:
+            best, path = size, sub
+    active.discard(func)
+    memo[func] = (frames.get(func, 0) + best, [func] + path)
+    return memo[func]
+
+
+def label(func, frames, indirect):
+    mark = "*" if func in indirect else ""
+    return "%s(%s)%s" % (func, frames[func] if func in frames else "?", mark)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("elf")
+    ap.add_argument("su", nargs="+")
+    ap.add_argument("--objdump", default="arm-none-eabi-objdump")
+    ap.add_argument("--stack", type=lambda s: int(s, 0), default=0, help="reserved stack [bytes] (_Min_Stack_Size)")
+    args = ap.parse_args()
+
+    frames                     = read_frames(args.su)
+    calls, indirect, recursive = read_calls(args.elf, args.objdump)
+    memo, notes                = {}, set("recursion in " + f for f in recursive)
+    entries                    = sorted((f for f in calls if ENTRY.match(f)), key=lambda f: (f != "main", f))
+    if "main" not in calls:
+        sys.exit("no main in " + args.elf)
+
+    print("%-30s %8s  %s" % ("entry point", "[bytes]", "worst case path: function(frame), * indirect calls"))
+    isr_max, isr_name = 0, "-"
+    for e in entries:
+        size, path = worst(e, calls, frames, memo, set(), notes)
+        if e != "main":
+            size += EXC_FRAME
+            if size > isr_max:
+                isr_max, isr_name = size, e
+        print("%-30s %8d  %s" % (e, size, " > ".join(label(f, frames, indirect) for f in path)))
+    for n in sorted(notes):
+        print("note: " + n)
+
+    total = memo["main"][0] + isr_max
+    print("main + largest interrupt (%s): %d bytes" % (isr_name, total), end="")
+    if args.stack:
+        print(" of %d reserved" % args.stack, end="")
+    print()
+    return 1 if args.stack and total > args.stack else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())